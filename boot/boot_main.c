@@ -0,0 +1,101 @@
+/**
+ * @file
+ * @brief Resident bootloader: installs or rolls back application images and
+ * starts the application slot.
+ *
+ * Runs on the reset HSI clock, without the HAL and without interrupts. An
+ * image on trial is started under the independent watchdog, which cannot be
+ * stopped afterwards: the application keeps kicking it, so a hung or reset
+ * looping image uses up its trial boots and is rolled back.
+ *
+ * Built on its own, apart from the application project (from the
+ * repository root):
+ *     arm-none-eabi-gcc -mcpu=cortex-m3 -mthumb -Os -ffunction-sections \
+ *         -fdata-sections -DSTM32F103xB -Icore/inc \
+ *         -Iexternal_libs/STM32CubeF1_lite/Drivers/CMSIS/Include \
+ *         -Iexternal_libs/STM32CubeF1_lite/Drivers/CMSIS/Device/ST/STM32F1xx/Include \
+ *         -Tboot/STM32F103C8TX_BOOT.ld -Wl,--gc-sections --specs=nano.specs \
+ *         --specs=nosys.specs core/startup/startup_stm32f103c8tx.s \
+ *         boot/boot_main.c core/src/boot_control.c core/src/boot_port.c \
+ *         -o boot.elf
+ * Program boot.elf once with the debugger, then an application built with
+ * BOOT_DUAL_SLOT=1 and linked with STM32F103C8TX_SLOT.ld.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "boot_control.h"
+
+/** Definitions --------------------------------------------------- */
+#define IWDG_KEY_RELOAD             0xAAAA
+#define IWDG_KEY_ENABLE             0xCCCC
+#define IWDG_KEY_ACCESS             0x5555
+
+/** LSI (40 kHz) / 64 with the largest reload: about 6.5 s. */
+#define IWDG_PRESCALER_64           4
+#define IWDG_RELOAD                 0x0FFF
+
+/** Prototypes ---------------------------------------------------- */
+static void watchdog_start(void);
+static void start_application(void);
+
+/** Internal functions -------------------------------------------- */
+static void watchdog_start(void) {
+    IWDG->KR = IWDG_KEY_ENABLE;
+    IWDG->KR = IWDG_KEY_ACCESS;
+    IWDG->PR = IWDG_PRESCALER_64;
+    IWDG->RLR = IWDG_RELOAD;
+
+    while (IWDG->SR != 0) {
+    }
+
+    IWDG->KR = IWDG_KEY_RELOAD;
+}
+
+/**
+ * @brief Points the vector table at the application slot, loads its stack
+ * pointer and branches to its reset handler.
+ */
+static void start_application(void) {
+    const uint32_t *vectors = (const uint32_t *)BOOT_APP_ADDRESS;
+    void (*reset_handler)(void) = (void (*)(void))vectors[1];
+
+    SCB->VTOR = BOOT_APP_ADDRESS;
+    __DSB();
+    __set_MSP(vectors[0]);
+    reset_handler();
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Keeps the reset clock and vector table.
+ */
+void SystemInit(void) {
+}
+
+int main(void) {
+    boot_init();
+
+    switch (boot_run()) {
+        case BOOT_RUN_TRIAL: {
+            watchdog_start();
+            start_application();
+            break;
+        }
+        case BOOT_RUN_APP: {
+            start_application();
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+
+    /* Nothing to run, wait for the debugger */
+    while (true) {
+        __WFI();
+    }
+}
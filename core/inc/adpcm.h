@@ -0,0 +1,38 @@
+/**
+ * @file
+ * @brief IMA ADPCM block decoder and PDM bit stream modulator.
+ *
+ * Sounds are stored as independent blocks of ADPCM_BLOCK_SAMPLES 4-bit
+ * codes, each with a header holding the predictor and step index it starts
+ * from, so a block can be decoded alone and a sound can loop on any block.
+ * Block layout:
+ *   int16_t predictor (little endian), uint8_t step index, uint8_t 0,
+ *   ADPCM_BLOCK_SAMPLES / 2 bytes of codes, low nibble first.
+ */
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stdint.h>
+
+/** Definitions --------------------------------------------------- */
+#define ADPCM_BLOCK_SAMPLES         64
+#define ADPCM_HEADER_SIZE           4
+#define ADPCM_BLOCK_SIZE            (ADPCM_HEADER_SIZE + ADPCM_BLOCK_SAMPLES / 2)
+#define ADPCM_INDEX_MAX             88
+
+/** PDM bits per sample, sent as 16-bit words, most significant bit first. */
+#define ADPCM_PDM_OVERSAMPLING      64
+#define ADPCM_PDM_WORDS             (ADPCM_BLOCK_SAMPLES * ADPCM_PDM_OVERSAMPLING / 16)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    int16_t predictor;
+    uint8_t index;
+} adpcm_state_t;
+
+/** Public functions ---------------------------------------------- */
+int16_t adpcm_step(adpcm_state_t *state, uint8_t code);
+void adpcm_decode_block(const uint8_t *block, int16_t samples[ADPCM_BLOCK_SAMPLES]);
+void adpcm_decode_pdm(const uint8_t *block, uint16_t words[ADPCM_PDM_WORDS], uint16_t *error);
+
+#endif /* ADPCM_H */
@@ -0,0 +1,33 @@
+/**
+ * @file
+ * @brief Fixed-priority arbitration between drive command sources.
+ */
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+
+/** Types --------------------------------------------------------- */
+/** Command sources, highest priority first. Safety is the obstacle brake,
+ * posted from the control tick over the setpoint of the other sources. */
+typedef enum {
+    ARBITER_SOURCE_SAFETY = 0,
+    ARBITER_SOURCE_SERIAL,
+    ARBITER_SOURCE_RADIO,
+    ARBITER_SOURCE_AUTONOMOUS,
+    ARBITER_SOURCE_REMOTE,
+    ARBITER_SOURCE_COUNT,
+    ARBITER_SOURCE_NONE = ARBITER_SOURCE_COUNT,
+} arbiter_source_t;
+
+/** Public functions ---------------------------------------------- */
+void arbiter_init(void);
+void arbiter_post(arbiter_source_t source, const drive_setpoint_t *setpoint, uint32_t now);
+void arbiter_release(arbiter_source_t source);
+arbiter_source_t arbiter_select(uint32_t now, drive_setpoint_t *setpoint);
+arbiter_source_t arbiter_select_from(arbiter_source_t first, uint32_t now, drive_setpoint_t *setpoint);
+
+#endif /* ARBITER_H */
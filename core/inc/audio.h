@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @brief Sampled sound effects on the buzzer, streamed by DMA.
+ */
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "adpcm.h"
+
+/** Definitions --------------------------------------------------- */
+/** PDM bit rate, APB2 (36 MHz) / 128 at the full clock profile. */
+#define AUDIO_BIT_RATE_HZ           281250
+#define AUDIO_SAMPLE_RATE_HZ        (AUDIO_BIT_RATE_HZ / ADPCM_PDM_OVERSAMPLING)
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    AUDIO_SOUND_NONE = 0,
+    AUDIO_SOUND_HORN,
+    AUDIO_SOUND_ENGINE,
+    AUDIO_SOUND_REVERSE,
+    AUDIO_SOUND_COUNT,
+} audio_sound_t;
+
+/** Looping sound effect, made of whole ADPCM blocks. */
+typedef struct {
+    const uint8_t *blocks;
+    uint16_t block_count;
+} audio_clip_t;
+
+/** Variables ----------------------------------------------------- */
+/** Indexed by audio_sound_t, generated by tools/adpcm_encode.c. */
+extern const audio_clip_t audio_clips[AUDIO_SOUND_COUNT];
+
+/** Public functions ---------------------------------------------- */
+void audio_setup(void);
+void audio_retime(void);
+bool audio_play(audio_sound_t sound);
+
+#endif /* AUDIO_H */
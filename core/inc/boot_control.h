@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Dual-slot firmware update state, shared by the bootloader and the
+ * application.
+ *
+ * The dual-slot update is a build option, BOOT_DUAL_SLOT, off by default.
+ * The default build links the application at the start of the flash, up
+ * to the settings pages (STM32F103C8TX_FLASH.ld), without the bootloader
+ * and without the 'U' update request. A dual-slot build links it into the
+ * 26 KB slot (STM32F103C8TX_SLOT.ld), and the link fails if the image
+ * does not fit. The full application does not: optional features must be
+ * left out of such a build.
+ *
+ * Flash layout of a dual-slot build (1 KB pages, 64 KB part):
+ *   0x08000000  bootloader        6 KB
+ *   0x08001800  application slot  26 KB
+ *   0x08008000  staging slot      26 KB
+ *   0x0800E800  swap scratch      1 KB
+ *   0x0800EC00  update state      2 KB, two pages used as a record log
+ *   0x0800F400  settings          3 KB, owned by the application
+ *
+ * The application writes a new image into the staging slot and records it
+ * as pending once its CRC matches. On the next reset the bootloader swaps
+ * the two slots page by page through the scratch page, logging every step
+ * so an interrupted swap resumes where it stopped. The new image then runs
+ * on trial under the watchdog and must confirm itself; after
+ * BOOT_TRIAL_ATTEMPTS boots without confirmation the slots are swapped back.
+ *
+ * State records are 16 bytes, appended to the active state page. The valid
+ * record with the highest sequence number wins; a full page is continued on
+ * the other one after erasing it.
+ */
+#ifndef BOOT_CONTROL_H
+#define BOOT_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#ifndef BOOT_DUAL_SLOT
+#define BOOT_DUAL_SLOT              0
+#endif
+
+#define BOOT_PAGE_SIZE              1024
+#define BOOT_LOADER_ADDRESS         0x08000000
+#define BOOT_APP_ADDRESS            0x08001800
+#define BOOT_STAGING_ADDRESS        0x08008000
+#define BOOT_SLOT_SIZE              0x6800
+#define BOOT_SLOT_PAGES             (BOOT_SLOT_SIZE / BOOT_PAGE_SIZE)
+#define BOOT_SCRATCH_ADDRESS        0x0800E800
+#define BOOT_STATE_ADDRESS          0x0800EC00
+#define BOOT_STATE_PAGES            2
+#define BOOT_SETTINGS_ADDRESS       0x0800F400
+#define BOOT_SETTINGS_PAGES         3
+
+#define BOOT_RAM_ADDRESS            0x20000000
+#define BOOT_RAM_SIZE               (20 * 1024)
+
+/** Boots of an unconfirmed image before it is rolled back. */
+#define BOOT_TRIAL_ATTEMPTS         3
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    BOOT_STATE_CONFIRMED = 1,   /**< Application slot holds the accepted image */
+    BOOT_STATE_PENDING,         /**< Verified image in staging, swap on next boot */
+    BOOT_STATE_SWAPPING,        /**< Swap in progress, step is the progress */
+    BOOT_STATE_TRIAL,           /**< New image on trial, step counts its boots */
+    BOOT_STATE_REVERTING,       /**< Swap back in progress, step is the progress */
+} boot_state_t;
+
+typedef enum {
+    BOOT_RUN_APP,               /**< Jump to the application */
+    BOOT_RUN_TRIAL,             /**< Jump to the application under the watchdog */
+    BOOT_RUN_NONE,              /**< No bootable application, or a swap step failed until the next reset */
+} boot_run_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t step;
+    uint16_t sequence;
+    uint32_t size;              /**< Image size, in bytes */
+    uint32_t crc;               /**< Image CRC, STM32 CRC unit algorithm */
+    uint32_t check;
+} boot_record_t;
+
+/** Public functions ---------------------------------------------- */
+void boot_init(void);
+void boot_get_record(boot_record_t *record);
+
+bool boot_update_begin(uint32_t size, uint32_t crc);
+bool boot_update_write(uint32_t offset, const void *data, uint32_t size);
+bool boot_update_finish(void);
+void boot_confirm(void);
+
+bool boot_app_valid(void);
+boot_run_t boot_run(void);
+
+/**
+ * @brief Flash access, provided by the platform (flash controller and CRC
+ * unit on the target, a simulated flash on the host). Programmed sizes are
+ * multiples of 4 bytes.
+ */
+bool boot_flash_erase(uint32_t address);
+bool boot_flash_program(uint32_t address, const void *data, uint32_t size);
+void boot_flash_read(uint32_t address, void *data, uint32_t size);
+uint32_t boot_flash_crc(uint32_t address, uint32_t size);
+
+#endif /* BOOT_CONTROL_H */
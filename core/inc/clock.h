@@ -0,0 +1,36 @@
+/**
+ * @file
+ * @brief System clock profiles.
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    CLOCK_PROFILE_FULL = 0,     /**< HSE x9 PLL, 72 MHz */
+    CLOCK_PROFILE_REDUCED,      /**< HSE x3 PLL, 24 MHz */
+    CLOCK_PROFILE_HSI,          /**< Internal RC, 8 MHz, HSE and PLL off */
+    CLOCK_PROFILE_COUNT,
+} clock_profile_t;
+
+typedef struct {
+    uint8_t profile;                            /**< Current clock_profile_t */
+    uint8_t reserved[3];
+    uint32_t hclk_hz;
+    uint32_t switches;
+    uint32_t switch_us[CLOCK_PROFILE_COUNT];    /**< Latency of the last switch into each profile */
+} clock_stats_t;
+
+/** Public functions ---------------------------------------------- */
+void clock_setup(void);
+bool clock_set_profile(clock_profile_t profile);
+clock_profile_t clock_get_profile(void);
+uint32_t clock_timer_frequency(const TIM_TypeDef *instance);
+void clock_get_stats(clock_stats_t *stats);
+
+#endif /* CLOCK_H */
@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @brief Per-channel motor compensation from requested effort to duty.
+ *
+ * Each bridge channel (one wheel in one direction) maps an effort magnitude
+ * through three stages:
+ *   duty = deadband + (1000 - deadband) * gain * lut(effort) / 1000
+ * deadband is the largest duty that does not move the wheel, gain trims the
+ * top speed to match the other wheel, and the LUT is a piecewise linear
+ * curve through COMPENSATION_LUT_POINTS evenly spaced efforts (0 to 1000 in
+ * 125 steps) that straightens the speed response.
+ */
+#ifndef COMPENSATION_H
+#define COMPENSATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+
+/** Definitions --------------------------------------------------- */
+#define COMPENSATION_MAGIC          0x31504D43  /* "CMP1" */
+#define COMPENSATION_LUT_POINTS     9
+#define COMPENSATION_GAIN_ONE       32768       /* Q15 */
+#define COMPENSATION_LUT_MAX        1000
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint16_t deadband;      /**< Duty below which the wheel does not move */
+    uint16_t gain;          /**< Q15 trim of the span above the deadband */
+    uint16_t lut[COMPENSATION_LUT_POINTS];  /**< 0 to COMPENSATION_LUT_MAX */
+} compensation_channel_t;
+
+/**
+ * @brief Calibration measurement: drives one channel at a raw duty, through
+ * the drive logic, until the speed settles and returns the encoder counts
+ * of a fixed window.
+ */
+typedef uint32_t (*compensation_measure_t)(drive_channel_t channel, uint16_t duty);
+
+/** Stored calibration, as laid out in flash. */
+typedef struct {
+    uint32_t magic;
+    compensation_channel_t channel[DRIVE_CHANNEL_COUNT];
+    uint32_t crc;           /**< STM32 CRC unit algorithm up to this field */
+} compensation_record_t;
+
+/** Public functions ---------------------------------------------- */
+void compensation_init(const compensation_channel_t channels[DRIVE_CHANNEL_COUNT]);
+void compensation_get(compensation_channel_t channels[DRIVE_CHANNEL_COUNT]);
+uint16_t compensation_apply(drive_channel_t channel, uint16_t effort);
+bool compensation_calibrate(compensation_measure_t measure, compensation_channel_t channels[DRIVE_CHANNEL_COUNT]);
+
+#endif /* COMPENSATION_H */
@@ -0,0 +1,23 @@
+/**
+ * @file
+ * @brief Serial console on USART1.
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Public functions ---------------------------------------------- */
+void console_setup(void);
+void console_retime(void);
+bool console_read(uint8_t *byte);
+bool console_read_block(void *data, uint16_t size, uint32_t timeout_ms);
+void console_write(const void *data, uint16_t size);
+
+void console_stream_start(uint8_t *buffer, uint16_t size);
+uint16_t console_stream_position(void);
+bool console_stream_overrun(void);
+void console_stream_stop(void);
+
+#endif /* CONSOLE_H */
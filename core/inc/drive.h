@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Drive commands to motor/buzzer output mapping.
+ */
+#ifndef DRIVE_H
+#define DRIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "infrared.h"
+#include "buzzer.h"
+
+/** Definitions --------------------------------------------------- */
+#define DRIVE_PWM_DUTY      700     /* Remote key effort, default of the parameter */
+#define DRIVE_EFFORT_MAX    1000    /* Full duty, in CCR counts */
+#define DRIVE_PWM_TOP       DRIVE_EFFORT_MAX    /* Top of the center aligned PWM counter */
+
+#define DRIVE_REVERSE_DWELL_MS  50  /* Brake time before a wheel reverses */
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    DRIVE_CHANNEL_1 = 0,
+    DRIVE_CHANNEL_2,
+    DRIVE_CHANNEL_3,
+    DRIVE_CHANNEL_4,
+    DRIVE_CHANNEL_COUNT,
+} drive_channel_t;
+
+/** Bridge state for a wheel with no effort requested. */
+typedef enum {
+    DRIVE_STOP_COAST = 0,   /**< Both inputs low, the wheel freewheels */
+    DRIVE_STOP_BRAKE,       /**< Both inputs high, the motor is shorted */
+} drive_stop_t;
+
+/** Bridge state during the PWM off time. */
+typedef enum {
+    DRIVE_DECAY_FAST = 0,   /**< Off time coasts, current returns to the supply */
+    DRIVE_DECAY_SLOW,       /**< Off time brakes, current recirculates */
+} drive_decay_t;
+
+typedef struct {
+    drive_stop_t stop;
+    drive_decay_t decay;
+    uint16_t reverse_dwell_ms;
+} drive_config_t;
+
+typedef struct {
+    int16_t left;       /**< Left wheel effort, positive forward */
+    int16_t right;      /**< Right wheel effort, positive forward */
+    buzzer_note_t note;
+} drive_setpoint_t;
+
+typedef struct {
+    uint16_t ccr[DRIVE_CHANNEL_COUNT];
+    buzzer_note_t note;
+} drive_output_t;
+
+/** Public functions ---------------------------------------------- */
+void drive_init(const drive_config_t *config);
+void drive_set_stop(drive_stop_t stop);
+void drive_key(ir_key_id_t key, drive_setpoint_t *setpoint);
+void drive_wheels(int16_t left, int16_t right, drive_setpoint_t *setpoint);
+void drive_twist(int16_t linear, int16_t angular, drive_setpoint_t *setpoint);
+void drive_output(const drive_setpoint_t *setpoint, uint32_t now, drive_output_t *output);
+void drive_interleave(const drive_output_t *output, uint16_t compare[DRIVE_CHANNEL_COUNT]);
+
+#endif /* DRIVE_H */
@@ -0,0 +1,14 @@
+/**
+ * @file
+ * @brief Wheel quadrature encoders on timers in encoder mode.
+ */
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+/** Public functions ---------------------------------------------- */
+void encoder_setup(void);
+void encoder_read(int16_t *left_counts, int16_t *right_counts);
+
+#endif /* ENCODER_H */
@@ -0,0 +1,135 @@
+/**
+ * @file
+ * @brief Fixed-point types, saturating arithmetic and approximations.
+ *
+ * q15_t and q31_t hold fractions in [-1, 1), q16_t holds 16.16 values for
+ * gains and ratios. Angles are q31_t semicircles: INT32_MIN..INT32_MAX maps to
+ * -pi..pi, so they wrap around naturally on overflow.
+ *
+ * The arithmetic helpers are inline so they cost a few instructions each. On
+ * cores with the saturation instructions (Cortex-M3 and up) the clamps are a
+ * single SSAT/USAT, elsewhere they fall back to plain C.
+ */
+#ifndef FIXMATH_H
+#define FIXMATH_H
+
+#include <stdint.h>
+
+/** Definitions --------------------------------------------------- */
+#define Q15_ONE             32767
+#define Q31_ONE             INT32_MAX
+#define Q16_ONE             65536
+
+/** Angle, in q31_t semicircles, of a turn fraction. */
+#define FIX_ANGLE_QUARTER   ((q31_t)0x40000000)
+
+/** Converts a constant to fixed-point, rounding to nearest. Compile time only. */
+#define Q15(x)              ((q15_t)((x) >= 1.0 ? Q15_ONE : (x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#define Q16(x)              ((q16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/** Types --------------------------------------------------------- */
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int32_t q16_t;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Saturates to the q15_t range.
+ */
+static inline q15_t fix_sat_q15(int32_t value) {
+#if defined(__ARM_FEATURE_SAT)
+    __asm__ ("ssat %0, #16, %1" : "=r" (value) : "r" (value));
+    return (q15_t)value;
+#else
+    return (q15_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value);
+#endif
+}
+
+/**
+ * @brief Saturates to 0..UINT16_MAX, e.g. for timer compare values.
+ */
+static inline uint16_t fix_sat_u16(int32_t value) {
+#if defined(__ARM_FEATURE_SAT)
+    __asm__ ("usat %0, #16, %1" : "=r" (value) : "r" (value));
+    return (uint16_t)value;
+#else
+    return (uint16_t)(value > UINT16_MAX ? UINT16_MAX : value < 0 ? 0 : value);
+#endif
+}
+
+/**
+ * @brief Saturates a 64-bit intermediate to the q31_t range.
+ */
+static inline q31_t fix_sat_q31(int64_t value) {
+    return (q31_t)(value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : value);
+}
+
+static inline q15_t q15_add(q15_t a, q15_t b) {
+    return fix_sat_q15((int32_t)a + b);
+}
+
+static inline q15_t q15_sub(q15_t a, q15_t b) {
+    return fix_sat_q15((int32_t)a - b);
+}
+
+/**
+ * @brief Rounded Q15 product. Only -1 * -1 saturates.
+ */
+static inline q15_t q15_mul(q15_t a, q15_t b) {
+    return fix_sat_q15(((int32_t)a * b + (1 << 14)) >> 15);
+}
+
+/**
+ * @brief Multiply-accumulate into a Q30 accumulator (MLA).
+ *
+ * Accumulate unscaled and convert once with q15_from_acc(), so rounding
+ * happens a single time per sum. Up to 2^15 full scale terms fit.
+ */
+static inline int64_t q15_mac(int64_t accumulator, q15_t a, q15_t b) {
+    return accumulator + (int32_t)a * b;
+}
+
+static inline q15_t q15_from_acc(int64_t accumulator) {
+    return fix_sat_q15((int32_t)fix_sat_q31((accumulator + (1 << 14)) >> 15));
+}
+
+static inline q31_t q31_add(q31_t a, q31_t b) {
+    return fix_sat_q31((int64_t)a + b);
+}
+
+static inline q31_t q31_sub(q31_t a, q31_t b) {
+    return fix_sat_q31((int64_t)a - b);
+}
+
+/**
+ * @brief Rounded Q31 product (SMULL).
+ */
+static inline q31_t q31_mul(q31_t a, q31_t b) {
+    return fix_sat_q31(((int64_t)a * b + (1LL << 30)) >> 31);
+}
+
+/**
+ * @brief Multiply-accumulate into a Q62 accumulator (SMLAL).
+ */
+static inline int64_t q31_mac(int64_t accumulator, q31_t a, q31_t b) {
+    return accumulator + (int64_t)a * b;
+}
+
+static inline q31_t q31_from_acc(int64_t accumulator) {
+    return fix_sat_q31((accumulator + (1LL << 30)) >> 31);
+}
+
+/**
+ * @brief Scales a value by a 16.16 gain, rounding and saturating.
+ */
+static inline int32_t q16_scale(int32_t value, q16_t gain) {
+    return fix_sat_q31(((int64_t)value * gain + (1 << 15)) >> 16);
+}
+
+q15_t fix_sin(q31_t angle);
+q15_t fix_cos(q31_t angle);
+q16_t fix_recip(q16_t value);
+uint16_t fix_isqrt(uint32_t value);
+q16_t fix_sqrt(q16_t value);
+
+#endif /* FIXMATH_H */
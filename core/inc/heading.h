@@ -0,0 +1,51 @@
+/**
+ * @file
+ * @brief Gyro heading hold for straight driving.
+ */
+#ifndef HEADING_H
+#define HEADING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+#include "fixmath.h"
+#include "imu.h"
+
+/** Definitions --------------------------------------------------- */
+/** Loop gains, in effort counts per degree, per deg/s and per degree second.
+ * Defaults of the parameters (see param.h). */
+#define HEADING_KP                  20
+#define HEADING_KD                  4
+#define HEADING_KI                  20
+
+/** Largest correction, kept below the turn threshold of the lights. */
+#define HEADING_TRIM_MAX            150
+
+/** Stopped time before the gyro bias is learnt, the car may still roll. */
+#define HEADING_SETTLE_SAMPLES      (IMU_RATE_HZ / 2)
+#define HEADING_BIAS_SHIFT          6       /* Bias filter, 2^6 samples */
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    HEADING_MODE_REST = 0,      /**< Stopped, the gyro bias is learnt */
+    HEADING_MODE_FREE,          /**< Turning, the heading is only tracked */
+    HEADING_MODE_HOLD,          /**< Driving straight, the heading is held */
+} heading_mode_t;
+
+typedef struct {
+    q31_t heading;              /**< Counter-clockwise, semicircles */
+    int32_t bias_q8;            /**< Gyro bias, in Q8 LSB */
+    int16_t trim;               /**< Effort moved from the left to the right wheel */
+    uint8_t mode;
+    uint8_t reserved;
+} heading_state_t;
+
+/** Public functions ---------------------------------------------- */
+void heading_init(void);
+void heading_update(int16_t rate);
+void heading_lost(void);
+void heading_hold(drive_setpoint_t *setpoint);
+void heading_get(heading_state_t *state);
+
+#endif /* HEADING_H */
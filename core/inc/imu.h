@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @brief MPU6050 gyro sampling, as a non-blocking bus state machine.
+ *
+ * imu_tick() runs at IMU_RATE_HZ from a timer interrupt. Every tick picks
+ * up the result of the transfer started on the previous one and starts the
+ * next, so no call ever waits on the bus: the driver resets the device,
+ * checks its identity, writes the configuration one register per tick,
+ * then reads the yaw rate on every tick. A failed transfer is retried;
+ * after IMU_RETRY_LIMIT failures in a row, or a transfer still running
+ * after IMU_TIMEOUT_TICKS, the bus is recovered and the sequence restarts.
+ *
+ * The transfers themselves are provided by the platform (I2C2 with DMA on
+ * the target, a simulated sensor on the host).
+ */
+#ifndef IMU_H
+#define IMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define IMU_RATE_HZ                 200
+#define IMU_I2C_ADDRESS             0x68    /* AD0 low */
+#define IMU_WHO_AM_I_VALUE          0x68
+
+#define IMU_REG_SMPLRT_DIV          0x19
+#define IMU_REG_CONFIG              0x1A
+#define IMU_REG_GYRO_CONFIG         0x1B
+#define IMU_REG_GYRO_ZOUT_H         0x47
+#define IMU_REG_PWR_MGMT_1          0x6B
+#define IMU_REG_WHO_AM_I            0x75
+
+#define IMU_PWR_DEVICE_RESET        0x80
+#define IMU_PWR_CLOCK_PLL_X         0x01
+#define IMU_CONFIG_DLPF_44HZ        0x03    /* Gyro output rate 1 kHz */
+#define IMU_GYRO_FS_250DPS          0x00
+
+/** Gyro sensitivity at +-250 deg/s, in LSB per deg/s. */
+#define IMU_GYRO_LSB_PER_DPS        131
+
+#define IMU_RESET_TICKS             (100 * IMU_RATE_HZ / 1000)  /* Device reset time */
+#define IMU_START_TICKS             (50 * IMU_RATE_HZ / 1000)   /* Gyro start up time */
+#define IMU_TIMEOUT_TICKS           2
+#define IMU_RETRY_LIMIT             3
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    IMU_STATE_RESET = 0,
+    IMU_STATE_WAIT,
+    IMU_STATE_IDENTIFY,
+    IMU_STATE_CONFIGURE,
+    IMU_STATE_RUN,
+} imu_state_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t errors;        /**< Failed transfers and wrong identities */
+    uint32_t timeouts;      /**< Transfers still running after IMU_TIMEOUT_TICKS */
+    uint32_t resets;        /**< Bus recoveries */
+    uint8_t state;
+    uint8_t reserved[3];
+} imu_stats_t;
+
+/** Public functions ---------------------------------------------- */
+void imu_init(void);
+bool imu_tick(int16_t *rate);
+bool imu_busy(void);
+void imu_get_stats(imu_stats_t *stats);
+
+/**
+ * @brief Called by the platform when the transfer started last completes.
+ *
+ * @param ok    false on a NACK or bus error.
+ */
+void imu_bus_done(bool ok);
+
+/**
+ * @brief Bus access, provided by the platform. Transfers start and return
+ * at once, and end with a call to imu_bus_done(), unless they fail to
+ * start (false returned).
+ */
+void imu_bus_setup(void);
+void imu_bus_retime(void);
+bool imu_bus_write(uint8_t reg, uint8_t value);
+bool imu_bus_read(uint8_t reg, uint8_t *data, uint8_t size);
+void imu_bus_recover(void);
+
+#endif /* IMU_H */
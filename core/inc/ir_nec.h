@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Edge driven NEC infrared frame decoder.
+ *
+ * The decoder only consumes pulse durations, so it has no hardware
+ * dependencies and can be fed with recorded or generated edges on the host.
+ *
+ * An address filter lets several cars share a room: every car accepts its
+ * own address, its group address and IR_NEC_BROADCAST_ADDRESS. A frame for
+ * any other address is given up right after its address byte.
+ */
+#ifndef IR_NEC_H
+#define IR_NEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "infrared.h"
+
+/** Definitions --------------------------------------------------- */
+#define IR_NEC_LEADER_MARK_US       9000
+#define IR_NEC_LEADER_SPACE_US      4500
+#define IR_NEC_REPEAT_SPACE_US      2250
+#define IR_NEC_BIT_MARK_US          562
+#define IR_NEC_ZERO_SPACE_US        562
+#define IR_NEC_ONE_SPACE_US         1687
+#define IR_NEC_FRAME_BITS           32
+#define IR_NEC_ADDRESS_BITS         16      /* Address and its inverse */
+
+#define IR_NEC_BROADCAST_ADDRESS    0xFF
+#define IR_NEC_ADDRESS_WORDS        (256 / 32)
+
+/** Longest remainder of a frame after its address bits: command bits, all
+ * ones, and the stop mark. */
+#define IR_NEC_SKIP_US              ((IR_NEC_FRAME_BITS - IR_NEC_ADDRESS_BITS) \
+                                     * (IR_NEC_BIT_MARK_US + IR_NEC_ONE_SPACE_US) + IR_NEC_BIT_MARK_US)
+
+/** Returned for commands that are not a digit key. */
+#define IR_NEC_DIGIT_NONE           (-1)
+
+#define IR_NEC_DEFAULT_GLITCH_US            150
+#define IR_NEC_DEFAULT_TOLERANCE_PERCENT    25
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    IR_NEC_EVENT_NONE = 0,
+    IR_NEC_EVENT_FRAME,
+    IR_NEC_EVENT_REPEAT,
+    IR_NEC_EVENT_FOREIGN,           /**< Frame for another address, its remainder is ignored */
+} ir_nec_event_t;
+
+typedef struct {
+    uint16_t glitch_us;             /**< Shorter pulses are merged into their neighbours, 0 disables */
+    uint8_t tolerance_percent;      /**< Accepted deviation from the nominal durations */
+} ir_nec_config_t;
+
+typedef struct {
+    uint32_t accepted;              /**< Frames that passed every check */
+    uint32_t repeats;               /**< Repeat codes */
+    uint32_t rejected_timing;       /**< Frames aborted by an out-of-window pulse */
+    uint32_t rejected_inverse;      /**< Frames with a bad address/command inverse */
+    uint32_t rejected_address;      /**< Frames for another address */
+    uint32_t glitches;              /**< Pulses removed by the glitch filter */
+    uint32_t rejected_repeats;      /**< Repeat codes following a foreign frame */
+} ir_nec_stats_t;
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+} ir_nec_window_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t bit_count;
+    uint32_t data;
+    uint8_t address;
+    uint8_t command;
+
+    bool filtering;
+    bool addressed;                 /**< Last frame was accepted, repeats apply */
+    uint32_t accept[IR_NEC_ADDRESS_WORDS];
+
+    uint16_t glitch_us;
+    ir_nec_window_t leader_mark;
+    ir_nec_window_t leader_space;
+    ir_nec_window_t repeat_space;
+    ir_nec_window_t bit_mark;
+    ir_nec_window_t zero_space;
+    ir_nec_window_t one_space;
+
+    bool pending;
+    bool pending_mark;
+    bool merge_next;
+    uint32_t pending_us;
+
+    ir_nec_stats_t stats;
+} ir_nec_t;
+
+/** Public functions ---------------------------------------------- */
+void ir_nec_init(ir_nec_t *decoder, const ir_nec_config_t *config);
+void ir_nec_set_addresses(ir_nec_t *decoder, const uint8_t *addresses, uint8_t count);
+ir_nec_event_t ir_nec_feed(ir_nec_t *decoder, bool mark, uint32_t duration_us);
+ir_key_id_t ir_nec_key(uint8_t command);
+int8_t ir_nec_digit(uint8_t command);
+
+#endif /* IR_NEC_H */
@@ -0,0 +1,35 @@
+/**
+ * @file
+ * @brief Infrared receiver: edge capture feeding the NEC decoder.
+ */
+#ifndef IR_RECEIVER_H
+#define IR_RECEIVER_H
+
+#include <stdint.h>
+
+#include "infrared.h"
+#include "ir_nec.h"
+
+/** Definitions --------------------------------------------------- */
+#define IR_ADDRESS_MAGIC            0x31524441  /* "ADR1" */
+
+/** Types --------------------------------------------------------- */
+/** Stored address assignment, as laid out in flash. */
+typedef struct {
+    uint32_t magic;
+    uint8_t unit;
+    uint8_t group;
+    uint16_t reserved;
+    uint32_t crc;           /**< STM32 CRC unit algorithm up to this field */
+} ir_address_record_t;
+
+/** Public functions ---------------------------------------------- */
+void ir_receiver_setup(void);
+void ir_receiver_set_addresses(uint8_t unit, uint8_t group);
+void ir_receiver_accept_all(void);
+void ir_receiver_tick(void);
+ir_key_id_t ir_receiver_get_key(void);
+int8_t ir_receiver_take_digit(void);
+void ir_receiver_get_stats(ir_nec_stats_t *stats);
+
+#endif /* IR_RECEIVER_H */
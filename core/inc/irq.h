@@ -0,0 +1,102 @@
+/**
+ * @file
+ * @brief Interrupt priority map and ISR latency profiler.
+ *
+ * Every NVIC priority in the firmware comes from this map. With priority
+ * group 2, the upper two bits are the preemption level and the lower two
+ * the order among pending interrupts of the same level:
+ *
+ *   0  IR receiver edges, timestamped in software at entry
+ *   1  Console RX, one byte every 87 us without a FIFO
+ *   2  PWM update (odometry, gyro, strip and radio slots), ultrasonic
+ *      capture, gyro I2C/DMA, radio IRQ line and SPI DMA: all buffered,
+ *      hardware timestamped or clock stretched, they tolerate jitter
+ *   3  SysTick, audio refill (a block of slack, about 15 ms)
+ *
+ * With IRQ_PROFILE set, handlers record entry latency, where the hardware
+ * holds the raise time, and duration, both in DWT cycles. Durations include
+ * time spent in preempting handlers. The dump layout is shared with the host
+ * report tool (tools/irq_report.c).
+ */
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+/** Definitions --------------------------------------------------- */
+#define IRQ_PRIORITY_GROUPING       NVIC_PRIORITYGROUP_2
+
+#define IRQ_PREEMPT_IR_RX           0
+#define IRQ_SUB_IR_RX               0
+#define IRQ_PREEMPT_CONSOLE         1
+#define IRQ_SUB_CONSOLE             0
+#define IRQ_PREEMPT_PWM             2
+#define IRQ_SUB_PWM                 0
+#define IRQ_PREEMPT_ULTRASONIC      2
+#define IRQ_SUB_ULTRASONIC          2
+#define IRQ_PREEMPT_IMU             2   /* Same level as PWM, see imu.h */
+#define IRQ_SUB_IMU                 3
+#define IRQ_PREEMPT_RADIO           2   /* Same level as PWM, see radio.h */
+#define IRQ_SUB_RADIO               3
+#define IRQ_PREEMPT_SYSTICK         3   /* Must match TICK_INT_PRIORITY */
+#define IRQ_SUB_SYSTICK             0
+#define IRQ_PREEMPT_AUDIO           3
+#define IRQ_SUB_AUDIO               1
+
+#ifndef IRQ_PROFILE
+#define IRQ_PROFILE                 0
+#endif
+
+#define IRQ_PROFILE_MAGIC           0x31515249  /* "IRQ1" */
+#define IRQ_LATENCY_UNKNOWN         UINT32_MAX
+
+#if IRQ_PROFILE
+#define IRQ_PROFILE_ENTER(id, latency)  uint32_t irq_profile_start = irq_profile_enter((id), (latency))
+#define IRQ_PROFILE_EXIT(id)            irq_profile_exit((id), irq_profile_start)
+#else
+#define IRQ_PROFILE_ENTER(id, latency)  do { } while (0)
+#define IRQ_PROFILE_EXIT(id)            do { } while (0)
+#endif
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    IRQ_ID_IR_RX = 0,
+    IRQ_ID_CONSOLE,
+    IRQ_ID_PWM,
+    IRQ_ID_ULTRASONIC,
+    IRQ_ID_SYSTICK,
+    IRQ_ID_AUDIO,
+    IRQ_ID_IMU,
+    IRQ_ID_RADIO,
+    IRQ_ID_COUNT,
+} irq_id_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t preempt;
+    uint8_t sub;
+    uint8_t reserved;
+    uint32_t count;
+    uint32_t latency_count;     /**< Entries with a known raise time */
+    uint32_t latency_max;       /**< Cycles from raise to handler entry */
+    uint32_t duration_max;      /**< Cycles from entry to exit */
+    uint32_t reserved2;
+    uint64_t duration_total;
+} irq_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t record_size;
+    uint16_t record_count;
+    uint32_t hclk_hz;
+    uint32_t elapsed_ms;        /**< Since the statistics were reset */
+} irq_header_t;
+
+/** Public functions ---------------------------------------------- */
+void irq_setup(void);
+uint32_t irq_profile_enter(irq_id_t id, uint32_t latency);
+void irq_profile_exit(irq_id_t id, uint32_t start);
+void irq_profile_reset(void);
+void irq_profile_dump(void);
+
+#endif /* IRQ_H */
@@ -0,0 +1,25 @@
+/**
+ * @file
+ * @brief WS2812 LED strip on SPI2, sent by DMA.
+ */
+#ifndef LED_STRIP_H
+#define LED_STRIP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lights.h"
+
+/** Definitions --------------------------------------------------- */
+/** SPI bit rate window, 3 SPI bits make one WS2812 bit of 0.9 to 1.5 us. */
+#define LED_STRIP_BIT_RATE_MIN_HZ   2000000
+#define LED_STRIP_BIT_RATE_MAX_HZ   3400000
+
+/** Public functions ---------------------------------------------- */
+void led_strip_setup(void);
+void led_strip_retime(void);
+bool led_strip_show(const lights_frame_t frame);
+void led_strip_start(void);
+void led_strip_release(void);
+
+#endif /* LED_STRIP_H */
@@ -0,0 +1,60 @@
+/**
+ * @file
+ * @brief Car lights on a WS2812 strip: frames from the drive state and
+ * their SPI bit encoding.
+ */
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+
+/** Definitions --------------------------------------------------- */
+/** SPI bits per WS2812 bit: 100 for a zero, 110 for a one. */
+#define LIGHTS_SPI_BITS             3
+#define LIGHTS_BITS_PER_LED         24
+#define LIGHTS_FRAME_SIZE           (LIGHTS_LED_COUNT * LIGHTS_BITS_PER_LED * LIGHTS_SPI_BITS / 8)
+
+#define LIGHTS_BLINK_MS             350     /* Indicator on and off times */
+#define LIGHTS_SWEEP_MS             60      /* Start up sweep step */
+#define LIGHTS_TURN_THRESHOLD       200     /* Wheel effort difference of a turn */
+
+/** Types --------------------------------------------------------- */
+/** Strip order, the front of the car first then around the back. */
+typedef enum {
+    LIGHTS_LED_FRONT_LEFT_INDICATOR = 0,
+    LIGHTS_LED_FRONT_LEFT_HEAD,
+    LIGHTS_LED_FRONT_RIGHT_HEAD,
+    LIGHTS_LED_FRONT_RIGHT_INDICATOR,
+    LIGHTS_LED_REAR_RIGHT_INDICATOR,
+    LIGHTS_LED_REAR_RIGHT_TAIL,
+    LIGHTS_LED_REAR_LEFT_TAIL,
+    LIGHTS_LED_REAR_LEFT_INDICATOR,
+    LIGHTS_LED_COUNT,
+} lights_led_t;
+
+/** One LED, in the order the WS2812 shifts it in. */
+typedef struct {
+    uint8_t green;
+    uint8_t red;
+    uint8_t blue;
+} lights_color_t;
+
+typedef lights_color_t lights_frame_t[LIGHTS_LED_COUNT];
+
+/** Precomputed effect, overlaid on the lamps: black LEDs are left alone. */
+typedef struct {
+    const lights_frame_t *frames;
+    uint8_t frame_count;
+    uint16_t step_ms;
+    bool loop;
+} lights_pattern_t;
+
+/** Public functions ---------------------------------------------- */
+void lights_init(uint32_t now);
+void lights_frame(const drive_setpoint_t *setpoint, bool braking, uint32_t now, lights_frame_t frame);
+void lights_encode(const lights_frame_t frame, uint8_t buffer[LIGHTS_FRAME_SIZE]);
+
+#endif /* LIGHTS_H */
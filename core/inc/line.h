@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief Line following from a reflectance sensor array.
+ */
+#ifndef LINE_H
+#define LINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+#include "fixmath.h"
+
+/** Definitions --------------------------------------------------- */
+#define LINE_SENSOR_COUNT           4
+#define LINE_SCAN_DEPTH             8       /* Scans averaged per step */
+#define LINE_SAMPLE_COUNT           (LINE_SENSOR_COUNT * LINE_SCAN_DEPTH)
+#define LINE_RATE_HZ                500
+
+/** Smallest spread between the darkest and the lightest sensor, in ADC
+ * counts, for the line to be seen. */
+#define LINE_CONTRAST_MIN           300
+
+/** Steering gains, in effort counts per unit of position (the outer sensor
+ * is 1), per unit/s and per unit second. Defaults of the parameters (see
+ * param.h). */
+#define LINE_KP                     700
+#define LINE_KD                     12
+#define LINE_KI                     300
+#define LINE_INTEGRAL_MAX           200     /* Effort counts */
+#define LINE_STEER_MAX              DRIVE_EFFORT_MAX
+
+/** Effort on a straight line; halved with the line under an outer sensor.
+ * Default of the parameter. */
+#define LINE_BASE_EFFORT            600
+
+/** The car keeps steering for the last position seen this long, then
+ * stops. */
+#define LINE_SEARCH_STEPS           (LINE_RATE_HZ / 2)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    q15_t position;             /**< Line position, positive to the right */
+    int16_t steer;              /**< Effort moved from the right to the left wheel */
+    uint16_t contrast;          /**< Darkest minus lightest sensor, in ADC counts */
+    uint16_t lost_steps;        /**< Steps since the line was last seen */
+    uint32_t lost;              /**< Times the line was lost */
+} line_state_t;
+
+/** Public functions ---------------------------------------------- */
+void line_init(void);
+bool line_estimate(const volatile uint16_t samples[LINE_SAMPLE_COUNT], q15_t *position, uint16_t *contrast);
+void line_step(const volatile uint16_t samples[LINE_SAMPLE_COUNT], drive_setpoint_t *setpoint);
+void line_get_state(line_state_t *state);
+
+#endif /* LINE_H */
@@ -0,0 +1,20 @@
+/**
+ * @file
+ * @brief Reflectance sensor array, scanned by ADC1 into a DMA buffer.
+ */
+#ifndef LINE_SENSOR_H
+#define LINE_SENSOR_H
+
+#include <stdint.h>
+
+#include "line.h"
+
+/** Definitions --------------------------------------------------- */
+#define LINE_SENSOR_ADC_CLOCK_MAX_HZ    14000000
+
+/** Public functions ---------------------------------------------- */
+void line_sensor_setup(void);
+void line_sensor_retime(void);
+const volatile uint16_t *line_sensor_samples(void);
+
+#endif /* LINE_SENSOR_H */
@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @brief Deferred binary logging: call sites store a site ID and raw
+ * argument words, formatting is done on the host.
+ *
+ * LOG() places "file:line: format" in the .log_sites section, which the
+ * linker script keeps in the ELF but never loads (INFO, at address 0), so
+ * the strings cost no flash and the site ID is the string offset, a link
+ * time constant. Up to LOG_ARGS_MAX integer arguments are stored as 32-bit
+ * words; the format may only use integer conversions.
+ *
+ * Entries go into a RAM ring of words, reserved with a compare and swap on
+ * the head and committed by writing their first word last, so LOG() is
+ * lock-free and safe from any interrupt. A full ring drops the entry and
+ * counts it. log_drain() hands the committed entries to a writer, as a
+ * dump: a log_header_t, the entries, then a zero word. The layout is shared
+ * with the host decoder (tools/log_decode.c).
+ *
+ * An entry is the site word (LOG_SITE_VALID, the argument count and the
+ * site ID), the timestamp word and the arguments, little endian.
+ */
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define LOG_MAGIC                   0x31474F4C  /* "LOG1" */
+#define LOG_RING_WORDS              256         /* Must be a power of two */
+#define LOG_ARGS_MAX                4
+#define LOG_ENTRY_WORDS_MAX         (2 + LOG_ARGS_MAX)
+
+#define LOG_SITE_VALID              0x80000000u
+#define LOG_SITE_COUNT_SHIFT        24
+#define LOG_SITE_COUNT_MASK         0x07u
+#define LOG_SITE_ID_MASK            0x00FFFFFFu
+
+#define LOG_STRINGIFY_(x)           #x
+#define LOG_STRINGIFY(x)            LOG_STRINGIFY_(x)
+#define LOG_COUNT_(_0, _1, _2, _3, _4, count, ...) count
+#define LOG_COUNT(...)              LOG_COUNT_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+
+/**
+ * @brief Logs a message with up to LOG_ARGS_MAX integer arguments.
+ */
+#define LOG(format, ...)                                                                        \
+    do {                                                                                        \
+        static const char log_site[] __attribute__((section(".log_sites"), used))               \
+            = __FILE__ ":" LOG_STRINGIFY(__LINE__) ": " format;                                  \
+        const uint32_t log_args[] = { 0, ##__VA_ARGS__ };                                       \
+        _Static_assert(LOG_COUNT(__VA_ARGS__) <= LOG_ARGS_MAX, "too many log arguments");       \
+        log_write((uint32_t)(uintptr_t)log_site, LOG_COUNT(__VA_ARGS__), log_args);             \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint32_t magic;
+    uint32_t dropped;       /**< Entries lost to a full ring since the last dump */
+} log_header_t;
+
+typedef void (*log_writer_t)(const void *data, uint16_t size);
+
+/** Public functions ---------------------------------------------- */
+void log_init(const volatile uint32_t *clock);
+void log_write(uint32_t site, uint32_t count, const uint32_t words[]);
+uint32_t log_drain(log_writer_t write);
+
+#endif /* LOG_H */
@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief Motion macros: drive setpoints recorded with their timing and
+ * played back on a millisecond tick.
+ */
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+
+/** Definitions --------------------------------------------------- */
+#define MACRO_MAGIC                 0x3143414D  /* "MAC1" */
+
+/** Steps of a macro, sized for the record to fit one flash page. */
+#define MACRO_STEP_MAX              120
+
+/** Types --------------------------------------------------------- */
+/** A setpoint and the time since the previous step. */
+typedef struct {
+    uint16_t delay_ms;
+    uint8_t note;
+    uint8_t reserved;
+    int16_t left;
+    int16_t right;
+} macro_step_t;
+
+/** Stored macro, as laid out in flash. */
+typedef struct {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+    macro_step_t steps[MACRO_STEP_MAX];
+    uint32_t crc;           /**< STM32 CRC unit algorithm up to this field */
+} macro_record_t;
+
+typedef enum {
+    MACRO_STATE_IDLE = 0,
+    MACRO_STATE_RECORDING,
+    MACRO_STATE_PLAYING,
+} macro_state_t;
+
+/** Public functions ---------------------------------------------- */
+void macro_init(const macro_record_t *record);
+void macro_record_start(const drive_setpoint_t *setpoint, uint32_t now);
+bool macro_record(const drive_setpoint_t *setpoint, uint32_t now);
+void macro_record_stop(uint32_t now, macro_record_t *record);
+bool macro_play_start(void);
+void macro_play_stop(void);
+bool macro_play_tick(drive_setpoint_t *setpoint);
+macro_state_t macro_get_state(void);
+uint16_t macro_get_count(void);
+
+#endif /* MACRO_H */
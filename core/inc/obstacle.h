@@ -0,0 +1,24 @@
+/**
+ * @file
+ * @brief Emergency braking rule for obstacles ahead.
+ */
+#ifndef OBSTACLE_H
+#define OBSTACLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+
+/** Definitions --------------------------------------------------- */
+#define OBSTACLE_MARGIN_MM          100     /* Distance kept after stopping */
+#define OBSTACLE_FULL_SPEED_MM_S    1000    /* Speed at DRIVE_EFFORT_MAX */
+#define OBSTACLE_DECEL_MM_S2        2000    /* Deceleration with the motors off */
+#define OBSTACLE_LATENCY_MS         60      /* Ranging period, echo and control tick */
+
+/** Public functions ---------------------------------------------- */
+uint16_t obstacle_threshold(const drive_setpoint_t *setpoint);
+bool obstacle_check(const drive_setpoint_t *setpoint, uint16_t range_mm);
+void obstacle_clamp(drive_setpoint_t *setpoint);
+
+#endif /* OBSTACLE_H */
@@ -0,0 +1,31 @@
+/**
+ * @file
+ * @brief Differential drive dead-reckoning from wheel encoder counts.
+ */
+#ifndef ODOMETRY_H
+#define ODOMETRY_H
+
+#include <stdint.h>
+
+#include "fixmath.h"
+
+/** Definitions --------------------------------------------------- */
+#define ODOMETRY_WHEEL_DIAMETER_UM  65000
+#define ODOMETRY_COUNTS_PER_REV     80      /* 20 slot disk, quadrature x4 */
+#define ODOMETRY_TRACK_WIDTH_UM     130000
+#define ODOMETRY_RATE_HZ            100
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    int32_t x_um;       /**< Forward from the start pose */
+    int32_t y_um;       /**< Left from the start pose */
+    q31_t heading;      /**< Counter-clockwise, semicircles */
+} odometry_pose_t;
+
+/** Public functions ---------------------------------------------- */
+void odometry_init(void);
+void odometry_update(int16_t left_counts, int16_t right_counts);
+void odometry_get_pose(odometry_pose_t *pose);
+void odometry_get_counts(int32_t *left, int32_t *right);
+
+#endif /* ODOMETRY_H */
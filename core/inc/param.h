@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Tuning parameters, changed at run time and kept in flash.
+ *
+ * Every parameter has a fixed ID, a type, a range and a default, declared
+ * in the table of param.c. Values live in a RAM array indexed by ID, so
+ * param_get() is a single load and can be used from interrupts; a value is
+ * one word, so a change is seen whole.
+ *
+ * IDs are only ever appended. A snapshot (param_record_t) holds the values
+ * by ID with their count, so a snapshot from an older build loads the
+ * values it has and leaves the newer ones at their default.
+ * PARAM_VERSION changes when the meaning or unit of an existing ID does,
+ * which discards older snapshots.
+ */
+#ifndef PARAM_H
+#define PARAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define PARAM_MAGIC                 0x4D524150  /* "PARM" */
+#define PARAM_VERSION               1
+#define PARAM_CAPACITY              24          /* Values room in a snapshot */
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    PARAM_DRIVE_DUTY = 0,       /**< Remote key effort, CCR counts */
+    PARAM_REMOTE_PERIOD_MS,     /**< Remote key repeat period */
+    PARAM_IDLE_TIMEOUT_MS,      /**< Idle time before the lowest clock */
+    PARAM_LINE_KP,              /**< Line gains, see line.h */
+    PARAM_LINE_KI,
+    PARAM_LINE_KD,
+    PARAM_LINE_BASE_EFFORT,
+    PARAM_HEADING_KP,           /**< Heading gains, see heading.h */
+    PARAM_HEADING_KI,
+    PARAM_HEADING_KD,
+    PARAM_DRIVE_STOP,           /**< Stop mode, drive_stop_t */
+    PARAM_COUNT,
+} param_id_t;
+
+typedef enum {
+    PARAM_TYPE_U16 = 0,
+    PARAM_TYPE_S16,
+    PARAM_TYPE_U32,
+} param_type_t;
+
+typedef enum {
+    PARAM_STATUS_OK = 0,
+    PARAM_STATUS_UNKNOWN,       /**< No parameter with this ID */
+    PARAM_STATUS_RANGE,         /**< Value out of range, not changed */
+} param_status_t;
+
+/** Parameter description and value, as sent on the console. */
+typedef struct {
+    uint8_t id;
+    uint8_t type;               /**< param_type_t */
+    uint8_t status;             /**< param_status_t of the request */
+    uint8_t reserved;
+    int32_t value;
+    int32_t min;
+    int32_t max;
+    int32_t default_value;
+} param_entry_t;
+
+/** Snapshot, in the settings record layout: magic first, CRC last. */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;             /**< Values held, by ID from 0 */
+    int32_t values[PARAM_CAPACITY];
+    uint32_t crc;               /**< STM32 CRC unit algorithm up to this field */
+} param_record_t;
+
+/** Variables ----------------------------------------------------- */
+/** Values by ID, read through param_get() and written through param_set(). */
+extern int32_t param_values[PARAM_COUNT];
+
+/** Public functions ---------------------------------------------- */
+bool param_init(const param_record_t *record);
+param_status_t param_set(uint8_t id, int32_t value);
+param_status_t param_describe(uint8_t id, param_entry_t *entry);
+void param_snapshot(param_record_t *record);
+
+/**
+ * @brief Gets a parameter value.
+ */
+static inline int32_t param_get(param_id_t id) {
+    return param_values[id];
+}
+
+#endif /* PARAM_H */
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief nRF24L01+ radio control link, as a non-blocking SPI state machine.
+ *
+ * The car is the primary receiver on one pipe, with auto acknowledgment,
+ * dynamic payloads and acknowledgment payloads. Every drive command the
+ * controller sends is acknowledged with a telemetry payload. That payload
+ * was loaded after the previous command, so it echoes that command's
+ * sequence.
+ *
+ * Reception is interrupt driven. The radio IRQ line only flags the
+ * packet; radio_tick() starts the read in the next bus window, and the
+ * transfer completions chain the rest of the exchange. The payload
+ * width, the payload, the next acknowledgment payload and the status
+ * clear are each one SPI transfer, so a packet takes about 0.1 ms of
+ * bus. A slow check every RADIO_CHECK_TICKS without traffic catches a
+ * radio that was reset or a packet whose edge was missed.
+ *
+ * The transfers themselves are provided by the platform (SPI2 with DMA on
+ * the target, a simulated transceiver on the host). radio_tick(),
+ * radio_irq() and radio_bus_done() must not preempt each other; the
+ * command handler runs from radio_bus_done().
+ */
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "serial_frame.h"
+
+/** Definitions --------------------------------------------------- */
+#define RADIO_TICK_HZ               1000
+#define RADIO_CHANNEL               76      /* 2476 MHz */
+#define RADIO_ADDRESS_SIZE          5
+#define RADIO_ADDRESS_BYTES         0x31, 0x52, 0x41, 0x43, 0x52    /* "RCAR1", LSB first */
+#define RADIO_PAYLOAD_MAX           32
+
+#define RADIO_CMD_R_REGISTER        0x00
+#define RADIO_CMD_W_REGISTER        0x20
+#define RADIO_CMD_R_RX_PL_WID       0x60
+#define RADIO_CMD_R_RX_PAYLOAD      0x61
+#define RADIO_CMD_W_ACK_PAYLOAD     0xA8    /* Pipe 0 */
+#define RADIO_CMD_FLUSH_TX          0xE1
+#define RADIO_CMD_FLUSH_RX          0xE2
+#define RADIO_CMD_NOP               0xFF
+
+#define RADIO_REG_CONFIG            0x00
+#define RADIO_REG_EN_AA             0x01
+#define RADIO_REG_EN_RXADDR         0x02
+#define RADIO_REG_SETUP_AW          0x03
+#define RADIO_REG_RF_CH             0x05
+#define RADIO_REG_RF_SETUP          0x06
+#define RADIO_REG_STATUS            0x07
+#define RADIO_REG_RX_ADDR_P0        0x0A
+#define RADIO_REG_DYNPD             0x1C
+#define RADIO_REG_FEATURE           0x1D
+
+/** Primary receiver, powered up, 2 byte CRC, only the reception interrupt. */
+#define RADIO_CONFIG_VALUE          0x3F
+#define RADIO_SETUP_AW_5_BYTES      0x03
+#define RADIO_RF_SETUP_2MBPS_0DBM   0x0E
+#define RADIO_FEATURE_DPL_ACK_PAY   0x06
+#define RADIO_PIPE_0                0x01
+
+#define RADIO_STATUS_RX_DR          0x40
+#define RADIO_STATUS_RX_P_NO        0x0E
+#define RADIO_STATUS_RX_EMPTY       0x0E    /* RX_P_NO with an empty FIFO */
+#define RADIO_STATUS_TX_FULL        0x01
+#define RADIO_STATUS_CLEAR          0x70
+
+#define RADIO_RESET_TICKS           (100 * RADIO_TICK_HZ / 1000)    /* Power on reset */
+#define RADIO_START_TICKS           (2 * RADIO_TICK_HZ / 1000)      /* Power down to standby, 1.5 ms */
+#define RADIO_CHECK_TICKS           (250 * RADIO_TICK_HZ / 1000)
+#define RADIO_TIMEOUT_TICKS         3
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    RADIO_STATE_RESET = 0,
+    RADIO_STATE_WAIT,
+    RADIO_STATE_CONFIGURE,
+    RADIO_STATE_VERIFY,
+    RADIO_STATE_RUN,
+} radio_state_t;
+
+/** Acknowledgment payload. */
+typedef struct {
+    uint8_t sequence;           /**< Last command received */
+    uint8_t source;             /**< Arbiter source driving the car */
+    uint16_t range_mm;          /**< Obstacle range */
+    int16_t left;               /**< Wheel efforts applied */
+    int16_t right;
+} radio_telemetry_t;
+
+typedef struct {
+    uint32_t packets;
+    uint32_t invalid;           /**< Payloads of the wrong size */
+    uint32_t checks;            /**< Link checks while idle */
+    uint32_t resets;            /**< Radio found unconfigured or not answering */
+    uint16_t latency_max_ticks; /**< From the IRQ edge to the command delivered */
+    uint8_t state;
+    uint8_t reserved;
+} radio_stats_t;
+
+/** Receives the commands, from the transfer completion context. */
+typedef void (*radio_handler_t)(const serial_command_t *command);
+
+/** Public functions ---------------------------------------------- */
+void radio_init(radio_handler_t handler);
+void radio_tick(bool window);
+void radio_irq(void);
+bool radio_busy(void);
+void radio_set_telemetry(const radio_telemetry_t *telemetry);
+void radio_get_stats(radio_stats_t *stats);
+
+/**
+ * @brief Called by the platform when the transfer started last completes.
+ */
+void radio_bus_done(void);
+
+/**
+ * @brief Bus access, provided by the platform. A transfer clocks size
+ * bytes out of tx and into rx with the chip selected, starts and returns
+ * at once, and ends with a call to radio_bus_done(), unless it fails to
+ * start (false returned). radio_bus_enable() drives the CE pin.
+ */
+void radio_bus_setup(void);
+void radio_bus_retime(void);
+bool radio_bus_transfer(const uint8_t *tx, uint8_t *rx, uint8_t size);
+void radio_bus_enable(bool enabled);
+
+#endif /* RADIO_H */
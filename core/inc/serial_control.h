@@ -0,0 +1,18 @@
+/**
+ * @file
+ * @brief Serial control channel on USART2 (HC-05/HC-06 style radios).
+ */
+#ifndef SERIAL_CONTROL_H
+#define SERIAL_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "serial_frame.h"
+
+/** Public functions ---------------------------------------------- */
+void serial_control_setup(void);
+void serial_control_retime(void);
+bool serial_control_read(serial_command_t *command);
+
+#endif /* SERIAL_CONTROL_H */
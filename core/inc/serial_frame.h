@@ -0,0 +1,56 @@
+/**
+ * @file
+ * @brief Binary drive command frames for the serial control channel.
+ *
+ * A frame is 12 bytes, little endian:
+ *   sync (0xA5), type, sequence, flags (0), a (int16), b (int16), crc (uint32)
+ * The CRC is the STM32 CRC unit algorithm (CRC-32, polynomial 0x04C11DB7,
+ * initial value 0xFFFFFFFF, no reflection, no final XOR) over the first two
+ * 32-bit words, read little endian.
+ */
+#ifndef SERIAL_FRAME_H
+#define SERIAL_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define SERIAL_FRAME_SYNC           0xA5
+#define SERIAL_FRAME_SIZE           12
+#define SERIAL_FRAME_CRC_WORDS      2
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    SERIAL_FRAME_WHEELS = 1,    /**< a: left effort, b: right effort */
+    SERIAL_FRAME_TWIST,         /**< a: linear effort, b: angular effort */
+} serial_frame_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t sequence;
+    int16_t a;
+    int16_t b;
+} serial_command_t;
+
+typedef struct {
+    union {
+        uint8_t bytes[SERIAL_FRAME_SIZE];
+        uint32_t words[SERIAL_FRAME_SIZE / 4];
+    } buffer;
+    uint8_t length;
+    uint32_t accepted;
+    uint32_t crc_errors;
+} serial_frame_parser_t;
+
+/** Public functions ---------------------------------------------- */
+void serial_frame_init(serial_frame_parser_t *parser);
+bool serial_frame_parse(serial_frame_parser_t *parser, uint8_t byte, serial_command_t *command);
+void serial_frame_encode(const serial_command_t *command, uint8_t frame[SERIAL_FRAME_SIZE]);
+
+/**
+ * @brief CRC of whole 32-bit words, provided by the platform (hardware CRC
+ * unit on the target, from the main loop only; software on the host).
+ */
+uint32_t serial_frame_crc(const uint32_t *words, uint32_t count);
+
+#endif /* SERIAL_FRAME_H */
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Wheel stall detection and motor thermal derating, without a
+ * current sensor.
+ */
+#ifndef STALL_H
+#define STALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drive.h"
+#include "odometry.h"
+
+/** Definitions --------------------------------------------------- */
+/** Encoder counts per second at full effort without load
+ * (OBSTACLE_FULL_SPEED_MM_S on the odometry wheels). */
+#define STALL_FULL_SPEED_COUNTS_S   390
+
+/** Speed window, in odometry periods. */
+#define STALL_WINDOW                8
+#define STALL_WINDOW_MS             (STALL_WINDOW * 1000 / ODOMETRY_RATE_HZ)
+
+/** A wheel driven with at least this effort that moves no more than
+ * STALL_COUNTS_MAX counts in STALL_WINDOW_MS + STALL_DETECT_MS is stalled,
+ * so a jam is cut within that time. */
+#define STALL_EFFORT_MIN            300
+#define STALL_COUNTS_MAX            1
+#define STALL_DETECT_MS             200
+
+/** A stalled wheel is cut for this long, or until its effort is released
+ * or reversed. */
+#define STALL_RETRY_MS              1000
+
+/** Thermal model: the mean square of the estimated current, in effort
+ * counts, over a time constant of 2^STALL_THERMAL_SHIFT odometry periods
+ * (41 s). The current allowed is derated from the derate current on, down
+ * to the rated current, which the mean square then does not exceed. */
+#define STALL_THERMAL_SHIFT         12
+#define STALL_DERATE_CURRENT        400
+#define STALL_RATED_CURRENT         500
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    STALL_WHEEL_LEFT = 0,
+    STALL_WHEEL_RIGHT,
+    STALL_WHEEL_COUNT,
+} stall_wheel_t;
+
+typedef struct {
+    uint32_t stalls;            /**< Stalls detected */
+    uint32_t heat;              /**< Mean square current, effort counts squared */
+    int16_t current;            /**< Last current estimate, effort counts */
+    int16_t limit;              /**< Largest effort allowed, in the direction last requested */
+    uint8_t stalled;
+    uint8_t reserved[3];
+} stall_state_t;
+
+/** Public functions ---------------------------------------------- */
+void stall_init(void);
+void stall_update(int16_t left_counts, int16_t right_counts);
+void stall_limit(drive_setpoint_t *setpoint);
+void stall_get_state(stall_wheel_t wheel, stall_state_t *state);
+
+#endif /* STALL_H */
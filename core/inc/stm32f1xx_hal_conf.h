@@ -123,7 +123,7 @@ extern "C" {
   * @brief This is the HAL system configuration section
   */
 #define  VDD_VALUE                    3300U /*!< Value of VDD in mv */
-#define  TICK_INT_PRIORITY            0x0FU /*!< tick interrupt priority */
+#define  TICK_INT_PRIORITY            3U    /*!< tick interrupt priority, IRQ_PREEMPT_SYSTICK in irq.h */
 #define  USE_RTOS                     0U
 #define  PREFETCH_ENABLE              1U
 
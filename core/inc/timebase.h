@@ -0,0 +1,22 @@
+/**
+ * @file
+ * @brief 64-bit microsecond monotonic clock.
+ */
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Public functions ---------------------------------------------- */
+void timebase_setup(void);
+void timebase_tick(void);
+void timebase_sync(void);
+void timebase_retime(uint32_t elapsed_us);
+uint64_t timebase_now(void);
+uint64_t timebase_deadline(uint32_t timeout_us);
+bool timebase_expired(uint64_t deadline);
+uint32_t timebase_remaining(uint64_t deadline);
+void timebase_delay(uint32_t delay_us);
+
+#endif /* TIMEBASE_H */
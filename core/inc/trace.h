@@ -0,0 +1,50 @@
+/**
+ * @file
+ * @brief Command/actuation trace recorder.
+ *
+ * Records are fixed-size and stored raw in a RAM ring buffer. A dump is a
+ * trace_header_t followed by the records, oldest first, little endian. The
+ * layout is shared with the host replay tool (tools/trace_replay.c).
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define TRACE_MAGIC         0x31435254  /* "TRC1" */
+#define TRACE_RECORD_COUNT  256         /* Must be a power of two */
+#define TRACE_PWM_CHANNELS  4
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    TRACE_TYPE_KEY = 1,     /**< arg: decoded key */
+    TRACE_TYPE_PWM,         /**< value: TIM3 CCR1..CCR4 */
+    TRACE_TYPE_NOTE,        /**< arg: buzzer note */
+    TRACE_TYPE_SERIAL,      /**< arg: serial frame type, value: a, b, sequence */
+    TRACE_TYPE_BRAKE,       /**< arg: emergency brake engaged, value: range (mm) */
+} trace_type_t;
+
+typedef struct {
+    uint32_t timestamp;     /**< HAL tick, in ms */
+    uint16_t type;
+    uint16_t arg;
+    uint16_t value[TRACE_PWM_CHANNELS];
+} trace_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t record_size;
+    uint16_t record_count;
+} trace_header_t;
+
+/** Public functions ---------------------------------------------- */
+void trace_key(uint16_t key);
+void trace_pwm(const uint16_t ccr[TRACE_PWM_CHANNELS]);
+void trace_note(uint16_t note);
+void trace_serial(uint16_t type, int16_t a, int16_t b, uint16_t sequence);
+void trace_brake(bool engaged, uint16_t range_mm);
+void trace_dump(void);
+
+#endif /* TRACE_H */
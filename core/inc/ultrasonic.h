@@ -0,0 +1,19 @@
+/**
+ * @file
+ * @brief HC-SR04 style ultrasonic ranging with timer input capture.
+ */
+#ifndef ULTRASONIC_H
+#define ULTRASONIC_H
+
+#include <stdint.h>
+
+/** Definitions --------------------------------------------------- */
+#define ULTRASONIC_RANGE_INVALID    0xFFFF
+#define ULTRASONIC_RANGE_MAX_MM     4000
+
+/** Public functions ---------------------------------------------- */
+void ultrasonic_setup(void);
+void ultrasonic_retime(void);
+uint16_t ultrasonic_get_range(uint32_t now);
+
+#endif /* ULTRASONIC_H */
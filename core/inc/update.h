@@ -0,0 +1,34 @@
+/**
+ * @file
+ * @brief Firmware image reception over the console UART.
+ *
+ * After the 'U' request the host sends an update_header_t, little endian,
+ * and waits for UPDATE_ACK while the staging slot is erased. It then
+ * streams the image without pauses; every 1 KB page is programmed while
+ * the next one is being received. Once the whole image is in, the car
+ * answers UPDATE_ACK if its CRC matches and resets into the bootloader, or
+ * UPDATE_NACK on any failure. The layout is shared with the host sender
+ * (tools/flash_update.c).
+ */
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** Definitions --------------------------------------------------- */
+#define UPDATE_MAGIC        0x31445055  /* "UPD1" */
+#define UPDATE_ACK          'K'
+#define UPDATE_NACK         'E'
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;          /**< Image size, in bytes, a multiple of 4 */
+    uint32_t crc;           /**< STM32 CRC unit algorithm over the image */
+} update_header_t;
+
+/** Public functions ---------------------------------------------- */
+void update_receive(void);
+
+#endif /* UPDATE_H */
@@ -0,0 +1,127 @@
+/**
+ * @file
+ * @brief IMA ADPCM block decoder and PDM bit stream modulator.
+ *
+ * The decoder follows the IMA reference: the difference is built from the
+ * step with shifts and adds, so an encoder that tracks its output with
+ * adpcm_step() reconstructs exactly what the car plays.
+ *
+ * The PDM output is a first order sigma-delta modulator: every output bit
+ * adds the sample level to an error accumulator and emits its carry, so the
+ * density of ones over a sample equals its level within one bit, and the
+ * remainder carries over to the next sample and block.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "adpcm.h"
+
+/** Variables ----------------------------------------------------- */
+static const uint16_t step_table[ADPCM_INDEX_MAX + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+    107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871,
+    5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767,
+};
+
+static const int8_t index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/** Prototypes ---------------------------------------------------- */
+static void adpcm_header(const uint8_t *block, adpcm_state_t *state);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Loads the decoder state stored at the start of a block.
+ */
+static void adpcm_header(const uint8_t *block, adpcm_state_t *state) {
+    state->predictor = (int16_t)(block[0] | (block[1] << 8));
+    state->index = block[2] > ADPCM_INDEX_MAX ? ADPCM_INDEX_MAX : block[2];
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Decodes one 4-bit code.
+ *
+ * @param state     Predictor and step index, updated.
+ * @param code      Code, sign in bit 3.
+ *
+ * @return Decoded sample.
+ */
+int16_t adpcm_step(adpcm_state_t *state, uint8_t code) {
+    int32_t step = step_table[state->index];
+    int32_t difference = step >> 3;
+
+    if (code & 4) {
+        difference += step;
+    }
+    if (code & 2) {
+        difference += step >> 1;
+    }
+    if (code & 1) {
+        difference += step >> 2;
+    }
+
+    int32_t predictor = state->predictor + ((code & 8) ? -difference : difference);
+    state->predictor = (int16_t)(predictor > INT16_MAX ? INT16_MAX : predictor < INT16_MIN ? INT16_MIN : predictor);
+
+    int32_t index = state->index + index_table[code & 7];
+    state->index = (uint8_t)(index < 0 ? 0 : index > ADPCM_INDEX_MAX ? ADPCM_INDEX_MAX : index);
+
+    return state->predictor;
+}
+
+/**
+ * @brief Decodes a block into samples.
+ *
+ * @param block     ADPCM_BLOCK_SIZE bytes.
+ * @param samples   Decoded samples.
+ */
+void adpcm_decode_block(const uint8_t *block, int16_t samples[ADPCM_BLOCK_SAMPLES]) {
+    adpcm_state_t state;
+    const uint8_t *codes = &block[ADPCM_HEADER_SIZE];
+
+    adpcm_header(block, &state);
+    for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+        samples[i] = adpcm_step(&state, codes[i / 2] & 0x0F);
+        samples[i + 1] = adpcm_step(&state, codes[i / 2] >> 4);
+    }
+}
+
+/**
+ * @brief Decodes a block straight into a PDM bit stream.
+ *
+ * @param block     ADPCM_BLOCK_SIZE bytes, NULL for silence.
+ * @param words     PDM output, ADPCM_PDM_OVERSAMPLING bits per sample.
+ * @param error     Modulator accumulator, carried from block to block.
+ */
+void adpcm_decode_pdm(const uint8_t *block, uint16_t words[ADPCM_PDM_WORDS], uint16_t *error) {
+    adpcm_state_t state;
+    uint32_t accumulator = *error;
+
+    if (block == NULL) {
+        for (uint32_t i = 0; i < ADPCM_PDM_WORDS; i++) {
+            words[i] = 0;
+        }
+        return;
+    }
+
+    adpcm_header(block, &state);
+    for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+        uint8_t byte = block[ADPCM_HEADER_SIZE + i / 2];
+        uint32_t level = (uint16_t)(adpcm_step(&state, (i & 1) ? byte >> 4 : byte & 0x0F) + 32768);
+
+        for (uint32_t w = 0; w < ADPCM_PDM_OVERSAMPLING / 16; w++) {
+            uint32_t word = 0;
+
+            for (uint32_t bit = 0; bit < 16; bit++) {
+                accumulator += level;
+                word = (word << 1) | (accumulator >> 16);
+                accumulator &= 0xFFFF;
+            }
+            *words++ = (uint16_t)word;
+        }
+    }
+
+    *error = (uint16_t)accumulator;
+}
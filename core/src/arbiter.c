@@ -0,0 +1,160 @@
+/**
+ * @file
+ * @brief Fixed-priority arbitration between drive command sources.
+ *
+ * Every source owns one slot and posts timestamped setpoints into it, from
+ * thread or interrupt context. Each control tick the highest priority slot
+ * that is fresh wins; a slot expires when it has not been refreshed within
+ * its source timeout. A post from an interrupt may be stamped after the
+ * time of the tick, so ages are signed and such a post is fresh. Slots are
+ * guarded by a sequence counter (odd while being written), so neither side
+ * ever masks interrupts and the selection cost does not depend on how many
+ * posts happened.
+ *
+ * Time is passed in by the caller (ms), which keeps this module free of HAL
+ * calls.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "arbiter.h"
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    volatile uint32_t sequence;
+    bool valid;
+    uint32_t timestamp;
+    drive_setpoint_t setpoint;
+} arbiter_slot_t;
+
+/** Variables ----------------------------------------------------- */
+/** Setpoint lifetime of each source, in ms. */
+static const uint32_t source_timeout_ms[ARBITER_SOURCE_COUNT] = {
+    [ARBITER_SOURCE_SAFETY] = 100,
+    [ARBITER_SOURCE_SERIAL] = 250,
+    [ARBITER_SOURCE_RADIO] = 100,
+    [ARBITER_SOURCE_AUTONOMOUS] = 100,
+    [ARBITER_SOURCE_REMOTE] = 250,
+};
+
+static arbiter_slot_t slots[ARBITER_SOURCE_COUNT];
+
+/** Prototypes ---------------------------------------------------- */
+static void arbiter_write(arbiter_slot_t *slot, bool valid, const drive_setpoint_t *setpoint, uint32_t now);
+static bool arbiter_read(arbiter_slot_t *slot, drive_setpoint_t *setpoint, uint32_t *timestamp);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Updates a slot. Each slot must have a single writer.
+ */
+static void arbiter_write(arbiter_slot_t *slot, bool valid, const drive_setpoint_t *setpoint, uint32_t now) {
+    slot->sequence++;
+    __sync_synchronize();
+
+    slot->valid = valid;
+    slot->timestamp = now;
+    if (setpoint != NULL) {
+        slot->setpoint = *setpoint;
+    }
+
+    __sync_synchronize();
+    slot->sequence++;
+}
+
+/**
+ * @brief Takes a consistent copy of a slot, retrying if a writer preempted
+ * the read.
+ *
+ * @return Slot validity.
+ */
+static bool arbiter_read(arbiter_slot_t *slot, drive_setpoint_t *setpoint, uint32_t *timestamp) {
+    uint32_t sequence;
+    bool valid;
+
+    do {
+        sequence = slot->sequence;
+        __sync_synchronize();
+
+        valid = slot->valid;
+        *timestamp = slot->timestamp;
+        *setpoint = slot->setpoint;
+
+        __sync_synchronize();
+    } while ((sequence & 1) != 0 || sequence != slot->sequence);
+
+    return valid;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Clears every slot.
+ */
+void arbiter_init(void) {
+    for (uint8_t i = 0; i < ARBITER_SOURCE_COUNT; i++) {
+        arbiter_write(&slots[i], false, NULL, 0);
+    }
+}
+
+/**
+ * @brief Posts a new setpoint for a source.
+ *
+ * @param source    Posting source.
+ * @param setpoint  Requested setpoint.
+ * @param now       Current time, in ms.
+ */
+void arbiter_post(arbiter_source_t source, const drive_setpoint_t *setpoint, uint32_t now) {
+    if (source < ARBITER_SOURCE_COUNT) {
+        arbiter_write(&slots[source], true, setpoint, now);
+    }
+}
+
+/**
+ * @brief Withdraws a source before its timeout.
+ *
+ * @param source    Source to be released.
+ */
+void arbiter_release(arbiter_source_t source) {
+    if (source < ARBITER_SOURCE_COUNT) {
+        arbiter_write(&slots[source], false, NULL, 0);
+    }
+}
+
+/**
+ * @brief Selects the active setpoint.
+ *
+ * @param now       Current time, in ms.
+ * @param setpoint  Setpoint of the winning source, or a stop when none is
+ *                  active.
+ *
+ * @return Winning source, ARBITER_SOURCE_NONE if every slot is empty or stale.
+ */
+arbiter_source_t arbiter_select(uint32_t now, drive_setpoint_t *setpoint) {
+    return arbiter_select_from(ARBITER_SOURCE_SAFETY, now, setpoint);
+}
+
+/**
+ * @brief Selects the active setpoint among a source and the ones of lower
+ * priority, such as the request the safety source overrides.
+ *
+ * @param first     Highest priority source taken into account.
+ * @param now       Current time, in ms.
+ * @param setpoint  Setpoint of the winning source, or a stop when none is
+ *                  active.
+ *
+ * @return Winning source, ARBITER_SOURCE_NONE if every slot from first on is
+ *         empty or stale.
+ */
+arbiter_source_t arbiter_select_from(arbiter_source_t first, uint32_t now, drive_setpoint_t *setpoint) {
+    for (uint8_t i = first; i < ARBITER_SOURCE_COUNT; i++) {
+        uint32_t timestamp;
+
+        if (arbiter_read(&slots[i], setpoint, &timestamp) &&
+            (int32_t)(now - timestamp) <= (int32_t)source_timeout_ms[i]) {
+            return (arbiter_source_t)i;
+        }
+    }
+
+    drive_wheels(0, 0, setpoint);
+    return ARBITER_SOURCE_NONE;
+}
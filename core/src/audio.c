@@ -0,0 +1,237 @@
+/**
+ * @file
+ * @brief Sampled sound effects on the buzzer, streamed by DMA.
+ *
+ * Every timer of the part is taken (ultrasonic, encoders, motors), so the
+ * buzzer is driven from SPI1 MOSI instead of a PWM channel: the SPI shifts
+ * out a PDM bit stream that the buzzer coil averages, ADPCM_PDM_OVERSAMPLING
+ * bits per sample. A circular DMA feeds the SPI from a buffer holding two
+ * blocks worth of bits; at half and full transfer the block just sent is
+ * replaced by the next one, decoded straight into bits, so the CPU only
+ * wakes every 64 samples (about 15 ms) for a fraction of a millisecond.
+ *
+ * SPI1 is remapped so MOSI lands on PB5. Only MOSI is configured as an
+ * output: PB3 (SCK) and PA15 (NSS) stay inputs of the left encoder, and NSS
+ * is managed in software.
+ *
+ * The bit rate is only exact at the full clock profile; at the others,
+ * sounds are refused and the caller falls back to buzzer notes.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "audio.h"
+#include "irq.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define AUDIO_GPIO_CLOCK_ENABLE()   __HAL_RCC_GPIOB_CLK_ENABLE()
+#define AUDIO_PORT                  GPIOB
+#define AUDIO_PIN                   GPIO_PIN_5
+
+#define AUDIO_SPI_INSTANCE          SPI1
+#define AUDIO_SPI_CLOCK_ENABLE()    __HAL_RCC_SPI1_CLK_ENABLE()
+
+#define AUDIO_DMA_CHANNEL           DMA1_Channel3
+#define AUDIO_DMA_CLOCK_ENABLE()    __HAL_RCC_DMA1_CLK_ENABLE()
+#define AUDIO_DMA_IRQ               DMA1_Channel3_IRQn
+
+#define AUDIO_BUFFER_WORDS          (2 * ADPCM_PDM_WORDS)
+
+/** Variables ----------------------------------------------------- */
+static SPI_HandleTypeDef spi_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+
+static uint16_t pdm_buffer[AUDIO_BUFFER_WORDS];
+static uint16_t pdm_error = 0;
+
+static volatile audio_sound_t requested = AUDIO_SOUND_NONE;
+static audio_sound_t playing = AUDIO_SOUND_NONE;
+static uint16_t block = 0;
+
+static volatile bool running = false;
+static bool silent = false;
+static bool available = false;
+
+/** Prototypes ---------------------------------------------------- */
+static void audio_fill(uint16_t *words);
+static void audio_stop(void);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Decodes the next block of the requested sound into half of the
+ * buffer. Sounds loop until another one is requested.
+ */
+static void audio_fill(uint16_t *words) {
+    if (requested != playing) {
+        playing = requested;
+        block = 0;
+    }
+
+    const audio_clip_t *clip = &audio_clips[playing];
+    if (playing == AUDIO_SOUND_NONE || clip->block_count == 0) {
+        adpcm_decode_pdm(NULL, words, &pdm_error);
+        silent = true;
+        return;
+    }
+
+    adpcm_decode_pdm(&clip->blocks[block * ADPCM_BLOCK_SIZE], words, &pdm_error);
+    silent = false;
+
+    block++;
+    if (block == clip->block_count) {
+        block = 0;
+    }
+}
+
+/**
+ * @brief Stops the DMA. A last zero word leaves MOSI low, so no current
+ * flows through the buzzer while idle.
+ */
+static void audio_stop(void) {
+    CLEAR_BIT(AUDIO_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+    HAL_DMA_Abort(&dma_handle);
+    AUDIO_SPI_INSTANCE->DR = 0;
+    running = false;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures SPI1 as a transmit only bit stream on PB5 and its DMA.
+ */
+void audio_setup(void) {
+    AUDIO_GPIO_CLOCK_ENABLE();
+    AUDIO_SPI_CLOCK_ENABLE();
+    AUDIO_DMA_CLOCK_ENABLE();
+    __HAL_RCC_AFIO_CLK_ENABLE();
+    __HAL_AFIO_REMAP_SPI1_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = AUDIO_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(AUDIO_PORT, &gpio_init);
+
+    spi_handle.Instance = AUDIO_SPI_INSTANCE;
+    spi_handle.Init.Mode = SPI_MODE_MASTER;
+    spi_handle.Init.Direction = SPI_DIRECTION_1LINE;
+    spi_handle.Init.DataSize = SPI_DATASIZE_16BIT;
+    spi_handle.Init.CLKPolarity = SPI_POLARITY_LOW;
+    spi_handle.Init.CLKPhase = SPI_PHASE_1EDGE;
+    spi_handle.Init.NSS = SPI_NSS_SOFT;
+    spi_handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_128; /* Full profile, see audio_retime() */
+    spi_handle.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    spi_handle.Init.TIMode = SPI_TIMODE_DISABLE;
+    spi_handle.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    HAL_SPI_Init(&spi_handle);
+
+    dma_handle.Instance = AUDIO_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    dma_handle.Init.Mode = DMA_CIRCULAR;
+    dma_handle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init(&dma_handle);
+
+    HAL_NVIC_SetPriority(AUDIO_DMA_IRQ, IRQ_PREEMPT_AUDIO, IRQ_SUB_AUDIO);
+    HAL_NVIC_EnableIRQ(AUDIO_DMA_IRQ);
+
+    audio_retime();
+}
+
+/**
+ * @brief Sets the bit rate after a clock profile switch. Playback stops; it
+ * is only possible again if APB2 divides down to AUDIO_BIT_RATE_HZ exactly.
+ */
+void audio_retime(void) {
+    if (running) {
+        audio_stop();
+    }
+    __HAL_SPI_DISABLE(&spi_handle);
+
+    uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+    uint32_t divider = pclk / AUDIO_BIT_RATE_HZ;
+    uint32_t setting = 0;
+
+    while ((2UL << setting) < divider && setting < 7) {
+        setting++;
+    }
+
+    available = divider * AUDIO_BIT_RATE_HZ == pclk && (2UL << setting) == divider;
+    if (!available) {
+        return;
+    }
+
+    MODIFY_REG(AUDIO_SPI_INSTANCE->CR1, SPI_CR1_BR, setting << SPI_CR1_BR_Pos);
+    SPI_1LINE_TX(&spi_handle);
+    __HAL_SPI_ENABLE(&spi_handle);
+}
+
+/**
+ * @brief Selects the sound to loop on the buzzer. Changes take effect at
+ * the next block boundary.
+ *
+ * @param sound     Sound effect, AUDIO_SOUND_NONE to stop.
+ *
+ * @return true if the sound is played, false for none or when sounds can't
+ *         be played at the current clock.
+ */
+bool audio_play(audio_sound_t sound) {
+    if (!available) {
+        return false;
+    }
+
+    requested = sound;
+    if (sound == AUDIO_SOUND_NONE) {
+        return false;
+    }
+
+    if (!running) {
+        audio_fill(&pdm_buffer[0]);
+        audio_fill(&pdm_buffer[ADPCM_PDM_WORDS]);
+
+        running = true;
+        HAL_DMA_Start(&dma_handle, (uint32_t)pdm_buffer, (uint32_t)&AUDIO_SPI_INSTANCE->DR, AUDIO_BUFFER_WORDS);
+        __HAL_DMA_ENABLE_IT(&dma_handle, DMA_IT_HT | DMA_IT_TC);
+        SET_BIT(AUDIO_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+    }
+
+    return true;
+}
+
+/**
+ * @brief SPI1 TX DMA interrupt, refills the half of the buffer just sent.
+ * Once a silent half is playing, the stream stops.
+ */
+void DMA1_Channel3_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_AUDIO, IRQ_LATENCY_UNKNOWN);
+
+    uint16_t *words = NULL;
+
+    if (__HAL_DMA_GET_FLAG(&dma_handle, DMA_FLAG_HT3)) {
+        __HAL_DMA_CLEAR_FLAG(&dma_handle, DMA_FLAG_HT3);
+        words = &pdm_buffer[0];
+    }
+    if (__HAL_DMA_GET_FLAG(&dma_handle, DMA_FLAG_TC3)) {
+        __HAL_DMA_CLEAR_FLAG(&dma_handle, DMA_FLAG_TC3);
+        words = &pdm_buffer[ADPCM_PDM_WORDS];
+    }
+
+    if (words != NULL) {
+        if (silent && requested == AUDIO_SOUND_NONE) {
+            audio_stop();
+        } else {
+            audio_fill(words);
+        }
+    }
+
+    IRQ_PROFILE_EXIT(IRQ_ID_AUDIO);
+}
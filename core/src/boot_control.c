@@ -0,0 +1,415 @@
+/**
+ * @file
+ * @brief Dual-slot firmware update state, shared by the bootloader and the
+ * application.
+ *
+ * Every swap step erases its destination before copying into it, from a
+ * source that is only erased by a later step, so repeating a step whose
+ * completion was not logged is always safe. Pages blank in both slots are
+ * skipped. A step that fails is retried, and if it keeps failing the swap
+ * stops without logging it, so no later step erases its source; a step
+ * whose log write fails stops the swap the same way. Flash is
+ * only reached through the platform hooks, which keeps
+ * this module free of HAL calls.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "boot_control.h"
+
+/** Definitions --------------------------------------------------- */
+#define BOOT_RECORD_SIZE            sizeof(boot_record_t)
+#define BOOT_STATE_RECORDS          (BOOT_PAGE_SIZE / BOOT_RECORD_SIZE)
+#define BOOT_CHECK_SEED             0x5AA5C33Cu
+#define BOOT_ERASED_WORD            0xFFFFFFFFu
+
+/** Pages are copied and compared through a small buffer, in chunks. */
+#define BOOT_CHUNK_SIZE             64
+
+/** Swap steps per page: slot to scratch, staging to slot, scratch to staging. */
+#define BOOT_SWAP_STEPS             3
+
+/** Attempts at a swap step before the swap is given up until the next reset. */
+#define BOOT_STEP_ATTEMPTS          3
+
+/** Variables ----------------------------------------------------- */
+static boot_record_t current = { 0 };
+static uint8_t active_page = 0;
+static uint32_t next_slot = 0;
+
+static uint32_t update_size = 0;
+static uint32_t update_crc = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static uint32_t boot_check(const boot_record_t *record);
+static uint32_t state_address(uint8_t page, uint32_t slot);
+static bool state_write(boot_state_t state, uint8_t step, uint32_t size, uint32_t crc);
+static bool page_blank(uint32_t address);
+static bool page_copy(uint32_t destination, uint32_t source);
+static bool blank_range(uint32_t address, uint32_t pages);
+static bool boot_swap(uint8_t progress);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Record checksum. An erased or partially programmed record fails it.
+ */
+static uint32_t boot_check(const boot_record_t *record) {
+    const uint32_t *words = (const uint32_t *)record;
+
+    return ~(BOOT_CHECK_SEED + words[0] + ((words[1] << 7) | (words[1] >> 25)) + (words[2] ^ words[0]));
+}
+
+static uint32_t state_address(uint8_t page, uint32_t slot) {
+    return BOOT_STATE_ADDRESS + page * BOOT_PAGE_SIZE + slot * BOOT_RECORD_SIZE;
+}
+
+/**
+ * @brief Appends a record, moving to the other state page when the active
+ * one is full. A failed write is retried once on a freshly erased page.
+ */
+static bool state_write(boot_state_t state, uint8_t step, uint32_t size, uint32_t crc) {
+    boot_record_t record = {
+        .state = state,
+        .step = step,
+        .sequence = (uint16_t)(current.sequence + 1),
+        .size = size,
+        .crc = crc,
+    };
+    record.check = boot_check(&record);
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        if (attempt != 0 || next_slot >= BOOT_STATE_RECORDS) {
+            active_page ^= 1;
+            next_slot = 0;
+            if (!boot_flash_erase(state_address(active_page, 0))) {
+                continue;
+            }
+        }
+
+        bool written = boot_flash_program(state_address(active_page, next_slot), &record, BOOT_RECORD_SIZE);
+        next_slot++;
+
+        if (written) {
+            current = record;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool page_blank(uint32_t address) {
+    uint32_t chunk[BOOT_CHUNK_SIZE / 4];
+
+    for (uint32_t offset = 0; offset < BOOT_PAGE_SIZE; offset += BOOT_CHUNK_SIZE) {
+        boot_flash_read(address + offset, chunk, BOOT_CHUNK_SIZE);
+
+        for (uint32_t i = 0; i < BOOT_CHUNK_SIZE / 4; i++) {
+            if (chunk[i] != BOOT_ERASED_WORD) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Erases a page and copies another one into it. Blank words are not
+ * programmed.
+ */
+static bool page_copy(uint32_t destination, uint32_t source) {
+    uint32_t chunk[BOOT_CHUNK_SIZE / 4];
+
+    if (!boot_flash_erase(destination)) {
+        return false;
+    }
+
+    for (uint32_t offset = 0; offset < BOOT_PAGE_SIZE; offset += BOOT_CHUNK_SIZE) {
+        boot_flash_read(source + offset, chunk, BOOT_CHUNK_SIZE);
+
+        for (uint32_t i = 0; i < BOOT_CHUNK_SIZE / 4; i++) {
+            if (chunk[i] != BOOT_ERASED_WORD && !boot_flash_program(destination + offset + i * 4, &chunk[i], 4)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Erases every page of a range that is not blank already.
+ */
+static bool blank_range(uint32_t address, uint32_t pages) {
+    for (uint32_t page = 0; page < pages; page++) {
+        uint32_t page_address = address + page * BOOT_PAGE_SIZE;
+
+        if (!page_blank(page_address) && !boot_flash_erase(page_address)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Exchanges the application and staging slots, resuming at a logged
+ * progress and logging every completed step in the current state.
+ *
+ * @return false if a step could not be done or logged; the swap resumes at
+ * that step.
+ */
+static bool boot_swap(uint8_t progress) {
+    boot_state_t state = (boot_state_t)current.state;
+    uint32_t size = current.size;
+    uint32_t crc = current.crc;
+
+    while (progress < BOOT_SLOT_PAGES * BOOT_SWAP_STEPS) {
+        uint32_t page = progress / BOOT_SWAP_STEPS;
+        uint32_t slot = BOOT_APP_ADDRESS + page * BOOT_PAGE_SIZE;
+        uint32_t staging = BOOT_STAGING_ADDRESS + page * BOOT_PAGE_SIZE;
+        uint32_t destination;
+        uint32_t source;
+
+        switch (progress % BOOT_SWAP_STEPS) {
+            case 0: {
+                if (page_blank(slot) && page_blank(staging)) {
+                    progress += BOOT_SWAP_STEPS;
+                    continue;
+                }
+                destination = BOOT_SCRATCH_ADDRESS;
+                source = slot;
+                break;
+            }
+            case 1: {
+                destination = slot;
+                source = staging;
+                break;
+            }
+            default: {
+                destination = staging;
+                source = BOOT_SCRATCH_ADDRESS;
+                break;
+            }
+        }
+
+        bool copied = false;
+        for (uint8_t attempt = 0; attempt < BOOT_STEP_ATTEMPTS && !copied; attempt++) {
+            copied = page_copy(destination, source);
+        }
+        if (!copied) {
+            return false;
+        }
+
+        /* An unlogged step is repeated on resume, which is safe for
+         * that one step only: stop before the next */
+        progress++;
+        if (!state_write(state, progress, size, crc)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Loads the newest valid state record. Without one the application
+ * slot is taken as confirmed, which is the case right after programming
+ * through the debugger.
+ */
+void boot_init(void) {
+    bool found = false;
+
+    current = (boot_record_t){ .state = BOOT_STATE_CONFIRMED };
+    active_page = BOOT_STATE_PAGES - 1;
+    next_slot = BOOT_STATE_RECORDS;
+
+    for (uint8_t page = 0; page < BOOT_STATE_PAGES; page++) {
+        for (uint32_t slot = 0; slot < BOOT_STATE_RECORDS; slot++) {
+            boot_record_t record;
+
+            boot_flash_read(state_address(page, slot), &record, BOOT_RECORD_SIZE);
+            if (record.check != boot_check(&record) || record.state < BOOT_STATE_CONFIRMED ||
+                record.state > BOOT_STATE_REVERTING) {
+                continue;
+            }
+
+            if (!found || (int16_t)(record.sequence - current.sequence) > 0) {
+                found = true;
+                current = record;
+                active_page = page;
+            }
+        }
+    }
+
+    if (!found) {
+        return;
+    }
+
+    /* Append after anything programmed on the active page, including a
+     * record torn by a reset */
+    next_slot = 0;
+    for (uint32_t slot = 0; slot < BOOT_STATE_RECORDS; slot++) {
+        uint32_t words[BOOT_RECORD_SIZE / 4];
+
+        boot_flash_read(state_address(active_page, slot), words, BOOT_RECORD_SIZE);
+        for (uint32_t i = 0; i < BOOT_RECORD_SIZE / 4; i++) {
+            if (words[i] != BOOT_ERASED_WORD) {
+                next_slot = slot + 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Gets the current state record.
+ */
+void boot_get_record(boot_record_t *record) {
+    *record = current;
+}
+
+/**
+ * @brief Prepares the staging slot for a new image. Refused while the
+ * running image is on trial, since staging then holds the fallback.
+ *
+ * @param size  Image size, in bytes, a multiple of 4.
+ * @param crc   Expected image CRC.
+ *
+ * @return true if the staging slot is erased and ready.
+ */
+bool boot_update_begin(uint32_t size, uint32_t crc) {
+    update_size = 0;
+
+    if (size == 0 || size > BOOT_SLOT_SIZE || (size & 3) != 0 || current.state == BOOT_STATE_TRIAL) {
+        return false;
+    }
+
+    if (current.state != BOOT_STATE_CONFIRMED && !state_write(BOOT_STATE_CONFIRMED, 0, 0, 0)) {
+        return false;
+    }
+
+    if (!blank_range(BOOT_STAGING_ADDRESS, BOOT_SLOT_PAGES)) {
+        return false;
+    }
+
+    update_size = size;
+    update_crc = crc;
+
+    return true;
+}
+
+/**
+ * @brief Programs part of the new image into the staging slot.
+ *
+ * @param offset    Offset in the image, a multiple of 4.
+ * @param data      Image data.
+ * @param size      Data size, in bytes, a multiple of 4.
+ *
+ * @return true on success.
+ */
+bool boot_update_write(uint32_t offset, const void *data, uint32_t size) {
+    if (offset + size > update_size || ((offset | size) & 3) != 0) {
+        return false;
+    }
+
+    return boot_flash_program(BOOT_STAGING_ADDRESS + offset, data, size);
+}
+
+/**
+ * @brief Checks the staging slot CRC and, if it matches, marks the image
+ * pending so the bootloader installs it on the next reset.
+ */
+bool boot_update_finish(void) {
+    if (update_size == 0 || boot_flash_crc(BOOT_STAGING_ADDRESS, update_size) != update_crc) {
+        return false;
+    }
+
+    bool pending = state_write(BOOT_STATE_PENDING, 0, update_size, update_crc);
+    update_size = 0;
+
+    return pending;
+}
+
+/**
+ * @brief Accepts the running image, called by the application once it is
+ * known to work. Does nothing outside a trial.
+ */
+void boot_confirm(void) {
+    if (current.state == BOOT_STATE_TRIAL) {
+        state_write(BOOT_STATE_CONFIRMED, 0, current.size, current.crc);
+    }
+}
+
+/**
+ * @brief Checks that the application slot starts with a plausible vector
+ * table: stack pointer in RAM and reset handler in the slot.
+ */
+bool boot_app_valid(void) {
+    uint32_t vectors[2];
+
+    boot_flash_read(BOOT_APP_ADDRESS, vectors, sizeof(vectors));
+
+    return vectors[0] > BOOT_RAM_ADDRESS && vectors[0] <= BOOT_RAM_ADDRESS + BOOT_RAM_SIZE &&
+           (vectors[0] & 3) == 0 && (vectors[1] & 1) != 0 && vectors[1] > BOOT_APP_ADDRESS &&
+           vectors[1] < BOOT_APP_ADDRESS + BOOT_SLOT_SIZE;
+}
+
+/**
+ * @brief Bootloader decision: installs a pending image, finishes an
+ * interrupted swap, counts trial boots and rolls back when they run out.
+ * A swap step that fails leaves the slots mixed, so nothing is started;
+ * the next reset resumes at that step.
+ *
+ * @return What to start.
+ */
+boot_run_t boot_run(void) {
+    bool logged = true;
+
+    while (logged) {
+        switch (current.state) {
+            case BOOT_STATE_PENDING: {
+                if (boot_flash_crc(BOOT_STAGING_ADDRESS, current.size) == current.crc) {
+                    logged = state_write(BOOT_STATE_SWAPPING, 0, current.size, current.crc);
+                } else {
+                    logged = state_write(BOOT_STATE_CONFIRMED, 0, 0, 0);
+                }
+                break;
+            }
+            case BOOT_STATE_SWAPPING: {
+                if (!boot_swap(current.step)) {
+                    return BOOT_RUN_NONE;
+                }
+                if (boot_flash_crc(BOOT_APP_ADDRESS, current.size) == current.crc && boot_app_valid()) {
+                    logged = state_write(BOOT_STATE_TRIAL, 0, current.size, current.crc);
+                } else {
+                    logged = state_write(BOOT_STATE_REVERTING, 0, current.size, current.crc);
+                }
+                break;
+            }
+            case BOOT_STATE_REVERTING: {
+                if (!boot_swap(current.step)) {
+                    return BOOT_RUN_NONE;
+                }
+                logged = state_write(BOOT_STATE_CONFIRMED, 0, 0, 0);
+                break;
+            }
+            case BOOT_STATE_TRIAL: {
+                if (current.step >= BOOT_TRIAL_ATTEMPTS) {
+                    logged = state_write(BOOT_STATE_REVERTING, 0, current.size, current.crc);
+                    break;
+                }
+                state_write(BOOT_STATE_TRIAL, current.step + 1, current.size, current.crc);
+                return BOOT_RUN_TRIAL;
+            }
+            default: {
+                return boot_app_valid() ? BOOT_RUN_APP : BOOT_RUN_NONE;
+            }
+        }
+    }
+
+    /* The state log cannot be written, run whatever is in the slot */
+    return boot_app_valid() ? BOOT_RUN_APP : BOOT_RUN_NONE;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file
+ * @brief Flash controller and CRC unit hooks of the update state, shared by
+ * the bootloader and the application.
+ *
+ * Register level only, so the bootloader links without the HAL. Code runs
+ * from the same flash bank, so the CPU stalls while a page is erased
+ * (about 20 ms) or a half word is programmed (about 50 us); the DMA and
+ * the peripherals keep running.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stm32f1xx.h"
+
+#include "boot_control.h"
+
+/** Definitions --------------------------------------------------- */
+#define FLASH_KEY_1                 0x45670123
+#define FLASH_KEY_2                 0xCDEF89AB
+#define FLASH_ERROR_FLAGS           (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)
+
+/** Prototypes ---------------------------------------------------- */
+static void flash_unlock(void);
+static bool flash_wait(void);
+
+/** Internal functions -------------------------------------------- */
+static void flash_unlock(void) {
+    if ((FLASH->CR & FLASH_CR_LOCK) != 0) {
+        FLASH->KEYR = FLASH_KEY_1;
+        FLASH->KEYR = FLASH_KEY_2;
+    }
+}
+
+/**
+ * @brief Waits for the current operation and clears its status.
+ *
+ * @return true if it completed without error.
+ */
+static bool flash_wait(void) {
+    while ((FLASH->SR & FLASH_SR_BSY) != 0) {
+    }
+
+    uint32_t status = FLASH->SR;
+    FLASH->SR = FLASH_ERROR_FLAGS | FLASH_SR_EOP;
+
+    return (status & FLASH_ERROR_FLAGS) == 0;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Erases the page at an address.
+ */
+bool boot_flash_erase(uint32_t address) {
+    flash_unlock();
+    flash_wait();
+
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = address;
+    FLASH->CR |= FLASH_CR_STRT;
+    bool erased = flash_wait();
+    FLASH->CR &= ~FLASH_CR_PER;
+
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    return erased;
+}
+
+/**
+ * @brief Programs whole words, one half word at a time, and checks them.
+ */
+bool boot_flash_program(uint32_t address, const void *data, uint32_t size) {
+    const uint16_t *source = (const uint16_t *)data;
+    volatile uint16_t *destination = (volatile uint16_t *)address;
+    bool programmed = true;
+
+    flash_unlock();
+    flash_wait();
+
+    FLASH->CR |= FLASH_CR_PG;
+    for (uint32_t i = 0; i < size / 2 && programmed; i++) {
+        destination[i] = source[i];
+        programmed = flash_wait() && destination[i] == source[i];
+    }
+    FLASH->CR &= ~FLASH_CR_PG;
+
+    FLASH->CR |= FLASH_CR_LOCK;
+
+    return programmed;
+}
+
+void boot_flash_read(uint32_t address, void *data, uint32_t size) {
+    memcpy(data, (const void *)address, size);
+}
+
+/**
+ * @brief CRC of a flash range with the CRC unit, which reads it directly.
+ * Main thread only: the unit is never used from an interrupt, so the
+ * sequence is not interrupted by another reset.
+ */
+uint32_t boot_flash_crc(uint32_t address, uint32_t size) {
+    const uint32_t *words = (const uint32_t *)address;
+
+    RCC->AHBENR |= RCC_AHBENR_CRCEN;
+    CRC->CR = CRC_CR_RESET;
+
+    for (uint32_t i = 0; i < size / 4; i++) {
+        CRC->DR = words[i];
+    }
+
+    return CRC->DR;
+}
@@ -0,0 +1,226 @@
+/**
+ * @file
+ * @brief System clock profiles.
+ *
+ * The PLL cannot be reprogrammed while it drives SYSCLK, so every switch
+ * first moves SYSCLK to HSI, then sets up the oscillators of the new
+ * profile and finally selects its clock source and bus dividers.
+ * HAL_RCC_ClockConfig() orders the flash wait states around the change and
+ * reloads SysTick for the new HCLK, so the 1 ms tick stays exact. Peripherals
+ * clocked from the buses must be retimed by their owners afterwards.
+ *
+ * Switch latency is measured with the DWT cycle counter, converting each
+ * step at the clock it ran on.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "clock.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint32_t hclk_hz;
+    uint32_t sysclk_source;
+    uint32_t pll_multiplier;    /**< 0 for no PLL */
+    uint32_t apb1_divider;
+    uint32_t apb2_divider;
+    uint32_t flash_latency;
+} clock_config_t;
+
+/** Variables ----------------------------------------------------- */
+static const clock_config_t clock_configs[CLOCK_PROFILE_COUNT] = {
+    [CLOCK_PROFILE_FULL] = {
+        .hclk_hz = 72000000,
+        .sysclk_source = RCC_SYSCLKSOURCE_PLLCLK,
+        .pll_multiplier = RCC_PLL_MUL9,
+        .apb1_divider = RCC_HCLK_DIV2,
+        .apb2_divider = RCC_HCLK_DIV2,
+        .flash_latency = FLASH_LATENCY_2,
+    },
+    [CLOCK_PROFILE_REDUCED] = {
+        .hclk_hz = 24000000,
+        .sysclk_source = RCC_SYSCLKSOURCE_PLLCLK,
+        .pll_multiplier = RCC_PLL_MUL3,
+        .apb1_divider = RCC_HCLK_DIV1,
+        .apb2_divider = RCC_HCLK_DIV1,
+        .flash_latency = FLASH_LATENCY_0,
+    },
+    [CLOCK_PROFILE_HSI] = {
+        .hclk_hz = HSI_VALUE,
+        .sysclk_source = RCC_SYSCLKSOURCE_HSI,
+        .pll_multiplier = 0,
+        .apb1_divider = RCC_HCLK_DIV1,
+        .apb2_divider = RCC_HCLK_DIV1,
+        .flash_latency = FLASH_LATENCY_0,
+    },
+};
+
+static clock_profile_t current_profile = CLOCK_PROFILE_COUNT;
+static clock_stats_t clock_stats = { 0 };
+
+/** Prototypes ---------------------------------------------------- */
+static bool clock_select(uint32_t source, uint32_t apb1_divider, uint32_t apb2_divider, uint32_t latency);
+static bool clock_oscillators(const clock_config_t *config);
+static uint32_t clock_cycles_to_us(uint32_t cycles, uint32_t hclk_hz);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Selects the SYSCLK source and bus dividers.
+ */
+static bool clock_select(uint32_t source, uint32_t apb1_divider, uint32_t apb2_divider, uint32_t latency) {
+    RCC_ClkInitTypeDef clock_init = { 0 };
+
+    clock_init.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clock_init.SYSCLKSource = source;
+    clock_init.AHBCLKDivider = RCC_SYSCLK_DIV1;
+    clock_init.APB1CLKDivider = apb1_divider;
+    clock_init.APB2CLKDivider = apb2_divider;
+
+    return HAL_RCC_ClockConfig(&clock_init, latency) == HAL_OK;
+}
+
+/**
+ * @brief Starts the oscillators of a profile and stops the unused ones.
+ *
+ * Must run with SYSCLK on HSI.
+ */
+static bool clock_oscillators(const clock_config_t *config) {
+    RCC_OscInitTypeDef osc_init = { 0 };
+
+    osc_init.OscillatorType = RCC_OSCILLATORTYPE_HSE | RCC_OSCILLATORTYPE_HSI;
+    osc_init.HSIState = RCC_HSI_ON;
+    osc_init.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+
+    if (config->pll_multiplier != 0) {
+        osc_init.HSEState = RCC_HSE_ON;
+        osc_init.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
+        osc_init.PLL.PLLState = RCC_PLL_ON;
+        osc_init.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+        osc_init.PLL.PLLMUL = config->pll_multiplier;
+    } else {
+        osc_init.HSEState = RCC_HSE_OFF;
+        osc_init.PLL.PLLState = RCC_PLL_OFF;
+    }
+
+    if (READ_BIT(RCC->CR, RCC_CR_PLLON) != 0) {
+        /* Stop the PLL before HSE, which may be its input */
+        osc_init.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+        osc_init.PLL.PLLState = RCC_PLL_OFF;
+        if (HAL_RCC_OscConfig(&osc_init) != HAL_OK) {
+            return false;
+        }
+
+        osc_init.OscillatorType = RCC_OSCILLATORTYPE_HSE | RCC_OSCILLATORTYPE_HSI;
+        osc_init.PLL.PLLState = config->pll_multiplier != 0 ? RCC_PLL_ON : RCC_PLL_OFF;
+    }
+
+    return HAL_RCC_OscConfig(&osc_init) == HAL_OK;
+}
+
+static uint32_t clock_cycles_to_us(uint32_t cycles, uint32_t hclk_hz) {
+    return (uint32_t)((uint64_t)cycles * 1000000 / hclk_hz);
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Enables the cycle counter and starts in the full speed profile.
+ */
+void clock_setup(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    current_profile = CLOCK_PROFILE_COUNT;
+    clock_set_profile(CLOCK_PROFILE_FULL);
+}
+
+/**
+ * @brief Switches the system clock to a profile.
+ *
+ * Bus clocked peripherals keep their old register settings, so timers and
+ * UARTs run off-rate until their owners retime them. A byte on the wire
+ * during the switch may be lost.
+ *
+ * @param profile   New profile.
+ *
+ * @return false if an oscillator failed to start; the system is then left
+ *         on HSI.
+ */
+bool clock_set_profile(clock_profile_t profile) {
+    if (profile >= CLOCK_PROFILE_COUNT) {
+        return false;
+    }
+    if (profile == current_profile) {
+        return true;
+    }
+
+    const clock_config_t *config = &clock_configs[profile];
+    uint32_t old_hclk = SystemCoreClock;
+    uint32_t start = DWT->CYCCNT;
+    bool ok = true;
+
+    /* Step to HSI first, the flash latency for the old clock is kept until
+     * HCLK has dropped */
+    ok = clock_select(RCC_SYSCLKSOURCE_HSI, RCC_HCLK_DIV1, RCC_HCLK_DIV1, __HAL_FLASH_GET_LATENCY());
+    uint32_t on_hsi = DWT->CYCCNT;
+
+    ok = ok && clock_oscillators(config);
+    uint32_t configured = DWT->CYCCNT;
+
+    if (ok && config->sysclk_source != RCC_SYSCLKSOURCE_HSI) {
+        ok = clock_select(config->sysclk_source, config->apb1_divider, config->apb2_divider,
+                          config->flash_latency);
+    } else {
+        ok = clock_select(RCC_SYSCLKSOURCE_HSI, config->apb1_divider, config->apb2_divider,
+                          config->flash_latency) && ok;
+    }
+    uint32_t end = DWT->CYCCNT;
+
+    current_profile = ok ? profile : CLOCK_PROFILE_HSI;
+
+    clock_stats.profile = (uint8_t)current_profile;
+    clock_stats.hclk_hz = SystemCoreClock;
+    clock_stats.switches++;
+    clock_stats.switch_us[current_profile] = clock_cycles_to_us(on_hsi - start, old_hclk)
+                                             + clock_cycles_to_us(configured - on_hsi, HSI_VALUE)
+                                             + clock_cycles_to_us(end - configured, SystemCoreClock);
+
+    return ok;
+}
+
+/**
+ * @brief Gets the current clock profile.
+ */
+clock_profile_t clock_get_profile(void) {
+    return current_profile;
+}
+
+/**
+ * @brief Gets the counter clock of a timer.
+ *
+ * Timers run at twice their bus clock whenever the bus is divided.
+ *
+ * @param instance  Timer.
+ *
+ * @return Timer input clock, in Hz.
+ */
+uint32_t clock_timer_frequency(const TIM_TypeDef *instance) {
+    bool apb2 = instance == TIM1;
+    uint32_t bus = apb2 ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    uint32_t divided = apb2 ? READ_BIT(RCC->CFGR, RCC_CFGR_PPRE2) : READ_BIT(RCC->CFGR, RCC_CFGR_PPRE1);
+
+    return divided != 0 ? 2 * bus : bus;
+}
+
+/**
+ * @brief Gets the current profile and the measured switch latencies.
+ *
+ * @param stats     Copy of the clock statistics.
+ */
+void clock_get_stats(clock_stats_t *stats) {
+    *stats = clock_stats;
+}
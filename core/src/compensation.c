@@ -0,0 +1,275 @@
+/**
+ * @file
+ * @brief Per-channel motor compensation from requested effort to duty.
+ *
+ * The three stages are folded into one table per channel whenever the
+ * parameters change, sampled every 64 effort counts, so applying them is a
+ * shift, a mask and one multiply.
+ *
+ * Calibration runs each channel through a platform measurement function:
+ * a binary search brackets the deadband, then the speed is sampled at
+ * evenly spaced duties above it, each over enough windows to hold a few
+ * hundred counts, and a line fitted through the lower samples gives the
+ * duty that starts the wheel. Both wheels of a direction are given the top
+ * speed of the slower one, which sets the gains, and each LUT is the
+ * inverse of its speed curve, so equal efforts give equal, proportional
+ * speeds. The wheels must turn freely (car on a stand) while it runs.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "compensation.h"
+
+/** Definitions --------------------------------------------------- */
+#define TABLE_SHIFT                 6
+#define TABLE_POINTS                ((DRIVE_EFFORT_MAX >> TABLE_SHIFT) + 2)
+#define LUT_STEP                    (DRIVE_EFFORT_MAX / (COMPENSATION_LUT_POINTS - 1))
+
+/** Counts per measurement window that tell a turning wheel. */
+#define CALIBRATION_START_COUNTS    3
+#define CALIBRATION_RESOLUTION      8
+
+/** Counts a curve point is measured over, in as many windows as it takes. */
+#define CALIBRATION_POINT_COUNTS    400
+#define CALIBRATION_POINT_WINDOWS   16
+#define CALIBRATION_SPEED_SHIFT     4
+
+/** Curve points above the deadband the start of the wheel is fitted on. */
+#define CALIBRATION_FIT_POINTS      ((COMPENSATION_LUT_POINTS - 1) / 2)
+
+#define IDENTITY_TABLE              { 0, 64, 128, 192, 256, 320, 384, 448, 512, 576, 640, 704, 768, 832, 896, 960, \
+                                      1024 }
+#define IDENTITY_CHANNEL            { .deadband = 0, .gain = COMPENSATION_GAIN_ONE, \
+                                      .lut = { 0, 125, 250, 375, 500, 625, 750, 875, 1000 } }
+
+/** Variables ----------------------------------------------------- */
+static const compensation_channel_t identity = IDENTITY_CHANNEL;
+
+static compensation_channel_t parameters[DRIVE_CHANNEL_COUNT] = {
+    IDENTITY_CHANNEL, IDENTITY_CHANNEL, IDENTITY_CHANNEL, IDENTITY_CHANNEL,
+};
+
+static uint16_t tables[DRIVE_CHANNEL_COUNT][TABLE_POINTS] = {
+    IDENTITY_TABLE, IDENTITY_TABLE, IDENTITY_TABLE, IDENTITY_TABLE,
+};
+
+/** Prototypes ---------------------------------------------------- */
+static uint32_t lut_evaluate(const compensation_channel_t *channel, uint32_t effort);
+static void table_build(const compensation_channel_t *channel, uint16_t table[TABLE_POINTS]);
+static uint16_t curve_inverse(const uint16_t duty[COMPENSATION_LUT_POINTS],
+                              const uint32_t speed[COMPENSATION_LUT_POINTS], uint32_t target);
+static uint32_t curve_speed(compensation_measure_t measure, drive_channel_t channel, uint16_t duty);
+static uint16_t curve_start(const uint16_t duty[COMPENSATION_LUT_POINTS],
+                            const uint32_t speed[COMPENSATION_LUT_POINTS], uint16_t still, uint16_t moving);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Evaluates the LUT, extending its last segment past the end.
+ */
+static uint32_t lut_evaluate(const compensation_channel_t *channel, uint32_t effort) {
+    uint32_t segment = effort / LUT_STEP;
+
+    if (segment > COMPENSATION_LUT_POINTS - 2) {
+        segment = COMPENSATION_LUT_POINTS - 2;
+    }
+
+    int32_t start = channel->lut[segment];
+    int32_t slope = (int32_t)channel->lut[segment + 1] - start;
+    int32_t value = start + slope * (int32_t)(effort - segment * LUT_STEP) / LUT_STEP;
+
+    return value > 0 ? (uint32_t)value : 0;
+}
+
+/**
+ * @brief Samples the complete mapping at every table point.
+ */
+static void table_build(const compensation_channel_t *channel, uint16_t table[TABLE_POINTS]) {
+    uint32_t span = ((uint32_t)(DRIVE_EFFORT_MAX - channel->deadband) * channel->gain) >> 15;
+
+    for (uint32_t i = 0; i < TABLE_POINTS; i++) {
+        uint32_t duty = channel->deadband + span * lut_evaluate(channel, i << TABLE_SHIFT) / COMPENSATION_LUT_MAX;
+        table[i] = duty > UINT16_MAX ? UINT16_MAX : (uint16_t)duty;
+    }
+}
+
+/**
+ * @brief Finds the duty giving a speed on a measured, non-decreasing curve.
+ */
+static uint16_t curve_inverse(const uint16_t duty[COMPENSATION_LUT_POINTS],
+                              const uint32_t speed[COMPENSATION_LUT_POINTS], uint32_t target) {
+    for (uint32_t k = 0; k < COMPENSATION_LUT_POINTS - 1; k++) {
+        if (target <= speed[k + 1]) {
+            uint32_t rise = speed[k + 1] - speed[k];
+            if (rise == 0) {
+                return duty[k];
+            }
+            return (uint16_t)(duty[k] + (uint32_t)(duty[k + 1] - duty[k]) * (target - speed[k]) / rise);
+        }
+    }
+
+    return duty[COMPENSATION_LUT_POINTS - 1];
+}
+
+/**
+ * @brief Measures the speed at a curve point, in 1/16 counts per window.
+ */
+static uint32_t curve_speed(compensation_measure_t measure, drive_channel_t channel, uint16_t duty) {
+    uint32_t counts = 0;
+    uint32_t windows = 0;
+
+    do {
+        counts += measure(channel, duty);
+        windows++;
+    } while (counts < CALIBRATION_POINT_COUNTS && windows < CALIBRATION_POINT_WINDOWS);
+
+    return (counts << CALIBRATION_SPEED_SHIFT) / windows;
+}
+
+/**
+ * @brief Finds the duty that starts the wheel from the measured curve.
+ *
+ * The search stops at the first duty giving a few counts per window, above
+ * the true start, so the start is where the speed line crosses zero. The
+ * line is fitted by least squares through the lower half of the curve, as
+ * a line through two points moves the start by several duty counts for
+ * each count of quantization.
+ */
+static uint16_t curve_start(const uint16_t duty[COMPENSATION_LUT_POINTS],
+                            const uint32_t speed[COMPENSATION_LUT_POINTS], uint16_t still, uint16_t moving) {
+    int64_t n = CALIBRATION_FIT_POINTS;
+    int64_t sum_duty = 0;
+    int64_t sum_speed = 0;
+    int64_t sum_product = 0;
+    int64_t sum_square = 0;
+
+    for (uint32_t k = 1; k <= CALIBRATION_FIT_POINTS; k++) {
+        sum_duty += duty[k];
+        sum_speed += speed[k];
+        sum_product += (int64_t)duty[k] * speed[k];
+        sum_square += (int64_t)duty[k] * duty[k];
+    }
+
+    int64_t rise = n * sum_product - sum_duty * sum_speed;
+    if (rise <= 0) {
+        return still;
+    }
+
+    int64_t run = n * sum_square - sum_duty * sum_duty;
+    int64_t intercept = (sum_duty - sum_speed * run / rise) / n;
+
+    return intercept > moving ? moving : intercept > 0 ? (uint16_t)intercept : 0;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Loads the compensation of every channel.
+ *
+ * @param channels  Parameters indexed by drive channel, NULL for none
+ *                  (duty equals effort).
+ */
+void compensation_init(const compensation_channel_t channels[DRIVE_CHANNEL_COUNT]) {
+    for (uint8_t c = 0; c < DRIVE_CHANNEL_COUNT; c++) {
+        parameters[c] = channels != NULL ? channels[c] : identity;
+        table_build(&parameters[c], tables[c]);
+    }
+}
+
+/**
+ * @brief Gets the parameters in use.
+ */
+void compensation_get(compensation_channel_t channels[DRIVE_CHANNEL_COUNT]) {
+    for (uint8_t c = 0; c < DRIVE_CHANNEL_COUNT; c++) {
+        channels[c] = parameters[c];
+    }
+}
+
+/**
+ * @brief Maps an effort magnitude to the duty of a channel.
+ *
+ * @param channel   Bridge input that is being modulated.
+ * @param effort    Effort magnitude, 0 to DRIVE_EFFORT_MAX.
+ *
+ * @return Duty, 0 to DRIVE_EFFORT_MAX, 0 only for no effort.
+ */
+uint16_t compensation_apply(drive_channel_t channel, uint16_t effort) {
+    if (effort == 0) {
+        return 0;
+    }
+
+    const uint16_t *table = tables[channel];
+    uint32_t index = effort >> TABLE_SHIFT;
+    int32_t fraction = effort & ((1 << TABLE_SHIFT) - 1);
+    int32_t duty = table[index] + ((((int32_t)table[index + 1] - table[index]) * fraction) >> TABLE_SHIFT);
+
+    return duty > DRIVE_EFFORT_MAX ? DRIVE_EFFORT_MAX : duty < 1 ? 1 : (uint16_t)duty;
+}
+
+/**
+ * @brief Measures every channel and computes its compensation. The
+ * compensation is disabled while measuring and left disabled; the caller
+ * loads the result.
+ *
+ * @param measure   Measurement on the motors (on a model on the host).
+ * @param channels  Resulting parameters, indexed by drive channel.
+ *
+ * @return false if a wheel did not turn even at full duty.
+ */
+bool compensation_calibrate(compensation_measure_t measure, compensation_channel_t channels[DRIVE_CHANNEL_COUNT]) {
+    uint16_t duty[DRIVE_CHANNEL_COUNT][COMPENSATION_LUT_POINTS];
+    uint32_t speed[DRIVE_CHANNEL_COUNT][COMPENSATION_LUT_POINTS];
+
+    compensation_init(NULL);
+
+    for (uint8_t c = 0; c < DRIVE_CHANNEL_COUNT; c++) {
+        uint16_t still = 0;
+        uint16_t moving = DRIVE_EFFORT_MAX;
+
+        if (measure((drive_channel_t)c, moving) < CALIBRATION_START_COUNTS) {
+            return false;
+        }
+
+        while (moving - still > CALIBRATION_RESOLUTION) {
+            uint16_t middle = (still + moving) / 2;
+
+            if (measure((drive_channel_t)c, middle) >= CALIBRATION_START_COUNTS) {
+                moving = middle;
+            } else {
+                still = middle;
+            }
+        }
+
+        for (uint8_t k = 0; k < COMPENSATION_LUT_POINTS; k++) {
+            duty[c][k] = (uint16_t)(still + (uint32_t)(DRIVE_EFFORT_MAX - still) * k / (COMPENSATION_LUT_POINTS - 1));
+            speed[c][k] = k == 0 ? 0 : curve_speed(measure, (drive_channel_t)c, duty[c][k]);
+
+            /* Measurement noise must not fold the curve back */
+            if (k > 0 && speed[c][k] < speed[c][k - 1]) {
+                speed[c][k] = speed[c][k - 1];
+            }
+        }
+
+        channels[c].deadband = curve_start(duty[c], speed[c], still, moving);
+        duty[c][0] = channels[c].deadband;
+    }
+
+    /* The other wheel in the same direction is channel 3 - c */
+    for (uint8_t c = 0; c < DRIVE_CHANNEL_COUNT; c++) {
+        uint32_t top = speed[c][COMPENSATION_LUT_POINTS - 1];
+        uint32_t other = speed[DRIVE_CHANNEL_COUNT - 1 - c][COMPENSATION_LUT_POINTS - 1];
+        top = other < top ? other : top;
+
+        uint16_t deadband = channels[c].deadband;
+        uint16_t full = curve_inverse(duty[c], speed[c], top);
+        uint32_t reach = full > deadband ? full - deadband : 1;
+
+        channels[c].gain = (uint16_t)((reach << 15) / (DRIVE_EFFORT_MAX - deadband));
+        for (uint8_t k = 0; k < COMPENSATION_LUT_POINTS; k++) {
+            uint16_t point = curve_inverse(duty[c], speed[c], top * k / (COMPENSATION_LUT_POINTS - 1));
+            uint32_t value = point > deadband ? (uint32_t)(point - deadband) * COMPENSATION_LUT_MAX / reach : 0;
+            channels[c].lut[k] = value > COMPENSATION_LUT_MAX ? COMPENSATION_LUT_MAX : (uint16_t)value;
+        }
+    }
+
+    return true;
+}
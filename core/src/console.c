@@ -0,0 +1,221 @@
+/**
+ * @file
+ * @brief Serial console on USART1.
+ *
+ * Transmission is blocking. Reception is interrupt driven into a small
+ * ring buffer, so incoming bytes are not lost while the main loop is busy.
+ * For bulk transfers reception can be switched to DMA into a caller buffer,
+ * which the caller polls.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+
+#include "console.h"
+#include "irq.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define CONSOLE_GPIO_CLOCK_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
+#define CONSOLE_PORT                GPIOA
+#define CONSOLE_TX_PIN              GPIO_PIN_9
+#define CONSOLE_RX_PIN              GPIO_PIN_10
+
+#define CONSOLE_UART_INSTANCE       USART1
+#define CONSOLE_UART_CLOCK_ENABLE() __HAL_RCC_USART1_CLK_ENABLE()
+#define CONSOLE_UART_IRQ            USART1_IRQn
+#define CONSOLE_BAUD_RATE           115200
+#define CONSOLE_TX_TIMEOUT_MS       100
+
+#define CONSOLE_RX_BUFFER_SIZE      64  /* Must be a power of two */
+
+#define CONSOLE_DMA_CHANNEL         DMA1_Channel5
+#define CONSOLE_DMA_CLOCK_ENABLE()  __HAL_RCC_DMA1_CLK_ENABLE()
+
+/** Variables ----------------------------------------------------- */
+static UART_HandleTypeDef uart_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+static uint16_t stream_size = 0;
+
+static uint8_t rx_buffer[CONSOLE_RX_BUFFER_SIZE];
+static volatile uint32_t rx_head = 0;
+static volatile uint32_t rx_tail = 0;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures USART1 pins, baud rate and RX interrupt.
+ */
+void console_setup(void) {
+    CONSOLE_GPIO_CLOCK_ENABLE();
+    CONSOLE_UART_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = CONSOLE_TX_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(CONSOLE_PORT, &gpio_init);
+
+    gpio_init.Pin = CONSOLE_RX_PIN;
+    gpio_init.Mode = GPIO_MODE_INPUT;
+    gpio_init.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(CONSOLE_PORT, &gpio_init);
+
+    uart_handle.Instance = CONSOLE_UART_INSTANCE;
+    uart_handle.Init.BaudRate = CONSOLE_BAUD_RATE;
+    uart_handle.Init.WordLength = UART_WORDLENGTH_8B;
+    uart_handle.Init.StopBits = UART_STOPBITS_1;
+    uart_handle.Init.Parity = UART_PARITY_NONE;
+    uart_handle.Init.Mode = UART_MODE_TX_RX;
+    uart_handle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    uart_handle.Init.OverSampling = UART_OVERSAMPLING_16;
+    HAL_UART_Init(&uart_handle);
+
+    __HAL_UART_ENABLE_IT(&uart_handle, UART_IT_RXNE);
+    HAL_NVIC_SetPriority(CONSOLE_UART_IRQ, IRQ_PREEMPT_CONSOLE, IRQ_SUB_CONSOLE);
+    HAL_NVIC_EnableIRQ(CONSOLE_UART_IRQ);
+}
+
+/**
+ * @brief Recomputes the baud rate divider after a clock profile switch.
+ */
+void console_retime(void) {
+    CONSOLE_UART_INSTANCE->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK2Freq(), CONSOLE_BAUD_RATE);
+}
+
+/**
+ * @brief Pops one received byte.
+ *
+ * @param byte  Received byte.
+ *
+ * @return true if a byte was available.
+ */
+bool console_read(uint8_t *byte) {
+    uint32_t tail = rx_tail;
+
+    if (tail == rx_head) {
+        return false;
+    }
+
+    *byte = rx_buffer[tail & (CONSOLE_RX_BUFFER_SIZE - 1)];
+    rx_tail = tail + 1;
+
+    return true;
+}
+
+/**
+ * @brief Reads a number of bytes, blocking until they are in.
+ *
+ * @param data          Buffer for the bytes.
+ * @param size          Number of bytes.
+ * @param timeout_ms    Longest wait between two bytes.
+ *
+ * @return false on timeout.
+ */
+bool console_read_block(void *data, uint16_t size, uint32_t timeout_ms) {
+    uint8_t *bytes = data;
+    uint16_t count = 0;
+    uint32_t timeshot = HAL_GetTick();
+
+    while (count < size) {
+        if (console_read(&bytes[count])) {
+            count++;
+            timeshot = HAL_GetTick();
+        } else if (HAL_GetTick() - timeshot > timeout_ms) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sends a buffer, blocking until it has been transmitted.
+ *
+ * @param data  Data to be sent.
+ * @param size  Data size, in bytes.
+ */
+void console_write(const void *data, uint16_t size) {
+    HAL_UART_Transmit(&uart_handle, (uint8_t *)data, size, CONSOLE_TX_TIMEOUT_MS);
+}
+
+/**
+ * @brief Switches reception from the ring buffer to circular DMA into a
+ * caller buffer. Bytes still in the ring buffer are dropped.
+ *
+ * @param buffer    Reception buffer.
+ * @param size      Buffer size, in bytes.
+ */
+void console_stream_start(uint8_t *buffer, uint16_t size) {
+    CONSOLE_DMA_CLOCK_ENABLE();
+
+    __HAL_UART_DISABLE_IT(&uart_handle, UART_IT_RXNE);
+    (void)CONSOLE_UART_INSTANCE->SR;
+    (void)CONSOLE_UART_INSTANCE->DR;
+    rx_tail = rx_head;
+
+    dma_handle.Instance = CONSOLE_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma_handle.Init.Mode = DMA_CIRCULAR;
+    dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+    HAL_DMA_Init(&dma_handle);
+
+    stream_size = size;
+    HAL_DMA_Start(&dma_handle, (uint32_t)&CONSOLE_UART_INSTANCE->DR, (uint32_t)buffer, size);
+    SET_BIT(CONSOLE_UART_INSTANCE->CR3, USART_CR3_DMAR);
+}
+
+/**
+ * @brief Gets the offset the DMA writes the next received byte to.
+ */
+uint16_t console_stream_position(void) {
+    return stream_size - (uint16_t)__HAL_DMA_GET_COUNTER(&dma_handle);
+}
+
+/**
+ * @brief Checks whether a byte was lost since the stream started.
+ */
+bool console_stream_overrun(void) {
+    return (CONSOLE_UART_INSTANCE->SR & USART_SR_ORE) != 0;
+}
+
+/**
+ * @brief Stops the DMA and returns to interrupt driven reception.
+ */
+void console_stream_stop(void) {
+    CLEAR_BIT(CONSOLE_UART_INSTANCE->CR3, USART_CR3_DMAR);
+    HAL_DMA_Abort(&dma_handle);
+
+    (void)CONSOLE_UART_INSTANCE->SR;
+    (void)CONSOLE_UART_INSTANCE->DR;
+    __HAL_UART_ENABLE_IT(&uart_handle, UART_IT_RXNE);
+}
+
+/**
+ * @brief USART1 interrupt, stores received bytes.
+ *
+ * Reading SR followed by DR also clears a pending overrun.
+ */
+void USART1_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_CONSOLE, IRQ_LATENCY_UNKNOWN);
+
+    uint32_t status = CONSOLE_UART_INSTANCE->SR;
+
+    if ((status & (USART_SR_RXNE | USART_SR_ORE)) != 0) {
+        uint8_t byte = (uint8_t)CONSOLE_UART_INSTANCE->DR;
+        uint32_t head = rx_head;
+
+        if (head - rx_tail < CONSOLE_RX_BUFFER_SIZE) {
+            rx_buffer[head & (CONSOLE_RX_BUFFER_SIZE - 1)] = byte;
+            rx_head = head + 1;
+        }
+    }
+
+    IRQ_PROFILE_EXIT(IRQ_ID_CONSOLE);
+}
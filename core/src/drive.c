@@ -0,0 +1,272 @@
+/**
+ * @file
+ * @brief Drive commands to motor/buzzer output mapping.
+ *
+ * Efforts are signed per wheel, positive forward. The left wheel is driven
+ * by CH2 (forward) and CH1 (reverse), the right wheel by CH3 (forward) and
+ * CH4 (reverse).
+ *
+ * The bridge inputs work in pairs: one high drives the motor, both low let
+ * it coast and both high short it (brake). In fast decay the PWM off time
+ * coasts; in slow decay the idle input stays high and the other one is
+ * modulated, so the off time brakes and speed follows duty far more
+ * linearly at low effort. A wheel that reverses is braked for the dwell
+ * time first, so the bridge never switches straight into a spinning motor.
+ * The modulated duty goes through the compensation of its channel (see
+ * compensation.h), so equal efforts turn both wheels alike.
+ *
+ * Compare values are duties in CCR counts of an edge aligned period
+ * (0 to DRIVE_EFFORT_MAX). drive_interleave() turns them into the compares
+ * of the center aligned timer, which runs the two wheels half a period
+ * apart so their currents are not drawn from the supply at the same time.
+ *
+ * Kept free of HAL calls so the same logic can be compiled on the host
+ * (see tools/trace_replay.c). The other modules without HAL includes
+ * follow the same rule and are built by the tools/ programs named in their
+ * build lines.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "compensation.h"
+#include "drive.h"
+#include "param.h"
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    int8_t direction;       /**< Last driven direction, -1, 0 or 1 */
+    bool braking;
+    uint32_t brake_start;
+} drive_wheel_t;
+
+/** Variables ----------------------------------------------------- */
+static const drive_config_t drive_default_config = {
+    .stop = DRIVE_STOP_COAST,
+    .decay = DRIVE_DECAY_SLOW,
+    .reverse_dwell_ms = DRIVE_REVERSE_DWELL_MS,
+};
+
+static drive_config_t drive_config;
+
+static drive_wheel_t drive_wheel_left;
+static drive_wheel_t drive_wheel_right;
+
+/** Prototypes ---------------------------------------------------- */
+static int16_t drive_clamp(int32_t effort);
+static void drive_wheel_brake(drive_wheel_t *wheel, uint32_t now);
+static void drive_wheel_output(drive_wheel_t *wheel, int16_t effort, uint32_t now, drive_channel_t forward,
+                               drive_channel_t reverse, drive_output_t *output);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Limits an effort to the PWM range.
+ */
+static int16_t drive_clamp(int32_t effort) {
+    if (effort > DRIVE_EFFORT_MAX) {
+        return DRIVE_EFFORT_MAX;
+    }
+    if (effort < -DRIVE_EFFORT_MAX) {
+        return -DRIVE_EFFORT_MAX;
+    }
+    return (int16_t)effort;
+}
+
+/**
+ * @brief Starts the brake interval of a wheel, if not already running.
+ */
+static void drive_wheel_brake(drive_wheel_t *wheel, uint32_t now) {
+    if (!wheel->braking) {
+        wheel->braking = true;
+        wheel->brake_start = now;
+    }
+}
+
+/**
+ * @brief Computes the compare values of one wheel.
+ *
+ * The brake interval is timed from the moment the wheel starts braking,
+ * whether from a stop or from a reversal request, so every change of the
+ * sequencer state is also a change of the output.
+ *
+ * @param wheel     Wheel state.
+ * @param effort    Requested signed effort.
+ * @param now       Current time, in ms.
+ * @param forward   Channel of the forward input.
+ * @param reverse   Channel of the reverse input.
+ * @param output    Output whose two compare values are set.
+ */
+static void drive_wheel_output(drive_wheel_t *wheel, int16_t effort, uint32_t now, drive_channel_t forward,
+                               drive_channel_t reverse, drive_output_t *output) {
+    int8_t direction = effort > 0 ? 1 : effort < 0 ? -1 : 0;
+    uint16_t *forward_ccr = &output->ccr[forward];
+    uint16_t *reverse_ccr = &output->ccr[reverse];
+
+    if (direction == 0) {
+        if (drive_config.stop == DRIVE_STOP_BRAKE) {
+            drive_wheel_brake(wheel, now);
+            *forward_ccr = DRIVE_EFFORT_MAX;
+            *reverse_ccr = DRIVE_EFFORT_MAX;
+        } else {
+            wheel->braking = false;
+            *forward_ccr = 0;
+            *reverse_ccr = 0;
+        }
+        return;
+    }
+
+    if (wheel->direction != 0 && direction != wheel->direction) {
+        drive_wheel_brake(wheel, now);
+        if (now - wheel->brake_start < drive_config.reverse_dwell_ms) {
+            *forward_ccr = DRIVE_EFFORT_MAX;
+            *reverse_ccr = DRIVE_EFFORT_MAX;
+            return;
+        }
+    }
+
+    wheel->braking = false;
+    wheel->direction = direction;
+
+    uint16_t duty = compensation_apply(direction > 0 ? forward : reverse, (uint16_t)(direction > 0 ? effort : -effort));
+    uint16_t *active = direction > 0 ? forward_ccr : reverse_ccr;
+    uint16_t *idle = direction > 0 ? reverse_ccr : forward_ccr;
+
+    if (drive_config.decay == DRIVE_DECAY_SLOW) {
+        *active = DRIVE_EFFORT_MAX;
+        *idle = DRIVE_EFFORT_MAX - duty;
+    } else {
+        *active = duty;
+        *idle = 0;
+    }
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Selects the bridge behaviour and resets the reversal sequencer.
+ *
+ * @param config    Stop and decay modes and brake dwell, NULL for the
+ *                  defaults (coast, slow decay, DRIVE_REVERSE_DWELL_MS).
+ */
+void drive_init(const drive_config_t *config) {
+    drive_config = config != NULL ? *config : drive_default_config;
+
+    drive_wheel_left = (drive_wheel_t){ 0 };
+    drive_wheel_right = (drive_wheel_t){ 0 };
+}
+
+/**
+ * @brief Changes the stop mode, from the next output on. A single word, so
+ * it can be changed while an interrupt drives.
+ *
+ * @param stop      Bridge state for a wheel with no effort.
+ */
+void drive_set_stop(drive_stop_t stop) {
+    drive_config.stop = stop;
+}
+
+/**
+ * @brief Computes the setpoint for a remote key.
+ *
+ * @param key       Key returned by the infrared decoder.
+ * @param setpoint  Resulting wheel efforts and note.
+ */
+void drive_key(ir_key_id_t key, drive_setpoint_t *setpoint) {
+    int16_t duty = (int16_t)param_get(PARAM_DRIVE_DUTY);
+
+    switch (key) {
+        case INFRARED_KEY_UP: {
+            drive_wheels(duty, duty, setpoint);
+            break;
+        }
+        case INFRARED_KEY_DOWN: {
+            drive_wheels(-duty, -duty, setpoint);
+            break;
+        }
+        case INFRARED_KEY_LEFT: {
+            drive_wheels(0, duty, setpoint);
+            break;
+        }
+        case INFRARED_KEY_RIGHT: {
+            drive_wheels(duty, 0, setpoint);
+            break;
+        }
+        default: {
+            drive_wheels(0, 0, setpoint);
+            break;
+        }
+    }
+
+    if (key == INFRARED_KEY_ENTER) {
+        setpoint->note = BUZZER_NOTE_A4;
+    }
+}
+
+/**
+ * @brief Computes the setpoint for signed wheel efforts.
+ *
+ * @param left      Left wheel effort, -DRIVE_EFFORT_MAX..DRIVE_EFFORT_MAX.
+ * @param right     Right wheel effort, -DRIVE_EFFORT_MAX..DRIVE_EFFORT_MAX.
+ * @param setpoint  Resulting setpoint, buzzer silent.
+ */
+void drive_wheels(int16_t left, int16_t right, drive_setpoint_t *setpoint) {
+    setpoint->left = drive_clamp(left);
+    setpoint->right = drive_clamp(right);
+    setpoint->note = BUZZER_NOTE_ST;
+}
+
+/**
+ * @brief Computes the setpoint for a linear/angular command.
+ *
+ * @param linear    Forward effort.
+ * @param angular   Turning effort, positive to the left.
+ * @param setpoint  Resulting setpoint, buzzer silent.
+ */
+void drive_twist(int16_t linear, int16_t angular, drive_setpoint_t *setpoint) {
+    drive_wheels(drive_clamp((int32_t)linear - angular), drive_clamp((int32_t)linear + angular), setpoint);
+}
+
+/**
+ * @brief Computes the TIM3 compare values for a setpoint.
+ *
+ * Must be called every control period: the reversal dwell is timed by the
+ * calls.
+ *
+ * @param setpoint  Wheel efforts and note.
+ * @param now       Current time, in ms.
+ * @param output    Resulting compare values and note.
+ */
+void drive_output(const drive_setpoint_t *setpoint, uint32_t now, drive_output_t *output) {
+    drive_wheel_output(&drive_wheel_left, setpoint->left, now, DRIVE_CHANNEL_2, DRIVE_CHANNEL_1, output);
+    drive_wheel_output(&drive_wheel_right, setpoint->right, now, DRIVE_CHANNEL_3, DRIVE_CHANNEL_4, output);
+    output->note = setpoint->note;
+}
+
+/**
+ * @brief Converts duties into the compare values of the center aligned PWM
+ * timer, counting from 0 up to DRIVE_PWM_TOP and back.
+ *
+ * The left wheel channels (CH1, CH2) use PWM mode 1, high while the counter
+ * is below the compare, so their pulses are centered on the bottom of the
+ * count. The right wheel channels (CH3, CH4) use PWM mode 2, high from the
+ * compare up, with the duty counted down from one past the top, so their
+ * pulses are centered on the top, half a period later. Over the period the
+ * counter passes each value twice but the bottom and the top once, so both
+ * modes are high for 2 * duty - 1 ticks and a duty drives both wheels
+ * alike. Full and zero duty map past the ends of the count, so the outputs
+ * hold their level rather than glitching for a tick at the turn of the
+ * counter.
+ *
+ * @param output    Duties, as computed by drive_output().
+ * @param compare   Resulting compare values of CH1 to CH4.
+ */
+void drive_interleave(const drive_output_t *output, uint16_t compare[DRIVE_CHANNEL_COUNT]) {
+    for (uint8_t channel = DRIVE_CHANNEL_1; channel < DRIVE_CHANNEL_COUNT; channel++) {
+        uint16_t duty = output->ccr[channel] < DRIVE_PWM_TOP ? output->ccr[channel] : DRIVE_PWM_TOP;
+
+        if (channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_2) {
+            compare[channel] = duty == DRIVE_PWM_TOP ? DRIVE_PWM_TOP + 1 : duty;
+        } else {
+            compare[channel] = duty == DRIVE_PWM_TOP ? 0 : DRIVE_PWM_TOP + 1 - duty;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Wheel quadrature encoders on timers in encoder mode.
+ *
+ * The timers count both edges of both channels on their own, so reading an
+ * encoder is just a 16-bit counter difference.
+ */
+#include <stdint.h>
+
+#include "stm32f1xx.h"
+
+#include "encoder.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+/* Left wheel: TIM2 partial remap 1, CH1 on PA15, CH2 on PB3 (JTAG pins) */
+#define ENCODER_LEFT_TIMER_INSTANCE         TIM2
+#define ENCODER_LEFT_TIMER_CLOCK_ENABLE()   __HAL_RCC_TIM2_CLK_ENABLE()
+#define ENCODER_LEFT_CH1_PORT               GPIOA
+#define ENCODER_LEFT_CH1_PIN                GPIO_PIN_15
+#define ENCODER_LEFT_CH2_PORT               GPIOB
+#define ENCODER_LEFT_CH2_PIN                GPIO_PIN_3
+#define ENCODER_LEFT_INVERT                 1   /* Mirrored mounting */
+
+/* Right wheel: TIM4, CH1 on PB6, CH2 on PB7 */
+#define ENCODER_RIGHT_TIMER_INSTANCE        TIM4
+#define ENCODER_RIGHT_TIMER_CLOCK_ENABLE()  __HAL_RCC_TIM4_CLK_ENABLE()
+#define ENCODER_RIGHT_PORT                  GPIOB
+#define ENCODER_RIGHT_CH1_PIN               GPIO_PIN_6
+#define ENCODER_RIGHT_CH2_PIN               GPIO_PIN_7
+#define ENCODER_RIGHT_INVERT                0
+
+#define ENCODER_INPUT_FILTER                0x6
+
+/** Variables ----------------------------------------------------- */
+static TIM_HandleTypeDef left_handle = { 0 };
+static TIM_HandleTypeDef right_handle = { 0 };
+
+static uint16_t left_last = 0;
+static uint16_t right_last = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static void encoder_timer_init(TIM_HandleTypeDef *handle, TIM_TypeDef *instance);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Configures a timer in x4 encoder mode and starts it.
+ */
+static void encoder_timer_init(TIM_HandleTypeDef *handle, TIM_TypeDef *instance) {
+    handle->Instance = instance;
+    handle->Init.Prescaler = 0;
+    handle->Init.Period = 0xFFFF;
+    handle->Init.CounterMode = TIM_COUNTERMODE_UP;
+    handle->Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+
+    TIM_Encoder_InitTypeDef encoder_config = { 0 };
+    encoder_config.EncoderMode = TIM_ENCODERMODE_TI12;
+    encoder_config.IC1Polarity = TIM_ICPOLARITY_RISING;
+    encoder_config.IC1Selection = TIM_ICSELECTION_DIRECTTI;
+    encoder_config.IC1Prescaler = TIM_ICPSC_DIV1;
+    encoder_config.IC1Filter = ENCODER_INPUT_FILTER;
+    encoder_config.IC2Polarity = TIM_ICPOLARITY_RISING;
+    encoder_config.IC2Selection = TIM_ICSELECTION_DIRECTTI;
+    encoder_config.IC2Prescaler = TIM_ICPSC_DIV1;
+    encoder_config.IC2Filter = ENCODER_INPUT_FILTER;
+    HAL_TIM_Encoder_Init(handle, &encoder_config);
+
+    HAL_TIM_Encoder_Start(handle, TIM_CHANNEL_ALL);
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures the encoder pins and timers.
+ */
+void encoder_setup(void) {
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    ENCODER_LEFT_TIMER_CLOCK_ENABLE();
+    ENCODER_RIGHT_TIMER_CLOCK_ENABLE();
+
+    /* Free PA15/PB3 from JTAG, SWD stays available */
+    __HAL_AFIO_REMAP_SWJ_NOJTAG();
+    __HAL_AFIO_REMAP_TIM2_PARTIAL_1();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Mode = GPIO_MODE_INPUT;
+    gpio_init.Pull = GPIO_PULLUP;
+
+    gpio_init.Pin = ENCODER_LEFT_CH1_PIN;
+    HAL_GPIO_Init(ENCODER_LEFT_CH1_PORT, &gpio_init);
+    gpio_init.Pin = ENCODER_LEFT_CH2_PIN;
+    HAL_GPIO_Init(ENCODER_LEFT_CH2_PORT, &gpio_init);
+    gpio_init.Pin = ENCODER_RIGHT_CH1_PIN | ENCODER_RIGHT_CH2_PIN;
+    HAL_GPIO_Init(ENCODER_RIGHT_PORT, &gpio_init);
+
+    encoder_timer_init(&left_handle, ENCODER_LEFT_TIMER_INSTANCE);
+    encoder_timer_init(&right_handle, ENCODER_RIGHT_TIMER_INSTANCE);
+
+    left_last = (uint16_t)__HAL_TIM_GET_COUNTER(&left_handle);
+    right_last = (uint16_t)__HAL_TIM_GET_COUNTER(&right_handle);
+}
+
+/**
+ * @brief Gets the counts accumulated since the previous call.
+ *
+ * Must be called more often than a 32767 count overflow, which is many
+ * seconds at full speed.
+ *
+ * @param left_counts   Left wheel counts, positive forward.
+ * @param right_counts  Right wheel counts, positive forward.
+ */
+void encoder_read(int16_t *left_counts, int16_t *right_counts) {
+    uint16_t left = (uint16_t)__HAL_TIM_GET_COUNTER(&left_handle);
+    uint16_t right = (uint16_t)__HAL_TIM_GET_COUNTER(&right_handle);
+
+    int16_t left_delta = (int16_t)(left - left_last);
+    int16_t right_delta = (int16_t)(right - right_last);
+    left_last = left;
+    right_last = right;
+
+    *left_counts = ENCODER_LEFT_INVERT ? -left_delta : left_delta;
+    *right_counts = ENCODER_RIGHT_INVERT ? -right_delta : right_delta;
+}
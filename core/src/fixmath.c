@@ -0,0 +1,185 @@
+/**
+ * @file
+ * @brief Fixed-point trigonometry, reciprocal and square root.
+ *
+ * Everything here is integer only, with a fixed instruction count per call,
+ * so nothing pulls in the soft-float library.
+ */
+#include <stdint.h>
+
+#include "fixmath.h"
+
+/** Definitions --------------------------------------------------- */
+#define SIN_TABLE_BITS      8
+#define SIN_TABLE_SIZE      (1 << SIN_TABLE_BITS)
+
+/** Newton-Raphson seed 48/17 - 32/17 * d for 1/d, d in [0.5, 1), in Q30. */
+#define RECIP_SEED_OFFSET   3031741621u
+#define RECIP_SEED_SLOPE    2021161081u
+#define RECIP_ITERATIONS    3
+
+/** Variables ----------------------------------------------------- */
+/** sin(x) in Q15 over the first quadrant, SIN_TABLE_SIZE + 1 points. */
+static const q15_t sin_table[SIN_TABLE_SIZE + 1] = {
+    0, 201, 402, 603, 804, 1005, 1206, 1407,
+    1608, 1809, 2009, 2210, 2410, 2611, 2811, 3012,
+    3212, 3412, 3612, 3811, 4011, 4210, 4410, 4609,
+    4808, 5007, 5205, 5404, 5602, 5800, 5998, 6195,
+    6393, 6590, 6786, 6983, 7179, 7375, 7571, 7767,
+    7962, 8157, 8351, 8545, 8739, 8933, 9126, 9319,
+    9512, 9704, 9896, 10087, 10278, 10469, 10659, 10849,
+    11039, 11228, 11417, 11605, 11793, 11980, 12167, 12353,
+    12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+    14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269,
+    15446, 15623, 15800, 15976, 16151, 16325, 16499, 16673,
+    16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+    18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357,
+    19519, 19680, 19841, 20000, 20159, 20317, 20475, 20631,
+    20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+    22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027,
+    23170, 23311, 23452, 23592, 23731, 23870, 24007, 24143,
+    24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+    25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198,
+    26319, 26438, 26556, 26674, 26790, 26905, 27019, 27133,
+    27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+    28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803,
+    28898, 28992, 29085, 29177, 29268, 29358, 29447, 29534,
+    29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+    30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783,
+    30852, 30919, 30985, 31050, 31113, 31176, 31237, 31297,
+    31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+    31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098,
+    32137, 32176, 32213, 32250, 32285, 32318, 32351, 32382,
+    32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+    32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717,
+    32728, 32737, 32745, 32752, 32757, 32761, 32765, 32766,
+    32767,
+};
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Sine, from a quarter-wave table with linear interpolation.
+ *
+ * Maximum error is about 2 LSB.
+ *
+ * @param angle     Angle, in q31_t semicircles.
+ *
+ * @return sin(angle) in Q15.
+ */
+q15_t fix_sin(q31_t angle) {
+    uint32_t phase = (uint32_t)angle;
+    uint32_t quadrant = phase >> 30;
+    uint32_t position = (phase >> 14) & 0xFFFF;    /* 8 index bits, 8 fraction bits */
+
+    if (quadrant & 1) {
+        position = 0x10000 - position;
+    }
+
+    uint32_t index = position >> 8;
+    int32_t fraction = (int32_t)(position & 0xFF);
+    int32_t value = sin_table[index];
+
+    if (fraction != 0) {
+        value += ((sin_table[index + 1] - value) * fraction + 128) >> 8;
+    }
+
+    return (q15_t)(quadrant & 2 ? -value : value);
+}
+
+/**
+ * @brief Cosine, as a quarter turn shifted sine.
+ *
+ * @param angle     Angle, in q31_t semicircles.
+ *
+ * @return cos(angle) in Q15.
+ */
+q15_t fix_cos(q31_t angle) {
+    return fix_sin((q31_t)((uint32_t)angle + (uint32_t)FIX_ANGLE_QUARTER));
+}
+
+/**
+ * @brief Reciprocal of a 16.16 value.
+ *
+ * The input is normalised with CLZ and refined by Newton-Raphson from a
+ * linear seed, so it needs no 64-bit division. Relative error is below 1e-8
+ * before the final rounding.
+ *
+ * @param value     Value to invert.
+ *
+ * @return 1 / value in 16.16, saturated for |value| below 2^-15 and for 0.
+ */
+q16_t fix_recip(q16_t value) {
+    if (value == 0) {
+        return INT32_MAX;
+    }
+
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    uint32_t shift = (uint32_t)__builtin_clz(magnitude);
+    uint32_t d = magnitude << shift;    /* d in [0.5, 1) as Q32 */
+    uint32_t y = RECIP_SEED_OFFSET - (uint32_t)(((uint64_t)RECIP_SEED_SLOPE * d) >> 32);
+
+    for (uint8_t i = 0; i < RECIP_ITERATIONS; i++) {
+        uint32_t product = (uint32_t)(((uint64_t)d * y) >> 32);    /* d * y in Q30 */
+        y = (uint32_t)(((uint64_t)y * ((1u << 31) - product)) >> 30);
+    }
+
+    /* 1 / value = (1 / d) * 2^shift in 16.16, with y = 1 / d in Q30 */
+    uint64_t result = shift >= 30 ? (uint64_t)y << (shift - 30)
+                                  : ((uint64_t)y + (1u << (29 - shift))) >> (30 - shift);
+    if (result > INT32_MAX) {
+        result = INT32_MAX;
+    }
+
+    return value < 0 ? -(q16_t)result : (q16_t)result;
+}
+
+/**
+ * @brief Integer square root, rounded down.
+ *
+ * One result bit per iteration, 16 iterations regardless of the input.
+ *
+ * @param value     Radicand.
+ *
+ * @return floor(sqrt(value)).
+ */
+uint16_t fix_isqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint16_t)root;
+}
+
+/**
+ * @brief Square root of a 16.16 value.
+ *
+ * Exact to the last bit below 1.0; above that the result keeps 16
+ * significant bits.
+ *
+ * @param value     Radicand, negative values give 0.
+ *
+ * @return sqrt(value) in 16.16.
+ */
+q16_t fix_sqrt(q16_t value) {
+    if (value <= 0) {
+        return 0;
+    }
+
+    /* sqrt(v / 2^16) * 2^16 = sqrt(v * 2^16): pre-shift by the largest even
+     * amount that fits, and make up the rest on the result */
+    uint32_t shift = (uint32_t)__builtin_clz((uint32_t)value) & ~1u;
+    if (shift > 16) {
+        shift = 16;
+    }
+
+    return (q16_t)fix_isqrt((uint32_t)value << shift) << ((16 - shift) / 2);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file
+ * @brief Gyro heading hold for straight driving.
+ *
+ * heading_update() runs at IMU_RATE_HZ with every gyro sample: it removes
+ * the bias, integrates the heading and, while driving straight, runs a PID
+ * loop on the heading held since the straight command started. The output
+ * is a trim moved from one wheel effort to the other, so a pair of
+ * mismatched motors still drives a straight line; the integral term ends
+ * up holding the mismatch. heading_hold() is called from the control loop,
+ * selects the mode from the setpoint and applies the latest trim.
+ *
+ * The bias is learnt while the car has been stopped for
+ * HEADING_SETTLE_SAMPLES. Angles are q31_t semicircles like the odometry
+ * heading; the loop works in centidegrees, all in integers.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "heading.h"
+#include "param.h"
+
+/** Definitions --------------------------------------------------- */
+/** Heading change per gyro LSB over one sample, in Q8 semicircle units:
+ * 2^31 / 180 / (LSB per deg/s) / (samples per second). */
+#define HEADING_ANGLE_PER_LSB_Q8    ((int64_t)(((int64_t)1 << 39) / (180LL * IMU_GYRO_LSB_PER_DPS * IMU_RATE_HZ)))
+
+#define HEADING_CENTIDEGREES        18000   /* Per semicircle */
+
+/** Variables ----------------------------------------------------- */
+static volatile heading_mode_t mode = HEADING_MODE_REST;
+static volatile int16_t trim = 0;
+
+static int64_t angle_q16 = 0;
+static volatile q31_t published = 0;
+static int32_t bias_q8 = 0;
+static q31_t target = 0;
+static int32_t integral = 0;       /* Effort counts x 100 */
+static bool engaged = false;
+static uint32_t rest_samples = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static int16_t heading_loop(q31_t heading, int32_t rate_q8);
+static int16_t heading_clamp(int32_t value, int32_t limit);
+
+/** Internal functions -------------------------------------------- */
+static int16_t heading_clamp(int32_t value, int32_t limit) {
+    return (int16_t)(value > limit ? limit : value < -limit ? -limit : value);
+}
+
+/**
+ * @brief Runs one PID step on the heading error.
+ *
+ * @param heading   Current heading.
+ * @param rate_q8   Yaw rate without bias, in Q8 gyro LSB.
+ *
+ * @return Trim, positive to turn counter-clockwise.
+ */
+static int16_t heading_loop(q31_t heading, int32_t rate_q8) {
+    int32_t error_cd = (int32_t)(((int64_t)(q31_t)(target - heading) * HEADING_CENTIDEGREES) >> 31);
+    int32_t rate_cd = (int32_t)((int64_t)rate_q8 * 100 / (IMU_GYRO_LSB_PER_DPS * 256));
+
+    integral += param_get(PARAM_HEADING_KI) * error_cd / IMU_RATE_HZ;
+    integral = heading_clamp(integral, HEADING_TRIM_MAX * 100);
+
+    int32_t trim = param_get(PARAM_HEADING_KP) * error_cd - param_get(PARAM_HEADING_KD) * rate_cd + integral;
+    return heading_clamp(trim / 100, HEADING_TRIM_MAX);
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Resets the heading to 0 and forgets the bias.
+ */
+void heading_init(void) {
+    mode = HEADING_MODE_REST;
+    trim = 0;
+    angle_q16 = 0;
+    published = 0;
+    bias_q8 = 0;
+    integral = 0;
+    engaged = false;
+    rest_samples = 0;
+}
+
+/**
+ * @brief Integrates a gyro sample and updates the trim. Must run at
+ * IMU_RATE_HZ.
+ *
+ * @param rate  Yaw rate, in gyro LSB, counter-clockwise positive.
+ */
+void heading_update(int16_t rate) {
+    heading_mode_t current = mode;
+
+    if (current == HEADING_MODE_REST) {
+        if (rest_samples < HEADING_SETTLE_SAMPLES) {
+            rest_samples++;
+        } else {
+            bias_q8 += (((int32_t)rate << 8) - bias_q8) >> HEADING_BIAS_SHIFT;
+        }
+    } else {
+        rest_samples = 0;
+    }
+
+    int32_t rate_q8 = ((int32_t)rate << 8) - bias_q8;
+    angle_q16 += rate_q8 * HEADING_ANGLE_PER_LSB_Q8;
+    q31_t heading = (q31_t)(uint32_t)(angle_q16 >> 16);
+    published = heading;
+
+    if (current != HEADING_MODE_HOLD) {
+        engaged = false;
+        trim = 0;
+        return;
+    }
+
+    if (!engaged) {
+        engaged = true;
+        target = heading;
+        integral = 0;
+    }
+    trim = heading_loop(heading, rate_q8);
+}
+
+/**
+ * @brief Drops the correction after a missed sample. The heading held is
+ * taken again once samples are back.
+ */
+void heading_lost(void) {
+    engaged = false;
+    trim = 0;
+    rest_samples = 0;
+}
+
+/**
+ * @brief Selects the mode from a setpoint and, when driving straight,
+ * moves the trim from one wheel to the other. The trim is limited to half
+ * the effort, so it never reverses a wheel.
+ *
+ * @param setpoint  Setpoint about to be sent to the motors.
+ */
+void heading_hold(drive_setpoint_t *setpoint) {
+    if (setpoint->left == 0 && setpoint->right == 0) {
+        mode = HEADING_MODE_REST;
+        return;
+    }
+    if (setpoint->left != setpoint->right) {
+        mode = HEADING_MODE_FREE;
+        return;
+    }
+
+    mode = HEADING_MODE_HOLD;
+
+    int32_t effort = setpoint->left < 0 ? -setpoint->left : setpoint->left;
+    int16_t correction = heading_clamp(trim, effort / 2);
+
+    setpoint->left = heading_clamp(setpoint->left - correction, DRIVE_EFFORT_MAX);
+    setpoint->right = heading_clamp(setpoint->right + correction, DRIVE_EFFORT_MAX);
+}
+
+void heading_get(heading_state_t *state) {
+    state->heading = published;
+    state->bias_q8 = bias_q8;
+    state->trim = trim;
+    state->mode = (uint8_t)mode;
+    state->reserved = 0;
+}
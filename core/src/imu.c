@@ -0,0 +1,231 @@
+/**
+ * @file
+ * @brief MPU6050 gyro sampling, as a non-blocking bus state machine.
+ *
+ * All the sequencing runs in imu_tick(); the completion callback only
+ * records the outcome, so the state is never touched from two contexts.
+ * The callback and the tick must not preempt each other.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "imu.h"
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    IMU_TRANSFER_NONE = 0,
+    IMU_TRANSFER_PENDING,
+    IMU_TRANSFER_DONE,
+    IMU_TRANSFER_FAILED,
+} imu_transfer_t;
+
+typedef struct {
+    uint8_t reg;
+    uint8_t value;
+} imu_register_t;
+
+/** Variables ----------------------------------------------------- */
+/** Gyro clock, 1 kHz output through the low pass filter, +-250 deg/s. */
+static const imu_register_t imu_config[] = {
+    { IMU_REG_PWR_MGMT_1, IMU_PWR_CLOCK_PLL_X },
+    { IMU_REG_SMPLRT_DIV, 0 },
+    { IMU_REG_CONFIG, IMU_CONFIG_DLPF_44HZ },
+    { IMU_REG_GYRO_CONFIG, IMU_GYRO_FS_250DPS },
+};
+
+#define IMU_CONFIG_COUNT    (sizeof(imu_config) / sizeof(imu_config[0]))
+
+static volatile imu_transfer_t transfer = IMU_TRANSFER_NONE;
+static uint8_t buffer[2];
+static uint8_t pending_ticks = 0;
+static uint8_t failures = 0;
+
+static imu_state_t state = IMU_STATE_RESET;
+static imu_state_t next_state = IMU_STATE_RESET;
+static uint8_t step = 0;
+static uint8_t wait_ticks = 0;
+
+static imu_stats_t imu_stats = { 0 };
+
+/** Prototypes ---------------------------------------------------- */
+static void imu_restart(void);
+static void imu_wait(uint8_t ticks, imu_state_t next);
+static bool imu_complete(int16_t *rate);
+static void imu_start(void);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Recovers the bus and starts over from the device reset.
+ */
+static void imu_restart(void) {
+    imu_bus_recover();
+    imu_stats.resets++;
+    transfer = IMU_TRANSFER_NONE;
+    failures = 0;
+    state = IMU_STATE_RESET;
+}
+
+static void imu_wait(uint8_t ticks, imu_state_t next) {
+    state = IMU_STATE_WAIT;
+    next_state = next;
+    wait_ticks = ticks;
+}
+
+/**
+ * @brief Moves on after a successful transfer.
+ *
+ * @return true if the transfer was a sample read.
+ */
+static bool imu_complete(int16_t *rate) {
+    failures = 0;
+
+    switch (state) {
+        case IMU_STATE_RESET: {
+            imu_wait(IMU_RESET_TICKS, IMU_STATE_IDENTIFY);
+            break;
+        }
+        case IMU_STATE_IDENTIFY: {
+            if (buffer[0] != IMU_WHO_AM_I_VALUE) {
+                imu_stats.errors++;
+                imu_restart();
+                break;
+            }
+            state = IMU_STATE_CONFIGURE;
+            step = 0;
+            break;
+        }
+        case IMU_STATE_CONFIGURE: {
+            if (++step == IMU_CONFIG_COUNT) {
+                imu_wait(IMU_START_TICKS, IMU_STATE_RUN);
+            }
+            break;
+        }
+        case IMU_STATE_RUN: {
+            *rate = (int16_t)((buffer[0] << 8) | buffer[1]);
+            imu_stats.samples++;
+            return true;
+        }
+        default: {
+            break;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Starts the transfer of the current state, if it has one.
+ */
+static void imu_start(void) {
+    bool started = true;
+
+    if (state == IMU_STATE_WAIT) {
+        if (--wait_ticks != 0) {
+            return;
+        }
+        state = next_state;
+    }
+
+    transfer = IMU_TRANSFER_PENDING;
+    pending_ticks = 0;
+
+    switch (state) {
+        case IMU_STATE_RESET: {
+            started = imu_bus_write(IMU_REG_PWR_MGMT_1, IMU_PWR_DEVICE_RESET);
+            break;
+        }
+        case IMU_STATE_IDENTIFY: {
+            started = imu_bus_read(IMU_REG_WHO_AM_I, buffer, 1);
+            break;
+        }
+        case IMU_STATE_CONFIGURE: {
+            started = imu_bus_write(imu_config[step].reg, imu_config[step].value);
+            break;
+        }
+        case IMU_STATE_RUN: {
+            started = imu_bus_read(IMU_REG_GYRO_ZOUT_H, buffer, sizeof(buffer));
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+
+    if (!started) {
+        transfer = IMU_TRANSFER_FAILED;
+    }
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Starts over from the device reset.
+ */
+void imu_init(void) {
+    transfer = IMU_TRANSFER_NONE;
+    failures = 0;
+    state = IMU_STATE_RESET;
+    imu_stats = (imu_stats_t){ 0 };
+}
+
+/**
+ * @brief Collects the last transfer and starts the next one. Must run at
+ * IMU_RATE_HZ.
+ *
+ * @param rate  Yaw rate read during the last period, in gyro LSB,
+ *              counter-clockwise positive.
+ *
+ * @return true if a new rate was read.
+ */
+bool imu_tick(int16_t *rate) {
+    bool sampled = false;
+
+    switch (transfer) {
+        case IMU_TRANSFER_PENDING: {
+            if (++pending_ticks < IMU_TIMEOUT_TICKS) {
+                return false;
+            }
+            imu_stats.timeouts++;
+            imu_restart();
+            break;
+        }
+        case IMU_TRANSFER_FAILED: {
+            imu_stats.errors++;
+            if (++failures >= IMU_RETRY_LIMIT) {
+                imu_restart();
+            }
+            break;
+        }
+        case IMU_TRANSFER_DONE: {
+            sampled = imu_complete(rate);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+
+    transfer = IMU_TRANSFER_NONE;
+    imu_start();
+    imu_stats.state = (uint8_t)state;
+
+    return sampled;
+}
+
+/**
+ * @brief Checks whether a transfer is running, so the bus DMA channel is in
+ * use.
+ */
+bool imu_busy(void) {
+    return transfer == IMU_TRANSFER_PENDING;
+}
+
+void imu_bus_done(bool ok) {
+    if (transfer == IMU_TRANSFER_PENDING) {
+        transfer = ok ? IMU_TRANSFER_DONE : IMU_TRANSFER_FAILED;
+    }
+}
+
+void imu_get_stats(imu_stats_t *stats) {
+    *stats = imu_stats;
+}
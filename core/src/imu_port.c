@@ -0,0 +1,215 @@
+/**
+ * @file
+ * @brief I2C2 bus hooks of the gyro driver.
+ *
+ * The MPU6050 sits on I2C2 (PB10 SCL, PB11 SDA) at 400 kHz. Register writes
+ * and the one byte identity read are interrupt driven; sample reads go
+ * through DMA1 channel 5, which is configured again for every read since
+ * the LED strip and the console update share it (see led_strip.c). A two
+ * byte read keeps the bus about 0.15 ms.
+ *
+ * The I2C event, error and DMA interrupts share one priority level with the
+ * PWM timer interrupt that runs imu_tick(), so completions never preempt the
+ * state machine.
+ *
+ * Recovery aborts the transfer and clocks SCL by hand until a slave holding
+ * SDA low lets it go, then generates a stop.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "imu.h"
+#include "irq.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define IMU_GPIO_CLOCK_ENABLE()     __HAL_RCC_GPIOB_CLK_ENABLE()
+#define IMU_PORT                    GPIOB
+#define IMU_SCL_PIN                 GPIO_PIN_10
+#define IMU_SDA_PIN                 GPIO_PIN_11
+
+#define IMU_I2C_INSTANCE            I2C2
+#define IMU_I2C_CLOCK_ENABLE()      __HAL_RCC_I2C2_CLK_ENABLE()
+#define IMU_I2C_EV_IRQ              I2C2_EV_IRQn
+#define IMU_I2C_ER_IRQ              I2C2_ER_IRQn
+#define IMU_I2C_SPEED_HZ            400000
+
+#define IMU_DMA_CHANNEL             DMA1_Channel5
+#define IMU_DMA_CLOCK_ENABLE()      __HAL_RCC_DMA1_CLK_ENABLE()
+#define IMU_DMA_IRQ                 DMA1_Channel5_IRQn
+
+#define IMU_RECOVERY_CLOCKS         9
+#define IMU_RECOVERY_HALF_US        5
+
+/** Variables ----------------------------------------------------- */
+static I2C_HandleTypeDef i2c_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+
+static uint8_t write_value;
+
+/** Prototypes ---------------------------------------------------- */
+static void imu_bus_pins(uint32_t mode);
+static void imu_bus_delay(void);
+
+/** Internal functions -------------------------------------------- */
+static void imu_bus_pins(uint32_t mode) {
+    GPIO_InitTypeDef gpio_init = { 0 };
+
+    gpio_init.Pin = IMU_SCL_PIN | IMU_SDA_PIN;
+    gpio_init.Mode = mode;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(IMU_PORT, &gpio_init);
+}
+
+/**
+ * @brief Waits half a recovery clock period on the cycle counter.
+ */
+static void imu_bus_delay(void) {
+    uint32_t start = DWT->CYCCNT;
+    uint32_t cycles = SystemCoreClock / 1000000 * IMU_RECOVERY_HALF_US;
+
+    while (DWT->CYCCNT - start < cycles) {
+    }
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures I2C2, its reception DMA and their interrupts.
+ */
+void imu_bus_setup(void) {
+    IMU_GPIO_CLOCK_ENABLE();
+    IMU_I2C_CLOCK_ENABLE();
+    IMU_DMA_CLOCK_ENABLE();
+
+    imu_bus_pins(GPIO_MODE_AF_OD);
+
+    i2c_handle.Instance = IMU_I2C_INSTANCE;
+    i2c_handle.Init.ClockSpeed = IMU_I2C_SPEED_HZ;
+    i2c_handle.Init.DutyCycle = I2C_DUTYCYCLE_2;
+    i2c_handle.Init.OwnAddress1 = 0;
+    i2c_handle.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+    i2c_handle.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+    i2c_handle.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+    i2c_handle.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+    HAL_I2C_Init(&i2c_handle);
+
+    dma_handle.Instance = IMU_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma_handle.Init.Mode = DMA_NORMAL;
+    dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+    __HAL_LINKDMA(&i2c_handle, hdmarx, dma_handle);
+
+    HAL_NVIC_SetPriority(IMU_I2C_EV_IRQ, IRQ_PREEMPT_IMU, IRQ_SUB_IMU);
+    HAL_NVIC_EnableIRQ(IMU_I2C_EV_IRQ);
+    HAL_NVIC_SetPriority(IMU_I2C_ER_IRQ, IRQ_PREEMPT_IMU, IRQ_SUB_IMU);
+    HAL_NVIC_EnableIRQ(IMU_I2C_ER_IRQ);
+    HAL_NVIC_SetPriority(IMU_DMA_IRQ, IRQ_PREEMPT_IMU, IRQ_SUB_IMU);
+    HAL_NVIC_EnableIRQ(IMU_DMA_IRQ);
+}
+
+/**
+ * @brief Sets the bus clock after a clock profile switch. A transfer cut
+ * short ends in a timeout and a recovery.
+ */
+void imu_bus_retime(void) {
+    HAL_I2C_Init(&i2c_handle);
+}
+
+bool imu_bus_write(uint8_t reg, uint8_t value) {
+    write_value = value;
+    return HAL_I2C_Mem_Write_IT(&i2c_handle, IMU_I2C_ADDRESS << 1, reg, I2C_MEMADD_SIZE_8BIT, &write_value, 1)
+           == HAL_OK;
+}
+
+/**
+ * @brief Starts a register read, by DMA from two bytes on. The F1 I2C needs
+ * the acknowledge handled by hand for a single byte, left to the interrupt
+ * path.
+ */
+bool imu_bus_read(uint8_t reg, uint8_t *data, uint8_t size) {
+    if (size < 2) {
+        return HAL_I2C_Mem_Read_IT(&i2c_handle, IMU_I2C_ADDRESS << 1, reg, I2C_MEMADD_SIZE_8BIT, data, size)
+               == HAL_OK;
+    }
+
+    HAL_DMA_Init(&dma_handle);
+    return HAL_I2C_Mem_Read_DMA(&i2c_handle, IMU_I2C_ADDRESS << 1, reg, I2C_MEMADD_SIZE_8BIT, data, size) == HAL_OK;
+}
+
+/**
+ * @brief Aborts the transfer, frees SDA and restarts the peripheral.
+ */
+void imu_bus_recover(void) {
+    HAL_DMA_Abort(&dma_handle);
+    HAL_I2C_DeInit(&i2c_handle);
+
+    HAL_GPIO_WritePin(IMU_PORT, IMU_SCL_PIN | IMU_SDA_PIN, GPIO_PIN_SET);
+    imu_bus_pins(GPIO_MODE_OUTPUT_OD);
+
+    for (uint32_t i = 0; i < IMU_RECOVERY_CLOCKS; i++) {
+        if (HAL_GPIO_ReadPin(IMU_PORT, IMU_SDA_PIN) == GPIO_PIN_SET) {
+            break;
+        }
+        HAL_GPIO_WritePin(IMU_PORT, IMU_SCL_PIN, GPIO_PIN_RESET);
+        imu_bus_delay();
+        HAL_GPIO_WritePin(IMU_PORT, IMU_SCL_PIN, GPIO_PIN_SET);
+        imu_bus_delay();
+    }
+
+    /* Stop: SDA rises while SCL is high */
+    HAL_GPIO_WritePin(IMU_PORT, IMU_SDA_PIN, GPIO_PIN_RESET);
+    imu_bus_delay();
+    HAL_GPIO_WritePin(IMU_PORT, IMU_SDA_PIN, GPIO_PIN_SET);
+    imu_bus_delay();
+
+    imu_bus_pins(GPIO_MODE_AF_OD);
+    SET_BIT(IMU_I2C_INSTANCE->CR1, I2C_CR1_SWRST);
+    CLEAR_BIT(IMU_I2C_INSTANCE->CR1, I2C_CR1_SWRST);
+    HAL_I2C_Init(&i2c_handle);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+    imu_bus_done(true);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+    imu_bus_done(true);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+    (void)hi2c;
+    imu_bus_done(false);
+}
+
+void I2C2_EV_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_IMU, IRQ_LATENCY_UNKNOWN);
+    HAL_I2C_EV_IRQHandler(&i2c_handle);
+    IRQ_PROFILE_EXIT(IRQ_ID_IMU);
+}
+
+void I2C2_ER_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_IMU, IRQ_LATENCY_UNKNOWN);
+    HAL_I2C_ER_IRQHandler(&i2c_handle);
+    IRQ_PROFILE_EXIT(IRQ_ID_IMU);
+}
+
+/**
+ * @brief I2C2 reception DMA interrupt. The strip transfers on the same
+ * channel run with its interrupts off.
+ */
+void DMA1_Channel5_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_IMU, IRQ_LATENCY_UNKNOWN);
+    HAL_DMA_IRQHandler(&dma_handle);
+    IRQ_PROFILE_EXIT(IRQ_ID_IMU);
+}
@@ -0,0 +1,334 @@
+/**
+ * @file
+ * @brief Edge driven NEC infrared frame decoder.
+ *
+ * A frame is a 9 ms leader mark and a 4.5 ms space, followed by 32 bits
+ * sent LSB first (address, ~address, command, ~command) and a stop mark.
+ * Every bit is a 562 us mark followed by a 562 us (0) or 1687 us (1) space.
+ * A held key sends a 9 ms mark, a 2.25 ms space and a stop mark.
+ *
+ * With an address filter the address byte and its inverse are checked as
+ * soon as they are in. A frame for another address then only skips pulses
+ * until the next leader mark, and its repeat codes are dropped, so foreign
+ * traffic costs one comparison per edge; the receiver may also stop
+ * listening for IR_NEC_SKIP_US.
+ *
+ * Pulses shorter than the glitch threshold are merged with the pulses around
+ * them before decoding, which costs one pulse of latency. The stop mark is
+ * decoded as soon as it ends, so a frame is never held back waiting for the
+ * next edge.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ir_nec.h"
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    IR_NEC_STATE_IDLE = 0,
+    IR_NEC_STATE_LEADER_SPACE,
+    IR_NEC_STATE_BIT_MARK,
+    IR_NEC_STATE_BIT_SPACE,
+    IR_NEC_STATE_REPEAT_MARK,
+    IR_NEC_STATE_SKIP,
+} ir_nec_state_t;
+
+typedef struct {
+    uint8_t command;
+    ir_key_id_t key;
+} ir_nec_keymap_t;
+
+/** Variables ----------------------------------------------------- */
+/** Command codes of the 17-key remote. */
+static const ir_nec_keymap_t keymap[] = {
+    { 0x18, INFRARED_KEY_UP },
+    { 0x52, INFRARED_KEY_DOWN },
+    { 0x08, INFRARED_KEY_LEFT },
+    { 0x5A, INFRARED_KEY_RIGHT },
+    { 0x1C, INFRARED_KEY_ENTER },
+};
+
+/** Command codes of the digit keys 0 to 9, which have no infrared library
+ * key. */
+static const uint8_t digit_commands[10] = { 0x19, 0x45, 0x46, 0x47, 0x44, 0x40, 0x43, 0x07, 0x15, 0x09 };
+
+/** Prototypes ---------------------------------------------------- */
+static void ir_nec_window(ir_nec_window_t *window, uint32_t nominal_us, uint8_t tolerance_percent);
+static bool ir_nec_match(uint32_t duration_us, const ir_nec_window_t *window);
+static bool ir_nec_awaits_stop(const ir_nec_t *decoder);
+static ir_nec_event_t ir_nec_check_address(ir_nec_t *decoder);
+static ir_nec_event_t ir_nec_process(ir_nec_t *decoder, bool mark, uint32_t duration_us);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Computes the accepted range around a nominal duration.
+ */
+static void ir_nec_window(ir_nec_window_t *window, uint32_t nominal_us, uint8_t tolerance_percent) {
+    uint32_t margin = nominal_us * tolerance_percent / 100;
+
+    window->min = (uint16_t)(nominal_us - margin);
+    window->max = (uint16_t)(nominal_us + margin);
+}
+
+/**
+ * @brief Checks a duration against a precomputed window.
+ */
+static bool ir_nec_match(uint32_t duration_us, const ir_nec_window_t *window) {
+    return duration_us >= window->min && duration_us <= window->max;
+}
+
+/**
+ * @brief Checks whether the next mark ends a frame or a repeat code.
+ */
+static bool ir_nec_awaits_stop(const ir_nec_t *decoder) {
+    return decoder->state == IR_NEC_STATE_REPEAT_MARK
+           || (decoder->state == IR_NEC_STATE_BIT_MARK && decoder->bit_count == IR_NEC_FRAME_BITS);
+}
+
+/**
+ * @brief Checks the address once its bits and their inverse are in.
+ */
+static ir_nec_event_t ir_nec_check_address(ir_nec_t *decoder) {
+    uint8_t address = (uint8_t)decoder->data;
+
+    if ((uint8_t)(address ^ (decoder->data >> 8)) != 0xFF) {
+        decoder->stats.rejected_inverse++;
+        decoder->state = IR_NEC_STATE_IDLE;
+        return IR_NEC_EVENT_NONE;
+    }
+
+    if ((decoder->accept[address >> 5] & (1UL << (address & 31))) == 0) {
+        decoder->stats.rejected_address++;
+        decoder->addressed = false;
+        decoder->state = IR_NEC_STATE_SKIP;
+        return IR_NEC_EVENT_FOREIGN;
+    }
+
+    return IR_NEC_EVENT_NONE;
+}
+
+/**
+ * @brief Runs the frame state machine on one filtered pulse.
+ */
+static ir_nec_event_t ir_nec_process(ir_nec_t *decoder, bool mark, uint32_t duration_us) {
+    switch (decoder->state) {
+        case IR_NEC_STATE_LEADER_SPACE: {
+            if (!mark && ir_nec_match(duration_us, &decoder->leader_space)) {
+                decoder->bit_count = 0;
+                decoder->data = 0;
+                decoder->state = IR_NEC_STATE_BIT_MARK;
+                return IR_NEC_EVENT_NONE;
+            }
+            if (!mark && ir_nec_match(duration_us, &decoder->repeat_space)) {
+                decoder->state = IR_NEC_STATE_REPEAT_MARK;
+                return IR_NEC_EVENT_NONE;
+            }
+            break;
+        }
+        case IR_NEC_STATE_BIT_MARK: {
+            if (mark && ir_nec_match(duration_us, &decoder->bit_mark)) {
+                if (decoder->bit_count < IR_NEC_FRAME_BITS) {
+                    decoder->state = IR_NEC_STATE_BIT_SPACE;
+                    return IR_NEC_EVENT_NONE;
+                }
+
+                decoder->state = IR_NEC_STATE_IDLE;
+
+                uint32_t data = decoder->data;
+                if ((uint8_t)(data ^ (data >> 8)) != 0xFF || (uint8_t)((data >> 16) ^ (data >> 24)) != 0xFF) {
+                    decoder->stats.rejected_inverse++;
+                    return IR_NEC_EVENT_NONE;
+                }
+
+                decoder->address = (uint8_t)data;
+                decoder->command = (uint8_t)(data >> 16);
+                decoder->addressed = true;
+                decoder->stats.accepted++;
+                return IR_NEC_EVENT_FRAME;
+            }
+            break;
+        }
+        case IR_NEC_STATE_BIT_SPACE: {
+            if (!mark && ir_nec_match(duration_us, &decoder->one_space)) {
+                decoder->data |= 1UL << decoder->bit_count;
+                decoder->bit_count++;
+                decoder->state = IR_NEC_STATE_BIT_MARK;
+            } else if (!mark && ir_nec_match(duration_us, &decoder->zero_space)) {
+                decoder->bit_count++;
+                decoder->state = IR_NEC_STATE_BIT_MARK;
+            } else {
+                break;
+            }
+
+            if (decoder->filtering && decoder->bit_count == IR_NEC_ADDRESS_BITS) {
+                return ir_nec_check_address(decoder);
+            }
+            return IR_NEC_EVENT_NONE;
+        }
+        case IR_NEC_STATE_REPEAT_MARK: {
+            if (mark && ir_nec_match(duration_us, &decoder->bit_mark)) {
+                decoder->state = IR_NEC_STATE_IDLE;
+                if (decoder->filtering && !decoder->addressed) {
+                    decoder->stats.rejected_repeats++;
+                    return IR_NEC_EVENT_NONE;
+                }
+                decoder->stats.repeats++;
+                return IR_NEC_EVENT_REPEAT;
+            }
+            break;
+        }
+        case IR_NEC_STATE_SKIP: {
+            if (mark && ir_nec_match(duration_us, &decoder->leader_mark)) {
+                decoder->state = IR_NEC_STATE_LEADER_SPACE;
+            }
+            return IR_NEC_EVENT_NONE;
+        }
+        default: {
+            break;
+        }
+    }
+
+    if (decoder->state != IR_NEC_STATE_IDLE) {
+        decoder->stats.rejected_timing++;
+    }
+
+    if (mark && ir_nec_match(duration_us, &decoder->leader_mark)) {
+        decoder->state = IR_NEC_STATE_LEADER_SPACE;
+    } else {
+        decoder->state = IR_NEC_STATE_IDLE;
+    }
+
+    return IR_NEC_EVENT_NONE;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Resets a decoder and its statistics.
+ *
+ * @param decoder   Decoder instance.
+ * @param config    Glitch threshold and timing tolerance, NULL for defaults.
+ */
+void ir_nec_init(ir_nec_t *decoder, const ir_nec_config_t *config) {
+    uint16_t glitch_us = IR_NEC_DEFAULT_GLITCH_US;
+    uint8_t tolerance = IR_NEC_DEFAULT_TOLERANCE_PERCENT;
+
+    if (config != NULL) {
+        glitch_us = config->glitch_us;
+        tolerance = config->tolerance_percent;
+    }
+
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->state = IR_NEC_STATE_IDLE;
+    decoder->glitch_us = glitch_us;
+
+    ir_nec_window(&decoder->leader_mark, IR_NEC_LEADER_MARK_US, tolerance);
+    ir_nec_window(&decoder->leader_space, IR_NEC_LEADER_SPACE_US, tolerance);
+    ir_nec_window(&decoder->repeat_space, IR_NEC_REPEAT_SPACE_US, tolerance);
+    ir_nec_window(&decoder->bit_mark, IR_NEC_BIT_MARK_US, tolerance);
+    ir_nec_window(&decoder->zero_space, IR_NEC_ZERO_SPACE_US, tolerance);
+    ir_nec_window(&decoder->one_space, IR_NEC_ONE_SPACE_US, tolerance);
+}
+
+/**
+ * @brief Restricts the accepted frames to a set of addresses.
+ *
+ * @param decoder   Decoder instance.
+ * @param addresses Accepted addresses, typically the car, its group and
+ *                  IR_NEC_BROADCAST_ADDRESS.
+ * @param count     Number of addresses, 0 to accept every address.
+ */
+void ir_nec_set_addresses(ir_nec_t *decoder, const uint8_t *addresses, uint8_t count) {
+    memset(decoder->accept, 0, sizeof(decoder->accept));
+    for (uint8_t i = 0; i < count; i++) {
+        decoder->accept[addresses[i] >> 5] |= 1UL << (addresses[i] & 31);
+    }
+
+    decoder->filtering = count != 0;
+    decoder->addressed = false;
+}
+
+/**
+ * @brief Feeds the duration of one completed pulse.
+ *
+ * Any out-of-window pulse drops the partial frame; a leader mark always
+ * starts a new one, so a corrupted frame never hides the next. Frames are
+ * only reported when both address and command match their inverses.
+ *
+ * @param decoder       Decoder instance.
+ * @param mark          true for carrier (mark), false for silence (space).
+ * @param duration_us   Pulse duration, in microseconds.
+ *
+ * @return IR_NEC_EVENT_FRAME when address/command were updated,
+ *         IR_NEC_EVENT_REPEAT for a repeat code, IR_NEC_EVENT_FOREIGN
+ *         when a frame turned out to be for another address.
+ */
+ir_nec_event_t ir_nec_feed(ir_nec_t *decoder, bool mark, uint32_t duration_us) {
+    if (decoder->glitch_us == 0) {
+        return ir_nec_process(decoder, mark, duration_us);
+    }
+
+    if (duration_us < decoder->glitch_us) {
+        decoder->stats.glitches++;
+        if (decoder->pending) {
+            decoder->pending_us += duration_us;
+            decoder->merge_next = true;
+        }
+        return IR_NEC_EVENT_NONE;
+    }
+
+    ir_nec_event_t event = IR_NEC_EVENT_NONE;
+
+    if (decoder->pending && decoder->merge_next && decoder->pending_mark == mark) {
+        decoder->pending_us += duration_us;
+    } else {
+        if (decoder->pending) {
+            event = ir_nec_process(decoder, decoder->pending_mark, decoder->pending_us);
+        }
+        decoder->pending = true;
+        decoder->pending_mark = mark;
+        decoder->pending_us = duration_us;
+    }
+    decoder->merge_next = false;
+
+    if (decoder->pending_mark && ir_nec_awaits_stop(decoder)) {
+        decoder->pending = false;
+        event = ir_nec_process(decoder, true, decoder->pending_us);
+    }
+
+    return event;
+}
+
+/**
+ * @brief Maps a NEC command code to a key.
+ *
+ * @param command   Command byte of a decoded frame.
+ *
+ * @return Matching key, or INFRARED_KEY_NONE for unknown codes.
+ */
+ir_key_id_t ir_nec_key(uint8_t command) {
+    for (uint8_t i = 0; i < sizeof(keymap) / sizeof(keymap[0]); i++) {
+        if (keymap[i].command == command) {
+            return keymap[i].key;
+        }
+    }
+
+    return INFRARED_KEY_NONE;
+}
+
+/**
+ * @brief Maps a NEC command code to a digit key.
+ *
+ * @param command   Command byte of a decoded frame.
+ *
+ * @return Digit 0 to 9, or IR_NEC_DIGIT_NONE for other codes.
+ */
+int8_t ir_nec_digit(uint8_t command) {
+    for (uint8_t i = 0; i < sizeof(digit_commands); i++) {
+        if (digit_commands[i] == command) {
+            return (int8_t)i;
+        }
+    }
+
+    return IR_NEC_DIGIT_NONE;
+}
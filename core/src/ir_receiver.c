@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief Infrared receiver: edge capture feeding the NEC decoder.
+ *
+ * Both edges of the receiver output raise an EXTI interrupt. Pulse durations
+ * are taken from the microsecond timebase and decoded right away, so the
+ * main loop only reads the latest key. Digit keys select modes rather than
+ * being held, so each press is latched until it is taken.
+ *
+ * Once the decoder reports a frame for another address, the EXTI line is
+ * masked for the rest of that frame and unmasked from the SysTick handler,
+ * so the traffic of other cars costs a handful of interrupts per frame.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "ir_receiver.h"
+#include "irq.h"
+#include "timebase.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define IR_RX_GPIO_CLOCK_ENABLE()   __HAL_RCC_GPIOB_CLK_ENABLE()
+#define IR_RX_PORT                  GPIOB
+#define IR_RX_PIN                   GPIO_PIN_9
+#define IR_RX_IRQ                   EXTI9_5_IRQn
+
+/** A key stays pressed while frames or repeat codes (every 108 ms) arrive. */
+#define IR_KEY_HOLD_MS              150
+
+/** Variables ----------------------------------------------------- */
+static ir_nec_t decoder;
+static uint64_t last_edge = 0;
+
+static volatile ir_key_id_t last_key = INFRARED_KEY_NONE;
+static volatile uint32_t last_key_tick = 0;
+static volatile int8_t pressed_digit = IR_NEC_DIGIT_NONE;
+
+static volatile bool muted = false;
+static uint64_t mute_deadline = 0;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures the receiver pin, the cycle counter and the decoder.
+ */
+void ir_receiver_setup(void) {
+    ir_nec_init(&decoder, NULL);
+
+    last_edge = timebase_now();
+
+    IR_RX_GPIO_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = IR_RX_PIN;
+    gpio_init.Mode = GPIO_MODE_IT_RISING_FALLING;
+    gpio_init.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(IR_RX_PORT, &gpio_init);
+
+    HAL_NVIC_SetPriority(IR_RX_IRQ, IRQ_PREEMPT_IR_RX, IRQ_SUB_IR_RX);
+    HAL_NVIC_EnableIRQ(IR_RX_IRQ);
+}
+
+/**
+ * @brief Sets the addresses the car answers to. Frames for any other address
+ * are ignored.
+ *
+ * @param unit      Address of this car.
+ * @param group     Address shared by a set of cars, may equal unit or
+ *                  IR_NEC_BROADCAST_ADDRESS when unused.
+ */
+void ir_receiver_set_addresses(uint8_t unit, uint8_t group) {
+    uint8_t addresses[] = { unit, group, IR_NEC_BROADCAST_ADDRESS };
+
+    HAL_NVIC_DisableIRQ(IR_RX_IRQ);
+    ir_nec_set_addresses(&decoder, addresses, sizeof(addresses));
+    HAL_NVIC_EnableIRQ(IR_RX_IRQ);
+}
+
+/**
+ * @brief Answers frames for every address, as a car with no address
+ * assigned does.
+ */
+void ir_receiver_accept_all(void) {
+    HAL_NVIC_DisableIRQ(IR_RX_IRQ);
+    ir_nec_set_addresses(&decoder, NULL, 0);
+    HAL_NVIC_EnableIRQ(IR_RX_IRQ);
+}
+
+/**
+ * @brief Unmasks the receiver once a foreign frame is over. Called from the
+ * SysTick handler.
+ */
+void ir_receiver_tick(void) {
+    if (!muted || !timebase_expired(mute_deadline)) {
+        return;
+    }
+
+    /* The pulse in progress is a fragment, its duration is discarded by the
+     * decoder like any out of range pulse */
+    last_edge = timebase_now();
+    muted = false;
+    EXTI->PR = IR_RX_PIN;
+    EXTI->IMR |= IR_RX_PIN;
+}
+
+/**
+ * @brief Gets the key currently pressed on the remote.
+ *
+ * @return Last decoded key while it is being held, INFRARED_KEY_NONE otherwise.
+ */
+ir_key_id_t ir_receiver_get_key(void) {
+    __disable_irq();
+    ir_key_id_t key = last_key;
+    uint32_t tick = last_key_tick;
+    __enable_irq();
+
+    if (HAL_GetTick() - tick > IR_KEY_HOLD_MS) {
+        return INFRARED_KEY_NONE;
+    }
+
+    return key;
+}
+
+/**
+ * @brief Takes the last digit key press. Repeat codes of a held key are not
+ * presses.
+ *
+ * @return Digit pressed since the previous call, IR_NEC_DIGIT_NONE if none.
+ */
+int8_t ir_receiver_take_digit(void) {
+    __disable_irq();
+    int8_t digit = pressed_digit;
+    pressed_digit = IR_NEC_DIGIT_NONE;
+    __enable_irq();
+
+    return digit;
+}
+
+/**
+ * @brief Copies the decoder counters.
+ *
+ * @param stats     Accepted/rejected frame counters.
+ */
+void ir_receiver_get_stats(ir_nec_stats_t *stats) {
+    __disable_irq();
+    *stats = decoder.stats;
+    __enable_irq();
+}
+
+/**
+ * @brief Receiver edge interrupt.
+ *
+ * The receiver output is active low, so a rising edge ends a mark.
+ */
+void EXTI9_5_IRQHandler(void) {
+    if (__HAL_GPIO_EXTI_GET_IT(IR_RX_PIN) == 0) {
+        return;
+    }
+    __HAL_GPIO_EXTI_CLEAR_IT(IR_RX_PIN);
+
+    IRQ_PROFILE_ENTER(IRQ_ID_IR_RX, IRQ_LATENCY_UNKNOWN);
+
+    uint64_t now = timebase_now();
+    uint64_t elapsed_us = now - last_edge;
+    uint32_t duration_us = elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us;
+    last_edge = now;
+
+    bool mark = HAL_GPIO_ReadPin(IR_RX_PORT, IR_RX_PIN) == GPIO_PIN_SET;
+    ir_nec_event_t event = ir_nec_feed(&decoder, mark, duration_us);
+
+    if (event == IR_NEC_EVENT_FRAME) {
+        int8_t digit = ir_nec_digit(decoder.command);
+        if (digit != IR_NEC_DIGIT_NONE) {
+            pressed_digit = digit;
+        }
+        last_key = ir_nec_key(decoder.command);
+        last_key_tick = HAL_GetTick();
+    } else if (event == IR_NEC_EVENT_REPEAT) {
+        last_key_tick = HAL_GetTick();
+    } else if (event == IR_NEC_EVENT_FOREIGN) {
+        EXTI->IMR &= ~IR_RX_PIN;
+        mute_deadline = timebase_deadline(IR_NEC_SKIP_US);
+        muted = true;
+    }
+
+    IRQ_PROFILE_EXIT(IRQ_ID_IR_RX);
+}
@@ -0,0 +1,128 @@
+/**
+ * @file
+ * @brief Interrupt priority map and ISR latency profiler.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "irq.h"
+#include "console.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Variables ----------------------------------------------------- */
+static const uint8_t irq_priorities[IRQ_ID_COUNT][2] = {
+    [IRQ_ID_IR_RX] = { IRQ_PREEMPT_IR_RX, IRQ_SUB_IR_RX },
+    [IRQ_ID_CONSOLE] = { IRQ_PREEMPT_CONSOLE, IRQ_SUB_CONSOLE },
+    [IRQ_ID_PWM] = { IRQ_PREEMPT_PWM, IRQ_SUB_PWM },
+    [IRQ_ID_ULTRASONIC] = { IRQ_PREEMPT_ULTRASONIC, IRQ_SUB_ULTRASONIC },
+    [IRQ_ID_SYSTICK] = { IRQ_PREEMPT_SYSTICK, IRQ_SUB_SYSTICK },
+    [IRQ_ID_AUDIO] = { IRQ_PREEMPT_AUDIO, IRQ_SUB_AUDIO },
+    [IRQ_ID_IMU] = { IRQ_PREEMPT_IMU, IRQ_SUB_IMU },
+    [IRQ_ID_RADIO] = { IRQ_PREEMPT_RADIO, IRQ_SUB_RADIO },
+};
+
+static irq_record_t records[IRQ_ID_COUNT];
+static uint32_t reset_tick = 0;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Selects the priority grouping and the SysTick priority.
+ *
+ * HAL_Init() leaves group 4 and encodes the tick priority for it, so the
+ * tick is set again once the grouping changes. Must run before any other
+ * interrupt is configured.
+ */
+void irq_setup(void) {
+    HAL_NVIC_SetPriorityGrouping(IRQ_PRIORITY_GROUPING);
+    HAL_NVIC_SetPriority(SysTick_IRQn, IRQ_PREEMPT_SYSTICK, IRQ_SUB_SYSTICK);
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    irq_profile_reset();
+}
+
+/**
+ * @brief Records a handler entry.
+ *
+ * @param id        Interrupt source.
+ * @param latency   Cycles since the interrupt was raised, or
+ *                  IRQ_LATENCY_UNKNOWN.
+ *
+ * @return Entry timestamp, for irq_profile_exit().
+ */
+uint32_t irq_profile_enter(irq_id_t id, uint32_t latency) {
+    uint32_t start = DWT->CYCCNT;
+    irq_record_t *record = &records[id];
+
+    record->count++;
+    if (latency != IRQ_LATENCY_UNKNOWN) {
+        record->latency_count++;
+        if (latency > record->latency_max) {
+            record->latency_max = latency;
+        }
+    }
+
+    return start;
+}
+
+/**
+ * @brief Records a handler exit.
+ *
+ * @param id        Interrupt source.
+ * @param start     Timestamp returned by irq_profile_enter().
+ */
+void irq_profile_exit(irq_id_t id, uint32_t start) {
+    uint32_t duration = DWT->CYCCNT - start;
+    irq_record_t *record = &records[id];
+
+    record->duration_total += duration;
+    if (duration > record->duration_max) {
+        record->duration_max = duration;
+    }
+}
+
+/**
+ * @brief Clears the statistics, e.g. when the cycle length changes with
+ * the clock profile.
+ */
+void irq_profile_reset(void) {
+    __disable_irq();
+    for (uint8_t id = 0; id < IRQ_ID_COUNT; id++) {
+        records[id] = (irq_record_t){
+            .id = id,
+            .preempt = irq_priorities[id][0],
+            .sub = irq_priorities[id][1],
+        };
+    }
+    reset_tick = HAL_GetTick();
+    __enable_irq();
+}
+
+/**
+ * @brief Sends the statistics to the console: an irq_header_t followed by
+ * one irq_record_t per source.
+ */
+void irq_profile_dump(void) {
+    irq_header_t header = {
+        .magic = IRQ_PROFILE_MAGIC,
+        .record_size = sizeof(irq_record_t),
+        .record_count = IRQ_ID_COUNT,
+        .hclk_hz = SystemCoreClock,
+        .elapsed_ms = HAL_GetTick() - reset_tick,
+    };
+    irq_record_t copy[IRQ_ID_COUNT];
+
+    __disable_irq();
+    for (uint8_t id = 0; id < IRQ_ID_COUNT; id++) {
+        copy[id] = records[id];
+    }
+    __enable_irq();
+
+    console_write(&header, sizeof(header));
+    console_write(copy, sizeof(copy));
+}
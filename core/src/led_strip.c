@@ -0,0 +1,208 @@
+/**
+ * @file
+ * @brief WS2812 LED strip on SPI2, sent by DMA.
+ *
+ * The strip timing is generated by the SPI rather than by the CPU: a frame
+ * is encoded once into a buffer of SPI bits (see lights_encode()) and a
+ * DMA transfer shifts it out of SPI2 MOSI on PB15, about 0.3 ms for the
+ * whole strip, with no interrupt. Frames equal to the one on the strip are
+ * not sent, so the DMA only runs when a light changes.
+ *
+ * SPI2 TX shares DMA1 channel 5 with the gyro I2C reception and the console
+ * reception of firmware updates, so the channel is configured again for
+ * every frame and is used in time slots: led_strip_show() only encodes the
+ * frame, led_strip_start() sends it in the strip slot of the PWM timer
+ * interrupt and led_strip_release() hands the channel back before the gyro
+ * slot, long after the transfer has ended. Two buffers let the next frame
+ * be encoded while one is being sent.
+ *
+ * The latch gap (over 280 us low) is the time between two slots.
+ *
+ * SPI2 is shared with the radio (see radio_port.c), which sets it up full
+ * duplex at its own bit rate for its transfers; the strip setup is written
+ * back before every frame. The strip must be wired through a gate, as the
+ * radio shares MOSI:
+ *
+ *   PB15 (MOSI) --+-- 74HCT1G08 A     10k pull-down
+ *   PB12 (CSN)  --+-- 74HCT1G08 B     10k pull-up to 3.3 V
+ *                     74HCT1G08 Y     strip DIN, gate VCC 5 V
+ *
+ * The strip only sees MOSI while the radio is deselected, and the HCT
+ * inputs take the 3.3 V levels, so the gate is the strip level shifter
+ * too. While the MCU is in reset the resistors keep the radio deselected
+ * and the strip input low. The radio parks MOSI low whenever it deselects,
+ * and the strip hands it back to the SPI for its own frames only.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "led_strip.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define LED_STRIP_GPIO_CLOCK_ENABLE()   __HAL_RCC_GPIOB_CLK_ENABLE()
+#define LED_STRIP_PORT                  GPIOB
+#define LED_STRIP_PIN                   GPIO_PIN_15
+
+#define LED_STRIP_SPI_INSTANCE          SPI2
+#define LED_STRIP_SPI_CLOCK_ENABLE()    __HAL_RCC_SPI2_CLK_ENABLE()
+
+#define LED_STRIP_DMA_CHANNEL           DMA1_Channel5
+#define LED_STRIP_DMA_CLOCK_ENABLE()    __HAL_RCC_DMA1_CLK_ENABLE()
+
+/** Variables ----------------------------------------------------- */
+static SPI_HandleTypeDef spi_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+
+static uint8_t strip_buffers[2][LIGHTS_FRAME_SIZE];
+static uint8_t sent = 0;                /* Buffer of the last transfer */
+static lights_frame_t shown;
+
+static volatile bool pending = false;
+static bool sending = false;
+static bool available = false;
+static uint32_t strip_cr1 = 0;          /* Transmit only, at the strip bit rate */
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures SPI2 as a transmit only bit stream on PB15 and its DMA,
+ * and turns every LED off.
+ */
+void led_strip_setup(void) {
+    LED_STRIP_GPIO_CLOCK_ENABLE();
+    LED_STRIP_SPI_CLOCK_ENABLE();
+    LED_STRIP_DMA_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = LED_STRIP_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_MEDIUM;
+    HAL_GPIO_Init(LED_STRIP_PORT, &gpio_init);
+
+    spi_handle.Instance = LED_STRIP_SPI_INSTANCE;
+    spi_handle.Init.Mode = SPI_MODE_MASTER;
+    spi_handle.Init.Direction = SPI_DIRECTION_1LINE;
+    spi_handle.Init.DataSize = SPI_DATASIZE_8BIT;
+    spi_handle.Init.CLKPolarity = SPI_POLARITY_LOW;
+    spi_handle.Init.CLKPhase = SPI_PHASE_1EDGE;
+    spi_handle.Init.NSS = SPI_NSS_SOFT;
+    spi_handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
+    spi_handle.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    spi_handle.Init.TIMode = SPI_TIMODE_DISABLE;
+    spi_handle.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    HAL_SPI_Init(&spi_handle);
+
+    dma_handle.Instance = LED_STRIP_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma_handle.Init.Mode = DMA_NORMAL;
+    dma_handle.Init.Priority = DMA_PRIORITY_MEDIUM;
+
+    led_strip_retime();
+
+    const lights_frame_t off = { { 0, 0, 0 } };
+    led_strip_show(off);
+}
+
+/**
+ * @brief Sets the bit rate after a clock profile switch: the fastest APB1
+ * division within the WS2812 timing window, if there is one. The frame is
+ * sent again, in case the switch cut a transfer short.
+ */
+void led_strip_retime(void) {
+    __HAL_SPI_DISABLE(&spi_handle);
+    memset(shown, 0xFF, sizeof(shown));
+
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t setting = 0;
+
+    while ((pclk >> (setting + 1)) > LED_STRIP_BIT_RATE_MAX_HZ && setting < 7) {
+        setting++;
+    }
+
+    uint32_t rate = pclk >> (setting + 1);
+    available = rate >= LED_STRIP_BIT_RATE_MIN_HZ && rate <= LED_STRIP_BIT_RATE_MAX_HZ;
+    if (!available) {
+        return;
+    }
+
+    MODIFY_REG(LED_STRIP_SPI_INSTANCE->CR1, SPI_CR1_BR, setting << SPI_CR1_BR_Pos);
+    SPI_1LINE_TX(&spi_handle);
+    strip_cr1 = LED_STRIP_SPI_INSTANCE->CR1;
+    __HAL_SPI_ENABLE(&spi_handle);
+}
+
+/**
+ * @brief Queues a frame for the strip, unless it is already showing.
+ *
+ * A frame that arrives while the previous one still waits for its slot is
+ * dropped; the caller passes it again on its next tick.
+ *
+ * @param frame     Colors of every LED.
+ *
+ * @return true if the frame was queued.
+ */
+bool led_strip_show(const lights_frame_t frame) {
+    if (!available || pending || memcmp(frame, shown, sizeof(shown)) == 0) {
+        return false;
+    }
+
+    lights_encode(frame, strip_buffers[sent ^ 1]);
+    memcpy(shown, frame, sizeof(shown));
+    __sync_synchronize();
+    pending = true;
+
+    return true;
+}
+
+/**
+ * @brief Sends the queued frame, if any. Runs in the strip slot, with the
+ * DMA channel free.
+ */
+void led_strip_start(void) {
+    if (!pending) {
+        return;
+    }
+
+    sent ^= 1;
+    WRITE_REG(LED_STRIP_SPI_INSTANCE->CR1, strip_cr1);
+    __HAL_SPI_ENABLE(&spi_handle);
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = LED_STRIP_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Speed = GPIO_SPEED_FREQ_MEDIUM;
+    HAL_GPIO_Init(LED_STRIP_PORT, &gpio_init);
+
+    HAL_DMA_Init(&dma_handle);
+    __HAL_DMA_DISABLE_IT(&dma_handle, DMA_IT_TC | DMA_IT_HT | DMA_IT_TE);
+    HAL_DMA_Start(&dma_handle, (uint32_t)strip_buffers[sent], (uint32_t)&LED_STRIP_SPI_INSTANCE->DR,
+                  LIGHTS_FRAME_SIZE);
+    SET_BIT(LED_STRIP_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+    sending = true;
+    pending = false;
+}
+
+/**
+ * @brief Stops the SPI DMA requests, so the channel can be used by another
+ * peripheral. The transfer must have ended.
+ */
+void led_strip_release(void) {
+    if (!sending) {
+        return;
+    }
+
+    CLEAR_BIT(LED_STRIP_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+    __HAL_DMA_DISABLE(&dma_handle);
+    sending = false;
+}
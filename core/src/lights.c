@@ -0,0 +1,196 @@
+/**
+ * @file
+ * @brief Car lights on a WS2812 strip: frames from the drive state and
+ * their SPI bit encoding.
+ *
+ * A frame is built every control tick from two layers. The lamps follow the
+ * setpoint: head lights bright while driving forward, tail lights bright
+ * red while stopped or emergency braking, white while reversing. Over them
+ * runs at most one precomputed pattern (indicators, hazards, the start up
+ * sweep), whose step is picked from the time since it started, so nothing
+ * is computed between steps and a frame only changes when a lamp or a
+ * pattern step does.
+ *
+ * Each WS2812 bit is sent as 3 SPI bits, 100 for a zero and 110 for a one,
+ * looked up a nibble at a time. Every frame ends with a zero bit, which
+ * leaves the line low for the latch gap.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lights.h"
+
+/** Definitions --------------------------------------------------- */
+#define LIGHTS_OFF          { 0, 0, 0 }
+#define LIGHTS_AMBER        { 96, 255, 0 }
+#define LIGHTS_SWEEP        { 0, 0, 160 }
+
+#define LIGHTS_HEAD_DIM     32
+#define LIGHTS_HEAD_BRIGHT  192
+#define LIGHTS_TAIL_DIM     40
+#define LIGHTS_TAIL_BRIGHT  255
+#define LIGHTS_REVERSE      160
+
+/** Variables ----------------------------------------------------- */
+/** SPI bits of every nibble, 12 per nibble, most significant first. */
+static const uint16_t lights_nibble_bits[16] = {
+    0x924, 0x926, 0x934, 0x936, 0x9A4, 0x9A6, 0x9B4, 0x9B6,
+    0xD24, 0xD26, 0xD34, 0xD36, 0xDA4, 0xDA6, 0xDB4, 0xDB6,
+};
+
+static const lights_frame_t lights_left_frames[] = {
+    {
+        [LIGHTS_LED_FRONT_LEFT_INDICATOR] = LIGHTS_AMBER,
+        [LIGHTS_LED_REAR_LEFT_INDICATOR] = LIGHTS_AMBER,
+    },
+    { LIGHTS_OFF },
+};
+
+static const lights_frame_t lights_right_frames[] = {
+    {
+        [LIGHTS_LED_FRONT_RIGHT_INDICATOR] = LIGHTS_AMBER,
+        [LIGHTS_LED_REAR_RIGHT_INDICATOR] = LIGHTS_AMBER,
+    },
+    { LIGHTS_OFF },
+};
+
+static const lights_frame_t lights_hazard_frames[] = {
+    {
+        [LIGHTS_LED_FRONT_LEFT_INDICATOR] = LIGHTS_AMBER,
+        [LIGHTS_LED_REAR_LEFT_INDICATOR] = LIGHTS_AMBER,
+        [LIGHTS_LED_FRONT_RIGHT_INDICATOR] = LIGHTS_AMBER,
+        [LIGHTS_LED_REAR_RIGHT_INDICATOR] = LIGHTS_AMBER,
+    },
+    { LIGHTS_OFF },
+};
+
+/** One LED going around the car, then back to the lamps. */
+static const lights_frame_t lights_sweep_frames[LIGHTS_LED_COUNT] = {
+    { [0] = LIGHTS_SWEEP }, { [1] = LIGHTS_SWEEP }, { [2] = LIGHTS_SWEEP }, { [3] = LIGHTS_SWEEP },
+    { [4] = LIGHTS_SWEEP }, { [5] = LIGHTS_SWEEP }, { [6] = LIGHTS_SWEEP }, { [7] = LIGHTS_SWEEP },
+};
+
+static const lights_pattern_t lights_left = { lights_left_frames, 2, LIGHTS_BLINK_MS, true };
+static const lights_pattern_t lights_right = { lights_right_frames, 2, LIGHTS_BLINK_MS, true };
+static const lights_pattern_t lights_hazard = { lights_hazard_frames, 2, LIGHTS_BLINK_MS, true };
+static const lights_pattern_t lights_sweep = { lights_sweep_frames, LIGHTS_LED_COUNT, LIGHTS_SWEEP_MS, false };
+
+static const lights_pattern_t *lights_pattern = NULL;
+static uint32_t lights_pattern_start = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static const lights_pattern_t *lights_select(const drive_setpoint_t *setpoint, bool braking);
+static void lights_lamps(const drive_setpoint_t *setpoint, bool braking, lights_frame_t frame);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Picks the pattern for the drive state: hazards while emergency
+ * braking, otherwise the indicator of the slower side in a turn.
+ */
+static const lights_pattern_t *lights_select(const drive_setpoint_t *setpoint, bool braking) {
+    if (braking) {
+        return &lights_hazard;
+    }
+    if (setpoint->right - setpoint->left > LIGHTS_TURN_THRESHOLD) {
+        return &lights_left;
+    }
+    if (setpoint->left - setpoint->right > LIGHTS_TURN_THRESHOLD) {
+        return &lights_right;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Sets the head and tail lamps, indicators off.
+ */
+static void lights_lamps(const drive_setpoint_t *setpoint, bool braking, lights_frame_t frame) {
+    bool stopped = setpoint->left == 0 && setpoint->right == 0;
+    bool reversing = setpoint->left < 0 && setpoint->right < 0;
+    uint8_t head = setpoint->left + setpoint->right > 0 ? LIGHTS_HEAD_BRIGHT : LIGHTS_HEAD_DIM;
+    lights_color_t tail = { 0, LIGHTS_TAIL_DIM, 0 };
+
+    if (reversing) {
+        tail = (lights_color_t){ LIGHTS_REVERSE, LIGHTS_REVERSE, LIGHTS_REVERSE };
+    } else if (stopped || braking) {
+        tail.red = LIGHTS_TAIL_BRIGHT;
+    }
+
+    for (uint32_t i = 0; i < LIGHTS_LED_COUNT; i++) {
+        frame[i] = (lights_color_t){ 0, 0, 0 };
+    }
+    frame[LIGHTS_LED_FRONT_LEFT_HEAD] = (lights_color_t){ head, head, head };
+    frame[LIGHTS_LED_FRONT_RIGHT_HEAD] = (lights_color_t){ head, head, head };
+    frame[LIGHTS_LED_REAR_LEFT_TAIL] = tail;
+    frame[LIGHTS_LED_REAR_RIGHT_TAIL] = tail;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Starts the start up sweep.
+ *
+ * @param now   Current time, in ms.
+ */
+void lights_init(uint32_t now) {
+    lights_pattern = &lights_sweep;
+    lights_pattern_start = now;
+}
+
+/**
+ * @brief Builds the frame for a drive state.
+ *
+ * A pattern restarts from its first step whenever it is selected, so an
+ * indicator always comes on at once. The start up sweep runs to its end
+ * whatever the drive state.
+ *
+ * @param setpoint  Setpoint sent to the motors.
+ * @param braking   Emergency brake engaged.
+ * @param now       Current time, in ms.
+ * @param frame     Colors of every LED.
+ */
+void lights_frame(const drive_setpoint_t *setpoint, bool braking, uint32_t now, lights_frame_t frame) {
+    uint32_t step = 0;
+
+    if (lights_pattern != NULL) {
+        step = (now - lights_pattern_start) / lights_pattern->step_ms;
+    }
+
+    if (lights_pattern == NULL || lights_pattern->loop || step >= lights_pattern->frame_count) {
+        const lights_pattern_t *pattern = lights_select(setpoint, braking);
+        if (pattern != lights_pattern) {
+            lights_pattern = pattern;
+            lights_pattern_start = now;
+            step = 0;
+        }
+    }
+
+    lights_lamps(setpoint, braking, frame);
+    if (lights_pattern == NULL) {
+        return;
+    }
+
+    const lights_color_t *overlay = lights_pattern->frames[step % lights_pattern->frame_count];
+    for (uint32_t i = 0; i < LIGHTS_LED_COUNT; i++) {
+        if (overlay[i].green != 0 || overlay[i].red != 0 || overlay[i].blue != 0) {
+            frame[i] = overlay[i];
+        }
+    }
+}
+
+/**
+ * @brief Encodes a frame into the SPI bit stream of the strip.
+ *
+ * @param frame     Colors of every LED.
+ * @param buffer    SPI bytes, sent most significant bit first.
+ */
+void lights_encode(const lights_frame_t frame, uint8_t buffer[LIGHTS_FRAME_SIZE]) {
+    const uint8_t *bytes = (const uint8_t *)frame;
+
+    for (uint32_t i = 0; i < LIGHTS_LED_COUNT * sizeof(lights_color_t); i++) {
+        uint32_t bits = ((uint32_t)lights_nibble_bits[bytes[i] >> 4] << 12) | lights_nibble_bits[bytes[i] & 0x0F];
+
+        *buffer++ = (uint8_t)(bits >> 16);
+        *buffer++ = (uint8_t)(bits >> 8);
+        *buffer++ = (uint8_t)bits;
+    }
+}
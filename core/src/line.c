@@ -0,0 +1,158 @@
+/**
+ * @file
+ * @brief Line following from a reflectance sensor array.
+ *
+ * The ADC scans the array continuously into a circular DMA buffer holding
+ * the last LINE_SCAN_DEPTH scans, so line_step() only reads memory: every
+ * sensor is averaged over the buffer, the lightest level is taken as the
+ * floor and the line position is the centroid of the levels above it, the
+ * outer sensors being at -1 and 1. The tape reads darker than the floor,
+ * which with the usual phototransistor modules is a higher voltage.
+ *
+ * The steering is a PID loop on the position, run at LINE_RATE_HZ. The
+ * speed drops on curves and the wheels are never reversed, so the drive
+ * reversal dwell never cuts into the loop. When the line is lost the car
+ * keeps steering for the position it was last seen at, which crosses gaps
+ * in the tape and brings it back from a curve taken too wide, for
+ * LINE_SEARCH_STEPS, then stops until it sees the line again. That is also
+ * the state after line_init().
+ *
+ * A step is a fixed amount of work, LINE_SAMPLE_COUNT additions and a
+ * single division, whatever the samples hold.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "line.h"
+#include "param.h"
+
+/** Definitions --------------------------------------------------- */
+/** Sensor position, evenly spaced from -1 (left) to 1 (right). */
+#define LINE_SENSOR_X(i)            (((2 * (int32_t)(i)) - (LINE_SENSOR_COUNT - 1)) * Q15_ONE \
+                                     / (LINE_SENSOR_COUNT - 1))
+
+/** Variables ----------------------------------------------------- */
+static line_state_t current;
+static q15_t previous = 0;
+static int32_t integral_q15 = 0;   /* Effort counts, Q15 */
+
+/** Prototypes ---------------------------------------------------- */
+static int16_t line_clamp(int32_t value, int32_t min, int32_t max);
+
+/** Internal functions -------------------------------------------- */
+static int16_t line_clamp(int32_t value, int32_t min, int32_t max) {
+    return (int16_t)(value > max ? max : value < min ? min : value);
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Resets the loop. The car waits for the line before moving.
+ */
+void line_init(void) {
+    current = (line_state_t){ .lost_steps = LINE_SEARCH_STEPS };
+    previous = 0;
+    integral_q15 = 0;
+}
+
+/**
+ * @brief Estimates the line position from the sample buffer.
+ *
+ * @param samples   Last LINE_SCAN_DEPTH scans, LINE_SENSOR_COUNT samples
+ *                  each, left sensor first. Scans may be overwritten while
+ *                  they are read.
+ * @param position  Line position, positive to the right. Left unchanged
+ *                  when the line is not seen.
+ * @param contrast  Darkest minus lightest sensor, in ADC counts.
+ *
+ * @return true if the line is seen.
+ */
+bool line_estimate(const volatile uint16_t samples[LINE_SAMPLE_COUNT], q15_t *position, uint16_t *contrast) {
+    uint32_t levels[LINE_SENSOR_COUNT] = { 0 };
+
+    for (uint32_t scan = 0; scan < LINE_SAMPLE_COUNT; scan += LINE_SENSOR_COUNT) {
+        for (uint32_t i = 0; i < LINE_SENSOR_COUNT; i++) {
+            levels[i] += samples[scan + i];
+        }
+    }
+
+    uint32_t darkest = 0;
+    uint32_t lightest = UINT32_MAX;
+    for (uint32_t i = 0; i < LINE_SENSOR_COUNT; i++) {
+        levels[i] /= LINE_SCAN_DEPTH;
+        darkest = levels[i] > darkest ? levels[i] : darkest;
+        lightest = levels[i] < lightest ? levels[i] : lightest;
+    }
+
+    *contrast = (uint16_t)(darkest - lightest);
+    if (*contrast < LINE_CONTRAST_MIN) {
+        return false;
+    }
+
+    /* 12-bit weights keep the sum of products within 32 bits */
+    int32_t weights = 0;
+    int32_t moments = 0;
+    for (uint32_t i = 0; i < LINE_SENSOR_COUNT; i++) {
+        int32_t weight = (int32_t)(levels[i] - lightest);
+        weights += weight;
+        moments += weight * LINE_SENSOR_X(i);
+    }
+
+    *position = fix_sat_q15(moments / weights);
+    return true;
+}
+
+/**
+ * @brief Runs one loop step. Must run at LINE_RATE_HZ.
+ *
+ * @param samples   Sample buffer, see line_estimate().
+ * @param setpoint  Wheel efforts.
+ */
+void line_step(const volatile uint16_t samples[LINE_SAMPLE_COUNT], drive_setpoint_t *setpoint) {
+    q15_t position = current.position;
+
+    if (line_estimate(samples, &position, &current.contrast)) {
+        if (current.lost_steps != 0) {
+            previous = position;
+            integral_q15 = 0;
+        }
+        current.lost_steps = 0;
+    } else {
+        if (current.lost_steps == 0) {
+            current.lost++;
+        }
+        if (current.lost_steps < LINE_SEARCH_STEPS) {
+            current.lost_steps++;
+        }
+        if (current.lost_steps >= LINE_SEARCH_STEPS) {
+            current.steer = 0;
+            drive_wheels(0, 0, setpoint);
+            return;
+        }
+    }
+
+    q15_t change = fix_sat_q15((int32_t)position - previous);
+    previous = position;
+    current.position = position;
+
+    integral_q15 += param_get(PARAM_LINE_KI) * position / LINE_RATE_HZ;
+    if (integral_q15 > (LINE_INTEGRAL_MAX << 15)) {
+        integral_q15 = LINE_INTEGRAL_MAX << 15;
+    } else if (integral_q15 < -(LINE_INTEGRAL_MAX << 15)) {
+        integral_q15 = -(LINE_INTEGRAL_MAX << 15);
+    }
+
+    int32_t steer = (param_get(PARAM_LINE_KP) * position + param_get(PARAM_LINE_KD) * LINE_RATE_HZ * change
+                     + integral_q15) >> 15;
+    current.steer = line_clamp(steer, -LINE_STEER_MAX, LINE_STEER_MAX);
+
+    int32_t magnitude = position < 0 ? -position : position;
+    int32_t base_effort = param_get(PARAM_LINE_BASE_EFFORT);
+    int32_t base = base_effort - ((base_effort / 2 * magnitude) >> 15);
+
+    drive_wheels(line_clamp(base + current.steer, 0, DRIVE_EFFORT_MAX),
+                 line_clamp(base - current.steer, 0, DRIVE_EFFORT_MAX), setpoint);
+}
+
+void line_get_state(line_state_t *state) {
+    *state = current;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file
+ * @brief Reflectance sensor array, scanned by ADC1 into a DMA buffer.
+ *
+ * The four sensors sit on PA0, PA1, PA4 and PA5 (ADC channels 0, 1, 4 and
+ * 5), left to right. ADC1 converts them in continuous scan mode and DMA1
+ * channel 1 stores every conversion into a circular buffer of
+ * LINE_SCAN_DEPTH scans, with no interrupt: the line loop reads the buffer
+ * whenever it runs and never waits for a conversion.
+ *
+ * With the longest sample time a scan takes 1008 ADC clocks, so the buffer
+ * spans 0.9 ms at full speed and 2 ms at the lowest clock, about one loop
+ * period.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "line_sensor.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define LINE_SENSOR_GPIO_CLOCK_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
+#define LINE_SENSOR_PORT                GPIOA
+#define LINE_SENSOR_PINS                (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_4 | GPIO_PIN_5)
+
+#define LINE_SENSOR_ADC_INSTANCE        ADC1
+#define LINE_SENSOR_ADC_CLOCK_ENABLE()  __HAL_RCC_ADC1_CLK_ENABLE()
+#define LINE_SENSOR_SAMPLE_TIME         ADC_SAMPLETIME_239CYCLES_5
+
+#define LINE_SENSOR_DMA_CHANNEL         DMA1_Channel1
+#define LINE_SENSOR_DMA_CLOCK_ENABLE()  __HAL_RCC_DMA1_CLK_ENABLE()
+
+/** Variables ----------------------------------------------------- */
+static ADC_HandleTypeDef adc_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+
+static const uint32_t sensor_channels[LINE_SENSOR_COUNT] = {
+    ADC_CHANNEL_0, ADC_CHANNEL_1, ADC_CHANNEL_4, ADC_CHANNEL_5,
+};
+
+static volatile uint16_t samples[LINE_SAMPLE_COUNT];
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures the sensor inputs, calibrates ADC1 and starts the
+ * continuous scan.
+ */
+void line_sensor_setup(void) {
+    LINE_SENSOR_GPIO_CLOCK_ENABLE();
+    LINE_SENSOR_ADC_CLOCK_ENABLE();
+    LINE_SENSOR_DMA_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = LINE_SENSOR_PINS;
+    gpio_init.Mode = GPIO_MODE_ANALOG;
+    HAL_GPIO_Init(LINE_SENSOR_PORT, &gpio_init);
+
+    line_sensor_retime();
+
+    adc_handle.Instance = LINE_SENSOR_ADC_INSTANCE;
+    adc_handle.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    adc_handle.Init.ScanConvMode = ADC_SCAN_ENABLE;
+    adc_handle.Init.ContinuousConvMode = ENABLE;
+    adc_handle.Init.NbrOfConversion = LINE_SENSOR_COUNT;
+    adc_handle.Init.DiscontinuousConvMode = DISABLE;
+    adc_handle.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    HAL_ADC_Init(&adc_handle);
+
+    ADC_ChannelConfTypeDef channel_config = { 0 };
+    channel_config.SamplingTime = LINE_SENSOR_SAMPLE_TIME;
+    for (uint32_t i = 0; i < LINE_SENSOR_COUNT; i++) {
+        channel_config.Channel = sensor_channels[i];
+        channel_config.Rank = ADC_REGULAR_RANK_1 + i;
+        HAL_ADC_ConfigChannel(&adc_handle, &channel_config);
+    }
+
+    dma_handle.Instance = LINE_SENSOR_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    dma_handle.Init.Mode = DMA_CIRCULAR;
+    dma_handle.Init.Priority = DMA_PRIORITY_LOW;
+    HAL_DMA_Init(&dma_handle);
+    __HAL_LINKDMA(&adc_handle, DMA_Handle, dma_handle);
+
+    /* Leaves the ADC on */
+    HAL_ADCEx_Calibration_Start(&adc_handle);
+
+    /* HAL_ADC_Start_DMA() would enable the transfer interrupts, which are
+     * not needed */
+    HAL_DMA_Start(&dma_handle, (uint32_t)&LINE_SENSOR_ADC_INSTANCE->DR, (uint32_t)samples, LINE_SAMPLE_COUNT);
+    SET_BIT(LINE_SENSOR_ADC_INSTANCE->CR2, ADC_CR2_DMA);
+    SET_BIT(LINE_SENSOR_ADC_INSTANCE->CR2, ADC_CR2_SWSTART | ADC_CR2_EXTTRIG);
+}
+
+/**
+ * @brief Sets the ADC clock after a clock profile switch: the smallest
+ * APB2 division within the ADC limit. The scan goes on undisturbed.
+ */
+void line_sensor_retime(void) {
+    uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+
+    if (pclk / 2 <= LINE_SENSOR_ADC_CLOCK_MAX_HZ) {
+        __HAL_RCC_ADC_CONFIG(RCC_ADCPCLK2_DIV2);
+    } else if (pclk / 4 <= LINE_SENSOR_ADC_CLOCK_MAX_HZ) {
+        __HAL_RCC_ADC_CONFIG(RCC_ADCPCLK2_DIV4);
+    } else if (pclk / 6 <= LINE_SENSOR_ADC_CLOCK_MAX_HZ) {
+        __HAL_RCC_ADC_CONFIG(RCC_ADCPCLK2_DIV6);
+    } else {
+        __HAL_RCC_ADC_CONFIG(RCC_ADCPCLK2_DIV8);
+    }
+}
+
+/**
+ * @brief Gets the sample buffer, LINE_SCAN_DEPTH scans of every sensor in
+ * array order, refreshed by the DMA all the time.
+ */
+const volatile uint16_t *line_sensor_samples(void) {
+    return samples;
+}
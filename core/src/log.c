@@ -0,0 +1,116 @@
+/**
+ * @file
+ * @brief Deferred binary logging into a lock-free RAM ring.
+ *
+ * Writers reserve their words by moving the head with a compare and swap
+ * (LDREX/STREX on the Cortex-M3) and commit by writing the site word last.
+ * The single reader, log_drain(), stops at the first entry not yet
+ * committed, clears what it read and only then moves the tail, so a writer
+ * never reuses words the reader still needs.
+ *
+ * The clock is passed in by the caller (a tick counter), which keeps this
+ * module free of HAL calls.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "log.h"
+
+/** Definitions --------------------------------------------------- */
+#define LOG_RING_MASK   (LOG_RING_WORDS - 1)
+
+/** Variables ----------------------------------------------------- */
+static uint32_t ring[LOG_RING_WORDS];
+static uint32_t head = 0;               /* Next word to reserve */
+static volatile uint32_t tail = 0;      /* Next word to read */
+static uint32_t dropped = 0;
+
+static const volatile uint32_t *log_clock = NULL;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Empties the ring.
+ *
+ * @param clock     Counter read for the timestamps, NULL for none.
+ */
+void log_init(const volatile uint32_t *clock) {
+    log_clock = clock;
+    for (uint32_t i = 0; i < LOG_RING_WORDS; i++) {
+        ring[i] = 0;
+    }
+    head = 0;
+    tail = 0;
+    dropped = 0;
+}
+
+/**
+ * @brief Stores an entry. Use LOG() rather than calling this directly.
+ *
+ * @param site      Site ID, the offset of the site string.
+ * @param count     Number of arguments.
+ * @param words     Arguments from index 1; index 0 is padding, so that a
+ *                  call without arguments still has an array.
+ */
+void log_write(uint32_t site, uint32_t count, const uint32_t words[]) {
+    uint32_t size = 2 + count;
+    uint32_t start = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+    do {
+        if (start + size - tail > LOG_RING_WORDS) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&head, &start, start + size, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    ring[(start + 1) & LOG_RING_MASK] = log_clock != NULL ? *log_clock : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        ring[(start + 2 + i) & LOG_RING_MASK] = words[1 + i];
+    }
+
+    __atomic_store_n(&ring[start & LOG_RING_MASK],
+                     LOG_SITE_VALID | (count << LOG_SITE_COUNT_SHIFT) | (site & LOG_SITE_ID_MASK), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Hands the committed entries to a writer as a dump and frees them.
+ * From thread context only.
+ *
+ * @param write     Output, called once per entry plus the header and the
+ *                  end word.
+ *
+ * @return Number of entries written.
+ */
+uint32_t log_drain(log_writer_t write) {
+    uint32_t entries = 0;
+    uint32_t end = 0;
+    log_header_t header = {
+        .magic = LOG_MAGIC,
+        .dropped = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED),
+    };
+
+    write(&header, sizeof(header));
+
+    while (tail != __atomic_load_n(&head, __ATOMIC_RELAXED)) {
+        uint32_t position = tail;
+        uint32_t site = __atomic_load_n(&ring[position & LOG_RING_MASK], __ATOMIC_ACQUIRE);
+        if ((site & LOG_SITE_VALID) == 0) {
+            break;
+        }
+
+        uint32_t entry[2 + LOG_SITE_COUNT_MASK];
+        uint32_t size = 2 + ((site >> LOG_SITE_COUNT_SHIFT) & LOG_SITE_COUNT_MASK);
+        for (uint32_t i = 0; i < size; i++) {
+            entry[i] = ring[(position + i) & LOG_RING_MASK];
+            ring[(position + i) & LOG_RING_MASK] = 0;
+        }
+        write(entry, (uint16_t)(size * sizeof(uint32_t)));
+
+        __atomic_store_n(&tail, position + size, __ATOMIC_RELEASE);
+        entries++;
+    }
+
+    write(&end, sizeof(end));
+
+    return entries;
+}
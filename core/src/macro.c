@@ -0,0 +1,205 @@
+/**
+ * @file
+ * @brief Motion macros: drive setpoints recorded with their timing and
+ * played back on a millisecond tick.
+ *
+ * Recording keeps a step for every setpoint change, with the time since
+ * the previous change; a wait longer than a step can hold takes extra
+ * steps repeating the setpoint. The last slot is kept for the stop step
+ * added when the recording ends, so a macro always ends stopped, after the
+ * time the last setpoint was held.
+ *
+ * Playback is paced by macro_play_tick() alone, one call per millisecond
+ * from a timer interrupt: every step is applied on the tick it was
+ * recorded at, counted from the first tick, whatever the main loop does.
+ * Starting and stopping are done from thread context, the state being
+ * written last.
+ *
+ * Time is passed in by the caller (ms), which keeps this module free of HAL
+ * calls.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "macro.h"
+
+/** Variables ----------------------------------------------------- */
+static macro_step_t steps[MACRO_STEP_MAX];
+static uint16_t count = 0;
+static volatile macro_state_t state = MACRO_STATE_IDLE;
+
+static drive_setpoint_t last;
+static uint32_t last_ms = 0;
+
+static uint16_t next = 0;
+static uint32_t remaining = 0;
+static macro_step_t current;
+
+/** Prototypes ---------------------------------------------------- */
+static void macro_push(const drive_setpoint_t *setpoint, uint16_t delay_ms);
+
+/** Internal functions -------------------------------------------- */
+static void macro_push(const drive_setpoint_t *setpoint, uint16_t delay_ms) {
+    steps[count++] = (macro_step_t){
+        .delay_ms = delay_ms,
+        .note = (uint8_t)setpoint->note,
+        .left = setpoint->left,
+        .right = setpoint->right,
+    };
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Loads a stored macro.
+ *
+ * @param record    Stored macro, NULL to start empty.
+ */
+void macro_init(const macro_record_t *record) {
+    state = MACRO_STATE_IDLE;
+    count = 0;
+
+    if (record != NULL && record->count <= MACRO_STEP_MAX) {
+        count = record->count;
+        memcpy(steps, record->steps, count * sizeof(steps[0]));
+    }
+}
+
+/**
+ * @brief Drops the macro and starts recording a new one.
+ *
+ * @param setpoint  Setpoint in use, the first step.
+ * @param now       Current time, in ms.
+ */
+void macro_record_start(const drive_setpoint_t *setpoint, uint32_t now) {
+    state = MACRO_STATE_IDLE;
+    count = 0;
+    last = *setpoint;
+    last_ms = now;
+    macro_push(setpoint, 0);
+    state = MACRO_STATE_RECORDING;
+}
+
+/**
+ * @brief Records a setpoint if it changed.
+ *
+ * @param setpoint  Setpoint in use.
+ * @param now       Current time, in ms.
+ *
+ * @return false once the macro is full; the recording must be stopped.
+ */
+bool macro_record(const drive_setpoint_t *setpoint, uint32_t now) {
+    if (state != MACRO_STATE_RECORDING) {
+        return false;
+    }
+    if (setpoint->left == last.left && setpoint->right == last.right && setpoint->note == last.note) {
+        return true;
+    }
+
+    uint32_t delay_ms = now - last_ms;
+    while (delay_ms > UINT16_MAX && count < MACRO_STEP_MAX - 1) {
+        macro_push(&last, UINT16_MAX);
+        delay_ms -= UINT16_MAX;
+    }
+    if (count >= MACRO_STEP_MAX - 1) {
+        return false;
+    }
+
+    macro_push(setpoint, (uint16_t)delay_ms);
+    last = *setpoint;
+    last_ms = now;
+
+    return count < MACRO_STEP_MAX - 1;
+}
+
+/**
+ * @brief Ends the recording with a stop step.
+ *
+ * @param now       Current time, in ms.
+ * @param record    Macro to be stored, CRC left to the caller.
+ */
+void macro_record_stop(uint32_t now, macro_record_t *record) {
+    if (state == MACRO_STATE_RECORDING) {
+        drive_setpoint_t stop;
+        uint32_t delay_ms = now - last_ms;
+
+        drive_wheels(0, 0, &stop);
+        macro_push(&stop, delay_ms > UINT16_MAX ? UINT16_MAX : (uint16_t)delay_ms);
+        state = MACRO_STATE_IDLE;
+    }
+
+    memset(record, 0, sizeof(*record));
+    record->magic = MACRO_MAGIC;
+    record->count = count;
+    memcpy(record->steps, steps, count * sizeof(steps[0]));
+}
+
+/**
+ * @brief Starts playing the macro; the first step is applied on the next
+ * tick.
+ *
+ * @return false if there is no macro or one is being recorded.
+ */
+bool macro_play_start(void) {
+    if (count == 0 || state == MACRO_STATE_RECORDING) {
+        return false;
+    }
+
+    state = MACRO_STATE_IDLE;
+    next = 0;
+    remaining = steps[0].delay_ms;
+    current = (macro_step_t){ .note = BUZZER_NOTE_ST };
+    __sync_synchronize();
+    state = MACRO_STATE_PLAYING;
+
+    return true;
+}
+
+void macro_play_stop(void) {
+    if (state == MACRO_STATE_PLAYING) {
+        state = MACRO_STATE_IDLE;
+    }
+}
+
+/**
+ * @brief Applies the steps due on this tick. Must be called every ms.
+ *
+ * @param setpoint  Setpoint of the last step applied, a stop before the
+ *                  first one.
+ *
+ * @return false when the macro is not playing, or has just ended with the
+ *         stop step in setpoint.
+ */
+bool macro_play_tick(drive_setpoint_t *setpoint) {
+    if (state != MACRO_STATE_PLAYING) {
+        return false;
+    }
+
+    bool playing = true;
+    while (remaining == 0) {
+        current = steps[next++];
+        if (next >= count) {
+            playing = false;
+            state = MACRO_STATE_IDLE;
+            break;
+        }
+        remaining = steps[next].delay_ms;
+    }
+    if (playing) {
+        remaining--;
+    }
+
+    drive_wheels(current.left, current.right, setpoint);
+    setpoint->note = (buzzer_note_t)current.note;
+
+    return playing;
+}
+
+macro_state_t macro_get_state(void) {
+    return state;
+}
+
+uint16_t macro_get_count(void) {
+    return count;
+}
@@ -1,11 +1,41 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "stm32f1xx.h"
 #include "core_cm3.h"
 
 #include "infrared.h"
 #include "buzzer.h"
+#include "arbiter.h"
+#include "audio.h"
+#include "boot_control.h"
+#include "clock.h"
+#include "compensation.h"
+#include "console.h"
+#include "drive.h"
+#include "encoder.h"
+#include "heading.h"
+#include "imu.h"
+#include "irq.h"
+#include "ir_receiver.h"
+#include "led_strip.h"
+#include "lights.h"
+#include "line.h"
+#include "line_sensor.h"
+#include "log.h"
+#include "macro.h"
+#include "obstacle.h"
+#include "odometry.h"
+#include "param.h"
+#include "radio.h"
+#include "serial_control.h"
+#include "stall.h"
+#include "timebase.h"
+#include "trace.h"
+#include "ultrasonic.h"
+#include "update.h"
 
 #include "stm32f1xx_hal.h"
 
@@ -22,55 +52,543 @@
 
 #define PWM_TIMER_INSTANCE          TIM3
 #define PWM_TIMER_CLOCK_ENABLE()    __HAL_RCC_TIM3_CLK_ENABLE()
-#define PWM_TIMER_PRESCALER         71
-#define PWM_TIMER_PERIOD            999
-#define PWM_TIMER_DUTY              700
+#define PWM_TIMER_FREQUENCY_HZ      1000
+#define PWM_TIMER_PERIOD            DRIVE_PWM_TOP
+/** Center aligned: the counter goes up to the period and back down. */
+#define PWM_TIMER_TICK_HZ           (2 * PWM_TIMER_PERIOD * PWM_TIMER_FREQUENCY_HZ)
+
+/** PWM timer update rate divided down to the odometry rate. */
+#define ODOMETRY_DIVIDER            (PWM_TIMER_FREQUENCY_HZ / ODOMETRY_RATE_HZ)
+
+/** PWM timer updates per gyro period. DMA1 channel 5 is shared in slots:
+ * the gyro read starts in slot 0 and ends within about 0.2 ms, the strip
+ * frame starts in STRIP_SLOT and ends within 0.3 ms, radio exchanges start
+ * in the other slots and end within 0.4 ms. */
+#define IMU_DIVIDER                 (PWM_TIMER_FREQUENCY_HZ / IMU_RATE_HZ)
+#define STRIP_SLOT                  (IMU_DIVIDER / 2)
+
+/** PWM timer updates per line following step. */
+#define LINE_DIVIDER                (PWM_TIMER_FREQUENCY_HZ / LINE_RATE_HZ)
+
+/** PWM timer updates per macro playback tick (1 ms). */
+#define MACRO_DIVIDER               (PWM_TIMER_FREQUENCY_HZ / 1000)
+
+/** Remote digit keys: line following on/off, macro recording start/stop
+ * and macro playback start/stop. */
+#define LINE_DIGIT                  1
+#define RECORD_DIGIT                2
+#define PLAY_DIGIT                  3
+
+/** Time for the slot users to hand the DMA channel back. */
+#define BUS_DRAIN_MS                (1000 / IMU_RATE_HZ + 1)
+
+#define CONTROL_PERIOD_MS           10
+
+/** Clock profile after the idle timeout parameter. */
+#define IDLE_CLOCK_PROFILE          CLOCK_PROFILE_HSI
+
+/** A new image running this long without a watchdog reset is accepted. */
+#define BOOT_CONFIRM_DELAY_MS       5000
+#define IWDG_KEY_RELOAD             0xAAAA
+
+/** Motor compensation, in the first settings page. */
+#define COMPENSATION_ADDRESS        BOOT_SETTINGS_ADDRESS
+#define CALIBRATION_SETTLE_MS       300
+#define CALIBRATION_WINDOW_MS       500
+
+/** Remote address assignment, in the second settings page. */
+#define IR_ADDRESS_ADDRESS          (BOOT_SETTINGS_ADDRESS + BOOT_PAGE_SIZE)
+#define ADDRESS_TIMEOUT_MS          1000
+
+/** Motion macro, in the third settings page. */
+#define MACRO_ADDRESS               (BOOT_SETTINGS_ADDRESS + 2 * BOOT_PAGE_SIZE)
+
+/** Parameter snapshot, sharing the second settings page with the remote
+ * addresses. */
+#define PARAM_ADDRESS               (IR_ADDRESS_ADDRESS + BOOT_PAGE_SIZE / 2)
+#define PARAM_TIMEOUT_MS            1000
+
+#define TRACE_DUMP_REQUEST          'T'
+#define IR_STATS_REQUEST            'I'
+#define POSE_REQUEST                'P'
+#define CLOCK_REQUEST               'C'
+#define IRQ_PROFILE_REQUEST         'L'
+#define JITTER_REQUEST              'J'
+#define UPDATE_REQUEST              'U'
+#define CALIBRATION_REQUEST         'M'
+#define ADDRESS_REQUEST             'A'
+#define GYRO_REQUEST                'G'
+#define LINE_REQUEST                'F'
+#define RADIO_REQUEST               'R'
+#define LOG_REQUEST                 'D'
+#define PARAM_GET_REQUEST           'K'
+#define PARAM_SET_REQUEST           'S'
+#define PARAM_SAVE_REQUEST          'V'
+#define STALL_REQUEST               'W'
 
 /** Types --------------------------------------------------------- */
+/** Measured control loop periods, reset on every report. */
+typedef struct {
+    uint32_t periods;
+    uint32_t min_us;
+    uint32_t max_us;
+} control_jitter_t;
+
+/** Modes driving the car from the PWM timer interrupt. */
+typedef enum {
+    AUTONOMOUS_NONE = 0,
+    AUTONOMOUS_LINE,            /**< Line following */
+    AUTONOMOUS_MACRO,           /**< Macro playback */
+} autonomous_t;
+
+/** Line following step cost, in core cycles, reset on every report. */
+typedef struct {
+    uint32_t steps;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} line_cost_t;
 
 /** Variables ----------------------------------------------------- */
 static TIM_HandleTypeDef timer_handle = { 0 };
+static control_jitter_t control_jitter = { 0, UINT32_MAX, 0 };
+static volatile bool bus_paused = false;
+
+/** An autonomous mode runs from the PWM timer interrupt and drives the
+ * motors itself while it is the selected source. */
+static volatile autonomous_t autonomous = AUTONOMOUS_NONE;
+static volatile bool autonomous_driving = false;
+
+/** Set by the main loop on a mode change. The interrupt is the only writer
+ * of the autonomous arbiter slot, so it withdraws the slot itself. */
+static volatile bool autonomous_release = false;
+static line_cost_t line_cost = { 0 };
+
+/** The radio drives the motors itself, from its SPI DMA interrupt, while
+ * it is the selected source. */
+static volatile bool radio_driving = false;
+
+/** Last output written to the compare registers, so the control tick can
+ * trace what the interrupts drive. */
+static volatile drive_output_t compare_output = { 0 };
+
+/** Too large for the stack, only used from the main loop. */
+static macro_record_t macro_buffer;
+
+/** Coasting stops, as before the stop modes, short-braking only when the
+ * stop parameter asks; slow decay PWM, braking before every reversal. */
+static const drive_config_t drive_config = {
+    .stop = DRIVE_STOP_COAST,
+    .decay = DRIVE_DECAY_SLOW,
+    .reverse_dwell_ms = DRIVE_REVERSE_DWELL_MS,
+};
 
 /** Prototypes ---------------------------------------------------- */
-static void clock_config(void);
+static uint32_t pwm_prescaler(void);
+static void set_clock_profile(clock_profile_t profile);
+static void set_compare(const drive_output_t *output);
+static void apply_output(const drive_output_t *output);
+static void autonomous_select(autonomous_t mode);
+static void autonomous_apply(const drive_setpoint_t *setpoint, uint32_t now);
+static void line_run(void);
+static void macro_run(void);
+static void radio_receive(const serial_command_t *command);
+static audio_sound_t select_sound(const drive_setpoint_t *setpoint);
+static bool settings_load(uint32_t address, void *record, uint32_t size, uint32_t magic);
+static bool settings_store(uint32_t address, const void *record, uint32_t size);
+static bool settings_store_beside(uint32_t address, const void *record, uint32_t size, uint32_t other,
+                                  uint32_t other_size);
+static void compensation_restore(void);
+static bool compensation_store(const compensation_channel_t channels[DRIVE_CHANNEL_COUNT]);
+static void ir_address_restore(ir_address_record_t *record);
+static void param_restore(void);
+static void macro_restore(void);
+static void macro_finish(void);
+static uint32_t calibration_measure(drive_channel_t channel, uint16_t duty);
 
 /** Internal functions -------------------------------------------- */
 /**
- * @brief MCU clock configuration.
+ * @brief Gets the PWM timer prescaler for the current clock.
+ */
+static uint32_t pwm_prescaler(void) {
+    return clock_timer_frequency(PWM_TIMER_INSTANCE) / PWM_TIMER_TICK_HZ - 1;
+}
+
+/**
+ * @brief Switches the clock profile and retimes every clock dependent
+ * peripheral, so PWM frequency, baud rates and timekeeping are unchanged.
+ */
+static void set_clock_profile(clock_profile_t profile) {
+    if (profile == clock_get_profile()) {
+        return;
+    }
+
+    clock_stats_t stats;
+
+    timebase_sync();
+    clock_set_profile(profile);
+    clock_get_stats(&stats);
+    timebase_retime(stats.switch_us[clock_get_profile()]);
+
+    __HAL_TIM_SET_PRESCALER(&timer_handle, pwm_prescaler());
+    ultrasonic_retime();
+    console_retime();
+    serial_control_retime();
+    audio_retime();
+    led_strip_retime();
+    imu_bus_retime();
+    radio_bus_retime();
+    line_sensor_retime();
+    irq_profile_reset();
+
+    LOG("clock profile %u, switched in %u us", clock_get_profile(), stats.switch_us[clock_get_profile()]);
+}
+
+/**
+ * @brief Writes the motor duties, interleaved so the two wheels switch on
+ * half a period apart.
+ */
+static void set_compare(const drive_output_t *output) {
+    uint16_t compare[DRIVE_CHANNEL_COUNT];
+
+    drive_interleave(output, compare);
+    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, compare[DRIVE_CHANNEL_1]);
+    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, compare[DRIVE_CHANNEL_2]);
+    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, compare[DRIVE_CHANNEL_3]);
+    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, compare[DRIVE_CHANNEL_4]);
+    compare_output = *output;
+}
+
+/**
+ * @brief Writes the motor compare values and buzzer note, and traces them.
+ */
+static void apply_output(const drive_output_t *output) {
+    set_compare(output);
+    buzzer_play_note(output->note);
+
+    trace_pwm(output->ccr);
+    trace_note(output->note);
+}
+
+/**
+ * @brief Switches the autonomous mode. Line following starts waiting for
+ * the line, macro playback from its first step.
+ */
+static void autonomous_select(autonomous_t mode) {
+    if (mode == autonomous) {
+        return;
+    }
+
+    /* The timer interrupt stops posting before it is asked to release */
+    autonomous = AUTONOMOUS_NONE;
+    autonomous_driving = false;
+    macro_play_stop();
+    autonomous_release = true;
+
+    if (mode == AUTONOMOUS_LINE) {
+        line_init();
+    } else if (mode == AUTONOMOUS_MACRO && !macro_play_start()) {
+        return;
+    }
+    autonomous = mode;
+}
+
+/**
+ * @brief Hands an autonomous setpoint to the arbiter, which lets the serial
+ * link and the obstacle brake take over, and straight to the motors while
+ * the main loop hands them over. From the PWM timer interrupt.
+ */
+static void autonomous_apply(const drive_setpoint_t *setpoint, uint32_t now) {
+    arbiter_post(ARBITER_SOURCE_AUTONOMOUS, setpoint, now);
+
+    if (autonomous_driving) {
+        drive_setpoint_t limited = *setpoint;
+        drive_output_t output;
+
+        stall_limit(&limited);
+        drive_output(&limited, now, &output);
+        set_compare(&output);
+    }
+}
+
+/**
+ * @brief Line following step, from the PWM timer interrupt.
+ */
+static void line_run(void) {
+    uint32_t start = DWT->CYCCNT;
+    drive_setpoint_t setpoint;
+
+    line_step(line_sensor_samples(), &setpoint);
+    autonomous_apply(&setpoint, HAL_GetTick());
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    line_cost.steps++;
+    line_cost.total_cycles += cycles;
+    line_cost.max_cycles = cycles > line_cost.max_cycles ? cycles : line_cost.max_cycles;
+}
+
+/**
+ * @brief Macro playback tick, from the PWM timer interrupt. The mode ends
+ * with the stop step.
+ */
+static void macro_run(void) {
+    drive_setpoint_t setpoint;
+
+    bool playing = macro_play_tick(&setpoint);
+    autonomous_apply(&setpoint, HAL_GetTick());
+    if (!playing) {
+        autonomous = AUTONOMOUS_NONE;
+    }
+}
+
+/**
+ * @brief Radio command, from the SPI DMA interrupt: handed to the arbiter,
+ * and straight to the motors while the main loop hands them over, so it
+ * takes effect on the next PWM period.
+ */
+static void radio_receive(const serial_command_t *command) {
+    drive_setpoint_t setpoint;
+    uint32_t now = HAL_GetTick();
+
+    if (command->type == SERIAL_FRAME_TWIST) {
+        drive_twist(command->a, command->b, &setpoint);
+    } else {
+        drive_wheels(command->a, command->b, &setpoint);
+    }
+    arbiter_post(ARBITER_SOURCE_RADIO, &setpoint, now);
+
+    if (radio_driving) {
+        drive_output_t output;
+
+        stall_limit(&setpoint);
+        drive_output(&setpoint, now, &output);
+        set_compare(&output);
+    }
+}
+
+/**
+ * @brief Picks the sound effect for a setpoint: the horn for a note, the
+ * beeper when backing up and the engine otherwise while moving.
+ */
+static audio_sound_t select_sound(const drive_setpoint_t *setpoint) {
+    if (setpoint->note != BUZZER_NOTE_ST) {
+        return AUDIO_SOUND_HORN;
+    }
+    if (setpoint->left < 0 && setpoint->right < 0) {
+        return AUDIO_SOUND_REVERSE;
+    }
+    if (setpoint->left != 0 || setpoint->right != 0) {
+        return AUDIO_SOUND_ENGINE;
+    }
+
+    return AUDIO_SOUND_NONE;
+}
+
+/**
+ * @brief Reads a settings record, made of a magic word, the data and a CRC
+ * word over everything before it.
+ *
+ * @return false if the page holds no valid record.
+ */
+static bool settings_load(uint32_t address, void *record, uint32_t size, uint32_t magic) {
+    uint32_t crc_offset = size - sizeof(uint32_t);
+    uint32_t words[2];
+
+    boot_flash_read(address, record, size);
+    memcpy(&words[0], record, sizeof(uint32_t));
+    memcpy(&words[1], (uint8_t *)record + crc_offset, sizeof(uint32_t));
+
+    return words[0] == magic && boot_flash_crc(address, crc_offset) == words[1];
+}
+
+/**
+ * @brief Stores a settings record in its own page. The CRC is programmed
+ * last, so an interrupted write is never loaded.
+ */
+static bool settings_store(uint32_t address, const void *record, uint32_t size) {
+    uint32_t crc_offset = size - sizeof(uint32_t);
+
+    if (!boot_flash_erase(address) || !boot_flash_program(address, record, crc_offset)) {
+        return false;
+    }
+
+    uint32_t crc = boot_flash_crc(address, crc_offset);
+    return boot_flash_program(address + crc_offset, &crc, sizeof(crc));
+}
+
+/**
+ * @brief Stores a settings record in a page shared with another record,
+ * which is programmed back as it was. A reset during the store loses the
+ * other record, which then falls back to its default like an erased one.
+ *
+ * @param other     Address of the other record.
+ * @param other_size Size of the other record.
+ */
+static bool settings_store_beside(uint32_t address, const void *record, uint32_t size, uint32_t other,
+                                  uint32_t other_size) {
+    uint32_t kept[sizeof(param_record_t) / sizeof(uint32_t)];
+
+    if (other_size > sizeof(kept)) {
+        return false;
+    }
+
+    boot_flash_read(other, kept, other_size);
+    bool stored = settings_store(address, record, size);
+
+    /* An erased record is left erased */
+    if (kept[0] == UINT32_MAX) {
+        return stored;
+    }
+    return boot_flash_program(other, kept, other_size) && stored;
+}
+
+/**
+ * @brief Loads the stored motor compensation, if there is a valid one.
+ */
+static void compensation_restore(void) {
+    compensation_record_t record;
+
+    if (settings_load(COMPENSATION_ADDRESS, &record, sizeof(record), COMPENSATION_MAGIC)) {
+        compensation_init(record.channel);
+    }
+}
+
+/**
+ * @brief Stores the motor compensation.
+ */
+static bool compensation_store(const compensation_channel_t channels[DRIVE_CHANNEL_COUNT]) {
+    compensation_record_t record = { .magic = COMPENSATION_MAGIC };
+
+    memcpy(record.channel, channels, sizeof(record.channel));
+    return settings_store(COMPENSATION_ADDRESS, &record, sizeof(record));
+}
+
+/**
+ * @brief Applies the stored remote addresses, or answers every remote when
+ * none were assigned.
+ *
+ * @param record    Record read back, cleared when none was stored.
+ */
+static void ir_address_restore(ir_address_record_t *record) {
+    if (!settings_load(IR_ADDRESS_ADDRESS, record, sizeof(*record), IR_ADDRESS_MAGIC)) {
+        memset(record, 0, sizeof(*record));
+        ir_receiver_accept_all();
+        return;
+    }
+
+    ir_receiver_set_addresses(record->unit, record->group);
+}
+
+/**
+ * @brief Loads the stored parameters, or the defaults without a valid
+ * snapshot of this version.
+ */
+static void param_restore(void) {
+    param_record_t record;
+    bool valid = settings_load(PARAM_ADDRESS, &record, sizeof(record), PARAM_MAGIC);
+
+    param_init(valid ? &record : NULL);
+}
+
+/**
+ * @brief Loads the stored macro, if there is a valid one.
  */
-static void clock_config(void)
-{
-    RCC_OscInitTypeDef RCC_OscInitStruct = { 0 };
-    RCC_ClkInitTypeDef RCC_ClkInitStruct = { 0 };
+static void macro_restore(void) {
+    bool valid = settings_load(MACRO_ADDRESS, &macro_buffer, sizeof(macro_buffer), MACRO_MAGIC);
+    macro_init(valid ? &macro_buffer : NULL);
+}
 
-    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
-    RCC_OscInitStruct.HSEState = RCC_HSE_ON;
-    RCC_OscInitStruct.HSEPredivValue = RCC_HSE_PREDIV_DIV1;
-    RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
-    RCC_OscInitStruct.PLL.PLLMUL = RCC_PLL_MUL9;
-    HAL_RCC_OscConfig(&RCC_OscInitStruct);
+/**
+ * @brief Ends the recording and stores the macro.
+ */
+static void macro_finish(void) {
+    macro_record_stop(HAL_GetTick(), &macro_buffer);
+    bool stored = settings_store(MACRO_ADDRESS, &macro_buffer, sizeof(macro_buffer));
 
-    /** Initializes the CPU, AHB and APB buses clocks
-     */
-    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
-    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-    RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-    RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV2;
-    RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2;
-    HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_2);
+    LOG("macro of %u steps, stored %d", macro_buffer.count, stored);
+}
+
+/**
+ * @brief Calibration measurement: drives one bridge channel alone, through
+ * the drive logic, and counts its wheel encoder after the speed settles.
+ */
+static uint32_t calibration_measure(drive_channel_t channel, uint16_t duty) {
+    bool left = channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_2;
+    int16_t effort = channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_4 ? -(int16_t)duty : (int16_t)duty;
+    drive_setpoint_t setpoint;
+    drive_output_t output;
+    int32_t start[2] = { 0, 0 };
+    int32_t end[2];
+    bool sampled = false;
+
+    drive_wheels(left ? effort : 0, left ? 0 : effort, &setpoint);
+
+    uint32_t timeshot = HAL_GetTick();
+    while (HAL_GetTick() - timeshot < CALIBRATION_SETTLE_MS + CALIBRATION_WINDOW_MS) {
+        IWDG->KR = IWDG_KEY_RELOAD;
+
+        if (!sampled && HAL_GetTick() - timeshot >= CALIBRATION_SETTLE_MS) {
+            sampled = true;
+            odometry_get_counts(&start[0], &start[1]);
+        }
+
+        drive_output(&setpoint, HAL_GetTick(), &output);
+        apply_output(&output);
+        HAL_Delay(CONTROL_PERIOD_MS);
+    }
+    odometry_get_counts(&end[0], &end[1]);
+
+    int32_t counts = left ? end[0] - start[0] : end[1] - start[1];
+    return (uint32_t)(counts < 0 ? -counts : counts);
 }
 
 /** Public functions ---------------------------------------------- */
 int main(void) {
     uint32_t timeshot = 0;
+    uint32_t control_timeshot = 0;
+    uint32_t activity_timeshot = 0;
+    uint64_t control_us = 0;
+    ir_key_id_t remote_key = INFRARED_KEY_NONE;
+    bool braking = false;
+    bool idle = false;
+#if BOOT_DUAL_SLOT
+    bool confirmed = false;
+#endif
+    ir_address_record_t address_record;
 
     HAL_Init();
-    clock_config();
+    log_init(&uwTick);
+    irq_setup();
+    clock_setup();
+    timebase_setup();
+#if BOOT_DUAL_SLOT
+    boot_init();
+#endif
 
-    infrared_setup();
+    ir_receiver_setup();
     buzzer_setup();
+    audio_setup();
+    console_setup();
+    serial_control_setup();
+    led_strip_setup();
+    radio_bus_setup();
+    radio_init(radio_receive);
+    lights_init(HAL_GetTick());
+    drive_init(&drive_config);
+    arbiter_init();
+    ultrasonic_setup();
+    encoder_setup();
+    odometry_init();
+    stall_init();
+    imu_bus_setup();
+    imu_init();
+    heading_init();
+    line_sensor_setup();
+    line_init();
+    param_restore();
+    drive_set_stop((drive_stop_t)param_get(PARAM_DRIVE_STOP));
+    macro_restore();
+    compensation_restore();
+    ir_address_restore(&address_record);
 
     GPIO_MOTOR_1_CLOCK_ENABLE();
     GPIO_MOTOR_2_CLOCK_ENABLE();
@@ -88,17 +606,21 @@ int main(void) {
     PWM_TIMER_CLOCK_ENABLE();
 
     timer_handle.Instance = PWM_TIMER_INSTANCE;
-    timer_handle.Init.Prescaler = PWM_TIMER_PRESCALER;
+    timer_handle.Init.Prescaler = pwm_prescaler();
     timer_handle.Init.Period = PWM_TIMER_PERIOD;
-    timer_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timer_handle.Init.CounterMode = TIM_COUNTERMODE_CENTERALIGNED1;
     timer_handle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
     HAL_TIM_PWM_Init(&timer_handle);
 
     TIM_OC_InitTypeDef pwm_config = { 0 };
 
+    /* Left wheel pulses centered on the bottom of the count, right wheel on
+     * the top (see drive_interleave()) */
     pwm_config.OCMode = TIM_OCMODE_PWM1;
     HAL_TIM_PWM_ConfigChannel(&timer_handle, &pwm_config, TIM_CHANNEL_1);
     HAL_TIM_PWM_ConfigChannel(&timer_handle, &pwm_config, TIM_CHANNEL_2);
+    pwm_config.OCMode = TIM_OCMODE_PWM2;
+    pwm_config.Pulse = PWM_TIMER_PERIOD + 1;
     HAL_TIM_PWM_ConfigChannel(&timer_handle, &pwm_config, TIM_CHANNEL_3);
     HAL_TIM_PWM_ConfigChannel(&timer_handle, &pwm_config, TIM_CHANNEL_4);
 
@@ -107,55 +629,410 @@ int main(void) {
     HAL_TIM_PWM_Start(&timer_handle, TIM_CHANNEL_3);
     HAL_TIM_PWM_Start(&timer_handle, TIM_CHANNEL_4);
 
+    __HAL_TIM_ENABLE_IT(&timer_handle, TIM_IT_UPDATE);
+    HAL_NVIC_SetPriority(TIM3_IRQn, IRQ_PREEMPT_PWM, IRQ_SUB_PWM);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+
     while (true) {
-        if (HAL_GetTick() - timeshot > 200) {
+        serial_command_t command;
+        drive_setpoint_t setpoint;
+
+        /* Started by the bootloader when this image is on trial */
+        IWDG->KR = IWDG_KEY_RELOAD;
+
+#if BOOT_DUAL_SLOT
+        if (!confirmed && HAL_GetTick() > BOOT_CONFIRM_DELAY_MS) {
+            confirmed = true;
+            boot_confirm();
+            LOG("image confirmed");
+        }
+#endif
+
+        if (serial_control_read(&command)) {
+            if (command.type == SERIAL_FRAME_TWIST) {
+                drive_twist(command.a, command.b, &setpoint);
+            } else {
+                drive_wheels(command.a, command.b, &setpoint);
+            }
+
+            arbiter_post(ARBITER_SOURCE_SERIAL, &setpoint, HAL_GetTick());
+            trace_serial(command.type, command.a, command.b, command.sequence);
+            activity_timeshot = HAL_GetTick();
+        }
+
+        /* Key changes are taken at once, so macros are recorded with the
+         * timing of the remote */
+        ir_key_id_t key_pressed = ir_receiver_get_key();
+        if (key_pressed != remote_key || HAL_GetTick() - timeshot > (uint32_t)param_get(PARAM_REMOTE_PERIOD_MS)) {
             timeshot = HAL_GetTick();
+            remote_key = key_pressed;
 
-            ir_key_id_t key_pressed = infrared_decode();
+            drive_key(key_pressed, &setpoint);
 
-            switch (key_pressed) {
-                case INFRARED_KEY_UP: {
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, PWM_TIMER_DUTY);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, PWM_TIMER_DUTY);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, 0);
-                    break;
-                }
-                case INFRARED_KEY_DOWN: {
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, PWM_TIMER_DUTY);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, PWM_TIMER_DUTY);
+            switch (ir_receiver_take_digit()) {
+                case LINE_DIGIT: {
+                    autonomous_select(autonomous == AUTONOMOUS_LINE ? AUTONOMOUS_NONE : AUTONOMOUS_LINE);
                     break;
                 }
-                case INFRARED_KEY_LEFT: {
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, PWM_TIMER_DUTY);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, 0);
+                case RECORD_DIGIT: {
+                    if (macro_get_state() == MACRO_STATE_RECORDING) {
+                        macro_finish();
+                    } else {
+                        autonomous_select(AUTONOMOUS_NONE);
+                        macro_record_start(&setpoint, timeshot);
+                    }
                     break;
                 }
-                case INFRARED_KEY_RIGHT: {
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, PWM_TIMER_DUTY);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, 0);
+                case PLAY_DIGIT: {
+                    if (macro_get_state() == MACRO_STATE_RECORDING) {
+                        macro_finish();
+                    }
+                    autonomous_select(autonomous == AUTONOMOUS_MACRO ? AUTONOMOUS_NONE : AUTONOMOUS_MACRO);
                     break;
                 }
                 default: {
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_1, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_2, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_3, 0);
-                    __HAL_TIM_SET_COMPARE(&timer_handle, TIM_CHANNEL_4, 0);
                     break;
                 }
             }
 
-            if (key_pressed == INFRARED_KEY_ENTER) {
-                buzzer_play_note(BUZZER_NOTE_A4);
+            if (!macro_record(&setpoint, timeshot) && macro_get_state() == MACRO_STATE_RECORDING) {
+                macro_finish();
+            }
+
+            arbiter_post(ARBITER_SOURCE_REMOTE, &setpoint, timeshot);
+            trace_key(key_pressed);
+
+            if (key_pressed != INFRARED_KEY_NONE || autonomous != AUTONOMOUS_NONE) {
+                activity_timeshot = timeshot;
+            }
+        }
+
+        /* Slow down while idle, back to full speed on the first command. A
+         * profile picked from the console holds until the next change. */
+        if ((HAL_GetTick() - activity_timeshot > (uint32_t)param_get(PARAM_IDLE_TIMEOUT_MS)) != idle) {
+            idle = !idle;
+            set_clock_profile(idle ? IDLE_CLOCK_PROFILE : CLOCK_PROFILE_FULL);
+        }
+
+        if (HAL_GetTick() - control_timeshot >= CONTROL_PERIOD_MS) {
+            control_timeshot = HAL_GetTick();
+
+            uint64_t now_us = timebase_now();
+            if (control_us != 0) {
+                uint32_t period_us = (uint32_t)(now_us - control_us);
+                control_jitter.periods++;
+                control_jitter.min_us = period_us < control_jitter.min_us ? period_us : control_jitter.min_us;
+                control_jitter.max_us = period_us > control_jitter.max_us ? period_us : control_jitter.max_us;
+            }
+            control_us = now_us;
+
+            drive_output_t output;
+
+            /* The obstacle brake is the safety source: it limits what the
+             * other sources request and wins over all of them */
+            arbiter_select_from(ARBITER_SOURCE_SERIAL, control_timeshot, &setpoint);
+
+            uint16_t range = ultrasonic_get_range(control_timeshot);
+            bool blocked = obstacle_check(&setpoint, range);
+            if (blocked) {
+                obstacle_clamp(&setpoint);
+                arbiter_post(ARBITER_SOURCE_SAFETY, &setpoint, control_timeshot);
+            }
+            if (blocked != braking) {
+                braking = blocked;
+                trace_brake(braking, range);
+                if (!blocked) {
+                    arbiter_release(ARBITER_SOURCE_SAFETY);
+                }
+            }
+
+            arbiter_source_t source = arbiter_select(control_timeshot, &setpoint);
+
+            heading_hold(&setpoint);
+            bool sampled = audio_play(select_sound(&setpoint));
+
+            /* An autonomous mode or the radio drives the motors while it
+             * wins; the flags are only changed here, so drive_output() and
+             * the compare registers always have a single user */
+            autonomous_driving = autonomous != AUTONOMOUS_NONE && source == ARBITER_SOURCE_AUTONOMOUS;
+            radio_driving = source == ARBITER_SOURCE_RADIO;
+            if (source == ARBITER_SOURCE_RADIO) {
+                activity_timeshot = control_timeshot;
+            }
+            if (!autonomous_driving && !radio_driving) {
+                drive_setpoint_t limited = setpoint;
+                stall_limit(&limited);
+                drive_output(&limited, control_timeshot, &output);
+
+                /* Sampled sounds replace the note whenever they can be played */
+                if (sampled) {
+                    output.note = BUZZER_NOTE_ST;
+                }
+                apply_output(&output);
             } else {
-                buzzer_play_note(BUZZER_NOTE_ST);
+                /* The trace is written from here only: take the compare
+                 * values the interrupt applied; it leaves the buzzer alone */
+                __disable_irq();
+                output = compare_output;
+                __enable_irq();
+                trace_pwm(output.ccr);
+            }
+
+            lights_frame_t frame;
+            lights_frame(&setpoint, braking, control_timeshot, frame);
+            led_strip_show(frame);
+
+            radio_telemetry_t telemetry = {
+                .source = (uint8_t)source,
+                .range_mm = range,
+                .left = setpoint.left,
+                .right = setpoint.right,
+            };
+            radio_set_telemetry(&telemetry);
+        }
+
+        uint8_t request = 0;
+        if (console_read(&request)) {
+            switch (request) {
+                case TRACE_DUMP_REQUEST: {
+                    trace_dump();
+                    break;
+                }
+                case IR_STATS_REQUEST: {
+                    ir_nec_stats_t stats;
+                    ir_receiver_get_stats(&stats);
+                    console_write(&stats, sizeof(stats));
+                    break;
+                }
+                case JITTER_REQUEST: {
+                    console_write(&control_jitter, sizeof(control_jitter));
+                    control_jitter = (control_jitter_t){ 0, UINT32_MAX, 0 };
+                    break;
+                }
+                case IRQ_PROFILE_REQUEST: {
+                    irq_profile_dump();
+                    break;
+                }
+                case CLOCK_REQUEST: {
+                    clock_stats_t stats;
+                    set_clock_profile((clock_profile_t)((clock_get_profile() + 1) % CLOCK_PROFILE_COUNT));
+                    clock_get_stats(&stats);
+                    console_write(&stats, sizeof(stats));
+                    break;
+                }
+#if BOOT_DUAL_SLOT
+                case UPDATE_REQUEST: {
+                    const drive_output_t stop = { .note = BUZZER_NOTE_ST };
+                    autonomous_select(AUTONOMOUS_NONE);
+                    radio_driving = false;
+                    apply_output(&stop);
+                    audio_play(AUDIO_SOUND_NONE);
+                    bus_paused = true;
+                    HAL_Delay(BUS_DRAIN_MS);
+                    update_receive();
+                    bus_paused = false;
+                    break;
+                }
+#endif
+                case CALIBRATION_REQUEST: {
+                    compensation_record_t record = { .magic = COMPENSATION_MAGIC };
+                    autonomous_select(AUTONOMOUS_NONE);
+                    radio_driving = false;
+                    audio_play(AUDIO_SOUND_NONE);
+                    if (compensation_calibrate(calibration_measure, record.channel)) {
+                        compensation_init(record.channel);
+                        LOG("calibration stored %d", compensation_store(record.channel));
+                    } else {
+                        LOG("calibration failed");
+                        compensation_restore();
+                    }
+                    compensation_get(record.channel);
+                    console_write(&record, sizeof(record));
+                    break;
+                }
+                case ADDRESS_REQUEST: {
+                    /* Followed by the unit and group addresses; the record
+                     * in use is sent back */
+                    ir_address_record_t record = { .magic = IR_ADDRESS_MAGIC };
+                    if (console_read_block(&record.unit, 2, ADDRESS_TIMEOUT_MS)) {
+                        settings_store_beside(IR_ADDRESS_ADDRESS, &record, sizeof(record), PARAM_ADDRESS,
+                                              sizeof(param_record_t));
+                    }
+                    ir_address_restore(&record);
+                    console_write(&record, sizeof(record));
+                    break;
+                }
+                case GYRO_REQUEST: {
+                    imu_stats_t stats;
+                    heading_state_t state;
+                    imu_get_stats(&stats);
+                    heading_get(&state);
+                    console_write(&stats, sizeof(stats));
+                    console_write(&state, sizeof(state));
+                    break;
+                }
+                case LINE_REQUEST: {
+                    line_state_t state;
+                    line_cost_t cost;
+                    line_get_state(&state);
+                    __disable_irq();
+                    cost = line_cost;
+                    line_cost = (line_cost_t){ 0 };
+                    __enable_irq();
+                    console_write(&state, sizeof(state));
+                    console_write(&cost, sizeof(cost));
+                    break;
+                }
+                case RADIO_REQUEST: {
+                    radio_stats_t stats;
+                    __disable_irq();
+                    radio_get_stats(&stats);
+                    __enable_irq();
+                    console_write(&stats, sizeof(stats));
+                    break;
+                }
+                case LOG_REQUEST: {
+                    log_drain(console_write);
+                    break;
+                }
+                case PARAM_GET_REQUEST: {
+                    /* Followed by the parameter ID */
+                    param_entry_t entry;
+                    uint8_t id;
+                    if (console_read_block(&id, sizeof(id), PARAM_TIMEOUT_MS)) {
+                        param_describe(id, &entry);
+                        console_write(&entry, sizeof(entry));
+                    }
+                    break;
+                }
+                case PARAM_SET_REQUEST: {
+                    /* Followed by the parameter ID and the value, little
+                     * endian; the entry in use is sent back, with the
+                     * status of the change */
+                    param_entry_t entry;
+                    uint8_t data[1 + sizeof(int32_t)];
+                    if (console_read_block(data, sizeof(data), PARAM_TIMEOUT_MS)) {
+                        int32_t value;
+                        memcpy(&value, &data[1], sizeof(value));
+                        param_status_t status = param_set(data[0], value);
+                        if (status == PARAM_STATUS_OK && data[0] == PARAM_DRIVE_STOP) {
+                            drive_set_stop((drive_stop_t)param_get(PARAM_DRIVE_STOP));
+                        }
+                        param_describe(data[0], &entry);
+                        entry.status = (uint8_t)status;
+                        console_write(&entry, sizeof(entry));
+                    }
+                    break;
+                }
+                case PARAM_SAVE_REQUEST: {
+                    /* The stored snapshot is sent back, magic cleared if
+                     * it could not be stored */
+                    param_record_t record;
+                    param_snapshot(&record);
+                    bool stored = settings_store_beside(PARAM_ADDRESS, &record, sizeof(record), IR_ADDRESS_ADDRESS,
+                                                        sizeof(ir_address_record_t));
+                    if (!stored || !settings_load(PARAM_ADDRESS, &record, sizeof(record), PARAM_MAGIC)) {
+                        record.magic = 0;
+                    }
+                    LOG("parameters stored %d", stored);
+                    console_write(&record, sizeof(record));
+                    break;
+                }
+                case STALL_REQUEST: {
+                    /* Left wheel, then right */
+                    for (uint8_t wheel = 0; wheel < STALL_WHEEL_COUNT; wheel++) {
+                        stall_state_t state;
+                        __disable_irq();
+                        stall_get_state((stall_wheel_t)wheel, &state);
+                        __enable_irq();
+                        console_write(&state, sizeof(state));
+                    }
+                    break;
+                }
+                case POSE_REQUEST: {
+                    odometry_pose_t pose;
+                    odometry_get_pose(&pose);
+                    console_write(&pose, sizeof(pose));
+                    break;
+                }
+                default: {
+                    break;
+                }
             }
         }
     }
 }
+
+/**
+ * @brief PWM timer update, runs the odometry, the gyro and the autonomous
+ * modes at fixed rates and hands DMA1 channel 5 to the gyro, the LED strip
+ * and the radio in turn.
+ *
+ * The center aligned counter updates at the top and the bottom of the
+ * count; only the bottom one, once per PWM period, is used.
+ */
+void TIM3_IRQHandler(void) {
+    static uint32_t divider = 0;
+    static uint32_t slot = 0;
+    static uint32_t line_divider = 0;
+    static uint32_t macro_divider = 0;
+
+    if (__HAL_TIM_GET_FLAG(&timer_handle, TIM_FLAG_UPDATE) == 0) {
+        return;
+    }
+    __HAL_TIM_CLEAR_FLAG(&timer_handle, TIM_FLAG_UPDATE);
+    if (READ_BIT(PWM_TIMER_INSTANCE->CR1, TIM_CR1_DIR) != 0) {
+        return;
+    }
+
+    /* The counter turned up from 0 at the update */
+    IRQ_PROFILE_ENTER(IRQ_ID_PWM, PWM_TIMER_INSTANCE->CNT * (SystemCoreClock / PWM_TIMER_TICK_HZ));
+
+    if (autonomous_release) {
+        autonomous_release = false;
+        arbiter_release(ARBITER_SOURCE_AUTONOMOUS);
+    }
+
+    if (++divider >= ODOMETRY_DIVIDER) {
+        int16_t left_counts;
+        int16_t right_counts;
+
+        divider = 0;
+        encoder_read(&left_counts, &right_counts);
+        odometry_update(left_counts, right_counts);
+        stall_update(left_counts, right_counts);
+    }
+
+    if (++line_divider >= LINE_DIVIDER) {
+        line_divider = 0;
+        if (autonomous == AUTONOMOUS_LINE) {
+            line_run();
+        }
+    }
+
+    if (++macro_divider >= MACRO_DIVIDER) {
+        macro_divider = 0;
+        if (autonomous == AUTONOMOUS_MACRO) {
+            macro_run();
+        }
+    }
+
+    if (++slot >= IMU_DIVIDER) {
+        slot = 0;
+    }
+    if (slot == 0) {
+        int16_t rate;
+
+        led_strip_release();
+        if (!bus_paused && !radio_busy() && imu_tick(&rate)) {
+            heading_update(rate);
+        } else {
+            heading_lost();
+        }
+    } else if (slot == STRIP_SLOT && !bus_paused && !imu_busy() && !radio_busy()) {
+        led_strip_start();
+    }
+    radio_tick(slot != 0 && slot != STRIP_SLOT && !bus_paused && !imu_busy());
+
+    IRQ_PROFILE_EXIT(IRQ_ID_PWM);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file
+ * @brief Emergency braking rule for obstacles ahead.
+ *
+ * Forward efforts are cut when the range is shorter than the distance the
+ * car needs to stop from the commanded speed: the distance covered during
+ * the sensing latency, plus the braking distance, plus a margin. Reverse
+ * efforts are never limited, so the car can always back away.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "obstacle.h"
+#include "ultrasonic.h"
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Computes the stopping threshold for a setpoint.
+ *
+ * @param setpoint  Requested wheel efforts.
+ *
+ * @return Minimum clear range, in mm.
+ */
+uint16_t obstacle_threshold(const drive_setpoint_t *setpoint) {
+    int32_t effort = setpoint->left > setpoint->right ? setpoint->left : setpoint->right;
+
+    if (effort <= 0) {
+        return 0;
+    }
+
+    uint32_t speed = (uint32_t)effort * OBSTACLE_FULL_SPEED_MM_S / DRIVE_EFFORT_MAX;
+    uint32_t threshold = OBSTACLE_MARGIN_MM + speed * OBSTACLE_LATENCY_MS / 1000
+                         + speed * speed / (2 * OBSTACLE_DECEL_MM_S2);
+
+    return threshold > UINT16_MAX ? UINT16_MAX : (uint16_t)threshold;
+}
+
+/**
+ * @brief Checks whether forward motion must be blocked.
+ *
+ * @param setpoint  Requested wheel efforts.
+ * @param range     Measured range, in mm.
+ *
+ * @return true if the range is shorter than the stopping threshold. A missing
+ *         reading never blocks.
+ */
+bool obstacle_check(const drive_setpoint_t *setpoint, uint16_t range_mm) {
+    if (range_mm == ULTRASONIC_RANGE_INVALID) {
+        return false;
+    }
+
+    return range_mm < obstacle_threshold(setpoint);
+}
+
+/**
+ * @brief Removes the forward component of a setpoint.
+ *
+ * @param setpoint  Setpoint to be limited.
+ */
+void obstacle_clamp(drive_setpoint_t *setpoint) {
+    if (setpoint->left > 0) {
+        setpoint->left = 0;
+    }
+    if (setpoint->right > 0) {
+        setpoint->right = 0;
+    }
+}
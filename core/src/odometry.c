@@ -0,0 +1,134 @@
+/**
+ * @file
+ * @brief Differential drive dead-reckoning from wheel encoder counts.
+ *
+ * Each update advances the pose along the chord of the travelled arc: the
+ * distance is the mean of both wheels, applied at the midpoint heading.
+ * Positions are integer micrometres, the heading a q31_t angle, and sine and
+ * cosine come from the Q15 table, so an update is a handful of integer
+ * multiplies.
+ *
+ * odometry_update() is meant to run from a fixed-rate timer interrupt. The
+ * pose is published through a sequence counter, so odometry_get_pose() never
+ * masks interrupts and never returns a half-updated pose.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "odometry.h"
+
+/** Definitions --------------------------------------------------- */
+#define ODOMETRY_PI_NUMERATOR       355     /* 355 / 113 */
+#define ODOMETRY_PI_DENOMINATOR     113
+
+/** Travelled distance per count, in Q16 micrometres. */
+#define ODOMETRY_UM_PER_COUNT_Q16   ((int32_t)(((int64_t)ODOMETRY_WHEEL_DIAMETER_UM * ODOMETRY_PI_NUMERATOR << 16) \
+                                     / ((int64_t)ODOMETRY_PI_DENOMINATOR * ODOMETRY_COUNTS_PER_REV)))
+
+/** Heading change, in Q16 semicircle units (2^31 = pi), per micrometre of
+ * wheel difference: 2^31 / (pi * track). */
+#define ODOMETRY_ANGLE_PER_UM_Q16   ((int64_t)(((int64_t)1 << 47) * ODOMETRY_PI_DENOMINATOR \
+                                     / ((int64_t)ODOMETRY_PI_NUMERATOR * ODOMETRY_TRACK_WIDTH_UM)))
+
+/** Variables ----------------------------------------------------- */
+static odometry_pose_t pose;
+static int64_t x_q15 = 0;
+static int64_t y_q15 = 0;
+
+static int32_t counts[2] = { 0, 0 };
+
+static odometry_pose_t published;
+static int32_t published_counts[2];
+static volatile uint32_t sequence = 0;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Resets the pose to the origin, heading along x.
+ */
+void odometry_init(void) {
+    pose.x_um = 0;
+    pose.y_um = 0;
+    pose.heading = 0;
+    x_q15 = 0;
+    y_q15 = 0;
+    counts[0] = 0;
+    counts[1] = 0;
+
+    sequence++;
+    __sync_synchronize();
+    published = pose;
+    published_counts[0] = 0;
+    published_counts[1] = 0;
+    __sync_synchronize();
+    sequence++;
+}
+
+/**
+ * @brief Integrates the encoder counts of one update period.
+ *
+ * @param left_counts   Left wheel counts since the last update.
+ * @param right_counts  Right wheel counts since the last update.
+ */
+void odometry_update(int16_t left_counts, int16_t right_counts) {
+    /* Work from the count sum and difference so the per-wheel truncation
+     * to whole micrometres does not bias the heading */
+    int32_t sum = (int32_t)left_counts + right_counts;
+    int32_t difference = (int32_t)right_counts - left_counts;
+
+    int32_t distance_um = (int32_t)(((int64_t)sum * ODOMETRY_UM_PER_COUNT_Q16) >> 17);
+    q31_t turn = (q31_t)(((int64_t)difference * ODOMETRY_UM_PER_COUNT_Q16 * ODOMETRY_ANGLE_PER_UM_Q16) >> 32);
+    q31_t midpoint = (q31_t)((uint32_t)pose.heading + (uint32_t)(turn / 2));
+
+    /* Accumulate with 15 fractional bits so rounding does not drift */
+    x_q15 += (int64_t)distance_um * fix_cos(midpoint);
+    y_q15 += (int64_t)distance_um * fix_sin(midpoint);
+
+    pose.x_um = (int32_t)(x_q15 >> 15);
+    pose.y_um = (int32_t)(y_q15 >> 15);
+    pose.heading = (q31_t)((uint32_t)pose.heading + (uint32_t)turn);
+    counts[0] += left_counts;
+    counts[1] += right_counts;
+
+    sequence++;
+    __sync_synchronize();
+    published = pose;
+    published_counts[0] = counts[0];
+    published_counts[1] = counts[1];
+    __sync_synchronize();
+    sequence++;
+}
+
+/**
+ * @brief Gets a consistent copy of the latest pose.
+ *
+ * @param copy  Latest pose.
+ */
+void odometry_get_pose(odometry_pose_t *copy) {
+    uint32_t start;
+
+    do {
+        start = sequence;
+        __sync_synchronize();
+        *copy = published;
+        __sync_synchronize();
+    } while ((start & 1) != 0 || start != sequence);
+}
+
+/**
+ * @brief Gets the encoder counts accumulated by each wheel since the last
+ * reset, consistent with each other.
+ *
+ * @param left  Left wheel counts, positive forward.
+ * @param right Right wheel counts, positive forward.
+ */
+void odometry_get_counts(int32_t *left, int32_t *right) {
+    uint32_t start;
+
+    do {
+        start = sequence;
+        __sync_synchronize();
+        *left = published_counts[0];
+        *right = published_counts[1];
+        __sync_synchronize();
+    } while ((start & 1) != 0 || start != sequence);
+}
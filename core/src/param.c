@@ -0,0 +1,149 @@
+/**
+ * @file
+ * @brief Tuning parameter table and snapshots.
+ *
+ * The snapshot is stored and loaded by the caller.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "drive.h"
+#include "heading.h"
+#include "line.h"
+#include "param.h"
+
+/** Definitions --------------------------------------------------- */
+/** Remote key repeat, kept below the arbiter timeout of the remote. */
+#define REMOTE_PERIOD_MS            200
+#define REMOTE_PERIOD_MAX_MS        240
+
+/** Without any drive command for this long, drop to the lowest clock. */
+#define IDLE_TIMEOUT_MS             60000
+
+_Static_assert(PARAM_COUNT <= PARAM_CAPACITY, "parameter snapshot too small");
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    param_type_t type;
+    int32_t min;
+    int32_t max;
+    int32_t default_value;
+} param_info_t;
+
+/** Variables ----------------------------------------------------- */
+/** Gain ranges keep the controller sums within 32 bits. */
+static const param_info_t param_table[PARAM_COUNT] = {
+    [PARAM_DRIVE_DUTY] = { PARAM_TYPE_U16, 0, DRIVE_EFFORT_MAX, DRIVE_PWM_DUTY },
+    [PARAM_REMOTE_PERIOD_MS] = { PARAM_TYPE_U16, 20, REMOTE_PERIOD_MAX_MS, REMOTE_PERIOD_MS },
+    [PARAM_IDLE_TIMEOUT_MS] = { PARAM_TYPE_U32, 1000, 3600000, IDLE_TIMEOUT_MS },
+    [PARAM_LINE_KP] = { PARAM_TYPE_S16, 0, 2000, LINE_KP },
+    [PARAM_LINE_KI] = { PARAM_TYPE_S16, 0, 1000, LINE_KI },
+    [PARAM_LINE_KD] = { PARAM_TYPE_S16, 0, 60, LINE_KD },
+    [PARAM_LINE_BASE_EFFORT] = { PARAM_TYPE_U16, 0, DRIVE_EFFORT_MAX, LINE_BASE_EFFORT },
+    [PARAM_HEADING_KP] = { PARAM_TYPE_S16, 0, 100, HEADING_KP },
+    [PARAM_HEADING_KI] = { PARAM_TYPE_S16, 0, 100, HEADING_KI },
+    [PARAM_HEADING_KD] = { PARAM_TYPE_S16, 0, 50, HEADING_KD },
+    [PARAM_DRIVE_STOP] = { PARAM_TYPE_U16, DRIVE_STOP_COAST, DRIVE_STOP_BRAKE, DRIVE_STOP_COAST },
+};
+
+/** Defaults from the start, so modules work before param_init(). */
+int32_t param_values[PARAM_COUNT] = {
+    [PARAM_DRIVE_DUTY] = DRIVE_PWM_DUTY,
+    [PARAM_REMOTE_PERIOD_MS] = REMOTE_PERIOD_MS,
+    [PARAM_IDLE_TIMEOUT_MS] = IDLE_TIMEOUT_MS,
+    [PARAM_LINE_KP] = LINE_KP,
+    [PARAM_LINE_KI] = LINE_KI,
+    [PARAM_LINE_KD] = LINE_KD,
+    [PARAM_LINE_BASE_EFFORT] = LINE_BASE_EFFORT,
+    [PARAM_HEADING_KP] = HEADING_KP,
+    [PARAM_HEADING_KI] = HEADING_KI,
+    [PARAM_HEADING_KD] = HEADING_KD,
+    [PARAM_DRIVE_STOP] = DRIVE_STOP_COAST,
+};
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Sets every parameter to its default, then takes the values of a
+ * snapshot. Values out of range keep their default.
+ *
+ * @param record    Snapshot loaded from flash, NULL for the defaults.
+ *
+ * @return true if the snapshot was of this version and was used.
+ */
+bool param_init(const param_record_t *record) {
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        param_values[id] = param_table[id].default_value;
+    }
+
+    if (record == NULL || record->magic != PARAM_MAGIC || record->version != PARAM_VERSION) {
+        return false;
+    }
+
+    for (uint8_t id = 0; id < PARAM_COUNT && id < record->count; id++) {
+        param_set(id, record->values[id]);
+    }
+    return true;
+}
+
+/**
+ * @brief Changes a parameter, if the value is within its range.
+ *
+ * @param id        Parameter ID.
+ * @param value     New value.
+ *
+ * @return PARAM_STATUS_OK if the value was taken.
+ */
+param_status_t param_set(uint8_t id, int32_t value) {
+    if (id >= PARAM_COUNT) {
+        return PARAM_STATUS_UNKNOWN;
+    }
+    if (value < param_table[id].min || value > param_table[id].max) {
+        return PARAM_STATUS_RANGE;
+    }
+
+    param_values[id] = value;
+    return PARAM_STATUS_OK;
+}
+
+/**
+ * @brief Describes a parameter and its current value.
+ *
+ * @param id        Parameter ID.
+ * @param entry     Description, with only the ID and the status set for
+ *                  an unknown ID.
+ *
+ * @return PARAM_STATUS_UNKNOWN for an unknown ID.
+ */
+param_status_t param_describe(uint8_t id, param_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+
+    if (id >= PARAM_COUNT) {
+        entry->status = PARAM_STATUS_UNKNOWN;
+        return PARAM_STATUS_UNKNOWN;
+    }
+
+    entry->type = (uint8_t)param_table[id].type;
+    entry->status = PARAM_STATUS_OK;
+    entry->value = param_values[id];
+    entry->min = param_table[id].min;
+    entry->max = param_table[id].max;
+    entry->default_value = param_table[id].default_value;
+    return PARAM_STATUS_OK;
+}
+
+/**
+ * @brief Takes a snapshot of every value, to be stored. The CRC is left to
+ * the store.
+ *
+ * @param record    Snapshot.
+ */
+void param_snapshot(param_record_t *record) {
+    memset(record, 0, sizeof(*record));
+    record->magic = PARAM_MAGIC;
+    record->version = PARAM_VERSION;
+    record->count = PARAM_COUNT;
+    memcpy(record->values, param_values, sizeof(param_values));
+}
@@ -0,0 +1,419 @@
+/**
+ * @file
+ * @brief nRF24L01+ radio control link, as a non-blocking SPI state machine.
+ *
+ * Bring-up and the idle link check are sequenced by radio_tick(); a packet
+ * exchange is started by the tick and then chained from radio_bus_done(),
+ * one transfer per completion, so it holds the bus for about 0.1 ms per
+ * packet instead of one tick per transfer. The callback and the tick must
+ * not preempt each other.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "radio.h"
+
+/** Definitions --------------------------------------------------- */
+#define RADIO_COMMAND_SIZE          (1 + RADIO_ADDRESS_SIZE)
+
+/** Types --------------------------------------------------------- */
+/** Transfers of a packet exchange, and of the idle link check. */
+typedef enum {
+    RADIO_JOB_NONE = 0,
+    RADIO_JOB_CHECK,            /**< Read CONFIG, with the status */
+    RADIO_JOB_WIDTH,            /**< Read the width of the payload on top */
+    RADIO_JOB_PAYLOAD,
+    RADIO_JOB_FLUSH_RX,         /**< Drop a payload of a bad width */
+    RADIO_JOB_FLUSH_TX,         /**< Drop acknowledgment payloads never sent */
+    RADIO_JOB_ACK,              /**< Load the next acknowledgment payload */
+    RADIO_JOB_CLEAR,            /**< Clear RX_DR, with the status */
+} radio_job_t;
+
+typedef struct {
+    uint8_t size;
+    uint8_t bytes[RADIO_COMMAND_SIZE];
+} radio_command_t;
+
+/** Variables ----------------------------------------------------- */
+/** Primary receiver on pipe 0 only, with auto acknowledgment, dynamic
+ * payloads and acknowledgment payloads. CONFIG is written last: it powers
+ * the radio up. */
+static const radio_command_t radio_config[] = {
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_CONFIG, 0 } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_SETUP_AW, RADIO_SETUP_AW_5_BYTES } },
+    { RADIO_COMMAND_SIZE, { RADIO_CMD_W_REGISTER | RADIO_REG_RX_ADDR_P0, RADIO_ADDRESS_BYTES } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_EN_AA, RADIO_PIPE_0 } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_EN_RXADDR, RADIO_PIPE_0 } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_RF_CH, RADIO_CHANNEL } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_RF_SETUP, RADIO_RF_SETUP_2MBPS_0DBM } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_FEATURE, RADIO_FEATURE_DPL_ACK_PAY } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_DYNPD, RADIO_PIPE_0 } },
+    { 1, { RADIO_CMD_FLUSH_RX } },
+    { 1, { RADIO_CMD_FLUSH_TX } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_STATUS, RADIO_STATUS_CLEAR } },
+    { 2, { RADIO_CMD_W_REGISTER | RADIO_REG_CONFIG, RADIO_CONFIG_VALUE } },
+};
+
+#define RADIO_CONFIG_COUNT  (sizeof(radio_config) / sizeof(radio_config[0]))
+
+static radio_handler_t radio_handler = NULL;
+
+static uint8_t tx[1 + RADIO_PAYLOAD_MAX];
+static uint8_t rx[1 + RADIO_PAYLOAD_MAX];
+
+static radio_state_t state = RADIO_STATE_RESET;
+static radio_state_t next_state = RADIO_STATE_RESET;
+static uint8_t step = 0;
+static uint8_t wait_ticks = 0;
+
+static volatile bool pending = false;
+static uint8_t pending_ticks = 0;
+static radio_job_t job = RADIO_JOB_NONE;
+static uint8_t width = 0;
+static uint16_t idle_ticks = 0;
+
+static volatile bool irq_flag = false;
+static uint16_t irq_ticks = 0;          /* Since the oldest unread IRQ */
+
+/** Written by the main loop, read by the exchange: the writer fills the
+ * buffer not in use and then publishes it. */
+static radio_telemetry_t telemetry[2];
+static volatile uint8_t telemetry_index = 0;
+static uint8_t last_sequence = 0;
+
+static radio_stats_t radio_stats = { 0 };
+
+/** Prototypes ---------------------------------------------------- */
+static void radio_restart(void);
+static void radio_wait(uint8_t ticks, radio_state_t next);
+static void radio_transfer(uint8_t size);
+static void radio_command(uint8_t command, uint8_t size);
+static void radio_run(radio_job_t next);
+static void radio_deliver(void);
+static void radio_exchange(void);
+static void radio_configure(void);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Drops out of reception and configures the radio again, from the
+ * power on wait.
+ */
+static void radio_restart(void) {
+    radio_bus_enable(false);
+    radio_stats.resets++;
+    pending = false;
+    job = RADIO_JOB_NONE;
+    radio_wait(RADIO_RESET_TICKS, RADIO_STATE_CONFIGURE);
+}
+
+static void radio_wait(uint8_t ticks, radio_state_t next) {
+    state = RADIO_STATE_WAIT;
+    next_state = next;
+    wait_ticks = ticks;
+    step = 0;
+}
+
+/**
+ * @brief Starts a transfer of tx; a failed start counts as a timeout.
+ */
+static void radio_transfer(uint8_t size) {
+    pending = true;
+    pending_ticks = 0;
+    if (!radio_bus_transfer(tx, rx, size)) {
+        pending_ticks = RADIO_TIMEOUT_TICKS;
+    }
+}
+
+/**
+ * @brief Starts a command followed by NOP bytes, to read size - 1 bytes.
+ */
+static void radio_command(uint8_t command, uint8_t size) {
+    tx[0] = command;
+    memset(&tx[1], RADIO_CMD_NOP, size - 1);
+    radio_transfer(size);
+}
+
+/**
+ * @brief Starts the next transfer of the exchange, or ends it.
+ */
+static void radio_run(radio_job_t next) {
+    job = next;
+
+    switch (job) {
+        case RADIO_JOB_CHECK: {
+            radio_command(RADIO_CMD_R_REGISTER | RADIO_REG_CONFIG, 2);
+            break;
+        }
+        case RADIO_JOB_WIDTH: {
+            radio_command(RADIO_CMD_R_RX_PL_WID, 2);
+            break;
+        }
+        case RADIO_JOB_PAYLOAD: {
+            radio_command(RADIO_CMD_R_RX_PAYLOAD, (uint8_t)(1 + width));
+            break;
+        }
+        case RADIO_JOB_FLUSH_RX: {
+            radio_command(RADIO_CMD_FLUSH_RX, 1);
+            break;
+        }
+        case RADIO_JOB_FLUSH_TX: {
+            radio_command(RADIO_CMD_FLUSH_TX, 1);
+            break;
+        }
+        case RADIO_JOB_ACK: {
+            radio_telemetry_t payload = telemetry[telemetry_index];
+
+            payload.sequence = last_sequence;
+            tx[0] = RADIO_CMD_W_ACK_PAYLOAD;
+            memcpy(&tx[1], &payload, sizeof(payload));
+            radio_transfer(1 + sizeof(payload));
+            break;
+        }
+        case RADIO_JOB_CLEAR: {
+            tx[0] = RADIO_CMD_W_REGISTER | RADIO_REG_STATUS;
+            tx[1] = RADIO_STATUS_RX_DR;
+            radio_transfer(2);
+            break;
+        }
+        default: {
+            idle_ticks = 0;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Hands a received command to the handler.
+ */
+static void radio_deliver(void) {
+    serial_command_t command;
+
+    if (width != sizeof(command)) {
+        radio_stats.invalid++;
+        return;
+    }
+
+    memcpy(&command, &rx[1], sizeof(command));
+    last_sequence = command.sequence;
+    radio_stats.packets++;
+    if (irq_ticks > radio_stats.latency_max_ticks) {
+        radio_stats.latency_max_ticks = irq_ticks;
+    }
+
+    if (radio_handler != NULL) {
+        radio_handler(&command);
+    }
+}
+
+/**
+ * @brief Moves the exchange on after a transfer. rx[0] always holds the
+ * status the radio clocked out with the command byte.
+ */
+static void radio_exchange(void) {
+    uint8_t status = rx[0];
+
+    switch (job) {
+        case RADIO_JOB_CHECK: {
+            if (rx[1] != RADIO_CONFIG_VALUE) {
+                radio_restart();
+                return;
+            }
+            /* A packet whose IRQ edge was missed */
+            radio_run((status & RADIO_STATUS_RX_P_NO) != RADIO_STATUS_RX_EMPTY ? RADIO_JOB_WIDTH : RADIO_JOB_NONE);
+            break;
+        }
+        case RADIO_JOB_WIDTH: {
+            width = rx[1];
+            if ((status & RADIO_STATUS_RX_P_NO) == RADIO_STATUS_RX_EMPTY) {
+                radio_run(RADIO_JOB_CLEAR);
+            } else if (width == 0 || width > RADIO_PAYLOAD_MAX) {
+                radio_stats.invalid++;
+                radio_run(RADIO_JOB_FLUSH_RX);
+            } else {
+                radio_run(RADIO_JOB_PAYLOAD);
+            }
+            break;
+        }
+        case RADIO_JOB_PAYLOAD: {
+            radio_deliver();
+            radio_run((status & RADIO_STATUS_TX_FULL) != 0 ? RADIO_JOB_FLUSH_TX : RADIO_JOB_ACK);
+            break;
+        }
+        case RADIO_JOB_FLUSH_TX: {
+            radio_run(RADIO_JOB_ACK);
+            break;
+        }
+        case RADIO_JOB_FLUSH_RX:
+        case RADIO_JOB_ACK: {
+            radio_run(RADIO_JOB_CLEAR);
+            break;
+        }
+        case RADIO_JOB_CLEAR: {
+            /* Packets that came in meanwhile raised no new edge */
+            if ((status & RADIO_STATUS_RX_P_NO) != RADIO_STATUS_RX_EMPTY) {
+                radio_run(RADIO_JOB_WIDTH);
+            } else {
+                irq_ticks = 0;
+                radio_run(RADIO_JOB_NONE);
+            }
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Moves the bring-up on after a transfer.
+ */
+static void radio_configure(void) {
+    switch (state) {
+        case RADIO_STATE_CONFIGURE: {
+            if (++step == RADIO_CONFIG_COUNT) {
+                radio_wait(RADIO_START_TICKS, RADIO_STATE_VERIFY);
+            }
+            break;
+        }
+        case RADIO_STATE_VERIFY: {
+            if (rx[1] != RADIO_CONFIG_VALUE) {
+                radio_restart();
+                break;
+            }
+            /* The first command is acknowledged with this payload */
+            state = RADIO_STATE_RUN;
+            radio_run(RADIO_JOB_ACK);
+            radio_bus_enable(true);
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Starts over from the power on wait.
+ *
+ * @param handler   Receives every command, NULL to drop them.
+ */
+void radio_init(radio_handler_t handler) {
+    radio_handler = handler;
+    radio_bus_enable(false);
+    pending = false;
+    job = RADIO_JOB_NONE;
+    irq_flag = false;
+    irq_ticks = 0;
+    idle_ticks = 0;
+    last_sequence = 0;
+    memset(telemetry, 0, sizeof(telemetry));
+    radio_wait(RADIO_RESET_TICKS, RADIO_STATE_CONFIGURE);
+    radio_stats = (radio_stats_t){ .state = RADIO_STATE_WAIT };
+}
+
+/**
+ * @brief Keeps time and starts the transfers. Must be called every tick.
+ *
+ * @param window    Whether the bus is free for this tick. An exchange
+ *                  started here runs on through the transfer completions.
+ */
+void radio_tick(bool window) {
+    if (irq_flag || job != RADIO_JOB_NONE) {
+        irq_ticks++;
+    }
+
+    if (pending) {
+        if (++pending_ticks >= RADIO_TIMEOUT_TICKS) {
+            radio_restart();
+        }
+        radio_stats.state = (uint8_t)state;
+        return;
+    }
+
+    if (state == RADIO_STATE_WAIT) {
+        if (wait_ticks == 0 || --wait_ticks == 0) {
+            state = next_state;
+        }
+    } else if (state == RADIO_STATE_RUN && idle_ticks < RADIO_CHECK_TICKS) {
+        idle_ticks++;
+    }
+
+    if (window) {
+        switch (state) {
+            case RADIO_STATE_CONFIGURE: {
+                memcpy(tx, radio_config[step].bytes, radio_config[step].size);
+                radio_transfer(radio_config[step].size);
+                break;
+            }
+            case RADIO_STATE_VERIFY: {
+                radio_command(RADIO_CMD_R_REGISTER | RADIO_REG_CONFIG, 2);
+                break;
+            }
+            case RADIO_STATE_RUN: {
+                if (irq_flag) {
+                    irq_flag = false;
+                    radio_run(RADIO_JOB_WIDTH);
+                } else if (idle_ticks >= RADIO_CHECK_TICKS) {
+                    radio_stats.checks++;
+                    radio_run(RADIO_JOB_CHECK);
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+
+    radio_stats.state = (uint8_t)state;
+}
+
+/**
+ * @brief Radio IRQ line falling edge: a packet is in the FIFO.
+ */
+void radio_irq(void) {
+    if (!irq_flag && job == RADIO_JOB_NONE) {
+        irq_ticks = 0;
+    }
+    irq_flag = true;
+}
+
+/**
+ * @brief Checks whether a transfer is running, so the bus and its DMA
+ * channels are in use.
+ */
+bool radio_busy(void) {
+    return pending;
+}
+
+/**
+ * @brief Sets what the next acknowledgment payloads carry; the sequence is
+ * filled in by the link.
+ */
+void radio_set_telemetry(const radio_telemetry_t *payload) {
+    uint8_t next = telemetry_index ^ 1;
+
+    telemetry[next] = *payload;
+    __sync_synchronize();
+    telemetry_index = next;
+}
+
+void radio_get_stats(radio_stats_t *stats) {
+    *stats = radio_stats;
+}
+
+void radio_bus_done(void) {
+    if (!pending) {
+        return;
+    }
+    pending = false;
+
+    if (job != RADIO_JOB_NONE) {
+        radio_exchange();
+    } else {
+        radio_configure();
+    }
+}
@@ -0,0 +1,241 @@
+/**
+ * @file
+ * @brief SPI2 bus hooks of the radio link.
+ *
+ * The nRF24L01+ shares SPI2 with the LED strip: SCK on PB13, MISO on PB14,
+ * MOSI on PB15, with its own CSN on PB12, CE on PA12 and IRQ on PB4
+ * (EXTI4). The strip data input is gated by CSN in hardware (see
+ * led_strip.c), so radio traffic never reaches the LEDs, and the radio
+ * ignores strip frames as its CSN is high. MOSI is parked low before CSN
+ * rises and only handed back to the SPI once CSN is low, so the level the
+ * last radio bit leaves on MOSI never passes the gate.
+ *
+ * Transfers are full duplex by DMA: reception on DMA1 channel 4, whose
+ * transfer complete interrupt ends the transfer, and transmission on DMA1
+ * channel 5, shared with the strip and the gyro (see led_strip.c), so it
+ * is configured again for every transfer and only used in the bus windows
+ * of the PWM timer interrupt. The SPI is set up again for every transfer
+ * too: the strip leaves it transmit only, at its own bit rate.
+ *
+ * The DMA and IRQ line interrupts share one priority level with the PWM
+ * timer interrupt that runs radio_tick(), so completions never preempt the
+ * state machine.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "radio.h"
+#include "irq.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define RADIO_SPI_GPIO_CLOCK_ENABLE()   __HAL_RCC_GPIOB_CLK_ENABLE()
+#define RADIO_SPI_PORT                  GPIOB
+#define RADIO_SCK_PIN                   GPIO_PIN_13
+#define RADIO_MISO_PIN                  GPIO_PIN_14
+#define RADIO_MOSI_PIN                  GPIO_PIN_15
+#define RADIO_CSN_PIN                   GPIO_PIN_12
+#define RADIO_IRQ_PIN                   GPIO_PIN_4
+#define RADIO_IRQ                       EXTI4_IRQn
+
+#define RADIO_CE_GPIO_CLOCK_ENABLE()    __HAL_RCC_GPIOA_CLK_ENABLE()
+#define RADIO_CE_PORT                   GPIOA
+#define RADIO_CE_PIN                    GPIO_PIN_12
+
+#define RADIO_SPI_INSTANCE              SPI2
+#define RADIO_SPI_CLOCK_ENABLE()        __HAL_RCC_SPI2_CLK_ENABLE()
+#define RADIO_SPI_RATE_MAX_HZ           8000000
+
+#define RADIO_DMA_CLOCK_ENABLE()        __HAL_RCC_DMA1_CLK_ENABLE()
+#define RADIO_RX_DMA_CHANNEL            DMA1_Channel4
+#define RADIO_RX_DMA_IRQ                DMA1_Channel4_IRQn
+#define RADIO_TX_DMA_CHANNEL            DMA1_Channel5
+
+/** Variables ----------------------------------------------------- */
+static DMA_HandleTypeDef rx_dma_handle = { 0 };
+static DMA_HandleTypeDef tx_dma_handle = { 0 };
+
+/** Master, software chip select, mode 0, MSB first, full duplex. */
+static uint32_t spi_cr1 = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static void radio_bus_select(void);
+static void radio_bus_deselect(void);
+static void radio_bus_complete(DMA_HandleTypeDef *hdma);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Selects the chip, which closes the strip gate, then hands MOSI to
+ * the SPI.
+ */
+static void radio_bus_select(void) {
+    GPIO_InitTypeDef gpio_init = { 0 };
+
+    HAL_GPIO_WritePin(RADIO_SPI_PORT, RADIO_CSN_PIN, GPIO_PIN_RESET);
+    gpio_init.Pin = RADIO_MOSI_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+}
+
+/**
+ * @brief Parks MOSI low, then deselects the chip, which opens the strip
+ * gate on a low level.
+ */
+static void radio_bus_deselect(void) {
+    GPIO_InitTypeDef gpio_init = { 0 };
+
+    HAL_GPIO_WritePin(RADIO_SPI_PORT, RADIO_MOSI_PIN, GPIO_PIN_RESET);
+    gpio_init.Pin = RADIO_MOSI_PIN;
+    gpio_init.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+    HAL_GPIO_WritePin(RADIO_SPI_PORT, RADIO_CSN_PIN, GPIO_PIN_SET);
+}
+
+/**
+ * @brief Reception DMA complete: every byte has been clocked, so the chip
+ * can be deselected at once.
+ */
+static void radio_bus_complete(DMA_HandleTypeDef *hdma) {
+    (void)hdma;
+
+    radio_bus_deselect();
+    CLEAR_BIT(RADIO_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+    __HAL_DMA_DISABLE(&tx_dma_handle);
+    radio_bus_done();
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures the radio pins, both DMA channels and the IRQ line.
+ * SPI2 itself is set up by the strip.
+ */
+void radio_bus_setup(void) {
+    RADIO_SPI_GPIO_CLOCK_ENABLE();
+    RADIO_CE_GPIO_CLOCK_ENABLE();
+    RADIO_SPI_CLOCK_ENABLE();
+    RADIO_DMA_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+
+    HAL_GPIO_WritePin(RADIO_SPI_PORT, RADIO_CSN_PIN, GPIO_PIN_SET);
+    gpio_init.Pin = RADIO_CSN_PIN;
+    gpio_init.Mode = GPIO_MODE_OUTPUT_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+    radio_bus_deselect();
+
+    HAL_GPIO_WritePin(RADIO_CE_PORT, RADIO_CE_PIN, GPIO_PIN_RESET);
+    gpio_init.Pin = RADIO_CE_PIN;
+    HAL_GPIO_Init(RADIO_CE_PORT, &gpio_init);
+
+    gpio_init.Pin = RADIO_SCK_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+
+    gpio_init.Pin = RADIO_MISO_PIN;
+    gpio_init.Mode = GPIO_MODE_INPUT;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+
+    gpio_init.Pin = RADIO_IRQ_PIN;
+    gpio_init.Mode = GPIO_MODE_IT_FALLING;
+    gpio_init.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(RADIO_SPI_PORT, &gpio_init);
+
+    rx_dma_handle.Instance = RADIO_RX_DMA_CHANNEL;
+    rx_dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    rx_dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    rx_dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    rx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    rx_dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    rx_dma_handle.Init.Mode = DMA_NORMAL;
+    rx_dma_handle.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    HAL_DMA_Init(&rx_dma_handle);
+    rx_dma_handle.XferCpltCallback = radio_bus_complete;
+
+    tx_dma_handle.Instance = RADIO_TX_DMA_CHANNEL;
+    tx_dma_handle.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    tx_dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    tx_dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    tx_dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    tx_dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    tx_dma_handle.Init.Mode = DMA_NORMAL;
+    tx_dma_handle.Init.Priority = DMA_PRIORITY_HIGH;
+
+    radio_bus_retime();
+
+    HAL_NVIC_SetPriority(RADIO_RX_DMA_IRQ, IRQ_PREEMPT_RADIO, IRQ_SUB_RADIO);
+    HAL_NVIC_EnableIRQ(RADIO_RX_DMA_IRQ);
+    HAL_NVIC_SetPriority(RADIO_IRQ, IRQ_PREEMPT_RADIO, IRQ_SUB_RADIO);
+    HAL_NVIC_EnableIRQ(RADIO_IRQ);
+}
+
+/**
+ * @brief Sets the bit rate after a clock profile switch: the fastest APB1
+ * division within the radio limit. A transfer cut short ends in a timeout
+ * and a new bring-up.
+ */
+void radio_bus_retime(void) {
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t setting = 0;
+
+    while ((pclk >> (setting + 1)) > RADIO_SPI_RATE_MAX_HZ && setting < 7) {
+        setting++;
+    }
+
+    spi_cr1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | (setting << SPI_CR1_BR_Pos);
+}
+
+/**
+ * @brief Starts a full duplex transfer with the chip selected. A transfer
+ * the state machine gave up on is dropped first.
+ */
+bool radio_bus_transfer(const uint8_t *tx, uint8_t *rx, uint8_t size) {
+    radio_bus_deselect();
+    CLEAR_BIT(RADIO_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+    CLEAR_BIT(RADIO_SPI_INSTANCE->CR1, SPI_CR1_SPE);
+    WRITE_REG(RADIO_SPI_INSTANCE->CR1, spi_cr1);
+    SET_BIT(RADIO_SPI_INSTANCE->CR1, SPI_CR1_SPE);
+    (void)RADIO_SPI_INSTANCE->DR;
+    (void)RADIO_SPI_INSTANCE->SR;
+
+    HAL_DMA_Abort(&rx_dma_handle);
+    HAL_DMA_Init(&tx_dma_handle);
+    __HAL_DMA_DISABLE_IT(&tx_dma_handle, DMA_IT_TC | DMA_IT_HT | DMA_IT_TE);
+    if (HAL_DMA_Start_IT(&rx_dma_handle, (uint32_t)&RADIO_SPI_INSTANCE->DR, (uint32_t)rx, size) != HAL_OK
+        || HAL_DMA_Start(&tx_dma_handle, (uint32_t)tx, (uint32_t)&RADIO_SPI_INSTANCE->DR, size) != HAL_OK) {
+        return false;
+    }
+
+    radio_bus_select();
+    SET_BIT(RADIO_SPI_INSTANCE->CR2, SPI_CR2_RXDMAEN);
+    SET_BIT(RADIO_SPI_INSTANCE->CR2, SPI_CR2_TXDMAEN);
+    return true;
+}
+
+void radio_bus_enable(bool enabled) {
+    HAL_GPIO_WritePin(RADIO_CE_PORT, RADIO_CE_PIN, enabled ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/**
+ * @brief Radio IRQ line, low while a packet waits.
+ */
+void EXTI4_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_RADIO, IRQ_LATENCY_UNKNOWN);
+    __HAL_GPIO_EXTI_CLEAR_IT(RADIO_IRQ_PIN);
+    radio_irq();
+    IRQ_PROFILE_EXIT(IRQ_ID_RADIO);
+}
+
+void DMA1_Channel4_IRQHandler(void) {
+    IRQ_PROFILE_ENTER(IRQ_ID_RADIO, IRQ_LATENCY_UNKNOWN);
+    HAL_DMA_IRQHandler(&rx_dma_handle);
+    IRQ_PROFILE_EXIT(IRQ_ID_RADIO);
+}
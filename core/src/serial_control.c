@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @brief Serial control channel on USART2 (HC-05/HC-06 style radios).
+ *
+ * Bytes are received by DMA into a circular buffer, without interrupts.
+ * serial_control_read() drains and parses it from the main loop, so frame
+ * CRCs are checked with the CRC unit in the same thread as boot_flash_crc()
+ * and never interrupt it. Frames that arrive while the loop is held up for
+ * longer than the buffer lasts are lost, as a late setpoint would be.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "serial_control.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define SERIAL_GPIO_CLOCK_ENABLE()  __HAL_RCC_GPIOA_CLK_ENABLE()
+#define SERIAL_PORT                 GPIOA
+#define SERIAL_TX_PIN               GPIO_PIN_2
+#define SERIAL_RX_PIN               GPIO_PIN_3
+
+#define SERIAL_UART_INSTANCE        USART2
+#define SERIAL_UART_CLOCK_ENABLE()  __HAL_RCC_USART2_CLK_ENABLE()
+#define SERIAL_BAUD_RATE            115200
+
+#define SERIAL_DMA_CHANNEL          DMA1_Channel6
+#define SERIAL_DMA_CLOCK_ENABLE()   __HAL_RCC_DMA1_CLK_ENABLE()
+
+#define SERIAL_RX_BUFFER_SIZE       64  /* 5.5 ms of bytes at the baud rate */
+
+/** Variables ----------------------------------------------------- */
+static UART_HandleTypeDef uart_handle = { 0 };
+static DMA_HandleTypeDef dma_handle = { 0 };
+
+static uint8_t rx_buffer[SERIAL_RX_BUFFER_SIZE];
+static uint32_t rx_position = 0;
+
+static serial_frame_parser_t parser;
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures USART2, its RX DMA channel and the CRC unit.
+ */
+void serial_control_setup(void) {
+    serial_frame_init(&parser);
+
+    __HAL_RCC_CRC_CLK_ENABLE();
+    SERIAL_GPIO_CLOCK_ENABLE();
+    SERIAL_UART_CLOCK_ENABLE();
+    SERIAL_DMA_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = SERIAL_TX_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(SERIAL_PORT, &gpio_init);
+
+    gpio_init.Pin = SERIAL_RX_PIN;
+    gpio_init.Mode = GPIO_MODE_INPUT;
+    gpio_init.Pull = GPIO_PULLUP;
+    HAL_GPIO_Init(SERIAL_PORT, &gpio_init);
+
+    uart_handle.Instance = SERIAL_UART_INSTANCE;
+    uart_handle.Init.BaudRate = SERIAL_BAUD_RATE;
+    uart_handle.Init.WordLength = UART_WORDLENGTH_8B;
+    uart_handle.Init.StopBits = UART_STOPBITS_1;
+    uart_handle.Init.Parity = UART_PARITY_NONE;
+    uart_handle.Init.Mode = UART_MODE_TX_RX;
+    uart_handle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    uart_handle.Init.OverSampling = UART_OVERSAMPLING_16;
+    HAL_UART_Init(&uart_handle);
+
+    dma_handle.Instance = SERIAL_DMA_CHANNEL;
+    dma_handle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    dma_handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    dma_handle.Init.MemInc = DMA_MINC_ENABLE;
+    dma_handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    dma_handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    dma_handle.Init.Mode = DMA_CIRCULAR;
+    dma_handle.Init.Priority = DMA_PRIORITY_MEDIUM;
+    HAL_DMA_Init(&dma_handle);
+
+    HAL_DMA_Start(&dma_handle, (uint32_t)&SERIAL_UART_INSTANCE->DR, (uint32_t)rx_buffer, SERIAL_RX_BUFFER_SIZE);
+    SET_BIT(SERIAL_UART_INSTANCE->CR3, USART_CR3_DMAR);
+}
+
+/**
+ * @brief Recomputes the baud rate divider after a clock profile switch.
+ */
+void serial_control_retime(void) {
+    SERIAL_UART_INSTANCE->BRR = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), SERIAL_BAUD_RATE);
+}
+
+/**
+ * @brief Parses every byte written by the DMA since the last call, from
+ * the main loop, and gets the latest command completed.
+ *
+ * Older commands completed in the same call are dropped: only the newest
+ * setpoint matters.
+ *
+ * @param command   Latest command.
+ *
+ * @return true if a command arrived since the last call.
+ */
+bool serial_control_read(serial_command_t *command) {
+    uint32_t position = SERIAL_RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&dma_handle);
+    bool received = false;
+
+    if (position == SERIAL_RX_BUFFER_SIZE) {
+        position = 0;
+    }
+
+    while (rx_position != position) {
+        if (serial_frame_parse(&parser, rx_buffer[rx_position], command)) {
+            received = true;
+        }
+
+        rx_position++;
+        if (rx_position == SERIAL_RX_BUFFER_SIZE) {
+            rx_position = 0;
+        }
+    }
+
+    return received;
+}
+
+/**
+ * @brief CRC of whole words, using the hardware CRC unit. Main thread only,
+ * like boot_flash_crc().
+ */
+uint32_t serial_frame_crc(const uint32_t *words, uint32_t count) {
+    CRC->CR = CRC_CR_RESET;
+
+    for (uint32_t i = 0; i < count; i++) {
+        CRC->DR = words[i];
+    }
+
+    return CRC->DR;
+}
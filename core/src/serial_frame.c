@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Binary drive command frames for the serial control channel.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "serial_frame.h"
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Resets a parser and its counters.
+ *
+ * @param parser    Parser instance.
+ */
+void serial_frame_init(serial_frame_parser_t *parser) {
+    memset(parser, 0, sizeof(*parser));
+}
+
+/**
+ * @brief Feeds one received byte.
+ *
+ * On a CRC error the parser resynchronises on the next sync byte already
+ * buffered, so a frame starting inside a corrupted one is not lost.
+ *
+ * @param parser    Parser instance.
+ * @param byte      Received byte.
+ * @param command   Decoded command, written when a valid frame completes.
+ *
+ * @return true if a valid frame was completed.
+ */
+bool serial_frame_parse(serial_frame_parser_t *parser, uint8_t byte, serial_command_t *command) {
+    if (parser->length == 0 && byte != SERIAL_FRAME_SYNC) {
+        return false;
+    }
+
+    parser->buffer.bytes[parser->length++] = byte;
+    if (parser->length < SERIAL_FRAME_SIZE) {
+        return false;
+    }
+
+    const uint8_t *bytes = parser->buffer.bytes;
+    uint32_t crc = (uint32_t)bytes[8] | ((uint32_t)bytes[9] << 8) | ((uint32_t)bytes[10] << 16)
+                   | ((uint32_t)bytes[11] << 24);
+
+    if (serial_frame_crc(parser->buffer.words, SERIAL_FRAME_CRC_WORDS) == crc) {
+        command->type = bytes[1];
+        command->sequence = bytes[2];
+        command->a = (int16_t)(bytes[4] | (bytes[5] << 8));
+        command->b = (int16_t)(bytes[6] | (bytes[7] << 8));
+        parser->length = 0;
+        parser->accepted++;
+        return true;
+    }
+
+    parser->crc_errors++;
+
+    uint8_t next = 1;
+    while (next < SERIAL_FRAME_SIZE && bytes[next] != SERIAL_FRAME_SYNC) {
+        next++;
+    }
+    parser->length = SERIAL_FRAME_SIZE - next;
+    memmove(parser->buffer.bytes, &parser->buffer.bytes[next], parser->length);
+
+    return false;
+}
+
+/**
+ * @brief Builds a frame, used by senders and stand-ins.
+ *
+ * @param command   Command to be sent.
+ * @param frame     Encoded frame.
+ */
+void serial_frame_encode(const serial_command_t *command, uint8_t frame[SERIAL_FRAME_SIZE]) {
+    uint32_t words[SERIAL_FRAME_SIZE / 4];
+    uint8_t *bytes = (uint8_t *)words;
+
+    bytes[0] = SERIAL_FRAME_SYNC;
+    bytes[1] = command->type;
+    bytes[2] = command->sequence;
+    bytes[3] = 0;
+    bytes[4] = (uint8_t)command->a;
+    bytes[5] = (uint8_t)((uint16_t)command->a >> 8);
+    bytes[6] = (uint8_t)command->b;
+    bytes[7] = (uint8_t)((uint16_t)command->b >> 8);
+
+    uint32_t crc = serial_frame_crc(words, SERIAL_FRAME_CRC_WORDS);
+    bytes[8] = (uint8_t)crc;
+    bytes[9] = (uint8_t)(crc >> 8);
+    bytes[10] = (uint8_t)(crc >> 16);
+    bytes[11] = (uint8_t)(crc >> 24);
+
+    memcpy(frame, bytes, SERIAL_FRAME_SIZE);
+}
@@ -0,0 +1,266 @@
+/**
+ * @file
+ * @brief Buzzer sound effects, IMA ADPCM blocks at AUDIO_SAMPLE_RATE_HZ.
+ *
+ * Generated by tools/adpcm_encode.c, do not edit:
+ *     adpcm_encode -o core/src/sounds.c horn=synth:horn engine=synth:engine reverse=synth:reverse
+ */
+#include <stdint.h>
+
+#include "audio.h"
+
+/** Variables ----------------------------------------------------- */
+static const uint8_t horn[1152] = {
+    0x00, 0x00, 0x4F, 0x00, 0x60, 0x08, 0xC9, 0x8B, 0x41, 0x40, 0xC0, 0x88,
+    0x3B, 0x81, 0x80, 0x80, 0x30, 0xF3, 0x98, 0x0D, 0x04, 0x04, 0xC8, 0x8C,
+    0x00, 0x16, 0x08, 0xBA, 0x89, 0x41, 0x40, 0xC8, 0x80, 0x3C, 0x80, 0x80,
+    0xD0, 0xFF, 0x4F, 0x00, 0x80, 0x50, 0xA9, 0xB8, 0x2C, 0x14, 0x05, 0xC9,
+    0x8C, 0x00, 0x17, 0x08, 0xBB, 0x09, 0x22, 0x33, 0xDA, 0x88, 0x4C, 0x80,
+    0x80, 0x08, 0x70, 0x9A, 0xC0, 0x39, 0x22, 0x03, 0xFA, 0x8B, 0x18, 0x17,
+    0xDB, 0x55, 0x56, 0x00, 0x80, 0xCB, 0x08, 0x03, 0x13, 0xAB, 0xB8, 0x69,
+    0x80, 0x80, 0x08, 0x70, 0x8B, 0xE0, 0x38, 0x40, 0x81, 0xDA, 0x0A, 0x38,
+    0x07, 0x88, 0xAB, 0x88, 0x05, 0x02, 0x8B, 0xB8, 0x21, 0x80, 0x80, 0x80,
+    0x9D, 0x0E, 0x46, 0x00, 0x70, 0x8C, 0xE8, 0x30, 0x50, 0x80, 0xDB, 0x88,
+    0x40, 0x03, 0x88, 0xAE, 0x00, 0x03, 0x04, 0x8C, 0xB8, 0x13, 0x08, 0x08,
+    0x08, 0x14, 0x0E, 0xD9, 0x40, 0x40, 0x88, 0xDB, 0x08, 0x60, 0x81, 0xA0,
+    0x55, 0xD5, 0x54, 0x00, 0xA0, 0x18, 0x14, 0x83, 0x8D, 0xB8, 0x04, 0x08,
+    0x08, 0x08, 0x96, 0x8A, 0xCA, 0x42, 0x41, 0x90, 0xBD, 0x88, 0x70, 0x82,
+    0xB0, 0x9B, 0x38, 0x32, 0xA4, 0x0C, 0xC9, 0x04, 0x08, 0x08, 0x08, 0xA7,
+    0x44, 0x00, 0x52, 0x00, 0x80, 0x9C, 0x23, 0x42, 0x98, 0xBE, 0x80, 0x71,
+    0x81, 0xB0, 0x8B, 0x48, 0x30, 0xB1, 0x0A, 0x9B, 0x05, 0x08, 0x88, 0x00,
+    0xB7, 0x08, 0x8F, 0x03, 0x13, 0xB0, 0xAE, 0x80, 0x73, 0x80, 0xB8, 0x8A,
+    0xEF, 0xAD, 0x52, 0x00, 0x40, 0x30, 0xC0, 0x88, 0x1B, 0x02, 0x08, 0x08,
+    0x28, 0xC7, 0x88, 0x0D, 0x13, 0x05, 0xC8, 0x9B, 0x80, 0x27, 0x08, 0xB9,
+    0x8B, 0x50, 0x40, 0xB8, 0x88, 0x3C, 0x00, 0x80, 0x08, 0x48, 0xD1, 0x90,
+    0x5C, 0xAB, 0x4D, 0x00, 0x00, 0x07, 0x84, 0xC0, 0x8B, 0x08, 0x17, 0x80,
+    0xB9, 0x8A, 0x32, 0x51, 0xC8, 0x88, 0x4B, 0x80, 0x80, 0x80, 0x60, 0x9A,
+    0xA8, 0x2C, 0x14, 0x04, 0xD9, 0x0C, 0x08, 0x17, 0x88, 0xBA, 0x09, 0x13,
+    0xF1, 0x2A, 0x4F, 0x00, 0x20, 0xDA, 0x90, 0x4C, 0x80, 0x80, 0x80, 0x70,
+    0x9A, 0xC0, 0x39, 0x22, 0x03, 0xFB, 0x0B, 0x18, 0x17, 0x80, 0xCB, 0x08,
+    0x03, 0x04, 0x9A, 0xA8, 0x49, 0x80, 0x80, 0x80, 0x70, 0x8B, 0xF0, 0x38,
+    0xB3, 0x00, 0x53, 0x00, 0x30, 0x00, 0xCC, 0x0A, 0x30, 0x07, 0x88, 0xBB,
+    0x08, 0x05, 0x03, 0x8C, 0xB8, 0x12, 0x80, 0x80, 0x80, 0x72, 0x8C, 0xD8,
+    0x30, 0x41, 0x80, 0xCC, 0x88, 0x50, 0x83, 0x90, 0xAD, 0x00, 0x03, 0x85,
+    0xD1, 0x03, 0x53, 0x00, 0x80, 0xC8, 0x03, 0x08, 0x08, 0x80, 0x14, 0x8D,
+    0xD9, 0x40, 0x50, 0x08, 0xBC, 0x08, 0x70, 0x81, 0xA0, 0xAB, 0x10, 0x23,
+    0x84, 0x8D, 0xB8, 0x04, 0x80, 0x08, 0x08, 0x96, 0x0A, 0xCB, 0x42, 0x41,
+    0x9B, 0x55, 0x51, 0x00, 0x90, 0xCD, 0x80, 0x70, 0x00, 0xB0, 0x9B, 0x30,
+    0x31, 0xB3, 0x8C, 0xC9, 0x85, 0x00, 0x88, 0x00, 0xB7, 0x08, 0x9C, 0x23,
+    0x23, 0xB0, 0xBF, 0x80, 0x71, 0x01, 0xB8, 0x8C, 0x30, 0x40, 0xA0, 0x0A,
+    0x55, 0xD5, 0x4F, 0x00, 0x80, 0x03, 0x08, 0x08, 0x18, 0xB7, 0x88, 0x8F,
+    0x13, 0x14, 0xB8, 0x9E, 0x08, 0x73, 0x08, 0xB8, 0x8B, 0x40, 0x40, 0xC0,
+    0x08, 0x2B, 0x81, 0x00, 0x88, 0x20, 0xD5, 0x88, 0x0D, 0x04, 0x03, 0xC8,
+    0x47, 0xB9, 0x52, 0x00, 0x90, 0x80, 0x27, 0x00, 0xCA, 0x0A, 0x40, 0x30,
+    0xD0, 0x08, 0x3C, 0x80, 0x80, 0x80, 0x30, 0xD0, 0xA0, 0x1E, 0x03, 0x86,
+    0xB8, 0x8C, 0x00, 0x17, 0x08, 0xBA, 0x0A, 0x31, 0x42, 0xD8, 0x88, 0x4B,
+    0xFA, 0xFF, 0x52, 0x00, 0x80, 0x80, 0x08, 0x78, 0x99, 0xB8, 0x2A, 0x24,
+    0x04, 0xE9, 0x8B, 0x00, 0x17, 0x80, 0xBB, 0x08, 0x13, 0x23, 0xDA, 0xA0,
+    0x5A, 0x08, 0x80, 0x08, 0x70, 0x8B, 0xD0, 0x28, 0x22, 0x83, 0xFA, 0x8A,
+    0x79, 0xAA, 0x52, 0x00, 0x10, 0x07, 0x80, 0xBB, 0x08, 0x04, 0x13, 0x9C,
+    0xB0, 0x30, 0x80, 0x80, 0x08, 0x71, 0x8B, 0xF8, 0x38, 0x41, 0x00, 0xCC,
+    0x09, 0x48, 0x04, 0x88, 0xBC, 0x00, 0x04, 0x03, 0x8C, 0xC8, 0x12, 0x08,
+    0x00, 0x00, 0x4E, 0x00, 0x80, 0x08, 0x52, 0x8D, 0xD8, 0x40, 0x30, 0x80,
+    0xCC, 0x88, 0x60, 0x01, 0x98, 0xBB, 0x00, 0x05, 0x03, 0x0D, 0xC8, 0x03,
+    0x08, 0x08, 0x08, 0x84, 0x8B, 0xFA, 0x31, 0x50, 0x80, 0xCC, 0x08, 0x70,
+    0x87, 0x55, 0x58, 0x00, 0x80, 0x98, 0x8C, 0x18, 0x12, 0x83, 0x0D, 0xB9,
+    0x04, 0x08, 0x08, 0x80, 0xA7, 0x09, 0xAB, 0x33, 0x62, 0x90, 0xBD, 0x88,
+    0x71, 0x01, 0xB8, 0x8B, 0x48, 0x21, 0xA2, 0x0C, 0xAA, 0x85, 0x00, 0x88,
+    0x06, 0x00, 0x4C, 0x00, 0x80, 0xA7, 0x09, 0x8D, 0x13, 0x23, 0xB8, 0xAF,
+    0x08, 0x71, 0x81, 0xB8, 0x8A, 0x48, 0x30, 0xC1, 0x88, 0x0B, 0x03, 0x08,
+    0x08, 0x18, 0xB7, 0x88, 0x8F, 0x13, 0x04, 0xC0, 0x9C, 0x80, 0x54, 0x08,
+    0xB9, 0x46, 0x55, 0x00, 0xC0, 0x8A, 0x40, 0x38, 0xC0, 0x80, 0x2B, 0x81,
+    0x80, 0x00, 0x38, 0xE4, 0x88, 0x0D, 0x13, 0x05, 0xC8, 0x8C, 0x80, 0x16,
+    0x80, 0xB9, 0x8A, 0x41, 0x40, 0xB8, 0x88, 0x3C, 0x00, 0x88, 0x00, 0x68,
+    0xAB, 0x2A, 0x4F, 0x00, 0xB0, 0xA8, 0x1E, 0x13, 0x05, 0xD8, 0x8B, 0x80,
+    0x17, 0x80, 0xBA, 0x09, 0x22, 0x42, 0xC9, 0x88, 0x4C, 0x80, 0x80, 0x08,
+    0x60, 0x9A, 0xB8, 0x3A, 0x24, 0x04, 0xF9, 0x8A, 0x18, 0x07, 0x80, 0xBA,
+    0x65, 0xAA, 0x53, 0x00, 0x80, 0x13, 0x14, 0xBA, 0xA0, 0x6B, 0x80, 0x80,
+    0x08, 0x70, 0x8B, 0xD0, 0x38, 0x31, 0x01, 0xFB, 0x8A, 0x20, 0x07, 0x80,
+    0xBB, 0x08, 0x04, 0x03, 0x9B, 0xC8, 0x30, 0x80, 0x80, 0x80, 0x71, 0x8B,
+    0x2F, 0xFC, 0x4C, 0x00, 0xF0, 0x38, 0x50, 0x80, 0xDA, 0x09, 0x48, 0x04,
+    0x88, 0xAC, 0x08, 0x13, 0x04, 0x8C, 0xB8, 0x12, 0x80, 0x80, 0x80, 0x53,
+    0x8D, 0xE8, 0x30, 0x50, 0x80, 0xBC, 0x88, 0x70, 0x01, 0x98, 0xAB, 0x18,
+    0x4D, 0xFF, 0x50, 0x00, 0x00, 0x85, 0x0C, 0xC8, 0x03, 0x08, 0x08, 0x08,
+    0x85, 0x8B, 0xEA, 0x41, 0x40, 0x88, 0xBC, 0x88, 0x70, 0x82, 0xB0, 0x9B,
+    0x38, 0x23, 0x94, 0x0D, 0xB9, 0x04, 0x08, 0x08, 0x80, 0xA7, 0x09, 0x9C,
+    0x0F, 0xD5, 0x50, 0x00, 0x20, 0x42, 0x90, 0xAF, 0x08, 0x70, 0x00, 0xA8,
+    0x9B, 0x30, 0x41, 0xA1, 0x0B, 0xBA, 0x06, 0x08, 0x08, 0x08, 0xB7, 0x08,
+    0x8D, 0x13, 0x13, 0xB0, 0xAF, 0x08, 0x72, 0x00, 0xB8, 0x8B, 0x40, 0x30,
+    0xA4, 0x54, 0x51, 0x00, 0xC0, 0x09, 0x0B, 0x83, 0x80, 0x08, 0x10, 0xC7,
+    0x80, 0x8E, 0x04, 0x12, 0xB8, 0x9D, 0x80, 0x44, 0x80, 0xC8, 0x0B, 0x40,
+    0x30, 0xD0, 0x08, 0x2B, 0x81, 0x80, 0x80, 0x30, 0xE4, 0x88, 0x0E, 0x03,
+    0x11, 0x52, 0x51, 0x00, 0x80, 0xD8, 0x8C, 0x08, 0x17, 0x08, 0xB9, 0x8A,
+    0x41, 0x40, 0xC8, 0x80, 0x3C, 0x80, 0x80, 0x80, 0x50, 0xA9, 0xA8, 0x1D,
+    0x14, 0x84, 0xC8, 0x8C, 0x00, 0x17, 0x08, 0xBB, 0x09, 0x22, 0x42, 0xC9,
+    0xBC, 0xFF, 0x51, 0x00, 0x90, 0x4C, 0x80, 0x80, 0x08, 0x60, 0x9A, 0xB8,
+    0x3A, 0x24, 0x04, 0xEA, 0x8B, 0x10, 0x17, 0x80, 0xBB, 0x09, 0x04, 0x23,
+    0xBB, 0xB0, 0x7B, 0x80, 0x80, 0x08, 0x70, 0x8B, 0xD0, 0x38, 0x31, 0x81,
+    0xAB, 0x2A, 0x4E, 0x00, 0xF0, 0x0A, 0x28, 0x07, 0x08, 0xBB, 0x88, 0x05,
+    0x02, 0x8B, 0xB8, 0x21, 0x80, 0x80, 0x80, 0x72, 0x8C, 0xF0, 0x20, 0x40,
+    0x80, 0xDA, 0x09, 0x30, 0x05, 0x88, 0xBC, 0x00, 0x04, 0x03, 0x8D, 0xB0,
+    0x63, 0xF1, 0x51, 0x00, 0x00, 0x08, 0x08, 0x80, 0x43, 0x8E, 0xD8, 0x30,
+    0x51, 0x80, 0xCC, 0x08, 0x78, 0x81, 0xA0, 0xAB, 0x10, 0x13, 0x85, 0x0C,
+    0xC8, 0x03, 0x08, 0x08, 0x08, 0x95, 0x8A, 0xEA, 0x41, 0x40, 0x88, 0xBC,
+    0x25, 0xAA, 0x52, 0x00, 0x80, 0x70, 0x82, 0xB0, 0x9B, 0x38, 0x22, 0x94,
+    0x8C, 0xC9, 0x85, 0x80, 0x80, 0x80, 0xA6, 0x09, 0xAB, 0x33, 0x53, 0xA0,
+    0xBE, 0x08, 0x71, 0x01, 0xB8, 0x8C, 0x30, 0x30, 0xC2, 0x89, 0x9A, 0x04,
+    0x30, 0x00, 0x4E, 0x00, 0x80, 0x08, 0x18, 0xB7, 0x88, 0x8E, 0x13, 0x14,
+    0xB8, 0xAD, 0x80, 0x73, 0x00, 0xB8, 0x0C, 0x38, 0x31, 0xD1, 0x88, 0x1B,
+    0x02, 0x08, 0x08, 0x28, 0xC7, 0x08, 0x0E, 0x03, 0x03, 0xD0, 0x9B, 0x08,
+};
+
+static const uint8_t engine[576] = {
+    0x00, 0x00, 0x32, 0x00, 0x70, 0x77, 0x01, 0x08, 0x98, 0xA9, 0xA9, 0xAA,
+    0x99, 0x08, 0x00, 0x11, 0x11, 0x00, 0xA9, 0xCC, 0xBC, 0xBC, 0xBB, 0xAA,
+    0x8A, 0x28, 0x42, 0x35, 0x34, 0x34, 0x24, 0x23, 0x23, 0x33, 0x22, 0x23,
+    0x65, 0x16, 0x2A, 0x00, 0x10, 0x11, 0x90, 0xB9, 0xDD, 0xDB, 0xBC, 0xBD,
+    0xCB, 0xCB, 0xBA, 0xBB, 0xAC, 0xA9, 0x99, 0x08, 0x21, 0x43, 0x35, 0x44,
+    0x43, 0x43, 0x33, 0x34, 0x42, 0x76, 0x25, 0x01, 0x88, 0xBA, 0xCB, 0xBB,
+    0x22, 0x04, 0x3C, 0x00, 0xC0, 0xA9, 0x98, 0x00, 0x01, 0x11, 0x01, 0x98,
+    0xBA, 0xCC, 0xBA, 0xAB, 0x09, 0x31, 0x55, 0x34, 0x35, 0x33, 0x34, 0x23,
+    0x23, 0x11, 0x01, 0x88, 0xB9, 0xCB, 0xDB, 0xDB, 0xBB, 0xCC, 0xBB, 0xBC,
+    0x11, 0xF7, 0x30, 0x00, 0xC0, 0xBB, 0xBB, 0xAB, 0x9A, 0x09, 0x31, 0x44,
+    0x35, 0x35, 0x34, 0x34, 0x43, 0x33, 0x43, 0x32, 0x22, 0x12, 0x77, 0x37,
+    0x00, 0xA9, 0xCA, 0xCB, 0xBB, 0xAB, 0xAA, 0x09, 0x18, 0x22, 0x22, 0x23,
+    0xC8, 0xF1, 0x30, 0x00, 0x00, 0x00, 0x89, 0x99, 0x00, 0x53, 0x45, 0x35,
+    0x34, 0x24, 0x33, 0x33, 0x21, 0x00, 0xA9, 0xDB, 0xDB, 0xCB, 0xCB, 0xBB,
+    0xCB, 0xBB, 0xAC, 0xAB, 0xBB, 0xAA, 0xAA, 0x08, 0x21, 0x54, 0x44, 0x43,
+    0xB0, 0xF5, 0x2F, 0x00, 0x40, 0x34, 0x43, 0x33, 0x24, 0x23, 0x22, 0x12,
+    0x00, 0xA8, 0xCA, 0x77, 0x47, 0x88, 0xA9, 0xCB, 0xAC, 0xBB, 0xAB, 0x99,
+    0x18, 0x21, 0x43, 0x33, 0x24, 0x22, 0x12, 0x10, 0x00, 0x11, 0x32, 0x44,
+    0xE4, 0x0B, 0x2E, 0x00, 0x40, 0x43, 0x23, 0x23, 0x81, 0xB8, 0xDC, 0xBC,
+    0xBD, 0xBC, 0xBB, 0xBC, 0xAB, 0xBB, 0xAA, 0x9A, 0x98, 0x10, 0x32, 0x45,
+    0x44, 0x43, 0x53, 0x33, 0x34, 0x33, 0x34, 0x23, 0x23, 0x12, 0x81, 0xA8,
+    0xFA, 0x17, 0x26, 0x00, 0xE0, 0xCB, 0xCC, 0xCB, 0x77, 0x02, 0x90, 0xBA,
+    0xCC, 0xBB, 0xAC, 0x9A, 0x88, 0x11, 0x43, 0x43, 0x24, 0x32, 0x21, 0x02,
+    0x01, 0x80, 0x08, 0x08, 0x10, 0x20, 0x10, 0x81, 0xC9, 0xDC, 0xCC, 0xDB,
+    0x9F, 0x02, 0x33, 0x00, 0xC0, 0xBB, 0xBC, 0xBA, 0xAA, 0xA9, 0x88, 0x11,
+    0x42, 0x34, 0x44, 0x43, 0x24, 0x43, 0x33, 0x43, 0x23, 0x33, 0x23, 0x22,
+    0x00, 0xA9, 0xEB, 0xDB, 0xBC, 0xCC, 0xBB, 0xBC, 0x9B, 0x77, 0x13, 0x90,
+    0x24, 0x10, 0x3B, 0x00, 0xC0, 0xCB, 0xBB, 0xBB, 0x99, 0x10, 0x34, 0x35,
+    0x44, 0x32, 0x22, 0x12, 0x00, 0x88, 0xA9, 0xAA, 0xAB, 0xBB, 0xAB, 0xAC,
+    0xCB, 0xCB, 0xCC, 0xCB, 0xBB, 0xBC, 0xCB, 0x9A, 0x99, 0x08, 0x22, 0x35,
+    0x09, 0xED, 0x2C, 0x00, 0x50, 0x34, 0x34, 0x24, 0x43, 0x32, 0x32, 0x32,
+    0x22, 0x11, 0x00, 0xA9, 0xCC, 0xCC, 0xBC, 0xBC, 0xCC, 0xCA, 0xBA, 0xBA,
+    0xBB, 0x7B, 0x57, 0x12, 0x80, 0xA9, 0xCA, 0xBA, 0xAA, 0x88, 0x31, 0x44,
+    0xF6, 0xFB, 0x38, 0x00, 0x40, 0x34, 0x23, 0x13, 0x01, 0xA8, 0xBA, 0xBD,
+    0xBC, 0xBB, 0xAC, 0xAA, 0xAA, 0xAB, 0xBA, 0xCA, 0xBA, 0xBB, 0xAB, 0x99,
+    0x21, 0x46, 0x44, 0x34, 0x35, 0x43, 0x33, 0x24, 0x33, 0x22, 0x12, 0x11,
+    0xCD, 0x19, 0x2A, 0x00, 0x90, 0xAA, 0xCC, 0xCC, 0xDB, 0xBB, 0xBC, 0xBC,
+    0xBB, 0xBC, 0xBA, 0xAB, 0xAA, 0x89, 0x70, 0x77, 0x17, 0x00, 0x98, 0x99,
+    0x99, 0x99, 0x88, 0x11, 0x33, 0x34, 0x24, 0x22, 0x01, 0xA8, 0xDA, 0xCB,
+    0x5B, 0x0C, 0x36, 0x00, 0xD0, 0xBA, 0xAB, 0xAB, 0x9A, 0x99, 0x88, 0x00,
+    0x00, 0x21, 0x31, 0x34, 0x45, 0x53, 0x43, 0x34, 0x43, 0x33, 0x34, 0x22,
+    0x22, 0x11, 0x90, 0xB9, 0xDC, 0xCB, 0xBC, 0xBC, 0xBC, 0xCB, 0xBB, 0xBB,
+    0xEB, 0xED, 0x2E, 0x00, 0xC0, 0xAA, 0xA9, 0x88, 0x20, 0x42, 0x44, 0x74,
+    0x77, 0x03, 0x00, 0x98, 0x99, 0xAA, 0x9A, 0x89, 0x18, 0x31, 0x33, 0x43,
+    0x11, 0x98, 0xBC, 0xBE, 0xCC, 0xBA, 0xBB, 0xBA, 0x99, 0x88, 0x11, 0x33,
+    0x3E, 0xE9, 0x2B, 0x00, 0x50, 0x43, 0x43, 0x33, 0x43, 0x43, 0x33, 0x43,
+    0x43, 0x32, 0x22, 0x12, 0x00, 0xB9, 0xCC, 0xBD, 0xCC, 0xCB, 0xCB, 0xBB,
+    0xCB, 0xBA, 0xBA, 0xAA, 0x99, 0x88, 0x21, 0x53, 0x44, 0x53, 0x43, 0x43,
+};
+
+static const uint8_t reverse[1152] = {
+    0x00, 0x00, 0x00, 0x00, 0x70, 0xF7, 0x7F, 0xF7, 0x5F, 0xC3, 0x2D, 0x95,
+    0x0C, 0x04, 0xBB, 0x44, 0xDA, 0x41, 0xC8, 0x38, 0xB2, 0x2D, 0x94, 0x0C,
+    0x04, 0xAB, 0x24, 0xCA, 0x41, 0xB8, 0x49, 0xB2, 0x2C, 0x94, 0x0C, 0x04,
+    0x1D, 0xDF, 0x57, 0x00, 0xA0, 0x33, 0xCB, 0x51, 0xC8, 0x48, 0xB1, 0x3B,
+    0x94, 0x0C, 0x13, 0x9D, 0x23, 0xCA, 0x41, 0xC8, 0x48, 0xA0, 0x3B, 0x94,
+    0x0C, 0x04, 0x9C, 0x23, 0xCA, 0x41, 0xC8, 0x48, 0xB1, 0x2A, 0xA4, 0x0B,
+    0xC4, 0x3C, 0x53, 0x00, 0x80, 0x9E, 0x14, 0xBA, 0x42, 0xC8, 0x48, 0xB0,
+    0x3A, 0xA4, 0x0B, 0x05, 0x8C, 0x13, 0xBB, 0x62, 0xB9, 0x40, 0xB0, 0x3A,
+    0xA4, 0x1C, 0x84, 0x9B, 0x24, 0xCB, 0x42, 0xC9, 0x30, 0xC1, 0x29, 0xA3,
+    0x9B, 0xB0, 0x53, 0x00, 0x10, 0x86, 0x9B, 0x24, 0xBB, 0x52, 0xC9, 0x40,
+    0xB0, 0x4A, 0xA2, 0x1C, 0x84, 0x9B, 0x14, 0xBA, 0x52, 0xC9, 0x30, 0xC1,
+    0x39, 0xA2, 0x1D, 0x84, 0x8C, 0x14, 0xBB, 0x43, 0xC9, 0x30, 0xD1, 0x39,
+    0xF0, 0x55, 0x56, 0x00, 0xB0, 0x1C, 0x84, 0x8C, 0x14, 0xAB, 0x42, 0xC9,
+    0x40, 0xC0, 0x39, 0xA2, 0x1C, 0x84, 0x8C, 0x14, 0xAB, 0x42, 0xBA, 0x50,
+    0xC0, 0x28, 0xA2, 0x2C, 0x83, 0x8D, 0x04, 0xAA, 0x42, 0xBA, 0x50, 0xC0,
+    0x9B, 0xB0, 0x58, 0x00, 0x20, 0xB2, 0x2B, 0x96, 0x0B, 0x04, 0xAB, 0x43,
+    0xCA, 0x41, 0xB8, 0x49, 0xB2, 0x2C, 0x94, 0x0C, 0x13, 0x9C, 0x32, 0xDA,
+    0x41, 0xB8, 0x49, 0xA1, 0x2B, 0x95, 0x0C, 0x13, 0x9C, 0x32, 0xDA, 0x41,
+    0xC4, 0x3C, 0x58, 0x00, 0xC0, 0x38, 0xB1, 0x3B, 0x95, 0x0C, 0x04, 0xAB,
+    0x43, 0xBB, 0x51, 0xB8, 0x59, 0xB1, 0x2A, 0x94, 0x0C, 0x04, 0xAB, 0x24,
+    0xCA, 0x41, 0xC8, 0x48, 0xB1, 0x3B, 0x94, 0x0C, 0x04, 0x9C, 0x23, 0xCA,
+    0x1D, 0xDF, 0x56, 0x00, 0x30, 0xD8, 0x48, 0xB1, 0x3B, 0xA4, 0x0B, 0x05,
+    0x8C, 0x22, 0xCA, 0x32, 0xD8, 0x48, 0xA0, 0x2A, 0xA4, 0x0B, 0x05, 0x8C,
+    0x22, 0xCA, 0x32, 0xD8, 0x48, 0xB0, 0x39, 0xA3, 0x1E, 0x83, 0x8C, 0x23,
+    0x00, 0x00, 0x54, 0x00, 0xC0, 0x42, 0xC9, 0x30, 0xC1, 0x3A, 0xA4, 0x1C,
+    0x03, 0x8D, 0x13, 0xBB, 0x53, 0xC9, 0x30, 0xC1, 0x3A, 0xA4, 0x1C, 0x03,
+    0x8D, 0x13, 0xBB, 0x53, 0xC9, 0x30, 0xC1, 0x3A, 0xA4, 0x1C, 0x84, 0x8C,
+    0xE3, 0x20, 0x57, 0x00, 0x10, 0xAC, 0x42, 0xC9, 0x40, 0xB0, 0x4A, 0xB2,
+    0x2B, 0x85, 0x8C, 0x13, 0xBB, 0x53, 0xC9, 0x40, 0xC0, 0x39, 0xB3, 0x1C,
+    0x84, 0x8C, 0x14, 0xAB, 0x42, 0xC9, 0x40, 0xC0, 0x39, 0xA2, 0x2C, 0x83,
+    0x3C, 0xC3, 0x53, 0x00, 0x80, 0x16, 0x9C, 0x32, 0xCA, 0x40, 0xC0, 0x38,
+    0xA1, 0x2C, 0x94, 0x0C, 0x13, 0xAC, 0x33, 0xDA, 0x31, 0xC0, 0x49, 0xA1,
+    0x2C, 0x83, 0x8D, 0x04, 0x9B, 0x33, 0xDB, 0x41, 0xB8, 0x49, 0xB2, 0x2C,
+    0x65, 0x4F, 0x55, 0x00, 0xA0, 0x0D, 0x04, 0xAB, 0x43, 0xCA, 0x41, 0xB8,
+    0x49, 0xB1, 0x2A, 0x95, 0x0C, 0x13, 0x9C, 0x32, 0xDA, 0x41, 0xB8, 0x49,
+    0xB1, 0x3A, 0x94, 0x0D, 0x13, 0xAC, 0x33, 0xCB, 0x51, 0xB8, 0x59, 0xB1,
+    0x10, 0xAA, 0x56, 0x00, 0x20, 0x94, 0x0C, 0x13, 0x9D, 0x23, 0xCA, 0x41,
+    0xC8, 0x48, 0xA0, 0x3B, 0x94, 0x0C, 0x84, 0x9B, 0x24, 0xBB, 0x52, 0xC8,
+    0x38, 0xB1, 0x4B, 0xA3, 0x0D, 0x04, 0x9B, 0x33, 0xBC, 0x52, 0xB9, 0x58,
+    0x65, 0x4F, 0x58, 0x00, 0xC0, 0x29, 0xA3, 0x1C, 0x84, 0x9B, 0x24, 0xCB,
+    0x42, 0xB9, 0x58, 0xB0, 0x4A, 0xA2, 0x1C, 0x84, 0x9B, 0x24, 0xBB, 0x52,
+    0xC9, 0x30, 0xC1, 0x29, 0xA3, 0x1D, 0x84, 0x9B, 0x14, 0xBA, 0x52, 0xC9,
+    0x3C, 0xC3, 0x58, 0x00, 0x30, 0xC0, 0x39, 0xB3, 0x1D, 0x84, 0x9B, 0x24,
+    0xBB, 0x52, 0xC9, 0x40, 0xB0, 0x3A, 0xB3, 0x1C, 0x85, 0x8C, 0x14, 0xBB,
+    0x43, 0xC9, 0x30, 0xD1, 0x39, 0xA2, 0x1C, 0x84, 0x8C, 0x04, 0xAA, 0x42,
+    0xE3, 0x20, 0x56, 0x00, 0xC0, 0x40, 0xB8, 0x49, 0xB2, 0x2B, 0x95, 0x8B,
+    0x14, 0xBB, 0x34, 0xDA, 0x40, 0xB0, 0x39, 0xB2, 0x2B, 0x95, 0x8B, 0x14,
+    0xAB, 0x33, 0xCA, 0x40, 0xA8, 0x39, 0xA1, 0x2A, 0x82, 0x0B, 0x02, 0x0A,
+    0x00, 0x00, 0x40, 0x00, 0x80, 0x08, 0x08, 0x80, 0x08, 0x80, 0x80, 0x08,
+    0x80, 0x08, 0x08, 0x80, 0x08, 0x80, 0x08, 0x80, 0x08, 0x80, 0x08, 0x80,
+    0x08, 0x80, 0x08, 0x80, 0x08, 0x80, 0x80, 0x80, 0x80, 0x08, 0x08, 0x08,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+const audio_clip_t audio_clips[AUDIO_SOUND_COUNT] = {
+    [AUDIO_SOUND_HORN] = { horn, 32 },
+    [AUDIO_SOUND_ENGINE] = { engine, 16 },
+    [AUDIO_SOUND_REVERSE] = { reverse, 32 },
+};
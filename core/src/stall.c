@@ -0,0 +1,228 @@
+/**
+ * @file
+ * @brief Wheel stall detection and motor thermal derating, without a
+ * current sensor.
+ *
+ * The motor current is estimated from the effort and the back-EMF: the
+ * applied voltage is the effort, the back-EMF is proportional to the wheel
+ * speed, taken from the encoder counts over the last STALL_WINDOW odometry
+ * periods, and the difference drives the current through the winding. In
+ * effort counts, DRIVE_EFFORT_MAX is the stall current at full effort.
+ *
+ * A wheel driven with STALL_EFFORT_MIN or more that gives no more than
+ * STALL_COUNTS_MAX encoder counts over STALL_WINDOW_MS + STALL_DETECT_MS is
+ * stalled and cut; a wheel that keeps counting, however slowly, is turning
+ * and is left alone. A mean square of the current over the thermal time
+ * constant stands for the winding and bridge temperature (an I2t model).
+ * From the derate current on, the current allowed shrinks linearly, down
+ * to the rated current at the rated heat, and the effort is limited to
+ * the back-EMF plus that current. The mean square cannot then rise past
+ * the rated current: a heavy load is slowed down, and a load that needs
+ * more than the rated current to turn ends up held still, then cut.
+ *
+ * stall_update() runs in the odometry period of the PWM timer interrupt;
+ * stall_limit() runs wherever a setpoint is turned into compare values.
+ * They share single words only.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stall.h"
+
+/** Definitions --------------------------------------------------- */
+#define STALL_DETECT_PERIODS        (STALL_DETECT_MS * ODOMETRY_RATE_HZ / 1000)
+#define STALL_STILL_PERIODS         (STALL_WINDOW + STALL_DETECT_PERIODS)
+#define STALL_RETRY_PERIODS         (STALL_RETRY_MS * ODOMETRY_RATE_HZ / 1000)
+
+#define STALL_CURRENT_MAX           (2 * DRIVE_EFFORT_MAX)
+#define STALL_DERATE_HEAT           ((uint32_t)STALL_DERATE_CURRENT * STALL_DERATE_CURRENT)
+#define STALL_RATED_HEAT            ((uint32_t)STALL_RATED_CURRENT * STALL_RATED_CURRENT)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    int16_t window[STALL_WINDOW];   /* Counts of the last periods */
+    uint8_t position;
+    int32_t window_counts;
+    int32_t still_counts;           /* Counts since the wheel was last seen turning */
+    uint32_t still_periods;
+    uint32_t cut_periods;           /* Left before a stalled wheel is tried again */
+    int8_t stalled_direction;
+    uint64_t heat_scaled;           /* Heat << STALL_THERMAL_SHIFT */
+
+    volatile int16_t requested;     /* Last effort requested, from stall_limit() */
+    volatile int16_t applied;       /* Last effort allowed, from stall_limit() */
+    volatile int16_t limit_forward;
+    volatile int16_t limit_reverse;
+    volatile bool stalled;
+
+    uint32_t stalls;
+    uint32_t heat;
+    int16_t current;
+} stall_motor_t;
+
+/** Variables ----------------------------------------------------- */
+static stall_motor_t motors[STALL_WHEEL_COUNT];
+
+/** Prototypes ---------------------------------------------------- */
+static int8_t stall_sign(int32_t value);
+static int32_t stall_thermal_current(uint32_t heat);
+static int16_t stall_effort_limit(int32_t effort);
+static void stall_motor_update(stall_motor_t *motor, int16_t counts);
+static int16_t stall_motor_limit(stall_motor_t *motor, int16_t effort);
+
+/** Internal functions -------------------------------------------- */
+static int8_t stall_sign(int32_t value) {
+    return value > 0 ? 1 : value < 0 ? -1 : 0;
+}
+
+/**
+ * @brief Largest current allowed at a heat level, in effort counts.
+ */
+static int32_t stall_thermal_current(uint32_t heat) {
+    if (heat <= STALL_DERATE_HEAT) {
+        return STALL_CURRENT_MAX;
+    }
+    if (heat >= STALL_RATED_HEAT) {
+        return STALL_RATED_CURRENT;
+    }
+    return STALL_RATED_CURRENT + (int32_t)((uint64_t)(STALL_CURRENT_MAX - STALL_RATED_CURRENT) *
+                                           (STALL_RATED_HEAT - heat) / (STALL_RATED_HEAT - STALL_DERATE_HEAT));
+}
+
+/**
+ * @brief Effort that drives a current against the back-EMF, within the
+ * effort range.
+ */
+static int16_t stall_effort_limit(int32_t effort) {
+    return effort > DRIVE_EFFORT_MAX ? DRIVE_EFFORT_MAX : effort < 0 ? 0 : (int16_t)effort;
+}
+
+/**
+ * @brief Updates the speed, current and heat estimates and the stall state
+ * of a motor, once per odometry period.
+ */
+static void stall_motor_update(stall_motor_t *motor, int16_t counts) {
+    int32_t effort = motor->applied;
+
+    motor->window_counts += counts - motor->window[motor->position];
+    motor->window[motor->position] = counts;
+    motor->position = (uint8_t)((motor->position + 1) % STALL_WINDOW);
+
+    int32_t back_emf = motor->window_counts * (DRIVE_EFFORT_MAX * ODOMETRY_RATE_HZ)
+                       / (STALL_WINDOW * STALL_FULL_SPEED_COUNTS_S);
+    int32_t current = effort - back_emf;
+    if (current > STALL_CURRENT_MAX) {
+        current = STALL_CURRENT_MAX;
+    } else if (current < -STALL_CURRENT_MAX) {
+        current = -STALL_CURRENT_MAX;
+    }
+
+    motor->current = (int16_t)current;
+    motor->heat_scaled += (uint64_t)(current * current) - (motor->heat_scaled >> STALL_THERMAL_SHIFT);
+    motor->heat = (uint32_t)(motor->heat_scaled >> STALL_THERMAL_SHIFT);
+
+    int16_t requested = motor->requested;
+    if (motor->stalled) {
+        /* Released, reversed or retried */
+        if (stall_sign(requested) != motor->stalled_direction || motor->cut_periods == 0) {
+            motor->stalled = false;
+        } else {
+            motor->cut_periods--;
+        }
+    } else if (effort >= STALL_EFFORT_MIN || effort <= -STALL_EFFORT_MIN) {
+        motor->still_counts += counts;
+        if (motor->still_counts > STALL_COUNTS_MAX || motor->still_counts < -STALL_COUNTS_MAX) {
+            /* Turning, however slowly */
+            motor->still_counts = 0;
+            motor->still_periods = 0;
+        } else if (++motor->still_periods >= STALL_STILL_PERIODS) {
+            motor->stalled = true;
+            motor->stalled_direction = stall_sign(effort);
+            motor->cut_periods = STALL_RETRY_PERIODS;
+            motor->still_counts = 0;
+            motor->still_periods = 0;
+            motor->stalls++;
+        }
+    } else {
+        motor->still_counts = 0;
+        motor->still_periods = 0;
+    }
+
+    if (motor->stalled) {
+        motor->limit_forward = 0;
+        motor->limit_reverse = 0;
+    } else {
+        int32_t allowed = stall_thermal_current(motor->heat);
+        motor->limit_forward = stall_effort_limit(back_emf + allowed);
+        motor->limit_reverse = stall_effort_limit(allowed - back_emf);
+    }
+}
+
+/**
+ * @brief Clamps the effort of a motor to its limit.
+ */
+static int16_t stall_motor_limit(stall_motor_t *motor, int16_t effort) {
+    int16_t forward = motor->limit_forward;
+    int16_t reverse = motor->limit_reverse;
+
+    motor->requested = effort;
+    if (effort > forward) {
+        effort = forward;
+    } else if (effort < -reverse) {
+        effort = -reverse;
+    }
+    motor->applied = effort;
+
+    return effort;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Forgets every estimate: both motors cold, at rest and allowed
+ * full effort.
+ */
+void stall_init(void) {
+    memset(motors, 0, sizeof(motors));
+    for (uint8_t wheel = 0; wheel < STALL_WHEEL_COUNT; wheel++) {
+        motors[wheel].limit_forward = DRIVE_EFFORT_MAX;
+        motors[wheel].limit_reverse = DRIVE_EFFORT_MAX;
+    }
+}
+
+/**
+ * @brief Takes the encoder counts of one odometry period. Must run at
+ * ODOMETRY_RATE_HZ.
+ *
+ * @param left_counts   Left wheel counts, positive forward.
+ * @param right_counts  Right wheel counts, positive forward.
+ */
+void stall_update(int16_t left_counts, int16_t right_counts) {
+    stall_motor_update(&motors[STALL_WHEEL_LEFT], left_counts);
+    stall_motor_update(&motors[STALL_WHEEL_RIGHT], right_counts);
+}
+
+/**
+ * @brief Cuts stalled wheels and derates hot ones. The result is taken as
+ * the effort applied to the motors.
+ *
+ * @param setpoint  Setpoint about to be driven, limited in place.
+ */
+void stall_limit(drive_setpoint_t *setpoint) {
+    setpoint->left = stall_motor_limit(&motors[STALL_WHEEL_LEFT], setpoint->left);
+    setpoint->right = stall_motor_limit(&motors[STALL_WHEEL_RIGHT], setpoint->right);
+}
+
+/**
+ * @brief Gets the state of a wheel.
+ */
+void stall_get_state(stall_wheel_t wheel, stall_state_t *state) {
+    const stall_motor_t *motor = &motors[wheel];
+
+    memset(state, 0, sizeof(*state));
+    state->stalls = motor->stalls;
+    state->heat = motor->heat;
+    state->current = motor->current;
+    state->limit = motor->requested < 0 ? motor->limit_reverse : motor->limit_forward;
+    state->stalled = motor->stalled;
+}
@@ -5,6 +5,10 @@
 
 #include "stm32f1xx_hal.h"
 
+#include "ir_receiver.h"
+#include "irq.h"
+#include "timebase.h"
+
 /******************************************************************************/
 /*           Cortex-M3 Processor Interruption and Exception Handlers         */
 /******************************************************************************/
@@ -65,5 +69,12 @@ void PendSV_Handler(void) {
  * @brief SysTick timer.
  */
 void SysTick_Handler(void) {
+    /* The counter reloaded at the raise and counts down at HCLK */
+    IRQ_PROFILE_ENTER(IRQ_ID_SYSTICK, SysTick->LOAD - SysTick->VAL);
+
     HAL_IncTick();
+    timebase_tick();
+    ir_receiver_tick();
+
+    IRQ_PROFILE_EXIT(IRQ_ID_SYSTICK);
 }
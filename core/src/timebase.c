@@ -0,0 +1,164 @@
+/**
+ * @file
+ * @brief 64-bit microsecond monotonic clock.
+ *
+ * The free-running DWT cycle counter is extended to 64 bits: a snapshot
+ * pairs a 64-bit microsecond count with the 32-bit cycle count it was taken
+ * at, and a reading adds the cycles elapsed since. The counter wraps after
+ * 59 s at 72 MHz, so a snapshot taken from SysTick every millisecond keeps
+ * any reading exact, even when SysTick is held off by other interrupts.
+ *
+ * Snapshots are double buffered: the writer fills the unpublished slot and
+ * then flips the sequence number, so a reader never waits on a writer it
+ * has preempted. Readers are lock-free from any context. The HAL 1 ms tick
+ * is left untouched.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "timebase.h"
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint64_t us;            /**< Microseconds at cycles */
+    uint32_t cycles;        /**< DWT cycle count of the snapshot */
+    uint32_t cycles_per_us;
+} timebase_snapshot_t;
+
+/** Variables ----------------------------------------------------- */
+static timebase_snapshot_t snapshots[2];
+static volatile uint32_t sequence = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static void timebase_publish(uint64_t us, uint32_t cycles, uint32_t cycles_per_us);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Writes the unpublished slot and makes it current.
+ *
+ * Writers must not preempt each other.
+ */
+static void timebase_publish(uint64_t us, uint32_t cycles, uint32_t cycles_per_us) {
+    timebase_snapshot_t *next = &snapshots[(sequence + 1) & 1];
+
+    next->us = us;
+    next->cycles = cycles;
+    next->cycles_per_us = cycles_per_us;
+
+    __DMB();
+    sequence++;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Starts the cycle counter and the clock at 0.
+ */
+void timebase_setup(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    timebase_publish(0, DWT->CYCCNT, SystemCoreClock / 1000000);
+}
+
+/**
+ * @brief Advances the snapshot, called from SysTick.
+ *
+ * Whole microseconds are moved into the snapshot and the remainder cycles
+ * are kept, so the clock does not drift.
+ */
+void timebase_tick(void) {
+    const timebase_snapshot_t *current = &snapshots[sequence & 1];
+    uint32_t elapsed = DWT->CYCCNT - current->cycles;
+    uint32_t us = elapsed / current->cycles_per_us;
+
+    timebase_publish(current->us + us, current->cycles + us * current->cycles_per_us, current->cycles_per_us);
+}
+
+/**
+ * @brief Takes a snapshot at the current rate, before a clock switch.
+ */
+void timebase_sync(void) {
+    __disable_irq();
+    timebase_tick();
+    __enable_irq();
+}
+
+/**
+ * @brief Restarts counting at the new core clock after a clock switch.
+ *
+ * @param elapsed_us    Duration of the switch, whose cycles ran at mixed
+ *                      rates and are not counted.
+ */
+void timebase_retime(uint32_t elapsed_us) {
+    __disable_irq();
+    const timebase_snapshot_t *current = &snapshots[sequence & 1];
+    timebase_publish(current->us + elapsed_us, DWT->CYCCNT, SystemCoreClock / 1000000);
+    __enable_irq();
+}
+
+/**
+ * @brief Gets the time since start-up.
+ *
+ * @return Time, in us.
+ */
+uint64_t timebase_now(void) {
+    uint32_t start;
+    uint64_t us;
+
+    do {
+        start = sequence;
+        __DMB();
+        const timebase_snapshot_t *current = &snapshots[start & 1];
+        us = current->us + (DWT->CYCCNT - current->cycles) / current->cycles_per_us;
+        __DMB();
+    } while (start != sequence);
+
+    return us;
+}
+
+/**
+ * @brief Computes a deadline from now.
+ *
+ * @param timeout_us    Time from now, in us.
+ *
+ * @return Deadline for timebase_expired() and timebase_remaining().
+ */
+uint64_t timebase_deadline(uint32_t timeout_us) {
+    return timebase_now() + timeout_us;
+}
+
+/**
+ * @brief Checks whether a deadline has passed.
+ */
+bool timebase_expired(uint64_t deadline) {
+    return timebase_now() >= deadline;
+}
+
+/**
+ * @brief Gets the time left before a deadline.
+ *
+ * @return Time left, in us, 0 once expired and UINT32_MAX beyond 71 min.
+ */
+uint32_t timebase_remaining(uint64_t deadline) {
+    uint64_t now = timebase_now();
+
+    if (now >= deadline) {
+        return 0;
+    }
+    return deadline - now > UINT32_MAX ? UINT32_MAX : (uint32_t)(deadline - now);
+}
+
+/**
+ * @brief Busy-waits, e.g. for sensor setup times.
+ *
+ * @param delay_us  Time to wait, in us.
+ */
+void timebase_delay(uint32_t delay_us) {
+    uint64_t deadline = timebase_deadline(delay_us);
+
+    while (!timebase_expired(deadline)) {
+    }
+}
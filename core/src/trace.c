@@ -0,0 +1,177 @@
+/**
+ * @file
+ * @brief Command/actuation trace recorder.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "trace.h"
+#include "console.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Variables ----------------------------------------------------- */
+static trace_record_t records[TRACE_RECORD_COUNT];
+static uint32_t record_head = 0;
+static volatile bool frozen = false;
+
+static uint16_t last_ccr[TRACE_PWM_CHANNELS] = { 0 };
+static bool last_ccr_valid = false;
+static uint16_t last_note = 0;
+static bool last_note_valid = false;
+
+/** Prototypes ---------------------------------------------------- */
+static trace_record_t *trace_claim(uint16_t type, uint16_t arg);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Reserves the next record slot, overwriting the oldest one.
+ *
+ * Only the index update is done with interrupts masked, so records can
+ * also be written from ISRs.
+ *
+ * @param type  Record type.
+ * @param arg   Record argument.
+ *
+ * @return Record to be filled, or NULL while a dump is in progress.
+ */
+static trace_record_t *trace_claim(uint16_t type, uint16_t arg) {
+    if (frozen) {
+        return NULL;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t index = record_head++;
+    __set_PRIMASK(primask);
+
+    trace_record_t *record = &records[index & (TRACE_RECORD_COUNT - 1)];
+    record->timestamp = HAL_GetTick();
+    record->type = type;
+    record->arg = arg;
+
+    return record;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Records a decoded key.
+ *
+ * @param key   Key returned by the infrared decoder.
+ */
+void trace_key(uint16_t key) {
+    trace_record_t *record = trace_claim(TRACE_TYPE_KEY, key);
+
+    if (record != NULL) {
+        memset(record->value, 0, sizeof(record->value));
+    }
+}
+
+/**
+ * @brief Records the TIM3 compare values, if they changed.
+ *
+ * @param ccr   CCR1..CCR4 values written to the timer.
+ */
+void trace_pwm(const uint16_t ccr[TRACE_PWM_CHANNELS]) {
+    if (last_ccr_valid && memcmp(last_ccr, ccr, sizeof(last_ccr)) == 0) {
+        return;
+    }
+
+    trace_record_t *record = trace_claim(TRACE_TYPE_PWM, 0);
+
+    if (record != NULL) {
+        memcpy(record->value, ccr, sizeof(record->value));
+        memcpy(last_ccr, ccr, sizeof(last_ccr));
+        last_ccr_valid = true;
+    }
+}
+
+/**
+ * @brief Records a buzzer note, if it changed.
+ *
+ * @param note  Note passed to the buzzer.
+ */
+void trace_note(uint16_t note) {
+    if (last_note_valid && last_note == note) {
+        return;
+    }
+
+    trace_record_t *record = trace_claim(TRACE_TYPE_NOTE, note);
+
+    if (record != NULL) {
+        memset(record->value, 0, sizeof(record->value));
+        last_note = note;
+        last_note_valid = true;
+    }
+}
+
+/**
+ * @brief Records a command received on the serial control channel.
+ *
+ * @param type      Frame type.
+ * @param a         First setpoint.
+ * @param b         Second setpoint.
+ * @param sequence  Frame sequence number.
+ */
+void trace_serial(uint16_t type, int16_t a, int16_t b, uint16_t sequence) {
+    trace_record_t *record = trace_claim(TRACE_TYPE_SERIAL, type);
+
+    if (record != NULL) {
+        record->value[0] = (uint16_t)a;
+        record->value[1] = (uint16_t)b;
+        record->value[2] = sequence;
+        record->value[3] = 0;
+    }
+}
+
+/**
+ * @brief Records the emergency brake engaging or releasing.
+ *
+ * @param engaged   Brake state.
+ * @param range_mm  Range that caused the change.
+ */
+void trace_brake(bool engaged, uint16_t range_mm) {
+    trace_record_t *record = trace_claim(TRACE_TYPE_BRAKE, engaged);
+
+    if (record != NULL) {
+        memset(record->value, 0, sizeof(record->value));
+        record->value[0] = range_mm;
+    }
+}
+
+/**
+ * @brief Sends the recorded trace over the console, oldest record first.
+ *
+ * Recording is suspended during the dump and the buffer is cleared
+ * afterwards. The next PWM and note records are always written, so every
+ * dump starts from a known output state.
+ */
+void trace_dump(void) {
+    frozen = true;
+
+    uint32_t head = record_head;
+    uint32_t count = head;
+    if (count > TRACE_RECORD_COUNT) {
+        count = TRACE_RECORD_COUNT;
+    }
+
+    trace_header_t header = {
+        .magic = TRACE_MAGIC,
+        .record_size = sizeof(trace_record_t),
+        .record_count = (uint16_t)count,
+    };
+    console_write(&header, sizeof(header));
+
+    for (uint32_t i = head - count; i != head; i++) {
+        console_write(&records[i & (TRACE_RECORD_COUNT - 1)], sizeof(trace_record_t));
+    }
+
+    record_head = 0;
+    last_ccr_valid = false;
+    last_note_valid = false;
+    frozen = false;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file
+ * @brief HC-SR04 style ultrasonic ranging with timer input capture.
+ *
+ * TIM1 runs with a 1 us tick and a 40 ms period. CH4 outputs the 10 us
+ * trigger pulse at the start of every period, and the echo pin drives TI1,
+ * captured by CH1 on the rising edge and by CH2 on the falling edge. The
+ * only CPU work is one interrupt per echo to turn its width into a range.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+
+#include "ultrasonic.h"
+#include "clock.h"
+#include "irq.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define ULTRASONIC_GPIO_CLOCK_ENABLE()  __HAL_RCC_GPIOA_CLK_ENABLE()
+#define ULTRASONIC_PORT                 GPIOA
+#define ULTRASONIC_ECHO_PIN             GPIO_PIN_8
+#define ULTRASONIC_TRIGGER_PIN          GPIO_PIN_11
+
+#define ULTRASONIC_TIMER_INSTANCE       TIM1
+#define ULTRASONIC_TIMER_CLOCK_ENABLE() __HAL_RCC_TIM1_CLK_ENABLE()
+#define ULTRASONIC_TIMER_IRQ            TIM1_CC_IRQn
+#define ULTRASONIC_TIMER_TICK_HZ        1000000 /* 1 us tick */
+#define ULTRASONIC_TIMER_PERIOD         39999   /* 40 ms, 25 Hz */
+#define ULTRASONIC_TRIGGER_US           10
+
+/** Echoes longer than this mean nothing in range. */
+#define ULTRASONIC_ECHO_MAX_US          (ULTRASONIC_RANGE_MAX_MM * 10000UL / 1715)
+
+/** Timer ticks elapsed since a capture. */
+#define ULTRASONIC_TICKS_SINCE(capture) \
+    ((ULTRASONIC_TIMER_INSTANCE->CNT + ULTRASONIC_TIMER_PERIOD + 1 - (capture)) % (ULTRASONIC_TIMER_PERIOD + 1))
+
+/** Ranges older than this (two missed echoes) are not trusted. */
+#define ULTRASONIC_STALE_MS             100
+
+/** Variables ----------------------------------------------------- */
+static TIM_HandleTypeDef timer_handle = { 0 };
+
+/** Range and HAL tick of the last echo, published through a sequence
+ * counter so the main loop never sees a torn update. */
+static uint16_t last_range = ULTRASONIC_RANGE_INVALID;
+static uint32_t last_tick = 0;
+static volatile uint32_t sequence = 0;
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Gets the prescaler for a 1 us tick at the current clock.
+ */
+static uint32_t ultrasonic_prescaler(void) {
+    return clock_timer_frequency(ULTRASONIC_TIMER_INSTANCE) / ULTRASONIC_TIMER_TICK_HZ - 1;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Configures the trigger output, the echo captures and starts ranging.
+ */
+void ultrasonic_setup(void) {
+    ULTRASONIC_GPIO_CLOCK_ENABLE();
+    ULTRASONIC_TIMER_CLOCK_ENABLE();
+
+    GPIO_InitTypeDef gpio_init = { 0 };
+    gpio_init.Pin = ULTRASONIC_TRIGGER_PIN;
+    gpio_init.Mode = GPIO_MODE_AF_PP;
+    gpio_init.Pull = GPIO_NOPULL;
+    gpio_init.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(ULTRASONIC_PORT, &gpio_init);
+
+    gpio_init.Pin = ULTRASONIC_ECHO_PIN;
+    gpio_init.Mode = GPIO_MODE_INPUT;
+    gpio_init.Pull = GPIO_PULLDOWN;
+    HAL_GPIO_Init(ULTRASONIC_PORT, &gpio_init);
+
+    timer_handle.Instance = ULTRASONIC_TIMER_INSTANCE;
+    timer_handle.Init.Prescaler = ultrasonic_prescaler();
+    timer_handle.Init.Period = ULTRASONIC_TIMER_PERIOD;
+    timer_handle.Init.CounterMode = TIM_COUNTERMODE_UP;
+    timer_handle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    timer_handle.Init.RepetitionCounter = 0;
+    HAL_TIM_PWM_Init(&timer_handle);
+
+    TIM_OC_InitTypeDef pwm_config = { 0 };
+    pwm_config.OCMode = TIM_OCMODE_PWM1;
+    pwm_config.Pulse = ULTRASONIC_TRIGGER_US;
+    pwm_config.OCPolarity = TIM_OCPOLARITY_HIGH;
+    HAL_TIM_PWM_ConfigChannel(&timer_handle, &pwm_config, TIM_CHANNEL_4);
+
+    TIM_IC_InitTypeDef capture_config = { 0 };
+    capture_config.ICPolarity = TIM_ICPOLARITY_RISING;
+    capture_config.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    capture_config.ICPrescaler = TIM_ICPSC_DIV1;
+    capture_config.ICFilter = 0x4;
+    HAL_TIM_IC_ConfigChannel(&timer_handle, &capture_config, TIM_CHANNEL_1);
+
+    capture_config.ICPolarity = TIM_ICPOLARITY_FALLING;
+    capture_config.ICSelection = TIM_ICSELECTION_INDIRECTTI;
+    HAL_TIM_IC_ConfigChannel(&timer_handle, &capture_config, TIM_CHANNEL_2);
+
+    __HAL_TIM_ENABLE_IT(&timer_handle, TIM_IT_CC2);
+    HAL_NVIC_SetPriority(ULTRASONIC_TIMER_IRQ, IRQ_PREEMPT_ULTRASONIC, IRQ_SUB_ULTRASONIC);
+    HAL_NVIC_EnableIRQ(ULTRASONIC_TIMER_IRQ);
+
+    HAL_TIM_IC_Start(&timer_handle, TIM_CHANNEL_1);
+    HAL_TIM_IC_Start(&timer_handle, TIM_CHANNEL_2);
+    HAL_TIM_PWM_Start(&timer_handle, TIM_CHANNEL_4);
+}
+
+/**
+ * @brief Keeps the 1 us tick after a clock profile switch.
+ *
+ * The prescaler is buffered, so the change lands at the next period start
+ * and at most one echo is mismeasured.
+ */
+void ultrasonic_retime(void) {
+    __HAL_TIM_SET_PRESCALER(&timer_handle, ultrasonic_prescaler());
+}
+
+/**
+ * @brief Gets the latest measured range.
+ *
+ * @param now   Current HAL tick, in ms.
+ *
+ * @return Range in mm, ULTRASONIC_RANGE_MAX_MM when nothing is in range,
+ *         ULTRASONIC_RANGE_INVALID if no recent echo was received.
+ */
+uint16_t ultrasonic_get_range(uint32_t now) {
+    uint32_t start;
+    uint16_t range;
+    uint32_t tick;
+
+    do {
+        start = sequence;
+        __sync_synchronize();
+        range = last_range;
+        tick = last_tick;
+        __sync_synchronize();
+    } while ((start & 1) != 0 || start != sequence);
+
+    /* An echo taken after the caller read the tick is fresh */
+    if (range == ULTRASONIC_RANGE_INVALID || (int32_t)(now - tick) > ULTRASONIC_STALE_MS) {
+        return ULTRASONIC_RANGE_INVALID;
+    }
+
+    return range;
+}
+
+/**
+ * @brief Echo falling edge: both edges are latched, compute the range.
+ *
+ * Sound travels 0.343 mm/us, halved for the round trip.
+ */
+void TIM1_CC_IRQHandler(void) {
+    if ((ULTRASONIC_TIMER_INSTANCE->SR & TIM_SR_CC2IF) == 0) {
+        return;
+    }
+
+    uint32_t rise = ULTRASONIC_TIMER_INSTANCE->CCR1;
+    uint32_t fall = ULTRASONIC_TIMER_INSTANCE->CCR2;
+
+    /* The falling edge capture is the raise time */
+    IRQ_PROFILE_ENTER(IRQ_ID_ULTRASONIC, ULTRASONIC_TICKS_SINCE(fall) * (SystemCoreClock / 1000000));
+
+    uint32_t width_us = fall >= rise ? fall - rise : fall + ULTRASONIC_TIMER_PERIOD + 1 - rise;
+
+    uint32_t range = ULTRASONIC_RANGE_MAX_MM;
+    if (width_us < ULTRASONIC_ECHO_MAX_US) {
+        range = width_us * 1715 / 10000;
+    }
+
+    sequence++;
+    __sync_synchronize();
+    last_range = (uint16_t)range;
+    last_tick = HAL_GetTick();
+    __sync_synchronize();
+    sequence++;
+
+    IRQ_PROFILE_EXIT(IRQ_ID_ULTRASONIC);
+}
@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Firmware image reception over the console UART.
+ *
+ * The console reception is switched to circular DMA over two pages. While
+ * one page is being programmed, with the CPU stalled on the flash, the DMA
+ * keeps filling the other one: programming a page takes about 30 ms, well
+ * below the 89 ms it takes to receive one at 115200 baud, so the host never
+ * has to wait between pages.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f1xx.h"
+#include "core_cm3.h"
+
+#include "boot_control.h"
+#include "console.h"
+#include "update.h"
+
+#include "stm32f1xx_hal.h"
+
+/** Definitions --------------------------------------------------- */
+#define UPDATE_BUFFER_SIZE          (2 * BOOT_PAGE_SIZE)
+#define UPDATE_TIMEOUT_MS           1000
+
+#define IWDG_KEY_RELOAD             0xAAAA
+
+/** Variables ----------------------------------------------------- */
+static uint8_t update_buffer[UPDATE_BUFFER_SIZE] __attribute__((aligned(4)));
+
+/** Prototypes ---------------------------------------------------- */
+static bool update_read_header(update_header_t *header);
+static bool update_stream(uint32_t size);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Reads the header from the console ring buffer.
+ */
+static bool update_read_header(update_header_t *header) {
+    return console_read_block(header, sizeof(*header), UPDATE_TIMEOUT_MS) && header->magic == UPDATE_MAGIC;
+}
+
+/**
+ * @brief Programs the image as it arrives, a page at a time.
+ *
+ * The DMA position is sampled at least once per page programmed, which is
+ * far less than a buffer worth of bytes, so the received count is exact.
+ */
+static bool update_stream(uint32_t size) {
+    uint32_t received = 0;
+    uint32_t written = 0;
+    uint16_t position = 0;
+    uint32_t timeshot = HAL_GetTick();
+
+    while (written < size) {
+        IWDG->KR = IWDG_KEY_RELOAD;
+
+        uint16_t now = console_stream_position();
+        if (now != position) {
+            received += (uint16_t)(now - position + UPDATE_BUFFER_SIZE) % UPDATE_BUFFER_SIZE;
+            position = now;
+            timeshot = HAL_GetTick();
+        }
+
+        if (received - written > UPDATE_BUFFER_SIZE || console_stream_overrun() ||
+            HAL_GetTick() - timeshot > UPDATE_TIMEOUT_MS) {
+            return false;
+        }
+
+        uint32_t page_end = written + BOOT_PAGE_SIZE < size ? written + BOOT_PAGE_SIZE : size;
+        if (received >= page_end) {
+            if (!boot_update_write(written, &update_buffer[written % UPDATE_BUFFER_SIZE], page_end - written)) {
+                return false;
+            }
+            written = page_end;
+        }
+    }
+
+    return true;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Receives an image into the staging slot and resets into the
+ * bootloader to install it. Blocks until done; returns only on failure,
+ * after answering UPDATE_NACK. The caller stops the motors beforehand.
+ */
+void update_receive(void) {
+    update_header_t header;
+    uint8_t reply = UPDATE_NACK;
+
+    if (!update_read_header(&header) || !boot_update_begin(header.size, header.crc)) {
+        console_write(&reply, sizeof(reply));
+        return;
+    }
+
+    console_stream_start(update_buffer, UPDATE_BUFFER_SIZE);
+    reply = UPDATE_ACK;
+    console_write(&reply, sizeof(reply));
+
+    bool received = update_stream(header.size);
+    console_stream_stop();
+
+    reply = received && boot_update_finish() ? UPDATE_ACK : UPDATE_NACK;
+    console_write(&reply, sizeof(reply));
+
+    if (reply == UPDATE_ACK) {
+        NVIC_SystemReset();
+    }
+}
@@ -0,0 +1,551 @@
+/**
+ * @file
+ * @brief Host tool: encodes sound effects for the buzzer and checks the
+ * ADPCM decoder.
+ *
+ * Each sound is read from a 16-bit PCM WAV file (mono or stereo, any rate),
+ * resampled to AUDIO_SAMPLE_RATE_HZ, padded to whole blocks and encoded
+ * with the same adpcm_step() the car decodes with, so every code is picked
+ * against the exact reconstruction. The output is the sound table compiled
+ * into the firmware (core/src/sounds.c). Built-in "synth:" sources stand in
+ * for recordings.
+ *
+ * Modes:
+ *   -o file name=source...
+ *                  Writes the sound table. name is a sound of audio_sound_t
+ *                  in lower case (horn, engine, reverse), source a WAV file
+ *                  or synth:horn, synth:engine or synth:reverse.
+ *   -t             Decoder accuracy test: random blocks must decode the
+ *                  same block by block as through the encoder's tracking
+ *                  state, test signals must keep their SNR, and the PDM
+ *                  stream must match every sample level within one bit.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/adpcm_encode.c core/src/adpcm.c -lm -o adpcm_encode
+ *
+ * Usage:
+ *     adpcm_encode -o core/src/sounds.c horn=synth:horn engine=synth:engine reverse=synth:reverse
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "adpcm.h"
+#include "audio.h"
+
+/** Definitions --------------------------------------------------- */
+#define PI                  3.14159265358979323846
+#define SYNTH_AMPLITUDE     22000
+#define TEST_BLOCKS         20000
+#define TEST_SIGNAL_SAMPLES (ADPCM_BLOCK_SAMPLES * 256)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    int16_t *samples;
+    uint32_t count;
+} pcm_t;
+
+typedef struct {
+    const char *name;
+    double frequency;
+    double min_snr_db;
+} test_signal_t;
+
+/** Variables ----------------------------------------------------- */
+static const char *const sound_names[AUDIO_SOUND_COUNT] = {
+    [AUDIO_SOUND_HORN] = "horn",
+    [AUDIO_SOUND_ENGINE] = "engine",
+    [AUDIO_SOUND_REVERSE] = "reverse",
+};
+
+/** Prototypes ---------------------------------------------------- */
+static uint8_t encode_pass(const pcm_t *pcm, uint8_t index, uint8_t *blocks, int16_t *decoded);
+
+/** Internal functions -------------------------------------------- */
+static uint32_t read_u32(const uint8_t *bytes) {
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t *bytes) {
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static int16_t clamp16(double value) {
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : lround(value));
+}
+
+/**
+ * @brief Pads a sound with silence to whole blocks.
+ */
+static void pcm_pad(pcm_t *pcm) {
+    uint32_t count = (pcm->count + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES * ADPCM_BLOCK_SAMPLES;
+
+    pcm->samples = realloc(pcm->samples, count * sizeof(int16_t));
+    memset(&pcm->samples[pcm->count], 0, (count - pcm->count) * sizeof(int16_t));
+    pcm->count = count;
+}
+
+/**
+ * @brief Reads a 16-bit PCM WAV file, mixes it to mono and resamples it.
+ */
+static bool wav_read(const char *path, pcm_t *pcm) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc((size_t)size);
+    bool read = fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    uint16_t channels = 0;
+    uint32_t rate = 0;
+    const uint8_t *frames = NULL;
+    uint32_t frame_bytes = 0;
+
+    if (read && size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(&data[8], "WAVE", 4) == 0) {
+        for (long offset = 12; offset + 8 <= size;) {
+            uint32_t chunk = read_u32(&data[offset + 4]);
+            const uint8_t *body = &data[offset + 8];
+
+            if (offset + 8 + (long)chunk > size) {
+                break;
+            }
+            if (memcmp(&data[offset], "fmt ", 4) == 0 && chunk >= 16 && read_u16(body) == 1 &&
+                read_u16(&body[14]) == 16) {
+                channels = read_u16(&body[2]);
+                rate = read_u32(&body[4]);
+            } else if (memcmp(&data[offset], "data", 4) == 0) {
+                frames = body;
+                frame_bytes = chunk;
+            }
+            offset += 8 + chunk + (chunk & 1);
+        }
+    }
+
+    if (channels == 0 || rate == 0 || frames == NULL) {
+        fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", path);
+        free(data);
+        return false;
+    }
+
+    uint32_t input_count = frame_bytes / (2 * channels);
+    double *mono = malloc((input_count + 1) * sizeof(double));
+    for (uint32_t i = 0; i < input_count; i++) {
+        double sum = 0;
+        for (uint16_t c = 0; c < channels; c++) {
+            sum += (int16_t)read_u16(&frames[(i * channels + c) * 2]);
+        }
+        mono[i] = sum / channels;
+    }
+    mono[input_count] = input_count > 0 ? mono[input_count - 1] : 0;
+
+    /* Linear interpolation is enough for a buzzer */
+    pcm->count = (uint32_t)((uint64_t)input_count * AUDIO_SAMPLE_RATE_HZ / rate);
+    pcm->samples = malloc((pcm->count + ADPCM_BLOCK_SAMPLES) * sizeof(int16_t));
+    for (uint32_t i = 0; i < pcm->count; i++) {
+        double position = (double)i * rate / AUDIO_SAMPLE_RATE_HZ;
+        uint32_t index = (uint32_t)position;
+        double fraction = position - index;
+        pcm->samples[i] = clamp16(mono[index] + (mono[index + 1] - mono[index]) * fraction);
+    }
+
+    free(mono);
+    free(data);
+    return true;
+}
+
+/**
+ * @brief Rounds a frequency to a whole number of periods over a loop, so
+ * looping sounds join without a click.
+ */
+static double loop_frequency(double frequency, uint32_t count) {
+    return round(frequency * count / AUDIO_SAMPLE_RATE_HZ) * AUDIO_SAMPLE_RATE_HZ / count;
+}
+
+/**
+ * @brief Generates a stand-in sound effect.
+ */
+static bool synth(const char *name, pcm_t *pcm) {
+    uint32_t blocks;
+
+    if (strcmp(name, "horn") == 0 || strcmp(name, "reverse") == 0) {
+        blocks = 32;
+    } else if (strcmp(name, "engine") == 0) {
+        blocks = 16;
+    } else {
+        fprintf(stderr, "unknown synth sound %s\n", name);
+        return false;
+    }
+
+    pcm->count = blocks * ADPCM_BLOCK_SAMPLES;
+    pcm->samples = malloc(pcm->count * sizeof(int16_t));
+
+    for (uint32_t i = 0; i < pcm->count; i++) {
+        double t = (double)i / AUDIO_SAMPLE_RATE_HZ;
+        double value;
+
+        if (name[0] == 'h') {
+            /* Two-tone horn, softened square waves */
+            double low = loop_frequency(420, pcm->count);
+            double high = loop_frequency(525, pcm->count);
+            value = 0.5 * tanh(4 * sin(2 * PI * low * t)) + 0.5 * tanh(4 * sin(2 * PI * high * t));
+        } else if (name[0] == 'e') {
+            /* Decaying firing pulses over a low hum */
+            double firing = loop_frequency(40, pcm->count);
+            double phase = fmod(t * firing, 1.0);
+            value = 0.7 * exp(-phase * 6) * sin(2 * PI * 180 * phase / firing) +
+                    0.3 * sin(2 * PI * loop_frequency(80, pcm->count) * t);
+        } else {
+            /* Reverse beeper: 1 kHz for half the loop, with short ramps */
+            double on = pcm->count / 2.0;
+            double ramp = fmin(fmin(i, on - i) / 40.0, 1.0);
+            value = i < on ? ramp * sin(2 * PI * loop_frequency(1000, pcm->count) * t) : 0;
+        }
+
+        pcm->samples[i] = clamp16(value * SYNTH_AMPLITUDE);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Encodes samples into blocks. Each block starts from its first
+ * sample, and every code is the one whose decoded value is closest.
+ *
+ * Sounds loop, so a first pass finds the step index the last block ends
+ * with and the first block starts from it instead of the smallest step.
+ *
+ * @return Decoded samples, as the car will play them, if requested.
+ */
+static void encode(const pcm_t *pcm, uint8_t *blocks, int16_t *decoded) {
+    adpcm_state_t state = { 0, 0 };
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        state.index = encode_pass(pcm, state.index, blocks, decoded);
+    }
+}
+
+/**
+ * @brief Encodes every block once.
+ *
+ * @return Step index after the last block.
+ */
+static uint8_t encode_pass(const pcm_t *pcm, uint8_t index, uint8_t *blocks, int16_t *decoded) {
+    adpcm_state_t state = { 0, index };
+
+    for (uint32_t b = 0; b < pcm->count / ADPCM_BLOCK_SAMPLES; b++) {
+        const int16_t *samples = &pcm->samples[b * ADPCM_BLOCK_SAMPLES];
+        uint8_t *block = &blocks[b * ADPCM_BLOCK_SIZE];
+
+        state.predictor = samples[0];
+        block[0] = (uint8_t)state.predictor;
+        block[1] = (uint8_t)((uint16_t)state.predictor >> 8);
+        block[2] = state.index;
+        block[3] = 0;
+        memset(&block[ADPCM_HEADER_SIZE], 0, ADPCM_BLOCK_SAMPLES / 2);
+
+        for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+            uint8_t best = 0;
+            int32_t best_error = INT32_MAX;
+
+            for (uint8_t code = 0; code < 16; code++) {
+                adpcm_state_t trial = state;
+                int32_t error = abs(adpcm_step(&trial, code) - samples[i]);
+                if (error < best_error) {
+                    best_error = error;
+                    best = code;
+                }
+            }
+
+            int16_t value = adpcm_step(&state, best);
+            if (decoded != NULL) {
+                decoded[b * ADPCM_BLOCK_SAMPLES + i] = value;
+            }
+            block[ADPCM_HEADER_SIZE + i / 2] |= (i & 1) ? best << 4 : best;
+        }
+    }
+
+    return state.index;
+}
+
+/**
+ * @brief Writes the sound table source.
+ */
+static int write_table(const char *path, int argc, char **argv) {
+    pcm_t sounds[AUDIO_SOUND_COUNT] = { 0 };
+
+    for (int a = 0; a < argc; a++) {
+        char *separator = strchr(argv[a], '=');
+        audio_sound_t sound = AUDIO_SOUND_COUNT;
+
+        for (uint8_t s = 1; separator != NULL && s < AUDIO_SOUND_COUNT; s++) {
+            if (strncmp(argv[a], sound_names[s], (size_t)(separator - argv[a])) == 0 &&
+                sound_names[s][separator - argv[a]] == '\0') {
+                sound = (audio_sound_t)s;
+            }
+        }
+        if (sound == AUDIO_SOUND_COUNT) {
+            fprintf(stderr, "%s: expected horn|engine|reverse=source\n", argv[a]);
+            return 2;
+        }
+
+        const char *source = separator + 1;
+        bool loaded = strncmp(source, "synth:", 6) == 0 ? synth(source + 6, &sounds[sound])
+                                                        : wav_read(source, &sounds[sound]);
+        if (!loaded) {
+            return 1;
+        }
+        pcm_pad(&sounds[sound]);
+    }
+
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        return 2;
+    }
+
+    fprintf(file, "/**\n * @file\n * @brief Buzzer sound effects, IMA ADPCM blocks at AUDIO_SAMPLE_RATE_HZ.\n *\n");
+    fprintf(file, " * Generated by tools/adpcm_encode.c, do not edit:\n *     adpcm_encode -o %s", path);
+    for (int a = 0; a < argc; a++) {
+        fprintf(file, " %s", argv[a]);
+    }
+    fprintf(file, "\n */\n#include <stdint.h>\n\n#include \"audio.h\"\n\n");
+    fprintf(file, "/** Variables ----------------------------------------------------- */\n");
+
+    uint32_t total = 0;
+    for (uint8_t s = 1; s < AUDIO_SOUND_COUNT; s++) {
+        if (sounds[s].count == 0) {
+            continue;
+        }
+
+        uint32_t size = sounds[s].count / ADPCM_BLOCK_SAMPLES * ADPCM_BLOCK_SIZE;
+        uint8_t *blocks = malloc(size);
+        encode(&sounds[s], blocks, NULL);
+
+        fprintf(file, "static const uint8_t %s[%u] = {", sound_names[s], size);
+        for (uint32_t i = 0; i < size; i++) {
+            fprintf(file, "%s0x%02X,", i % 12 == 0 ? "\n    " : " ", blocks[i]);
+        }
+        fprintf(file, "\n};\n\n");
+
+        printf("%-8s %5u samples, %4.2f s, %5u bytes\n", sound_names[s], sounds[s].count,
+               (double)sounds[s].count / AUDIO_SAMPLE_RATE_HZ, size);
+        total += size;
+        free(blocks);
+    }
+
+    fprintf(file, "const audio_clip_t audio_clips[AUDIO_SOUND_COUNT] = {\n");
+    for (uint8_t s = 1; s < AUDIO_SOUND_COUNT; s++) {
+        if (sounds[s].count != 0) {
+            char upper[16];
+            uint8_t n = 0;
+            for (; sound_names[s][n] != '\0' && n < sizeof(upper) - 1; n++) {
+                upper[n] = (char)toupper((unsigned char)sound_names[s][n]);
+            }
+            upper[n] = '\0';
+            fprintf(file, "    [AUDIO_SOUND_%s] = { %s, %u },\n", upper, sound_names[s],
+                    sounds[s].count / ADPCM_BLOCK_SAMPLES);
+        }
+        free(sounds[s].samples);
+    }
+    fprintf(file, "};\n");
+    fclose(file);
+
+    printf("%u bytes of flash\n", total);
+    return 0;
+}
+
+/**
+ * @brief Checks block decoding against the encoder's tracking state on
+ * random blocks, which also drive the step index to both ends.
+ */
+static uint32_t test_random_blocks(void) {
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < TEST_BLOCKS; n++) {
+        uint8_t block[ADPCM_BLOCK_SIZE];
+        int16_t samples[ADPCM_BLOCK_SAMPLES];
+
+        for (uint32_t i = 0; i < ADPCM_BLOCK_SIZE; i++) {
+            block[i] = (uint8_t)rand();
+        }
+        block[2] = (uint8_t)(rand() % (ADPCM_INDEX_MAX + 1));
+
+        adpcm_state_t state = { (int16_t)read_u16(block), block[2] };
+        adpcm_decode_block(block, samples);
+
+        for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+            uint8_t code = (i & 1) ? block[ADPCM_HEADER_SIZE + i / 2] >> 4 : block[ADPCM_HEADER_SIZE + i / 2] & 0x0F;
+            if (adpcm_step(&state, code) != samples[i]) {
+                failures++;
+                break;
+            }
+        }
+    }
+
+    printf("random blocks: %u blocks, %u mismatches\n", TEST_BLOCKS, failures);
+    return failures;
+}
+
+/**
+ * @brief Encodes test signals and checks the SNR of what the car plays.
+ */
+static uint32_t test_signals(void) {
+    static const test_signal_t signals[] = {
+        { "sine", 200, 27 }, { "sine", 500, 21 }, { "sine", 1000, 15 }, { "sine", 1800, 14 },
+        { "sweep", 2000, 16 }, { "square", 300, 13 }, { "noise", 0, 13 },
+    };
+    uint32_t failures = 0;
+
+    for (uint32_t s = 0; s < sizeof(signals) / sizeof(signals[0]); s++) {
+        const test_signal_t *signal = &signals[s];
+        pcm_t pcm = { malloc(TEST_SIGNAL_SAMPLES * sizeof(int16_t)), TEST_SIGNAL_SAMPLES };
+
+        for (uint32_t i = 0; i < pcm.count; i++) {
+            double t = (double)i / AUDIO_SAMPLE_RATE_HZ;
+            double value;
+
+            if (strcmp(signal->name, "sweep") == 0) {
+                double duration = (double)pcm.count / AUDIO_SAMPLE_RATE_HZ;
+                value = sin(PI * signal->frequency * t * t / duration);
+            } else if (strcmp(signal->name, "square") == 0) {
+                value = sin(2 * PI * signal->frequency * t) >= 0 ? 0.9 : -0.9;
+            } else if (strcmp(signal->name, "noise") == 0) {
+                value = (rand() / (double)RAND_MAX - 0.5) * 1.6;
+            } else {
+                value = sin(2 * PI * signal->frequency * t);
+            }
+            pcm.samples[i] = clamp16(value * SYNTH_AMPLITUDE);
+        }
+
+        uint32_t block_count = pcm.count / ADPCM_BLOCK_SAMPLES;
+        uint8_t *blocks = malloc(block_count * ADPCM_BLOCK_SIZE);
+        int16_t *tracked = malloc(pcm.count * sizeof(int16_t));
+        encode(&pcm, blocks, tracked);
+
+        double signal_power = 0;
+        double noise_power = 0;
+        uint32_t mismatches = 0;
+
+        for (uint32_t b = 0; b < block_count; b++) {
+            int16_t decoded[ADPCM_BLOCK_SAMPLES];
+            adpcm_decode_block(&blocks[b * ADPCM_BLOCK_SIZE], decoded);
+
+            for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+                double reference = pcm.samples[b * ADPCM_BLOCK_SAMPLES + i];
+                double error = decoded[i] - reference;
+
+                mismatches += decoded[i] != tracked[b * ADPCM_BLOCK_SAMPLES + i];
+                signal_power += reference * reference;
+                noise_power += error * error;
+            }
+        }
+
+        double snr = 10 * log10(signal_power / (noise_power > 0 ? noise_power : 1));
+        bool pass = snr >= signal->min_snr_db && mismatches == 0;
+        printf("  %-6s %6.0f Hz: SNR %5.1f dB (min %2.0f), %u mismatches%s\n", signal->name, signal->frequency, snr,
+               signal->min_snr_db, mismatches, pass ? "" : "  FAIL");
+        failures += !pass;
+
+        free(blocks);
+        free(tracked);
+        free(pcm.samples);
+    }
+
+    return failures;
+}
+
+/**
+ * @brief Checks the PDM stream of random blocks: the ones sent for each
+ * sample match its level within one bit, counting the error carried over.
+ */
+static uint32_t test_pdm(void) {
+    uint16_t error = 0;
+    int64_t carried = 0;
+    uint32_t worst = 0;
+    uint32_t failures = 0;
+
+    for (uint32_t n = 0; n < TEST_BLOCKS; n++) {
+        uint8_t block[ADPCM_BLOCK_SIZE];
+        int16_t samples[ADPCM_BLOCK_SAMPLES];
+        uint16_t words[ADPCM_PDM_WORDS];
+
+        for (uint32_t i = 0; i < ADPCM_BLOCK_SIZE; i++) {
+            block[i] = (uint8_t)rand();
+        }
+        block[2] = (uint8_t)(rand() % (ADPCM_INDEX_MAX + 1));
+
+        adpcm_decode_block(block, samples);
+        adpcm_decode_pdm(block, words, &error);
+
+        for (uint32_t i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+            uint32_t ones = 0;
+            for (uint32_t w = 0; w < ADPCM_PDM_OVERSAMPLING / 16; w++) {
+                ones += (uint32_t)__builtin_popcount(words[i * ADPCM_PDM_OVERSAMPLING / 16 + w]);
+            }
+
+            /* Deviation of the running count from the running level, in
+             * 1/65536 of a bit, must stay within one bit */
+            carried += (int64_t)ones * 65536 - (int64_t)(samples[i] + 32768) * ADPCM_PDM_OVERSAMPLING;
+            uint32_t deviation = (uint32_t)llabs(carried);
+            worst = deviation > worst ? deviation : worst;
+            if (deviation > 65536) {
+                failures++;
+            }
+        }
+    }
+
+    printf("pdm: %u blocks, worst deviation %.3f bit, %u failures\n", TEST_BLOCKS, worst / 65536.0, failures);
+    return failures;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char **argv) {
+    const char *output = NULL;
+    bool test = false;
+    int option;
+
+    srand(1);
+
+    while ((option = getopt(argc, argv, "o:t")) != -1) {
+        switch (option) {
+            case 'o': {
+                output = optarg;
+                break;
+            }
+            case 't': {
+                test = true;
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s -t | -o sounds.c name=file.wav|synth:name...\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    if (test) {
+        uint32_t failures = test_random_blocks();
+        printf("signals at %u Hz:\n", AUDIO_SAMPLE_RATE_HZ);
+        failures += test_signals();
+        failures += test_pdm();
+        return failures == 0 ? 0 : 1;
+    }
+
+    if (output == NULL || optind == argc) {
+        fprintf(stderr, "usage: %s -t | -o sounds.c name=file.wav|synth:name...\n", argv[0]);
+        return 2;
+    }
+
+    return write_table(output, argc - optind, &argv[optind]);
+}
@@ -0,0 +1,495 @@
+/**
+ * @file
+ * @brief Host tool: runs the firmware update state machine on a simulated
+ * flash, including power loss at every flash operation.
+ *
+ * The simulated flash follows the STM32F1 rules: 1 KB page erase to 0xFF,
+ * half word programming that fails on a half word not erased. A power cut
+ * leaves the interrupted operation half done (half an erased page, or the
+ * first half of the programmed data) and restarts from reset.
+ *
+ * Scenarios: factory image, update then confirm, unconfirmed image rolled
+ * back, corrupted images, a page that fails to erase during a swap, state
+ * log writes that fail during a swap followed by a reset, then
+ * power cut after every flash operation of an install and of a rollback,
+ * plus a second cut during recovery.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/boot_sim.c core/src/boot_control.c -o boot_sim
+ *
+ * Usage: boot_sim [-s stride]
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <unistd.h>
+
+#include "boot_control.h"
+
+/** Definitions --------------------------------------------------- */
+#define FLASH_BASE              BOOT_LOADER_ADDRESS
+#define FLASH_SIZE              (64 * 1024)
+#define CRC_POLYNOMIAL          0x04C11DB7
+
+#define IMAGE_A_SIZE            (20 * 1024 + 36)
+#define IMAGE_B_SIZE            (23 * 1024 + 512)
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Variables ----------------------------------------------------- */
+static uint8_t flash[FLASH_SIZE];
+static uint8_t image_a[BOOT_SLOT_SIZE];
+static uint8_t image_b[BOOT_SLOT_SIZE];
+
+/** Flash operations left before the power is cut, 0 for none. */
+static uint32_t power_budget = 0;
+static uint32_t operations = 0;
+static jmp_buf power_cut;
+
+/** Page whose erase fails, and how many more times it does. */
+static uint32_t failing_page = 0;
+static uint32_t failing_erases = 0;
+
+/** State log writes left before they fail, UINT32_MAX for none. */
+static uint32_t state_writes_left = UINT32_MAX;
+
+static uint32_t failures = 0;
+
+/** Prototypes ---------------------------------------------------- */
+static uint8_t *flash_at(uint32_t address);
+static bool power_tick(void);
+static uint32_t crc_words(const uint8_t *data, uint32_t size);
+static void make_image(uint8_t *image, uint32_t size, uint32_t seed);
+static void factory(void);
+static bool write_update(const uint8_t *image, uint32_t size, uint32_t crc);
+static boot_run_t boot(void);
+static boot_run_t boot_with_cut(uint32_t budget, bool *cut);
+static boot_state_t state(void);
+static bool slot_holds(uint32_t address, const uint8_t *image, uint32_t size);
+static void test_factory(void);
+static void test_confirm(void);
+static void test_rollback(void);
+static void test_corrupted(void);
+static void test_erase_failure(void);
+static void test_log_failure(void);
+static uint32_t test_power_loss(const char *name, bool rollback, uint32_t stride);
+
+/** Internal functions -------------------------------------------- */
+static uint8_t *flash_at(uint32_t address) {
+    if (address < FLASH_BASE || address >= FLASH_BASE + FLASH_SIZE) {
+        fprintf(stderr, "flash access out of range: %08x\n", address);
+        exit(2);
+    }
+
+    return &flash[address - FLASH_BASE];
+}
+
+/**
+ * @brief Counts a flash operation.
+ *
+ * @return true if the power is cut during this one.
+ */
+static bool power_tick(void) {
+    operations++;
+
+    return power_budget != 0 && --power_budget == 0;
+}
+
+static uint32_t crc_words(const uint8_t *data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t offset = 0; offset < size; offset += 4) {
+        uint32_t word;
+
+        memcpy(&word, &data[offset], 4);
+        crc ^= word;
+        for (uint8_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CRC_POLYNOMIAL : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Fills an image with a valid vector table and pseudo random code,
+ * blank after its size.
+ */
+static void make_image(uint8_t *image, uint32_t size, uint32_t seed) {
+    uint32_t vectors[2] = { BOOT_RAM_ADDRESS + BOOT_RAM_SIZE, BOOT_APP_ADDRESS + 0x131 };
+
+    memset(image, 0xFF, BOOT_SLOT_SIZE);
+    srand(seed);
+    for (uint32_t i = 0; i < size; i++) {
+        image[i] = (uint8_t)rand();
+    }
+    memcpy(image, vectors, sizeof(vectors));
+}
+
+/**
+ * @brief Blank flash with image A programmed through the debugger.
+ */
+static void factory(void) {
+    memset(flash, 0xFF, sizeof(flash));
+    memcpy(flash_at(BOOT_APP_ADDRESS), image_a, IMAGE_A_SIZE);
+    boot_init();
+}
+
+/**
+ * @brief Application side: streams an image into staging a page at a time.
+ */
+static bool write_update(const uint8_t *image, uint32_t size, uint32_t crc) {
+    if (!boot_update_begin(size, crc)) {
+        return false;
+    }
+
+    for (uint32_t offset = 0; offset < size; offset += BOOT_PAGE_SIZE) {
+        uint32_t length = size - offset < BOOT_PAGE_SIZE ? size - offset : BOOT_PAGE_SIZE;
+
+        if (!boot_update_write(offset, &image[offset], length)) {
+            return false;
+        }
+    }
+
+    return boot_update_finish();
+}
+
+/**
+ * @brief Reset: the bootloader loads the state and decides.
+ */
+static boot_run_t boot(void) {
+    boot_init();
+    return boot_run();
+}
+
+/**
+ * @brief Boots with the power cut after a number of flash operations.
+ *
+ * @param cut   Set if the cut happened before the bootloader finished.
+ */
+static boot_run_t boot_with_cut(uint32_t budget, bool *cut) {
+    boot_run_t run = BOOT_RUN_NONE;
+
+    power_budget = budget;
+    *cut = setjmp(power_cut) != 0;
+    if (!*cut) {
+        run = boot();
+    }
+    power_budget = 0;
+
+    return run;
+}
+
+static boot_state_t state(void) {
+    boot_record_t record;
+
+    boot_get_record(&record);
+    return (boot_state_t)record.state;
+}
+
+static bool slot_holds(uint32_t address, const uint8_t *image, uint32_t size) {
+    return memcmp(flash_at(address), image, size) == 0;
+}
+
+static void test_factory(void) {
+    printf("factory image\n");
+    factory();
+
+    CHECK(boot() == BOOT_RUN_APP);
+    CHECK(state() == BOOT_STATE_CONFIRMED);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, IMAGE_A_SIZE));
+
+    memset(flash, 0xFF, sizeof(flash));
+    CHECK(boot() == BOOT_RUN_NONE);
+}
+
+static void test_confirm(void) {
+    printf("update, trial, confirm\n");
+    factory();
+
+    CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+    CHECK(state() == BOOT_STATE_PENDING);
+
+    operations = 0;
+    CHECK(boot() == BOOT_RUN_TRIAL);
+    printf("  install: %u flash operations\n", operations);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+    CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_a, BOOT_SLOT_SIZE));
+
+    /* Application side: refuses a new update before confirming */
+    boot_init();
+    CHECK(!boot_update_begin(IMAGE_A_SIZE, crc_words(image_a, IMAGE_A_SIZE)));
+    boot_confirm();
+    CHECK(state() == BOOT_STATE_CONFIRMED);
+
+    for (uint8_t i = 0; i < BOOT_TRIAL_ATTEMPTS + 1; i++) {
+        CHECK(boot() == BOOT_RUN_APP);
+    }
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+
+    /* Back to A, then staging holds B */
+    CHECK(write_update(image_a, IMAGE_A_SIZE, crc_words(image_a, IMAGE_A_SIZE)));
+    CHECK(boot() == BOOT_RUN_TRIAL);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, BOOT_SLOT_SIZE));
+}
+
+static void test_rollback(void) {
+    printf("unconfirmed image rolled back\n");
+    factory();
+
+    CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+    for (uint8_t i = 0; i < BOOT_TRIAL_ATTEMPTS; i++) {
+        CHECK(boot() == BOOT_RUN_TRIAL);
+        CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+    }
+
+    CHECK(boot() == BOOT_RUN_APP);
+    CHECK(state() == BOOT_STATE_CONFIRMED);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, BOOT_SLOT_SIZE));
+    CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_b, BOOT_SLOT_SIZE));
+}
+
+static void test_corrupted(void) {
+    printf("corrupted images\n");
+    factory();
+
+    /* Wrong CRC from the host */
+    CHECK(!write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE) ^ 1));
+    CHECK(state() == BOOT_STATE_CONFIRMED);
+    CHECK(boot() == BOOT_RUN_APP);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, IMAGE_A_SIZE));
+
+    /* Staging damaged after it was verified */
+    CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+    flash_at(BOOT_STAGING_ADDRESS + 1000)[0] &= 0x0F;
+    CHECK(boot() == BOOT_RUN_APP);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, IMAGE_A_SIZE));
+
+    /* Correct CRC, but no vector table: swapped in and straight back */
+    static uint8_t image_c[BOOT_SLOT_SIZE];
+    memcpy(image_c, image_b, sizeof(image_c));
+    memset(image_c, 0, 8);
+    CHECK(write_update(image_c, IMAGE_B_SIZE, crc_words(image_c, IMAGE_B_SIZE)));
+    CHECK(boot() == BOOT_RUN_APP);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, IMAGE_A_SIZE));
+
+    /* Oversized and misaligned images are refused */
+    CHECK(!boot_update_begin(BOOT_SLOT_SIZE + 4, 0));
+    CHECK(!boot_update_begin(IMAGE_B_SIZE + 2, 0));
+}
+
+/**
+ * @brief The scratch page fails to erase during an install: a few failures
+ * are retried, a lasting one stops the swap with both images intact, and
+ * it resumes once the page erases again.
+ */
+static void test_erase_failure(void) {
+    printf("scratch page erase failures\n");
+    factory();
+
+    CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+    failing_page = BOOT_SCRATCH_ADDRESS;
+    failing_erases = 2;
+    CHECK(boot() == BOOT_RUN_TRIAL);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+    CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_a, BOOT_SLOT_SIZE));
+
+    factory();
+    CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+    failing_erases = UINT32_MAX;
+    CHECK(boot() == BOOT_RUN_NONE);
+    CHECK(state() == BOOT_STATE_SWAPPING);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_a, BOOT_SLOT_SIZE));
+    CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_b, IMAGE_B_SIZE));
+
+    failing_erases = 0;
+    CHECK(boot() == BOOT_RUN_TRIAL);
+    CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+    CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_a, BOOT_SLOT_SIZE));
+}
+
+/**
+ * @brief The state log stops taking writes partway through an install,
+ * then the car is reset with a working log: the swap must resume at the
+ * unlogged step and finish with both images intact.
+ */
+static void test_log_failure(void) {
+    const uint32_t failing_after[] = { 1, 2, 3, 4, 10, 31, 60 };
+
+    printf("state log write failures\n");
+    for (uint8_t i = 0; i < sizeof(failing_after) / sizeof(failing_after[0]); i++) {
+        factory();
+        CHECK(write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE)));
+
+        state_writes_left = failing_after[i];
+        CHECK(boot() == BOOT_RUN_NONE);
+        state_writes_left = UINT32_MAX;
+
+        CHECK(boot() == BOOT_RUN_TRIAL);
+        CHECK(slot_holds(BOOT_APP_ADDRESS, image_b, BOOT_SLOT_SIZE));
+        CHECK(slot_holds(BOOT_STAGING_ADDRESS, image_a, BOOT_SLOT_SIZE));
+    }
+}
+
+/**
+ * @brief Cuts the power after every stride-th flash operation of an install
+ * (or of a rollback), with a second cut halfway through the recovery, and
+ * checks that the bootloader always ends with consistent slots.
+ *
+ * @return Number of cut points tried.
+ */
+static uint32_t test_power_loss(const char *name, bool rollback, uint32_t stride) {
+    static uint8_t start[FLASH_SIZE];
+    uint32_t tried = 0;
+    uint32_t total;
+    bool cut;
+
+    printf("power loss during %s\n", name);
+
+    factory();
+    write_update(image_b, IMAGE_B_SIZE, crc_words(image_b, IMAGE_B_SIZE));
+    if (rollback) {
+        for (uint8_t i = 0; i < BOOT_TRIAL_ATTEMPTS; i++) {
+            boot();
+        }
+    }
+    memcpy(start, flash, sizeof(flash));
+
+    boot_init();
+    operations = 0;
+    boot_run();
+    total = operations;
+
+    const uint8_t *app = rollback ? image_a : image_b;
+    const uint8_t *staging = rollback ? image_b : image_a;
+    boot_run_t expected = rollback ? BOOT_RUN_APP : BOOT_RUN_TRIAL;
+
+    for (uint32_t budget = 1; budget <= total; budget += stride) {
+        memcpy(flash, start, sizeof(flash));
+        boot_with_cut(budget, &cut);
+        if (!cut) {
+            continue;
+        }
+        tried++;
+
+        /* Recovery, itself cut once halfway */
+        uint32_t before = operations;
+        uint8_t snapshot[FLASH_SIZE];
+        memcpy(snapshot, flash, sizeof(flash));
+        boot_init();
+        boot_run();
+        uint32_t recovery = operations - before;
+        memcpy(flash, snapshot, sizeof(flash));
+        boot_with_cut(recovery / 2 + 1, &cut);
+
+        boot_run_t run = boot();
+        bool consistent = run == expected && slot_holds(BOOT_APP_ADDRESS, app, BOOT_SLOT_SIZE) &&
+                          slot_holds(BOOT_STAGING_ADDRESS, staging, BOOT_SLOT_SIZE);
+        if (!consistent) {
+            printf("  FAIL cut after %u of %u operations: run %d, state %d\n", budget, total, run, state());
+            failures++;
+            break;
+        }
+    }
+
+    printf("  %u cut points of %u operations\n", tried, total);
+    return tried;
+}
+
+/** Public functions ---------------------------------------------- */
+bool boot_flash_erase(uint32_t address) {
+    uint8_t *page = flash_at(address & ~(uint32_t)(BOOT_PAGE_SIZE - 1));
+
+    if (power_tick()) {
+        memset(page, 0xFF, BOOT_PAGE_SIZE / 2);
+        longjmp(power_cut, 1);
+    }
+    if (failing_erases != 0 && page == flash_at(failing_page)) {
+        failing_erases--;
+        return false;
+    }
+
+    memset(page, 0xFF, BOOT_PAGE_SIZE);
+    return true;
+}
+
+bool boot_flash_program(uint32_t address, const void *data, uint32_t size) {
+    const uint8_t *source = data;
+    uint8_t *destination = flash_at(address);
+    uint32_t length = size;
+
+    bool cut = power_tick();
+    if (cut) {
+        length = (size / 2) & ~1u;
+    }
+    if (address >= BOOT_STATE_ADDRESS && address < BOOT_STATE_ADDRESS + BOOT_STATE_PAGES * BOOT_PAGE_SIZE &&
+        state_writes_left != UINT32_MAX) {
+        if (state_writes_left == 0) {
+            return false;
+        }
+        state_writes_left--;
+    }
+
+    for (uint32_t i = 0; i < length; i += 2) {
+        if (destination[i] != 0xFF || destination[i + 1] != 0xFF) {
+            return false;
+        }
+        destination[i] = source[i];
+        destination[i + 1] = source[i + 1];
+    }
+
+    if (cut) {
+        longjmp(power_cut, 1);
+    }
+
+    return true;
+}
+
+void boot_flash_read(uint32_t address, void *data, uint32_t size) {
+    memcpy(data, flash_at(address), size);
+}
+
+uint32_t boot_flash_crc(uint32_t address, uint32_t size) {
+    return crc_words(flash_at(address), size);
+}
+
+int main(int argc, char **argv) {
+    uint32_t stride = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:")) != -1) {
+        if (option == 's') {
+            stride = (uint32_t)strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-s stride]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (stride == 0) {
+        stride = 1;
+    }
+
+    make_image(image_a, IMAGE_A_SIZE, 1);
+    make_image(image_b, IMAGE_B_SIZE, 2);
+
+    test_factory();
+    test_confirm();
+    test_rollback();
+    test_corrupted();
+    test_erase_failure();
+    test_log_failure();
+    test_power_loss("install", false, stride);
+    test_power_loss("rollback", true, stride);
+
+    printf("%s, %u failures\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return failures == 0 ? 0 : 1;
+}
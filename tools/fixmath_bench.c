@@ -0,0 +1,175 @@
+/**
+ * @file
+ * @brief Host tool: accuracy and cost of the fixed-point library.
+ *
+ * Every function is swept against its double precision equivalent and the
+ * worst error is reported; a non-zero exit status means a function is out
+ * of its documented bound. The timing loop then compares each function
+ * with the float code it replaces. On a host with an FPU the float side is
+ * hardware assisted, so the ratio understates the gain on the target, where
+ * float goes through the soft-float library.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/fixmath_bench.c core/src/fixmath.c -lm -o fixmath_bench
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "fixmath.h"
+
+/** Definitions --------------------------------------------------- */
+#define BENCH_ITERATIONS    20000000u
+
+#define SIN_MAX_ERROR_LSB   2.5
+#define RECIP_MAX_ERROR     1e-6    /* relative, where the result is not rounded away */
+#define SQRT_MAX_ERROR      3.1e-5  /* relative, 16 significant bits */
+
+/** Variables ----------------------------------------------------- */
+static volatile int32_t sink_fixed;
+static volatile float sink_float;
+static bool failed = false;
+
+/** Internal functions -------------------------------------------- */
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+static void report(const char *name, double error, double bound, const char *unit) {
+    bool pass = error <= bound;
+
+    printf("%-12s worst error %.3g %s (bound %.3g) %s\n", name, error, unit, bound, pass ? "ok" : "FAIL");
+    if (!pass) {
+        failed = true;
+    }
+}
+
+static void check_trig(void) {
+    double worst = 0;
+
+    for (uint32_t n = 0; n < (1u << 20); n++) {
+        q31_t angle = (q31_t)(n << 12);
+        double radians = angle / 2147483648.0 * M_PI;
+        double error_sin = fabs(fix_sin(angle) - sin(radians) * 32768);
+        double error_cos = fabs(fix_cos(angle) - cos(radians) * 32768);
+
+        worst = fmax(worst, fmax(error_sin, error_cos));
+    }
+
+    report("sin/cos", worst, SIN_MAX_ERROR_LSB, "LSB");
+}
+
+static void check_arithmetic(void) {
+    double worst = 0;
+
+    for (int32_t a = INT16_MIN; a <= INT16_MAX; a += 7) {
+        for (int32_t b = INT16_MIN; b <= INT16_MAX; b += 13) {
+            double exact = fmin(fmax(floor(a * (double)b / 32768 + 0.5), INT16_MIN), INT16_MAX);
+            worst = fmax(worst, fabs(q15_mul((q15_t)a, (q15_t)b) - exact));
+
+            exact = fmin(fmax(a + b, INT16_MIN), INT16_MAX);
+            worst = fmax(worst, fabs(q15_add((q15_t)a, (q15_t)b) - exact));
+        }
+    }
+
+    /* Dot product of two full scale vectors through the accumulator */
+    int64_t accumulator = 0;
+    double exact = 0;
+    for (int32_t n = 0; n < 64; n++) {
+        q15_t a = (q15_t)(n * 511 - 16000);
+        q15_t b = (q15_t)(12000 - n * 301);
+        accumulator = q15_mac(accumulator, a, b);
+        exact += a * (double)b / 32768;
+    }
+    exact = fmin(fmax(floor(exact + 0.5), INT16_MIN), INT16_MAX);
+    worst = fmax(worst, fabs(q15_from_acc(accumulator) - exact));
+
+    worst = fmax(worst, fabs(q31_mul(INT32_MIN, INT32_MIN) - (double)INT32_MAX));
+    worst = fmax(worst, fabs(q31_add(INT32_MAX, 1) - (double)INT32_MAX));
+    worst = fmax(worst, fabs(fix_sat_u16(-5) - 0.0) + fabs(fix_sat_u16(70000) - 65535.0));
+
+    report("q15/q31 ops", worst, 0, "LSB");
+}
+
+static void check_recip(void) {
+    double worst = 0;
+
+    for (uint32_t n = 2; n < (1u << 31) - 100000; n += 4099) {
+        q16_t value = (q16_t)n;
+        double exact = 65536.0 * 65536.0 / n;
+        double result = fix_recip(value);
+        double negative = fix_recip(-value);
+
+        /* The result is rounded to 2^-16, which dominates for large inputs */
+        double error = fabs(result - exact) / fmax(exact, 1 / RECIP_MAX_ERROR);
+        worst = fmax(worst, error);
+        worst = fmax(worst, fabs(negative + result) / fmax(exact, 1));
+    }
+
+    report("recip", worst, RECIP_MAX_ERROR, "relative");
+}
+
+static void check_sqrt(void) {
+    double worst = 0;
+
+    for (uint32_t n = 1; n < (1u << 31) - 100000; n += 997) {
+        double exact = sqrt(n * 65536.0);
+        double error = fabs(fix_sqrt((q16_t)n) - exact) / fmax(exact, 1 / SQRT_MAX_ERROR);
+        worst = fmax(worst, error);
+    }
+
+    for (uint32_t n = 0; n < 100000; n++) {
+        uint32_t value = n * 42949u;
+        uint32_t root = fix_isqrt(value);
+        if ((uint64_t)root * root > value || (uint64_t)(root + 1) * (root + 1) <= value) {
+            worst = 1;
+        }
+    }
+
+    report("sqrt", worst, SQRT_MAX_ERROR, "relative");
+}
+
+#define BENCH(label, body)                                               \
+    do {                                                                 \
+        struct timespec start, end;                                      \
+        clock_gettime(CLOCK_MONOTONIC, &start);                          \
+        for (uint32_t n = 0; n < BENCH_ITERATIONS; n++) {                \
+            body;                                                        \
+        }                                                                \
+        clock_gettime(CLOCK_MONOTONIC, &end);                            \
+        printf("  %-22s %6.2f ns\n", label, elapsed_ns(&start, &end) / BENCH_ITERATIONS); \
+    } while (0)
+
+static void benchmark(void) {
+    printf("cost per call on this host:\n");
+
+    BENCH("fix_sin", sink_fixed = fix_sin((q31_t)(n * 2654435761u)));
+    BENCH("sinf", sink_float = sinf((float)n * 1e-6f));
+
+    BENCH("q15_mul + q15_add", sink_fixed = q15_add(q15_mul((q15_t)n, (q15_t)(n >> 3)), (q15_t)sink_fixed));
+    BENCH("float mul + add + clamp",
+          sink_float = fminf(fmaxf((float)(int16_t)n * (float)(int16_t)(n >> 3) * (1.0f / 32768) + sink_float,
+                                   -1.0f), 1.0f));
+
+    BENCH("fix_recip", sink_fixed = fix_recip((q16_t)(n | 1)));
+    BENCH("1.0f / x", sink_float = 1.0f / (float)(n | 1));
+
+    BENCH("fix_sqrt", sink_fixed = fix_sqrt((q16_t)n));
+    BENCH("sqrtf", sink_float = sqrtf((float)n));
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    check_trig();
+    check_arithmetic();
+    check_recip();
+    check_sqrt();
+
+    if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'b') {
+        benchmark();
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief Host tool: sends a firmware image to the car over the console UART.
+ *
+ * The image is a raw binary of an application built with BOOT_DUAL_SLOT=1
+ * and linked for the application slot (STM32F103C8TX_SLOT.ld):
+ *     arm-none-eabi-objcopy -O binary app.elf app.bin
+ * It is padded to a multiple of 4 bytes, announced with its size and CRC,
+ * then streamed in one go once the car has erased its staging slot. The car
+ * verifies the CRC, answers and resets into the bootloader, which installs
+ * the image and runs it on trial until it confirms itself.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/flash_update.c -o flash_update
+ *
+ * Usage: flash_update -d /dev/ttyUSB0 app.bin
+ */
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "boot_control.h"
+#include "update.h"
+
+/** Definitions --------------------------------------------------- */
+#define CRC_POLYNOMIAL      0x04C11DB7
+#define UPDATE_REQUEST      'U'
+
+/** Erasing the whole staging slot takes about 0.6 s. */
+#define ERASE_TIMEOUT_MS    3000
+#define VERIFY_TIMEOUT_MS   3000
+
+/** Internal functions -------------------------------------------- */
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void set_raw(int fd) {
+    struct termios options;
+
+    if (tcgetattr(fd, &options) == 0) {
+        cfmakeraw(&options);
+        cfsetispeed(&options, B115200);
+        cfsetospeed(&options, B115200);
+        tcsetattr(fd, TCSANOW, &options);
+    }
+}
+
+/**
+ * @brief Software equivalent of the STM32 CRC unit, over whole words.
+ */
+static uint32_t crc_words(const uint8_t *data, uint32_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t offset = 0; offset < size; offset += 4) {
+        uint32_t word;
+
+        memcpy(&word, &data[offset], 4);
+        crc ^= word;
+        for (uint8_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CRC_POLYNOMIAL : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Waits for the car's answer, skipping anything else it sends.
+ *
+ * @return true on UPDATE_ACK.
+ */
+static bool wait_reply(int fd, int timeout_ms) {
+    double deadline = now_seconds() + timeout_ms / 1000.0;
+    struct pollfd poll_fd = { .fd = fd, .events = POLLIN };
+
+    while (now_seconds() < deadline) {
+        uint8_t byte;
+
+        if (poll(&poll_fd, 1, (int)((deadline - now_seconds()) * 1000) + 1) <= 0) {
+            break;
+        }
+        if (read(fd, &byte, 1) != 1) {
+            break;
+        }
+        if (byte == UPDATE_ACK) {
+            return true;
+        }
+        if (byte == UPDATE_NACK) {
+            return false;
+        }
+    }
+
+    fprintf(stderr, "no answer\n");
+    return false;
+}
+
+static bool write_all(int fd, const void *data, size_t size) {
+    const uint8_t *bytes = data;
+
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            perror("write");
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+
+    return true;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char **argv) {
+    const char *device = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:")) != -1) {
+        if (option == 'd') {
+            device = optarg;
+        } else {
+            break;
+        }
+    }
+    if (device == NULL || optind != argc - 1) {
+        fprintf(stderr, "usage: %s -d device image.bin\n", argv[0]);
+        return 2;
+    }
+
+    static uint8_t image[BOOT_SLOT_SIZE + 4];
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror(argv[optind]);
+        return 2;
+    }
+    size_t size = fread(image, 1, sizeof(image), file);
+    fclose(file);
+
+    if (size == 0 || size > BOOT_SLOT_SIZE) {
+        fprintf(stderr, "image must be 1 to %u bytes, is %zu\n", BOOT_SLOT_SIZE, size);
+        return 2;
+    }
+    while ((size & 3) != 0) {
+        image[size++] = 0xFF;
+    }
+
+    int fd = open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(device);
+        return 2;
+    }
+    set_raw(fd);
+    tcflush(fd, TCIFLUSH);
+
+    uint8_t request = UPDATE_REQUEST;
+    update_header_t header = { .magic = UPDATE_MAGIC, .size = (uint32_t)size, .crc = crc_words(image, size) };
+    printf("%zu bytes, crc %08x\n", size, header.crc);
+
+    if (!write_all(fd, &request, 1) || !write_all(fd, &header, sizeof(header)) || !wait_reply(fd, ERASE_TIMEOUT_MS)) {
+        fprintf(stderr, "update refused\n");
+        return 1;
+    }
+
+    double start = now_seconds();
+    if (!write_all(fd, image, size)) {
+        return 1;
+    }
+    tcdrain(fd);
+
+    if (!wait_reply(fd, VERIFY_TIMEOUT_MS)) {
+        fprintf(stderr, "image rejected\n");
+        return 1;
+    }
+
+    double elapsed = now_seconds() - start;
+    printf("sent in %.2f s (%.0f bytes/s), car is restarting\n", elapsed, size / elapsed);
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,388 @@
+/**
+ * @file
+ * @brief Host tool: runs the gyro bus state machine and the heading hold
+ * against a simulated MPU6050 and car.
+ *
+ * The sensor stand-in implements the bus hooks of imu.h: transfers end a
+ * bus time later, a device reset leaves it deaf (NACK) for a while, it
+ * wakes up asleep with zero outputs, and the gyro reading follows the full
+ * scale written to it. Faults can be injected: random NACKs, a transfer
+ * that never ends (a stuck bus, only cleared by a recovery) and a device
+ * answering the wrong identity.
+ *
+ * Bus scenarios check that the configuration written is the expected one,
+ * that no transfer ever starts while another is running, how long the first
+ * sample takes and that the driver recovers from each fault.
+ *
+ * Loop scenarios drive straight at DRIVE_PWM_DUTY with the right motor
+ * weaker than the left and a gyro bias, after a rest for the bias to be
+ * learnt. The car follows the setpoint with a first-order lag; the heading
+ * and the sideways drift after DRIVE_US (about 2.8 m) are reported with
+ * and without the hold.
+ *
+ * Usage: imu_sim [-m mismatch_percent] [-b bias_dps] [-n noise_lsb]
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/imu_sim.c core/src/imu.c core/src/heading.c core/src/param.c -lm -o imu_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "heading.h"
+#include "imu.h"
+
+/** Definitions --------------------------------------------------- */
+#define STEP_US             1000    /* PWM timer update, the tick source */
+#define TICK_STEPS          (1000000 / STEP_US / IMU_RATE_HZ)
+#define CONTROL_STEPS       10
+#define RESET_DEAF_US       30000
+#define FULL_SPEED_MM_S     1000.0
+#define MOTOR_TAU_S         0.1
+#define TRACK_MM            130.0
+#define PI                  3.14159265358979
+#define REST_US             2000000
+#define DRIVE_US            4000000
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    double nack_probability;
+    uint64_t hang_at_us;        /**< First transfer started after this never ends, 0 for none */
+    uint8_t who_am_i;
+} fault_t;
+
+typedef struct {
+    uint8_t registers[128];
+    uint64_t deaf_until_us;
+    bool pending;
+    bool hung;
+    bool write;
+    uint8_t reg;
+    uint8_t value;
+    uint8_t *data;
+    uint8_t size;
+    uint32_t transfers;
+    uint32_t overlaps;          /**< Transfers started while one was running */
+    uint32_t recoveries;
+} sensor_t;
+
+typedef struct {
+    double left_mm_s;
+    double right_mm_s;
+    double heading_rad;
+    double x_mm;
+    double y_mm;
+} car_t;
+
+/** Variables ----------------------------------------------------- */
+static sensor_t sensor;
+static fault_t fault;
+static uint64_t now_us = 0;
+static double gyro_dps = 0.0;
+static double bias_dps = 0.0;
+static double noise_lsb = 2.0;
+static int failures = 0;
+
+/** Internal functions -------------------------------------------- */
+static double noise(double amplitude) {
+    return amplitude * (2.0 * rand() / RAND_MAX - 1.0);
+}
+
+static void sensor_reset(void) {
+    memset(sensor.registers, 0, sizeof(sensor.registers));
+    sensor.registers[IMU_REG_PWR_MGMT_1] = 0x40;   /* Asleep */
+    sensor.registers[IMU_REG_WHO_AM_I] = fault.who_am_i;
+}
+
+/**
+ * @brief Gyro z output as the device would latch it now.
+ */
+static int16_t sensor_gyro(void) {
+    if ((sensor.registers[IMU_REG_PWR_MGMT_1] & 0x40) != 0) {
+        return 0;
+    }
+
+    double lsb_per_dps = IMU_GYRO_LSB_PER_DPS / (double)(1 << ((sensor.registers[IMU_REG_GYRO_CONFIG] >> 3) & 3));
+    double value = (gyro_dps + bias_dps) * lsb_per_dps + noise(noise_lsb);
+
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : lround(value));
+}
+
+/**
+ * @brief Ends the running transfer, as the I2C and DMA interrupts would.
+ */
+static void sensor_complete(void) {
+    if (!sensor.pending || sensor.hung) {
+        return;
+    }
+    sensor.pending = false;
+
+    if (now_us < sensor.deaf_until_us || rand() < fault.nack_probability * RAND_MAX) {
+        imu_bus_done(false);
+        return;
+    }
+
+    if (sensor.write) {
+        if (sensor.reg == IMU_REG_PWR_MGMT_1 && (sensor.value & IMU_PWR_DEVICE_RESET) != 0) {
+            sensor_reset();
+            sensor.deaf_until_us = now_us + RESET_DEAF_US;
+        } else {
+            sensor.registers[sensor.reg] = sensor.value;
+        }
+    } else {
+        int16_t gyro = sensor_gyro();
+        for (uint8_t i = 0; i < sensor.size; i++) {
+            uint8_t reg = (uint8_t)(sensor.reg + i);
+            if (reg == IMU_REG_GYRO_ZOUT_H) {
+                sensor.data[i] = (uint8_t)((uint16_t)gyro >> 8);
+            } else if (reg == IMU_REG_GYRO_ZOUT_H + 1) {
+                sensor.data[i] = (uint8_t)gyro;
+            } else {
+                sensor.data[i] = sensor.registers[reg & 0x7F];
+            }
+        }
+    }
+
+    imu_bus_done(true);
+}
+
+static bool sensor_start(bool write, uint8_t reg, uint8_t value, uint8_t *data, uint8_t size) {
+    if (sensor.pending) {
+        sensor.overlaps++;
+        return false;
+    }
+
+    sensor.pending = true;
+    sensor.write = write;
+    sensor.reg = reg;
+    sensor.value = value;
+    sensor.data = data;
+    sensor.size = size;
+    sensor.transfers++;
+
+    if (fault.hang_at_us != 0 && now_us >= fault.hang_at_us) {
+        sensor.hung = true;
+        fault.hang_at_us = 0;
+    }
+    return true;
+}
+
+/** Platform hooks ------------------------------------------------ */
+void imu_bus_setup(void) {
+}
+
+void imu_bus_retime(void) {
+}
+
+bool imu_bus_write(uint8_t reg, uint8_t value) {
+    return sensor_start(true, reg, value, NULL, 0);
+}
+
+bool imu_bus_read(uint8_t reg, uint8_t *data, uint8_t size) {
+    return sensor_start(false, reg, 0, data, size);
+}
+
+void imu_bus_recover(void) {
+    sensor.pending = false;
+    sensor.hung = false;
+    sensor.recoveries++;
+}
+
+/** Scenarios ----------------------------------------------------- */
+static void start(const fault_t *faults) {
+    memset(&sensor, 0, sizeof(sensor));
+    fault = *faults;
+    sensor_reset();
+    now_us = 0;
+    gyro_dps = 0.0;
+    imu_init();
+    heading_init();
+}
+
+/**
+ * @brief Runs the bus alone for a while.
+ *
+ * @return Ticks that delivered a sample.
+ */
+static uint32_t run_bus(uint32_t duration_ms, uint64_t *first_us) {
+    uint32_t samples = 0;
+
+    for (uint32_t step = 0; step < duration_ms * 1000 / STEP_US; step++) {
+        int16_t rate;
+
+        if (step % TICK_STEPS == 0 && imu_tick(&rate)) {
+            if (samples == 0 && first_us != NULL) {
+                *first_us = now_us;
+            }
+            samples++;
+        }
+        now_us += STEP_US / 2;
+        sensor_complete();
+        now_us += STEP_US / 2;
+    }
+
+    return samples;
+}
+
+static void scenario_bus(void) {
+    imu_stats_t stats;
+    uint64_t first_us = 0;
+    uint32_t samples;
+
+    printf("bus:\n");
+
+    start(&(fault_t){ 0.0, 0, IMU_WHO_AM_I_VALUE });
+    samples = run_bus(1000, &first_us);
+    imu_get_stats(&stats);
+    printf("  clean         %4u samples/s, first after %llu ms, %u transfers\n", samples,
+           (unsigned long long)first_us / 1000, sensor.transfers);
+    CHECK(stats.state == IMU_STATE_RUN && stats.errors == 0 && stats.resets == 0);
+    CHECK(samples >= IMU_RATE_HZ - (first_us / 1000 * IMU_RATE_HZ / 1000) - 1);
+    CHECK(sensor.registers[IMU_REG_PWR_MGMT_1] == IMU_PWR_CLOCK_PLL_X);
+    CHECK(sensor.registers[IMU_REG_SMPLRT_DIV] == 0);
+    CHECK(sensor.registers[IMU_REG_CONFIG] == IMU_CONFIG_DLPF_44HZ);
+    CHECK(sensor.registers[IMU_REG_GYRO_CONFIG] == IMU_GYRO_FS_250DPS);
+    CHECK(sensor.overlaps == 0);
+
+    start(&(fault_t){ 0.05, 0, IMU_WHO_AM_I_VALUE });
+    samples = run_bus(10000, NULL);
+    imu_get_stats(&stats);
+    printf("  5%% nack       %4u samples/s, %u errors, %u resets\n", samples / 10, stats.errors, stats.resets);
+    CHECK(stats.state == IMU_STATE_RUN && samples > 9 * IMU_RATE_HZ * 9 / 10);
+    CHECK(sensor.overlaps == 0);
+
+    start(&(fault_t){ 0.0, 500000, IMU_WHO_AM_I_VALUE });
+    samples = run_bus(2000, NULL);
+    imu_get_stats(&stats);
+    printf("  stuck bus     %4u samples/2s, %u timeouts, %u recoveries\n", samples, stats.timeouts,
+           sensor.recoveries);
+    CHECK(stats.timeouts == 1 && sensor.recoveries == 1 && stats.state == IMU_STATE_RUN);
+    CHECK(sensor.overlaps == 0);
+
+    start(&(fault_t){ 0.0, 0, 0x70 });
+    samples = run_bus(1000, NULL);
+    imu_get_stats(&stats);
+    printf("  wrong device  %4u samples/s, %u errors, %u resets\n", samples, stats.errors, stats.resets);
+    CHECK(samples == 0 && stats.resets > 0);
+}
+
+/**
+ * @brief Rests for REST_US, then drives straight for DRIVE_US.
+ */
+static void run_car(bool hold, double mismatch, car_t *car) {
+    const fault_t faults = { 0.0, 0, IMU_WHO_AM_I_VALUE };
+    const double dt = STEP_US * 1e-6;
+    const double alpha = dt / MOTOR_TAU_S;
+    drive_setpoint_t setpoint = { 0, 0, BUZZER_NOTE_ST };
+
+    start(&faults);
+    memset(car, 0, sizeof(*car));
+
+    for (uint32_t step = 0; now_us < REST_US + DRIVE_US; step++) {
+        int16_t rate;
+
+        if (step % TICK_STEPS == 0) {
+            if (imu_tick(&rate)) {
+                heading_update(rate);
+            } else {
+                heading_lost();
+            }
+        }
+
+        if (step % CONTROL_STEPS == 0) {
+            int16_t effort = now_us < REST_US ? 0 : DRIVE_PWM_DUTY;
+            setpoint = (drive_setpoint_t){ effort, effort, BUZZER_NOTE_ST };
+            if (hold) {
+                heading_hold(&setpoint);
+            }
+        }
+
+        car->left_mm_s += alpha * (setpoint.left * FULL_SPEED_MM_S / DRIVE_EFFORT_MAX - car->left_mm_s);
+        car->right_mm_s += alpha * (setpoint.right * FULL_SPEED_MM_S / DRIVE_EFFORT_MAX * (1.0 - mismatch)
+                                    - car->right_mm_s);
+
+        double yaw = (car->right_mm_s - car->left_mm_s) / TRACK_MM;
+        double speed = (car->left_mm_s + car->right_mm_s) / 2.0;
+        car->heading_rad += yaw * dt;
+        car->x_mm += speed * cos(car->heading_rad) * dt;
+        car->y_mm += speed * sin(car->heading_rad) * dt;
+        gyro_dps = yaw * 180.0 / PI;
+
+        now_us += STEP_US / 2;
+        sensor_complete();
+        now_us += STEP_US / 2;
+    }
+}
+
+static void scenario_loop(double mismatch) {
+    car_t open;
+    car_t held;
+    heading_state_t state;
+
+    printf("loop, right motor %.0f%% weaker, bias %.2f deg/s:\n", mismatch * 100.0, bias_dps);
+
+    run_car(false, mismatch, &open);
+    run_car(true, mismatch, &held);
+    heading_get(&state);
+
+    double gyro_heading = state.heading * 180.0 / 2147483648.0;
+    double bias = state.bias_q8 / 256.0 / IMU_GYRO_LSB_PER_DPS;
+
+    printf("  open    heading %7.2f deg, drift %7.1f mm\n", open.heading_rad * 180.0 / PI, open.y_mm);
+    printf("  held    heading %7.2f deg, drift %7.1f mm, trim %d, gyro heading %.2f deg, bias %.2f deg/s\n",
+           held.heading_rad * 180.0 / PI, held.y_mm, state.trim, gyro_heading, bias);
+
+    CHECK(fabs(held.heading_rad * 180.0 / PI) < 2.0);
+    CHECK(fabs(held.y_mm) < 50.0);
+    CHECK(fabs(bias - bias_dps) < 0.1);
+    CHECK(mismatch == 0.0 || fabs(held.y_mm) < fabs(open.y_mm) / 5.0);
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char **argv) {
+    double mismatch = 0.10;
+    int option;
+
+    bias_dps = 0.8;
+    while ((option = getopt(argc, argv, "m:b:n:")) != -1) {
+        switch (option) {
+            case 'm': {
+                mismatch = atof(optarg) / 100.0;
+                break;
+            }
+            case 'b': {
+                bias_dps = atof(optarg);
+                break;
+            }
+            case 'n': {
+                noise_lsb = atof(optarg);
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s [-m mismatch_percent] [-b bias_dps] [-n noise_lsb]\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    scenario_bus();
+    scenario_loop(0.0);
+    scenario_loop(mismatch);
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
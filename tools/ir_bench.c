@@ -0,0 +1,650 @@
+/**
+ * @file
+ * @brief Host tool: throughput benchmark and robustness check of the NEC
+ * decoder.
+ *
+ * Modes:
+ *   -n frames      Generates valid frames (with timing jitter), decodes them
+ *                  and reports frames/s and ns per edge, for the baseline
+ *                  decoder (no glitch filter, no address filter, as first
+ *                  added) and for the configuration the car runs.
+ *   -r file        Decodes a recording in LIRC mode2 format
+ *                  ("pulse <us>" / "space <us>" lines).
+ *   -f iterations  Feeds random, truncated and corrupted pulse trains and
+ *                  flags any decoded key that is not in the keymap, or any
+ *                  frame that decodes from a corrupted train with a
+ *                  different command.
+ *   -g percent     Adds glitches to that percentage of the pulses of
+ *                  generated frames, plus noise bursts between frames, and
+ *                  reports the decode success rate with the glitch filter
+ *                  disabled and enabled.
+ *   -a remotes     Simulates a room with that many foreign remotes next to
+ *                  the car's own, group and broadcast ones, each press
+ *                  followed by repeat codes. Checks that exactly the frames
+ *                  and repeats addressed to the car come out, and reports
+ *                  the edges the decoder still sees when the receiver is
+ *                  muted for IR_NEC_SKIP_US after a foreign address.
+ *   -s seed        Random seed (default 1).
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         tools/ir_bench.c core/src/ir_nec.c -o ir_bench
+ *
+ * With IR_BENCH_FUZZER defined, the tool is a libFuzzer target instead
+ * (see LLVMFuzzerTestOneInput()):
+ *     clang -O1 -g -fsanitize=fuzzer,address,undefined -DIR_BENCH_FUZZER \
+ *         -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         tools/ir_bench.c core/src/ir_nec.c -o ir_fuzz
+ *     ./ir_fuzz -timeout=1
+ * Crashes and sanitizer reports are found by the sanitizers, hangs by the
+ * timeout; out-of-range keys, digits and addresses abort().
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ir_nec.h"
+
+/** Definitions --------------------------------------------------- */
+#define EDGES_PER_FRAME     (2 + 2 * IR_NEC_FRAME_BITS + 2)
+#define JITTER_PERCENT      10
+#define FRAME_GAP_US        40000
+#define GLITCH_MAX_US       120
+#define NOISE_BURST_PULSES  6
+#define ROOM_PRESSES        20000
+#define ROOM_REPEATS_MAX    3
+#define ROOM_UNIT           0x10
+#define ROOM_GROUP          0x80
+#define FUZZ_HEADER_SIZE    3
+#define FUZZ_MARK_BIT       0x8000
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    bool mark;
+    uint32_t duration_us;
+} edge_t;
+
+typedef struct {
+    edge_t *edges;
+    size_t count;
+    size_t capacity;
+} edge_list_t;
+
+/** Variables ----------------------------------------------------- */
+static const uint8_t commands[] = { 0x18, 0x52, 0x08, 0x5A, 0x1C, 0x45, 0x46 };
+
+/** Internal functions -------------------------------------------- */
+static void edge_push(edge_list_t *list, bool mark, uint32_t duration_us) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity == 0 ? 1024 : list->capacity * 2;
+        list->edges = realloc(list->edges, list->capacity * sizeof(edge_t));
+    }
+
+    list->edges[list->count].mark = mark;
+    list->edges[list->count].duration_us = duration_us;
+    list->count++;
+}
+
+static uint32_t jitter(uint32_t nominal_us) {
+    int32_t range = (int32_t)(nominal_us * JITTER_PERCENT / 100);
+    return (uint32_t)((int32_t)nominal_us + rand() % (2 * range + 1) - range);
+}
+
+/**
+ * @brief Appends one NEC frame with jittered timing.
+ */
+static void encode_frame(edge_list_t *list, uint8_t address, uint8_t command) {
+    uint32_t data = address | ((uint32_t)(uint8_t)~address << 8) | ((uint32_t)command << 16)
+                    | ((uint32_t)(uint8_t)~command << 24);
+
+    edge_push(list, true, jitter(IR_NEC_LEADER_MARK_US));
+    edge_push(list, false, jitter(IR_NEC_LEADER_SPACE_US));
+    for (uint8_t bit = 0; bit < IR_NEC_FRAME_BITS; bit++) {
+        edge_push(list, true, jitter(IR_NEC_BIT_MARK_US));
+        edge_push(list, false, jitter((data >> bit) & 1 ? IR_NEC_ONE_SPACE_US : IR_NEC_ZERO_SPACE_US));
+    }
+    edge_push(list, true, jitter(IR_NEC_BIT_MARK_US));
+    edge_push(list, false, FRAME_GAP_US);
+}
+
+/**
+ * @brief Appends one repeat code with jittered timing.
+ */
+static void encode_repeat(edge_list_t *list) {
+    edge_push(list, true, jitter(IR_NEC_LEADER_MARK_US));
+    edge_push(list, false, jitter(IR_NEC_REPEAT_SPACE_US));
+    edge_push(list, true, jitter(IR_NEC_BIT_MARK_US));
+    edge_push(list, false, FRAME_GAP_US);
+}
+
+/**
+ * @brief Copies a pulse train, splitting some pulses with short glitches of
+ * the opposite level and adding noise bursts in the frame gaps.
+ */
+static void add_noise(const edge_list_t *clean, edge_list_t *noisy, uint32_t percent) {
+    for (size_t i = 0; i < clean->count; i++) {
+        const edge_t *edge = &clean->edges[i];
+
+        if (edge->duration_us == FRAME_GAP_US) {
+            uint32_t quiet = FRAME_GAP_US / 2;
+            edge_push(noisy, false, quiet);
+            for (uint8_t n = 0; n < NOISE_BURST_PULSES; n++) {
+                edge_push(noisy, true, 10 + rand() % 800);
+                edge_push(noisy, false, 10 + rand() % 800);
+            }
+            edge_push(noisy, false, quiet);
+            continue;
+        }
+
+        if ((uint32_t)(rand() % 100) >= percent) {
+            edge_push(noisy, edge->mark, edge->duration_us);
+            continue;
+        }
+
+        uint32_t glitch = 10 + rand() % (GLITCH_MAX_US - 10);
+        uint32_t before = rand() % (edge->duration_us - glitch / 2);
+        uint32_t after = edge->duration_us - glitch / 2 - before;
+        edge_push(noisy, edge->mark, before);
+        edge_push(noisy, !edge->mark, glitch);
+        edge_push(noisy, edge->mark, after);
+    }
+}
+
+/**
+ * @brief Decodes a pulse train and counts frames matching the sent commands.
+ */
+static uint32_t count_matches(const edge_list_t *list, const ir_nec_config_t *config, const uint8_t *expected,
+                              uint32_t frames, ir_nec_stats_t *stats) {
+    ir_nec_t decoder;
+    ir_nec_init(&decoder, config);
+
+    uint32_t matches = 0;
+    uint32_t next = 0;
+
+    for (size_t i = 0; i < list->count; i++) {
+        if (ir_nec_feed(&decoder, list->edges[i].mark, list->edges[i].duration_us) == IR_NEC_EVENT_FRAME) {
+            /* A lost frame shifts the sequence, resynchronise on the command */
+            while (next < frames && expected[next] != decoder.command) {
+                next++;
+            }
+            if (next < frames) {
+                matches++;
+                next++;
+            }
+        }
+    }
+
+    *stats = decoder.stats;
+    return matches;
+}
+
+/**
+ * @brief Reports the decode success rate under simulated noise.
+ */
+static int run_noise(uint32_t frames, uint32_t percent) {
+    edge_list_t clean = { 0 };
+    edge_list_t noisy = { 0 };
+    uint8_t *expected = malloc(frames);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        expected[i] = commands[rand() % sizeof(commands)];
+        encode_frame(&clean, 0x00, expected[i]);
+    }
+    add_noise(&clean, &noisy, percent);
+
+    ir_nec_config_t unfiltered = { .glitch_us = 0, .tolerance_percent = IR_NEC_DEFAULT_TOLERANCE_PERCENT };
+    ir_nec_config_t filtered = { .glitch_us = IR_NEC_DEFAULT_GLITCH_US,
+                                 .tolerance_percent = IR_NEC_DEFAULT_TOLERANCE_PERCENT };
+    const ir_nec_config_t *configs[] = { &unfiltered, &filtered };
+
+    printf("noise: %u frames, %u%% of pulses glitched\n", frames, percent);
+    for (uint8_t i = 0; i < 2; i++) {
+        ir_nec_stats_t stats;
+        uint32_t matches = count_matches(&noisy, configs[i], expected, frames, &stats);
+
+        printf("  glitch filter %3u us: %6.2f%% decoded, accepted %u, timing %u, inverse %u, glitches %u\n",
+               configs[i]->glitch_us, 100.0 * matches / frames, stats.accepted, stats.rejected_timing,
+               stats.rejected_inverse, stats.glitches);
+    }
+
+    free(expected);
+    free(clean.edges);
+    free(noisy.edges);
+    return 0;
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/**
+ * @brief Decodes generated frames with the baseline decoder and with the
+ * car's configuration, and reports throughput.
+ */
+static int run_generated(uint32_t frames) {
+    edge_list_t list = { 0 };
+    uint8_t *expected = malloc(frames);
+
+    for (uint32_t i = 0; i < frames; i++) {
+        expected[i] = commands[rand() % sizeof(commands)];
+        encode_frame(&list, 0x00, expected[i]);
+    }
+
+    const uint8_t addresses[] = { 0x00, ROOM_GROUP, IR_NEC_BROADCAST_ADDRESS };
+    ir_nec_config_t baseline = { .glitch_us = 0, .tolerance_percent = IR_NEC_DEFAULT_TOLERANCE_PERCENT };
+    int result = 0;
+
+    printf("generated: %u frames\n", frames);
+    for (uint8_t car = 0; car < 2; car++) {
+        ir_nec_t decoder;
+        ir_nec_init(&decoder, car ? NULL : &baseline);
+        if (car) {
+            ir_nec_set_addresses(&decoder, addresses, sizeof(addresses));
+        }
+
+        uint32_t decoded = 0;
+        uint32_t wrong = 0;
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t i = 0; i < list.count; i++) {
+            if (ir_nec_feed(&decoder, list.edges[i].mark, list.edges[i].duration_us) == IR_NEC_EVENT_FRAME) {
+                if (decoded < frames && decoder.command != expected[decoded]) {
+                    wrong++;
+                }
+                decoded++;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = elapsed_ns(&start, &end);
+        printf("  %-9s %u decoded, %u wrong, %.0f frames/s, %.2f ns per edge\n", car ? "car:" : "baseline:",
+               decoded, wrong, decoded * 1e9 / ns, ns / list.count);
+
+        if (decoded != frames || wrong != 0) {
+            result = 1;
+        }
+    }
+
+    free(expected);
+    free(list.edges);
+    return result;
+}
+
+/**
+ * @brief Decodes the traffic of a room full of remotes with the address
+ * filter of one car, optionally muting the input after foreign addresses
+ * like the receiver does.
+ *
+ * @return Edges fed to the decoder.
+ */
+static size_t room_decode(const edge_list_t *list, bool mute, const uint8_t *expected, uint32_t frames,
+                          uint32_t *decoded, uint32_t *wrong, uint32_t *repeats, double *ns) {
+    const uint8_t addresses[] = { ROOM_UNIT, ROOM_GROUP, IR_NEC_BROADCAST_ADDRESS };
+    ir_nec_t decoder;
+    ir_nec_init(&decoder, NULL);
+    ir_nec_set_addresses(&decoder, addresses, sizeof(addresses));
+
+    size_t fed = 0;
+    uint32_t muted_us = 0;
+    struct timespec start, end;
+
+    *decoded = 0;
+    *wrong = 0;
+    *repeats = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t i = 0; i < list->count; i++) {
+        uint32_t duration_us = list->edges[i].duration_us;
+
+        /* Edges while masked are lost; the first one after unmasking is
+         * measured from the unmask time */
+        if (muted_us > 0) {
+            if (duration_us <= muted_us) {
+                muted_us -= duration_us;
+                continue;
+            }
+            duration_us -= muted_us;
+            muted_us = 0;
+        }
+
+        fed++;
+        ir_nec_event_t event = ir_nec_feed(&decoder, list->edges[i].mark, duration_us);
+
+        if (event == IR_NEC_EVENT_FRAME) {
+            if (*decoded >= frames || decoder.command != expected[*decoded]) {
+                (*wrong)++;
+            }
+            (*decoded)++;
+        } else if (event == IR_NEC_EVENT_REPEAT) {
+            (*repeats)++;
+        } else if (event == IR_NEC_EVENT_FOREIGN && mute) {
+            muted_us = IR_NEC_SKIP_US;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    *ns = elapsed_ns(&start, &end);
+    return fed;
+}
+
+/**
+ * @brief Checks address filtering on the traffic of several remotes.
+ */
+static int run_room(uint32_t remotes) {
+    edge_list_t list = { 0 };
+    uint8_t *expected = malloc(ROOM_PRESSES);
+    uint32_t frames = 0;
+    uint32_t own_repeats = 0;
+    uint32_t foreign_frames = 0;
+
+    for (uint32_t n = 0; n < ROOM_PRESSES; n++) {
+        /* Own, group and broadcast remotes, then the foreign ones */
+        uint32_t remote = (uint32_t)rand() % (remotes + 3);
+        uint8_t address = remote == 0 ? ROOM_UNIT : remote == 1 ? ROOM_GROUP :
+                          remote == 2 ? IR_NEC_BROADCAST_ADDRESS : (uint8_t)(ROOM_UNIT + remote - 2);
+        uint8_t command = commands[rand() % sizeof(commands)];
+        uint32_t count = (uint32_t)rand() % (ROOM_REPEATS_MAX + 1);
+
+        encode_frame(&list, address, command);
+        for (uint32_t r = 0; r < count; r++) {
+            encode_repeat(&list);
+        }
+
+        if (remote < 3) {
+            expected[frames++] = command;
+            own_repeats += count;
+        } else {
+            foreign_frames++;
+        }
+    }
+
+    printf("room: %u presses, %u for this car, %u from %u foreign remotes\n", ROOM_PRESSES, frames,
+           foreign_frames, remotes);
+
+    int result = 0;
+    for (uint8_t mute = 0; mute < 2; mute++) {
+        uint32_t decoded, wrong, repeats;
+        double ns;
+        size_t fed = room_decode(&list, mute != 0, expected, frames, &decoded, &wrong, &repeats, &ns);
+
+        printf("  %-9s %u/%u frames, %u wrong, %u/%u repeats, %zu of %zu edges decoded (%.1f%%), %.2f ns per "
+               "input edge\n", mute ? "muted:" : "unmuted:", decoded, frames, wrong, repeats, own_repeats, fed,
+               list.count, 100.0 * fed / list.count, ns / list.count);
+
+        if (decoded != frames || wrong != 0 || repeats != own_repeats) {
+            result = 1;
+        }
+    }
+
+    free(expected);
+    free(list.edges);
+    return result;
+}
+
+/**
+ * @brief Decodes a LIRC mode2 recording.
+ */
+static int run_recorded(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return 2;
+    }
+
+    edge_list_t list = { 0 };
+    char kind[16];
+    unsigned long duration;
+
+    while (fscanf(file, "%15s %lu", kind, &duration) == 2) {
+        if (strcmp(kind, "pulse") == 0) {
+            edge_push(&list, true, (uint32_t)duration);
+        } else if (strcmp(kind, "space") == 0) {
+            edge_push(&list, false, (uint32_t)duration);
+        }
+    }
+    fclose(file);
+
+    ir_nec_t decoder;
+    ir_nec_init(&decoder, NULL);
+
+    for (size_t i = 0; i < list.count; i++) {
+        ir_nec_event_t event = ir_nec_feed(&decoder, list.edges[i].mark, list.edges[i].duration_us);
+
+        if (event == IR_NEC_EVENT_FRAME) {
+            printf("edge %6zu: address 0x%02X command 0x%02X key %d\n", i, decoder.address,
+                   decoder.command, (int)ir_nec_key(decoder.command));
+        } else if (event == IR_NEC_EVENT_REPEAT) {
+            printf("edge %6zu: repeat\n", i);
+        }
+    }
+
+    free(list.edges);
+    return 0;
+}
+
+/**
+ * @brief Checks that a key returned by the decoder is one of the keymap.
+ */
+static bool key_is_valid(ir_key_id_t key) {
+    if (key == INFRARED_KEY_NONE) {
+        return true;
+    }
+
+    for (uint8_t i = 0; i < sizeof(commands); i++) {
+        if (ir_nec_key(commands[i]) == key) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Feeds random and corrupted pulse trains.
+ *
+ * Every iteration builds a frame, then truncates it, flips pulse levels,
+ * replaces durations with random ones or inserts glitches. Corruptions that
+ * produce a frame with a different command are reported, as are keys outside
+ * the keymap.
+ */
+static int run_fuzz(uint32_t iterations) {
+    ir_nec_t decoder;
+    ir_nec_init(&decoder, NULL);
+
+    uint32_t failures = 0;
+    uint32_t events = 0;
+    uint64_t edges = 0;
+
+    for (uint32_t n = 0; n < iterations; n++) {
+        edge_list_t list = { 0 };
+        uint8_t command = commands[rand() % sizeof(commands)];
+        encode_frame(&list, 0x00, command);
+
+        uint32_t corruptions = 1 + rand() % 4;
+        for (uint32_t c = 0; c < corruptions && list.count > 0; c++) {
+            size_t index = rand() % list.count;
+
+            switch (rand() % 4) {
+                case 0: {
+                    list.count = index;
+                    break;
+                }
+                case 1: {
+                    list.edges[index].mark = !list.edges[index].mark;
+                    break;
+                }
+                case 2: {
+                    list.edges[index].duration_us = (uint32_t)rand() % 20000;
+                    break;
+                }
+                default: {
+                    list.edges[index].duration_us = (uint32_t)rand() % 100;
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < list.count; i++) {
+            ir_nec_event_t event = ir_nec_feed(&decoder, list.edges[i].mark, list.edges[i].duration_us);
+
+            if (event == IR_NEC_EVENT_FRAME) {
+                events++;
+                ir_key_id_t key = ir_nec_key(decoder.command);
+
+                if (!key_is_valid(key)) {
+                    printf("iteration %u: key %d out of range\n", n, (int)key);
+                    failures++;
+                } else if (decoder.command != command) {
+                    printf("iteration %u: command 0x%02X decoded as 0x%02X\n", n, command, decoder.command);
+                    failures++;
+                }
+            }
+        }
+        edges += list.count;
+
+        /* A long space ends the train, as the receiver idles between frames */
+        ir_nec_feed(&decoder, false, FRAME_GAP_US);
+        free(list.edges);
+    }
+
+    printf("fuzz: %u iterations, %llu edges, %u frames accepted, %u failures\n", iterations,
+           (unsigned long long)edges, events, failures);
+    return failures == 0 ? 0 : 1;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief libFuzzer target over the edge feed.
+ *
+ * The input is a header and a pulse train. Header byte 0 turns the glitch
+ * filter on (bit 0) and sets the tolerance (5 to 50%); a nonzero byte 1 is
+ * the unit address and byte 2 the group address of an address filter. Then
+ * every 16-bit little endian word is one pulse: FUZZ_MARK_BIT for a mark,
+ * the low 15 bits its duration in us.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < FUZZ_HEADER_SIZE) {
+        return 0;
+    }
+
+    ir_nec_config_t config = {
+        .glitch_us = (data[0] & 1) != 0 ? IR_NEC_DEFAULT_GLITCH_US : 0,
+        .tolerance_percent = (uint8_t)(5 + (data[0] >> 1) % 46),
+    };
+    const uint8_t addresses[] = { data[1], data[2], IR_NEC_BROADCAST_ADDRESS };
+    bool filtering = data[1] != 0;
+
+    ir_nec_t decoder;
+    ir_nec_init(&decoder, &config);
+    if (filtering) {
+        ir_nec_set_addresses(&decoder, addresses, sizeof(addresses));
+    }
+
+    for (size_t i = FUZZ_HEADER_SIZE; i + 1 < size; i += 2) {
+        uint16_t word = (uint16_t)(data[i] | (data[i + 1] << 8));
+        ir_nec_event_t event = ir_nec_feed(&decoder, (word & FUZZ_MARK_BIT) != 0, word & ~FUZZ_MARK_BIT);
+
+        if (event > IR_NEC_EVENT_FOREIGN) {
+            abort();
+        }
+        if (event != IR_NEC_EVENT_FRAME) {
+            continue;
+        }
+
+        int8_t digit = ir_nec_digit(decoder.command);
+        if (!key_is_valid(ir_nec_key(decoder.command)) || digit < IR_NEC_DIGIT_NONE || digit > 9) {
+            abort();
+        }
+        if (filtering && decoder.address != addresses[0] && decoder.address != addresses[1] &&
+            decoder.address != IR_NEC_BROADCAST_ADDRESS) {
+            abort();
+        }
+    }
+
+    return 0;
+}
+
+#ifndef IR_BENCH_FUZZER
+int main(int argc, char *argv[]) {
+    uint32_t frames = 0;
+    uint32_t iterations = 0;
+    int32_t noise = -1;
+    int32_t remotes = -1;
+    const char *recording = NULL;
+    int option;
+
+    srand(1);
+
+    while ((option = getopt(argc, argv, "n:r:f:g:a:s:")) != -1) {
+        switch (option) {
+            case 'n': {
+                frames = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            case 'r': {
+                recording = optarg;
+                break;
+            }
+            case 'f': {
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            case 'g': {
+                noise = (int32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            case 'a': {
+                remotes = (int32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            case 's': {
+                srand((unsigned int)strtoul(optarg, NULL, 0));
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s [-n frames] [-r mode2.txt] [-f iterations] [-g percent] [-a remotes] "
+                        "[-s seed]\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    if (noise > 100) {
+        noise = 100;
+    }
+
+    if (remotes > 200) {
+        remotes = 200;
+    }
+    if (remotes >= 0) {
+        return run_room((uint32_t)remotes);
+    }
+
+    if (frames == 0 && iterations == 0 && recording == NULL) {
+        frames = 100000;
+    }
+
+    int result = 0;
+
+    if (noise >= 0) {
+        return run_noise(frames, (uint32_t)noise);
+    }
+
+    if (frames > 0) {
+        result |= run_generated(frames);
+    }
+    if (recording != NULL) {
+        result |= run_recorded(recording);
+    }
+    if (iterations > 0) {
+        result |= run_fuzz(iterations);
+    }
+
+    return result;
+}
+#endif /* IR_BENCH_FUZZER */
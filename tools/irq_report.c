@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @brief Host tool: worst-case interrupt latency report from a profiler dump.
+ *
+ * Prints per source the measured entry latency and handler duration, the
+ * CPU load, and a latency bound from the priority map: an interrupt can be
+ * held back by the longest other handler of its own preemption level, which
+ * it cannot preempt, plus one run of every handler that preempts it. Sources that fire again
+ * within that window, and PRIMASK critical sections, extend the bound; the
+ * report lists measured figures next to it so the two can be compared.
+ *
+ * Build the firmware with IRQ_PROFILE=1, send 'L' to the console UART
+ * (115200 8N1) and save the reply to a file. Leading bytes before the
+ * header are skipped.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/irq_report.c -o irq_report
+ *
+ * Usage: irq_report dump.bin
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "irq.h"
+
+/** Variables ----------------------------------------------------- */
+static const char *const irq_names[IRQ_ID_COUNT] = {
+    [IRQ_ID_IR_RX] = "ir_rx",
+    [IRQ_ID_CONSOLE] = "console",
+    [IRQ_ID_PWM] = "pwm",
+    [IRQ_ID_ULTRASONIC] = "ultrasonic",
+    [IRQ_ID_SYSTICK] = "systick",
+    [IRQ_ID_AUDIO] = "audio",
+    [IRQ_ID_IMU] = "imu",
+    [IRQ_ID_RADIO] = "radio",
+};
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Finds the header in a raw capture and copies out the records.
+ *
+ * @return Number of records, 0 if none was found.
+ */
+static uint16_t load_dump(const uint8_t *raw, size_t size, irq_header_t *header, irq_record_t *records) {
+    for (size_t offset = 0; offset + sizeof(*header) <= size; offset++) {
+        memcpy(header, &raw[offset], sizeof(*header));
+        if (header->magic != IRQ_PROFILE_MAGIC) {
+            continue;
+        }
+        if (header->record_size != sizeof(irq_record_t) || header->record_count > IRQ_ID_COUNT) {
+            fprintf(stderr, "unsupported layout: %u records of %u bytes\n", header->record_count,
+                    header->record_size);
+            return 0;
+        }
+
+        size_t available = (size - offset - sizeof(*header)) / sizeof(irq_record_t);
+        if (available < header->record_count) {
+            fprintf(stderr, "truncated dump: %zu of %u records\n", available, header->record_count);
+            return 0;
+        }
+
+        memcpy(records, &raw[offset + sizeof(*header)], header->record_count * sizeof(irq_record_t));
+        return header->record_count;
+    }
+
+    return 0;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s dump.bin\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    static uint8_t raw[4096];
+    size_t size = fread(raw, 1, sizeof(raw), file);
+    fclose(file);
+
+    irq_header_t header;
+    irq_record_t records[IRQ_ID_COUNT];
+    uint16_t count = load_dump(raw, size, &header, records);
+    if (count == 0) {
+        fprintf(stderr, "no profiler dump found in %s\n", argv[1]);
+        return 2;
+    }
+
+    double us_per_cycle = 1e6 / header.hclk_hz;
+    double elapsed_s = header.elapsed_ms / 1000.0;
+    double total_load = 0;
+
+    printf("HCLK %u Hz, %.1f s profiled\n\n", header.hclk_hz, elapsed_s);
+    printf("%-12s %4s %8s %9s %9s %9s %11s %9s %9s\n", "source", "prio", "count", "rate(Hz)", "avg(us)",
+           "max(us)", "latency(us)", "bound(us)", "load(%)");
+
+    for (uint16_t i = 0; i < count; i++) {
+        const irq_record_t *record = &records[i];
+
+        /* Blocking: longest other handler at the same level. Interference:
+         * one run of every handler at a higher level. */
+        uint32_t blocking = 0;
+        uint32_t interference = 0;
+        for (uint16_t j = 0; j < count; j++) {
+            if (j == i) {
+                continue;
+            }
+            if (records[j].preempt == record->preempt) {
+                if (records[j].duration_max > blocking) {
+                    blocking = records[j].duration_max;
+                }
+            } else if (records[j].preempt < record->preempt) {
+                interference += records[j].duration_max;
+            }
+        }
+
+        double load = elapsed_s > 0 ? record->duration_total * us_per_cycle / 1e6 / elapsed_s * 100 : 0;
+        total_load += load;
+
+        char latency[16] = "-";
+        if (record->latency_count > 0) {
+            snprintf(latency, sizeof(latency), "%.2f", record->latency_max * us_per_cycle);
+        }
+
+        const char *name = record->id < IRQ_ID_COUNT ? irq_names[record->id] : "?";
+        printf("%-12s %2u.%u %8u %9.1f %9.2f %9.2f %11s %9.2f %9.3f\n", name, record->preempt, record->sub,
+               record->count, elapsed_s > 0 ? record->count / elapsed_s : 0,
+               record->count > 0 ? record->duration_total * us_per_cycle / record->count : 0,
+               record->duration_max * us_per_cycle, latency, (blocking + interference) * us_per_cycle, load);
+    }
+
+    printf("\ntotal interrupt load %.3f%%\n", total_load);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file
+ * @brief Host tool: runs the lights through a drive script and checks the
+ * strip encoding.
+ *
+ * The control loop is stepped every 10 ms through a scripted drive (start
+ * up, forward, turns, reverse, an emergency brake, stop). At every tick the
+ * frame is encoded as the firmware sends it, then decoded back from the
+ * SPI bits as a WS2812 would, a 110 group being a one and a 100 group a
+ * zero; any other group or a color mismatch fails. Frames equal to the
+ * last one sent are skipped, as led_strip_show() does, and the number of
+ * transfers is reported next to the number of ticks.
+ *
+ * Usage: lights_sim [-v]
+ *   -v  Print every frame sent.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/lights_sim.c core/src/lights.c -o lights_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lights.h"
+
+/** Definitions --------------------------------------------------- */
+#define CONTROL_PERIOD_MS   10
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint32_t duration_ms;
+    int16_t left;
+    int16_t right;
+    bool braking;
+    const char *name;
+} script_step_t;
+
+/** Variables ----------------------------------------------------- */
+static const script_step_t script[] = {
+    { 1000, 0, 0, false, "start up" },
+    { 2000, 700, 700, false, "forward" },
+    { 2000, 0, 700, false, "left" },
+    { 2000, 700, 0, false, "right" },
+    { 2000, -700, -700, false, "reverse" },
+    { 1000, 700, 700, false, "forward" },
+    { 1000, 0, 0, true, "obstacle" },
+    { 2000, 0, 0, false, "stop" },
+};
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Decodes the SPI bits back into colors.
+ *
+ * @return false on a bit group a WS2812 would not read as 0 or 1.
+ */
+static bool decode(const uint8_t buffer[LIGHTS_FRAME_SIZE], lights_frame_t frame) {
+    uint8_t *bytes = (uint8_t *)frame;
+
+    for (uint32_t bit = 0; bit < LIGHTS_LED_COUNT * LIGHTS_BITS_PER_LED; bit++) {
+        uint32_t group = 0;
+
+        for (uint32_t i = 0; i < LIGHTS_SPI_BITS; i++) {
+            uint32_t position = bit * LIGHTS_SPI_BITS + i;
+            group = (group << 1) | ((buffer[position / 8] >> (7 - position % 8)) & 1);
+        }
+        if (group != 4 && group != 6) {
+            return false;
+        }
+
+        bytes[bit / 8] = (uint8_t)((bytes[bit / 8] << 1) | (group == 6));
+    }
+
+    return true;
+}
+
+static void print_frame(uint32_t now, const char *name, const lights_frame_t frame) {
+    printf("%6u %-9s", now, name);
+    for (uint32_t i = 0; i < LIGHTS_LED_COUNT; i++) {
+        printf(" %02x%02x%02x", frame[i].red, frame[i].green, frame[i].blue);
+    }
+    printf("\n");
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char **argv) {
+    bool verbose = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    lights_frame_t shown;
+    uint32_t now = 0;
+    uint32_t ticks = 0;
+    uint32_t transfers = 0;
+    uint32_t errors = 0;
+
+    memset(shown, 0xFF, sizeof(shown));
+    lights_init(now);
+
+    for (uint32_t s = 0; s < sizeof(script) / sizeof(script[0]); s++) {
+        const script_step_t *step = &script[s];
+        drive_setpoint_t setpoint = { step->left, step->right, BUZZER_NOTE_ST };
+        uint32_t end = now + step->duration_ms;
+        uint32_t step_transfers = 0;
+
+        for (; now < end; now += CONTROL_PERIOD_MS) {
+            lights_frame_t frame;
+            lights_frame_t decoded;
+            uint8_t buffer[LIGHTS_FRAME_SIZE];
+
+            ticks++;
+            lights_frame(&setpoint, step->braking, now, frame);
+            if (memcmp(frame, shown, sizeof(shown)) == 0) {
+                continue;
+            }
+
+            lights_encode(frame, buffer);
+            if (!decode(buffer, decoded) || memcmp(frame, decoded, sizeof(decoded)) != 0) {
+                printf("%6u %s: frame does not decode back\n", now, step->name);
+                errors++;
+            }
+            if ((buffer[LIGHTS_FRAME_SIZE - 1] & 1) != 0) {
+                printf("%6u %s: line left high\n", now, step->name);
+                errors++;
+            }
+
+            memcpy(shown, frame, sizeof(shown));
+            transfers++;
+            step_transfers++;
+            if (verbose) {
+                print_frame(now, step->name, frame);
+            }
+        }
+
+        printf("%-9s %5u ms  %3u transfers\n", step->name, step->duration_ms, step_transfers);
+    }
+
+    printf("%u ticks, %u transfers (%.1f%%), %u errors\n", ticks, transfers, 100.0 * transfers / ticks, errors);
+
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+/**
+ * @file
+ * @brief Host tool: runs the line following loop on a simulated car and
+ * sensor array, and times its steps.
+ *
+ * The track is a stadium of tape: two straights of STRAIGHT_MM joined by
+ * half circles of RADIUS_MM. The array sits SENSOR_AHEAD_MM ahead of the
+ * axle, its sensors SENSOR_PITCH_MM apart; each one reads the floor level
+ * plus the tape level in proportion to how much of its spot covers the
+ * tape, with noise. At every step the whole sample buffer is filled again,
+ * as the ADC refreshes it several times per loop period, then line_step()
+ * runs and the wheels follow its efforts with a first-order lag, the right
+ * motor weaker than the left.
+ *
+ * Scenarios:
+ *   - follow:  laps of the track, reporting the largest distance from the
+ *              array center to the tape.
+ *   - gap:     the same with a break in the tape on a straight, which must
+ *              be crossed without stopping.
+ *   - waiting: the car starts beside the tape and must not move.
+ *   - end:     the tape ends, the car must stop after the search time.
+ *
+ * The mean host time per step is reported; on the target the 'F' console
+ * request reports the cycle cost.
+ *
+ * Usage: line_sim [-m mismatch_percent] [-n noise_counts] [-v]
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/line_sim.c core/src/line.c core/src/drive.c core/src/compensation.c \
+ *         core/src/param.c -lm -o line_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "line.h"
+
+/** Definitions --------------------------------------------------- */
+#define STEP_S              (1.0 / LINE_RATE_HZ)
+#define FULL_SPEED_MM_S     1000.0
+#define MOTOR_TAU_S         0.1
+#define TRACK_MM            130.0
+#define PI                  3.14159265358979
+
+#define STRAIGHT_MM         1000.0
+#define RADIUS_MM           300.0
+#define TAPE_MM             19.0
+#define GAP_MM              30.0
+
+#define SENSOR_AHEAD_MM     60.0
+#define SENSOR_PITCH_MM     15.0
+#define SENSOR_SPOT_MM      8.0
+#define FLOOR_LEVEL         400
+#define TAPE_LEVEL          3000
+
+#define FOLLOW_S            20.0
+#define WAIT_S              2.0
+#define ERROR_LIMIT_MM      15.0
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef enum {
+    TAPE_FULL = 0,
+    TAPE_GAP,           /**< Break on the bottom straight */
+    TAPE_END,           /**< Tape only up to the middle of the bottom straight */
+} tape_t;
+
+typedef struct {
+    double x_mm;
+    double y_mm;
+    double heading;     /**< Counter-clockwise, radians */
+    double left_mm_s;
+    double right_mm_s;
+} car_t;
+
+/** Variables ----------------------------------------------------- */
+static int failures = 0;
+static double mismatch = 0.1;
+static int noise_counts = 40;
+static bool verbose = false;
+static uint32_t random_state = 12345;
+
+/** Internal functions -------------------------------------------- */
+static int noise(void) {
+    random_state = random_state * 1103515245u + 12345u;
+    return noise_counts == 0 ? 0 : (int)((random_state >> 16) % (2 * noise_counts + 1)) - noise_counts;
+}
+
+/**
+ * @brief Signed distance from a point to the tape center line, positive
+ * outside the stadium. NAN where there is no tape.
+ */
+static double tape_distance(double x, double y, tape_t tape) {
+    double cx = x < -STRAIGHT_MM / 2 ? -STRAIGHT_MM / 2 : x > STRAIGHT_MM / 2 ? STRAIGHT_MM / 2 : x;
+
+    if (y < 0 && fabs(x) < STRAIGHT_MM / 2) {
+        if (tape == TAPE_GAP && x > 0 && x < GAP_MM) {
+            return NAN;
+        }
+        if (tape == TAPE_END && x > 0) {
+            return NAN;
+        }
+    }
+
+    return hypot(x - cx, y) - RADIUS_MM;
+}
+
+/**
+ * @brief Reads one sensor: its spot is SENSOR_SPOT_MM wide across the
+ * tape.
+ */
+static uint16_t sensor_read(double x, double y, tape_t tape) {
+    double distance = tape_distance(x, y, tape);
+    double coverage = 0;
+
+    if (!isnan(distance)) {
+        double low = fmax(fabs(distance) - SENSOR_SPOT_MM / 2, -TAPE_MM / 2);
+        double high = fmin(fabs(distance) + SENSOR_SPOT_MM / 2, TAPE_MM / 2);
+        coverage = high > low ? (high - low) / SENSOR_SPOT_MM : 0;
+    }
+
+    int level = FLOOR_LEVEL + (int)((TAPE_LEVEL - FLOOR_LEVEL) * coverage) + noise();
+    return (uint16_t)(level < 0 ? 0 : level > 4095 ? 4095 : level);
+}
+
+/**
+ * @brief Fills the buffer as the ADC scan does, left sensor first.
+ */
+static void sensor_scan(const car_t *car, tape_t tape, uint16_t samples[LINE_SAMPLE_COUNT]) {
+    double ahead_x = car->x_mm + SENSOR_AHEAD_MM * cos(car->heading);
+    double ahead_y = car->y_mm + SENSOR_AHEAD_MM * sin(car->heading);
+
+    for (uint32_t scan = 0; scan < LINE_SCAN_DEPTH; scan++) {
+        for (uint32_t i = 0; i < LINE_SENSOR_COUNT; i++) {
+            double left_mm = ((LINE_SENSOR_COUNT - 1) / 2.0 - i) * SENSOR_PITCH_MM;
+            double x = ahead_x - left_mm * sin(car->heading);
+            double y = ahead_y + left_mm * cos(car->heading);
+            samples[scan * LINE_SENSOR_COUNT + i] = sensor_read(x, y, tape);
+        }
+    }
+}
+
+/**
+ * @brief Moves the car one step. The right motor is weaker.
+ */
+static void car_step(car_t *car, const drive_setpoint_t *setpoint) {
+    double alpha = STEP_S / MOTOR_TAU_S;
+    double left = setpoint->left * FULL_SPEED_MM_S / DRIVE_EFFORT_MAX;
+    double right = setpoint->right * FULL_SPEED_MM_S / DRIVE_EFFORT_MAX * (1.0 - mismatch);
+
+    car->left_mm_s += (left - car->left_mm_s) * alpha;
+    car->right_mm_s += (right - car->right_mm_s) * alpha;
+
+    double speed = (car->left_mm_s + car->right_mm_s) / 2;
+    car->heading += (car->right_mm_s - car->left_mm_s) / TRACK_MM * STEP_S;
+    car->x_mm += speed * cos(car->heading) * STEP_S;
+    car->y_mm += speed * sin(car->heading) * STEP_S;
+}
+
+/**
+ * @brief Runs the loop on a track for a while.
+ *
+ * @param start_y_mm    Start offset from the bottom straight tape.
+ * @param max_error_mm  Largest tape distance of the array center, while
+ *                      the tape is under it.
+ * @param distance_mm   Distance travelled.
+ */
+static void run(tape_t tape, double seconds, double start_y_mm, double *max_error_mm, double *distance_mm,
+                double *step_ns) {
+    car_t car = { .x_mm = -STRAIGHT_MM / 2, .y_mm = -RADIUS_MM + start_y_mm };
+    uint16_t samples[LINE_SAMPLE_COUNT];
+    drive_setpoint_t setpoint;
+    double total_ns = 0;
+    uint32_t steps = (uint32_t)(seconds * LINE_RATE_HZ);
+
+    *max_error_mm = 0;
+    *distance_mm = 0;
+    line_init();
+
+    for (uint32_t step = 0; step < steps; step++) {
+        struct timespec begin;
+        struct timespec end;
+
+        sensor_scan(&car, tape, samples);
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        line_step(samples, &setpoint);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        total_ns += (end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec);
+
+        double x0 = car.x_mm;
+        double y0 = car.y_mm;
+        car_step(&car, &setpoint);
+        *distance_mm += hypot(car.x_mm - x0, car.y_mm - y0);
+
+        double error = tape_distance(car.x_mm + SENSOR_AHEAD_MM * cos(car.heading),
+                                     car.y_mm + SENSOR_AHEAD_MM * sin(car.heading), tape);
+        if (!isnan(error) && step > LINE_RATE_HZ / 2 && fabs(error) > *max_error_mm) {
+            *max_error_mm = fabs(error);
+        }
+
+        if (verbose && step % (LINE_RATE_HZ / 10) == 0) {
+            line_state_t state;
+            line_get_state(&state);
+            printf("    %6.2f s  x %7.1f y %7.1f  pos %6d steer %5d  L %4d R %4d\n", step * STEP_S, car.x_mm,
+                   car.y_mm, state.position, state.steer, setpoint.left, setpoint.right);
+        }
+    }
+
+    *step_ns = total_ns / steps;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    int option;
+
+    while ((option = getopt(argc, argv, "m:n:v")) != -1) {
+        switch (option) {
+            case 'm': {
+                mismatch = atof(optarg) / 100.0;
+                break;
+            }
+            case 'n': {
+                noise_counts = atoi(optarg);
+                break;
+            }
+            case 'v': {
+                verbose = true;
+                break;
+            }
+            default: {
+                fprintf(stderr, "Usage: %s [-m mismatch_percent] [-n noise_counts] [-v]\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    double lap_mm = 2 * STRAIGHT_MM + 2 * PI * RADIUS_MM;
+    double max_error;
+    double distance;
+    double step_ns;
+    line_state_t state;
+
+    printf("follow: %.0f s, right motor %.0f%% weaker, noise %d counts\n", FOLLOW_S, mismatch * 100, noise_counts);
+    run(TAPE_FULL, FOLLOW_S, 0, &max_error, &distance, &step_ns);
+    line_get_state(&state);
+    printf("  %.2f laps, max error %.1f mm, lost %u times, %.0f ns per step\n", distance / lap_mm, max_error,
+           state.lost, step_ns);
+    CHECK(distance > lap_mm);
+    CHECK(max_error < ERROR_LIMIT_MM);
+    CHECK(state.lost == 0);
+
+    printf("gap: %.0f mm break in the tape\n", GAP_MM);
+    run(TAPE_GAP, FOLLOW_S, 0, &max_error, &distance, &step_ns);
+    line_get_state(&state);
+    printf("  %.2f laps, max error %.1f mm, lost %u times\n", distance / lap_mm, max_error, state.lost);
+    CHECK(distance > lap_mm);
+    CHECK(max_error < ERROR_LIMIT_MM);
+    CHECK(state.lost >= 1);
+
+    printf("waiting: start %.0f mm beside the tape\n", 4 * SENSOR_PITCH_MM);
+    run(TAPE_FULL, WAIT_S, 4 * SENSOR_PITCH_MM, &max_error, &distance, &step_ns);
+    printf("  moved %.1f mm\n", distance);
+    CHECK(distance < 1.0);
+
+    printf("end: the tape ends\n");
+    run(TAPE_END, FOLLOW_S, 0, &max_error, &distance, &step_ns);
+    line_get_state(&state);
+    printf("  stopped after %.0f mm, lost %u times\n", distance, state.lost);
+    CHECK(state.lost == 1);
+    CHECK(state.lost_steps == LINE_SEARCH_STEPS);
+    CHECK(distance < STRAIGHT_MM / 2 + 500);
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
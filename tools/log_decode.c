@@ -0,0 +1,254 @@
+/**
+ * @file
+ * @brief Host tool: turns a binary log dump back into text, with the site
+ * strings read from the firmware ELF.
+ *
+ * The .log_sites section of the ELF holds a "file:line: format" string per
+ * LOG() call site; the site ID of an entry is the string offset in the
+ * section. Arguments are 32-bit words, formatted with the integer
+ * conversions of the format (d, i, u, x, X, o, c), length modifiers being
+ * ignored. Both 32 and 64-bit little endian ELF files are read, so host
+ * builds of the logger can be decoded too (see tools/log_sim.c).
+ *
+ * Capture a dump by sending 'D' to the console UART (115200 8N1) and saving
+ * the reply to a file. Leading bytes before the log header are skipped.
+ *
+ * Usage: log_decode firmware.elf dump.bin
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/log_decode.c -o log_decode
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+/** Definitions --------------------------------------------------- */
+#define SECTION_NAME        ".log_sites"
+#define DUMP_SIZE_MAX       (64 * 1024)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    char *strings;
+    uint64_t size;
+    uint64_t address;
+} sites_t;
+
+/** Prototypes ---------------------------------------------------- */
+static uint8_t *read_file(const char *path, size_t *size);
+static uint64_t read_le(const uint8_t *data, uint32_t size);
+static bool load_sites(const char *path, sites_t *sites);
+static void print_entry(const sites_t *sites, const uint32_t *words, uint32_t count);
+
+/** Internal functions -------------------------------------------- */
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    *size = data != NULL ? fread(data, 1, (size_t)length, file) : 0;
+    fclose(file);
+
+    return data;
+}
+
+static uint64_t read_le(const uint8_t *data, uint32_t size) {
+    uint64_t value = 0;
+
+    for (uint32_t i = size; i > 0; i--) {
+        value = (value << 8) | data[i - 1];
+    }
+    return value;
+}
+
+/**
+ * @brief Finds the site strings section of an ELF file.
+ */
+static bool load_sites(const char *path, sites_t *sites) {
+    size_t size;
+    uint8_t *elf = read_file(path, &size);
+
+    if (elf == NULL) {
+        return false;
+    }
+    if (size < 52 || memcmp(elf, "\x7F" "ELF", 4) != 0 || elf[5] != 1) {
+        fprintf(stderr, "%s: not a little endian ELF file\n", path);
+        return false;
+    }
+
+    /* Field offsets and sizes of the ELF32 and ELF64 layouts */
+    bool wide = elf[4] == 2;
+    uint32_t word = wide ? 8 : 4;
+    uint64_t table = read_le(&elf[wide ? 0x28 : 0x20], word);
+    uint32_t entry_size = (uint32_t)read_le(&elf[wide ? 0x3A : 0x2E], 2);
+    uint32_t count = (uint32_t)read_le(&elf[wide ? 0x3C : 0x30], 2);
+    uint32_t names = (uint32_t)read_le(&elf[wide ? 0x3E : 0x32], 2);
+
+    if (table + (uint64_t)count * entry_size > size || names >= count) {
+        fprintf(stderr, "%s: bad section table\n", path);
+        return false;
+    }
+
+    const uint8_t *names_header = &elf[table + names * entry_size];
+    uint64_t names_offset = read_le(&names_header[wide ? 0x18 : 0x10], word);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *header = &elf[table + i * entry_size];
+        uint64_t name = names_offset + read_le(&header[0], 4);
+
+        if (name >= size || strncmp((const char *)&elf[name], SECTION_NAME, size - name) != 0) {
+            continue;
+        }
+
+        sites->address = read_le(&header[wide ? 0x10 : 0x0C], word);
+        uint64_t offset = read_le(&header[wide ? 0x18 : 0x10], word);
+        sites->size = read_le(&header[wide ? 0x20 : 0x14], word);
+        if (offset + sites->size > size) {
+            break;
+        }
+
+        /* Terminated, so a bad ID never runs past the end */
+        sites->strings = calloc(sites->size + 1, 1);
+        memcpy(sites->strings, &elf[offset], sites->size);
+        free(elf);
+        return true;
+    }
+
+    fprintf(stderr, "%s: no %s section\n", path, SECTION_NAME);
+    free(elf);
+    return false;
+}
+
+/**
+ * @brief Prints one entry: timestamp, site and formatted message.
+ */
+static void print_entry(const sites_t *sites, const uint32_t *words, uint32_t count) {
+    uint64_t id = words[0] & LOG_SITE_ID_MASK;
+    uint64_t offset = id - (sites->address & LOG_SITE_ID_MASK);
+
+    printf("%10.3f s  ", words[1] / 1000.0);
+    if (offset >= sites->size) {
+        printf("unknown site 0x%06llx", (unsigned long long)id);
+        for (uint32_t i = 0; i < count; i++) {
+            printf(" 0x%08x", words[2 + i]);
+        }
+        printf("\n");
+        return;
+    }
+
+    const char *format = &sites->strings[offset];
+    uint32_t arg = 0;
+
+    while (*format != '\0') {
+        if (*format != '%') {
+            putchar(*format++);
+            continue;
+        }
+        if (format[1] == '%') {
+            putchar('%');
+            format += 2;
+            continue;
+        }
+
+        /* Flags, width and precision are kept, length modifiers dropped */
+        char spec[32] = "%";
+        size_t length = 1;
+        format++;
+        while (*format != '\0' && strchr("-+ #0123456789.", *format) != NULL && length < sizeof(spec) - 3) {
+            spec[length++] = *format++;
+        }
+        while (*format != '\0' && strchr("hlzjt", *format) != NULL) {
+            format++;
+        }
+        char conversion = *format != '\0' ? *format++ : '?';
+
+        if (arg >= count) {
+            printf("<missing>");
+            continue;
+        }
+
+        uint32_t value = words[2 + arg++];
+        spec[length++] = conversion;
+        spec[length] = '\0';
+        if (conversion == 'd' || conversion == 'i' || conversion == 'c') {
+            printf(spec, (int)(int32_t)value);
+        } else if (strchr("uxXo", conversion) != NULL) {
+            printf(spec, (unsigned int)value);
+        } else {
+            printf("<%%%c 0x%08x>", conversion, value);
+        }
+    }
+    printf("\n");
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    sites_t sites = { 0 };
+    size_t size;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s firmware.elf dump.bin\n", argv[0]);
+        return 2;
+    }
+    if (!load_sites(argv[1], &sites)) {
+        return 1;
+    }
+
+    uint8_t *dump = read_file(argv[2], &size);
+    if (dump == NULL) {
+        return 1;
+    }
+
+    size_t offset = 0;
+    while (offset + sizeof(log_header_t) <= size && read_le(&dump[offset], 4) != LOG_MAGIC) {
+        offset++;
+    }
+    if (offset + sizeof(log_header_t) > size) {
+        fprintf(stderr, "no log header found in %s\n", argv[2]);
+        return 1;
+    }
+
+    log_header_t header;
+    memcpy(&header, &dump[offset], sizeof(header));
+    offset += sizeof(header);
+
+    uint32_t entries = 0;
+    bool ended = false;
+    while (offset + sizeof(uint32_t) <= size) {
+        uint32_t words[2 + LOG_SITE_COUNT_MASK];
+        uint32_t site = (uint32_t)read_le(&dump[offset], 4);
+
+        if (site == 0) {
+            ended = true;
+            break;
+        }
+
+        uint32_t count = (site >> LOG_SITE_COUNT_SHIFT) & LOG_SITE_COUNT_MASK;
+        if ((site & LOG_SITE_VALID) == 0 || offset + (2 + count) * sizeof(uint32_t) > size) {
+            break;
+        }
+        for (uint32_t i = 0; i < 2 + count; i++) {
+            words[i] = (uint32_t)read_le(&dump[offset + i * sizeof(uint32_t)], 4);
+        }
+        offset += (2 + count) * sizeof(uint32_t);
+
+        print_entry(&sites, words, count);
+        entries++;
+    }
+
+    printf("%u entries, %u dropped%s\n", entries, header.dropped, ended ? "" : ", dump truncated");
+    free(dump);
+    free(sites.strings);
+
+    return ended ? 0 : 1;
+}
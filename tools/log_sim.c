@@ -0,0 +1,226 @@
+/**
+ * @file
+ * @brief Host tool: exercises the log ring and writes a sample dump for the
+ * decoder.
+ *
+ * Checks:
+ *   - order:    entries of 0 to LOG_ARGS_MAX arguments come out in order,
+ *               with their timestamps and arguments.
+ *   - overflow: a full ring drops whole entries, reports the count in the
+ *               next dump header only, and keeps the entries it took.
+ *   - wrap:     entries of every size straddle the end of the ring many
+ *               times, drained at random points.
+ * The mean host time per LOG() call is reported.
+ *
+ * Usage: log_sim [-o dump.bin]
+ *   -o  Also write a dump of a few messages, to be read back with
+ *       log_decode log_sim dump.bin.
+ *
+ * Build (from the repository root; -no-pie keeps the site addresses within
+ * the 24-bit site ID):
+ *     gcc -O2 -no-pie -Icore/inc tools/log_sim.c core/src/log.c -o log_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+/** Definitions --------------------------------------------------- */
+#define CAPTURE_SIZE        (8 * LOG_RING_WORDS)
+#define WRAP_ROUNDS         20000
+#define BENCH_CALLS         100000
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Variables ----------------------------------------------------- */
+static int failures = 0;
+static volatile uint32_t clock_ms = 0;
+static uint32_t random_state = 12345;
+
+static uint32_t capture[CAPTURE_SIZE];
+static uint32_t capture_words = 0;
+
+/** Internal functions -------------------------------------------- */
+static uint32_t random_next(void) {
+    random_state = random_state * 1103515245u + 12345u;
+    return random_state >> 16;
+}
+
+static void capture_write(const void *data, uint16_t size) {
+    if (capture_words + size / sizeof(uint32_t) <= CAPTURE_SIZE) {
+        memcpy(&capture[capture_words], data, size);
+        capture_words += size / sizeof(uint32_t);
+    }
+}
+
+static void discard_write(const void *data, uint16_t size) {
+    (void)data;
+    (void)size;
+}
+
+/**
+ * @brief Drains the ring into the capture buffer.
+ *
+ * @return Dropped count of the dump header.
+ */
+static uint32_t drain(void) {
+    capture_words = 0;
+    log_drain(capture_write);
+    return capture[1];
+}
+
+/**
+ * @brief Writes an entry of count arguments, count + first... as values.
+ */
+static void write_counted(uint32_t site, uint32_t count, uint32_t first) {
+    uint32_t words[1 + LOG_ARGS_MAX] = { 0 };
+
+    for (uint32_t i = 0; i < count; i++) {
+        words[1 + i] = first + i;
+    }
+    log_write(site, count, words);
+}
+
+/**
+ * @brief Walks the captured dump, checking every entry was written by
+ * write_counted() with consecutive first values.
+ *
+ * @return Number of entries, or -1 on a malformed dump.
+ */
+static int check_counted(uint32_t *next_first) {
+    uint32_t position = 2;
+    int entries = 0;
+
+    if (capture[0] != LOG_MAGIC) {
+        return -1;
+    }
+
+    while (position < capture_words && capture[position] != 0) {
+        uint32_t site = capture[position];
+        uint32_t count = (site >> LOG_SITE_COUNT_SHIFT) & LOG_SITE_COUNT_MASK;
+
+        if ((site & LOG_SITE_VALID) == 0 || (site & LOG_SITE_ID_MASK) != count) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (capture[position + 2 + i] != *next_first + i) {
+                return -1;
+            }
+        }
+        *next_first += 100;
+        position += 2 + count;
+        entries++;
+    }
+
+    return position + 1 == capture_words ? entries : -1;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    const char *dump_path = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "o:")) != -1) {
+        if (option == 'o') {
+            dump_path = optarg;
+        } else {
+            fprintf(stderr, "Usage: %s [-o dump.bin]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("order\n");
+    log_init(&clock_ms);
+    for (uint32_t i = 0; i < 10; i++) {
+        clock_ms = 1000 + i;
+        write_counted(i % (LOG_ARGS_MAX + 1), i % (LOG_ARGS_MAX + 1), i * 100);
+    }
+    uint32_t dropped = drain();
+    uint32_t first = 0;
+    int entries = check_counted(&first);
+    printf("  %d entries, %u words\n", entries, capture_words);
+    CHECK(entries == 10);
+    CHECK(dropped == 0);
+    CHECK(capture[3] == 1000);
+    drain();
+    CHECK(capture_words == 3);
+
+    printf("overflow\n");
+    for (uint32_t i = 0; i < 100; i++) {
+        write_counted(LOG_ARGS_MAX, LOG_ARGS_MAX, i * 100);
+    }
+    dropped = drain();
+    first = 0;
+    entries = check_counted(&first);
+    printf("  %d entries kept, %u dropped\n", entries, dropped);
+    CHECK(entries == LOG_RING_WORDS / LOG_ENTRY_WORDS_MAX);
+    CHECK(dropped == 100 - LOG_RING_WORDS / LOG_ENTRY_WORDS_MAX);
+    CHECK(drain() == 0);
+
+    printf("wrap: %u rounds\n", WRAP_ROUNDS);
+    first = 0;
+    uint32_t total = 0;
+    bool intact = true;
+    uint32_t written_first = 0;
+    for (uint32_t round = 0; round < WRAP_ROUNDS; round++) {
+        uint32_t burst = random_next() % 12;
+        for (uint32_t i = 0; i < burst; i++) {
+            uint32_t count = random_next() % (LOG_ARGS_MAX + 1);
+            write_counted(count, count, written_first);
+            written_first += 100;
+        }
+        drain();
+        entries = check_counted(&first);
+        intact = intact && entries == (int)burst;
+        total += entries > 0 ? (uint32_t)entries : 0;
+    }
+    printf("  %u entries\n", total);
+    CHECK(intact);
+
+    struct timespec begin;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (uint32_t i = 0; i < BENCH_CALLS; i++) {
+        LOG("bench %u %d", i, -(int32_t)i);
+        if ((i & 31) == 31) {
+            log_drain(discard_write);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("%.1f ns per LOG() with the drains\n",
+           ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) / BENCH_CALLS);
+
+    if (dump_path != NULL) {
+        log_init(&clock_ms);
+        clock_ms = 1500;
+        LOG("radio link up on channel %u", 76);
+        clock_ms = 2750;
+        LOG("range %d mm, effort %d", 310, -450);
+        clock_ms = 3000;
+        LOG("status 0x%02x, %u%% full", 0x4E, 50);
+        LOG("no arguments");
+
+        FILE *file = fopen(dump_path, "wb");
+        if (file == NULL) {
+            perror(dump_path);
+            return 1;
+        }
+        drain();
+        fwrite(capture, sizeof(uint32_t), capture_words, file);
+        fclose(file);
+        printf("dump written to %s\n", dump_path);
+    }
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file
+ * @brief Host tool: records a drive script into a macro, plays it back on
+ * a millisecond tick and checks the timing.
+ *
+ * The script is fed to macro_record() at its timestamps, including a wait
+ * longer than a step can hold and repeated setpoints that must not take a
+ * step. Playback then runs one macro_play_tick() per millisecond, as the
+ * PWM timer interrupt does; every setpoint change must come out on the
+ * exact tick it went in, and the macro must end stopped on the tick the
+ * recording was stopped. A second run overfills the macro and checks that
+ * recording reports it and still ends with the stop step.
+ *
+ * Usage: macro_sim [-v]
+ *   -v  Print every step played.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/macro_sim.c core/src/macro.c core/src/drive.c core/src/compensation.c \
+ *         core/src/param.c -o macro_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "macro.h"
+
+/** Definitions --------------------------------------------------- */
+#define START_MS            123456  /* Clock at the start of the recording */
+#define FLASH_PAGE_SIZE     1024
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint32_t at_ms;         /**< From the start of the recording */
+    int16_t left;
+    int16_t right;
+} script_step_t;
+
+/** Variables ----------------------------------------------------- */
+static int failures = 0;
+static bool verbose = false;
+
+/** Forward, a repeated setpoint, a turn, a long wait, reverse, stop. */
+static const script_step_t script[] = {
+    { 0, 0, 0 },
+    { 37, 700, 700 },
+    { 180, 700, 700 },
+    { 411, 700, -700 },
+    { 412, 700, 700 },
+    { 1000, 0, 0 },
+    { 71000, -700, -700 },
+    { 71733, 0, 0 },
+};
+
+#define SCRIPT_STEPS        (sizeof(script) / sizeof(script[0]))
+#define STOP_MS             72000
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Plays the macro to its end.
+ *
+ * @param changes       Tick of every setpoint change, from the first tick.
+ * @param setpoints     Setpoint after each change.
+ * @param max_changes   Size of both arrays, less one for the end.
+ *
+ * @return Number of changes, or -1 if the macro never ends.
+ */
+static int play(uint32_t changes[], drive_setpoint_t setpoints[], int max_changes) {
+    drive_setpoint_t previous;
+    drive_setpoint_t setpoint;
+    int count = 0;
+
+    drive_wheels(0, 0, &previous);
+    if (!macro_play_start()) {
+        return -1;
+    }
+
+    for (uint32_t tick = 0; tick < 10 * STOP_MS; tick++) {
+        bool playing = macro_play_tick(&setpoint);
+
+        if ((setpoint.left != previous.left || setpoint.right != previous.right || tick == 0)
+            && count < max_changes) {
+            changes[count] = tick;
+            setpoints[count] = setpoint;
+            count++;
+            if (verbose) {
+                printf("    tick %6u  L %5d R %5d\n", tick, setpoint.left, setpoint.right);
+            }
+        }
+        previous = setpoint;
+
+        if (!playing) {
+            changes[count] = tick;
+            setpoints[count] = setpoint;
+            return count + 1;
+        }
+    }
+
+    return -1;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    static macro_record_t record;
+    drive_setpoint_t setpoint;
+    uint32_t changes[SCRIPT_STEPS + 2];
+    drive_setpoint_t setpoints[SCRIPT_STEPS + 2];
+    int option;
+
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("record: %u script steps, %u bytes per record\n", (unsigned)SCRIPT_STEPS, (unsigned)sizeof(record));
+    CHECK(sizeof(record) <= FLASH_PAGE_SIZE);
+
+    macro_init(NULL);
+    CHECK(!macro_play_start());
+
+    drive_wheels(script[0].left, script[0].right, &setpoint);
+    macro_record_start(&setpoint, START_MS);
+    for (uint32_t i = 1; i < SCRIPT_STEPS; i++) {
+        drive_wheels(script[i].left, script[i].right, &setpoint);
+        CHECK(macro_record(&setpoint, START_MS + script[i].at_ms));
+    }
+    macro_record_stop(START_MS + STOP_MS, &record);
+    printf("  %u steps\n", record.count);
+    CHECK(macro_get_state() == MACRO_STATE_IDLE);
+    /* Start, 4 changes, a step holding the long wait, 2 changes, stop */
+    CHECK(record.count == 9);
+
+    printf("play\n");
+    macro_init(&record);
+    int played = play(changes, setpoints, SCRIPT_STEPS + 1);
+    CHECK(played == SCRIPT_STEPS);
+
+    /* Changes: every script step but the repeated one, then the end */
+    uint32_t expected_ms[] = { 0, 37, 411, 412, 1000, 71000, 71733, STOP_MS };
+    for (int i = 0; i < played && i < (int)(sizeof(expected_ms) / sizeof(expected_ms[0])); i++) {
+        if (changes[i] != expected_ms[i]) {
+            printf("  change %d on tick %u, expected %u\n", i, changes[i], expected_ms[i]);
+        }
+        CHECK(changes[i] == expected_ms[i]);
+    }
+    CHECK(setpoints[played - 1].left == 0 && setpoints[played - 1].right == 0);
+    CHECK(macro_get_state() == MACRO_STATE_IDLE);
+
+    printf("overfill\n");
+    drive_wheels(0, 0, &setpoint);
+    macro_record_start(&setpoint, 0);
+    uint32_t accepted = 0;
+    for (uint32_t i = 1; i < 2 * MACRO_STEP_MAX; i++) {
+        drive_wheels((int16_t)(i % 2 ? 500 : 0), 0, &setpoint);
+        if (!macro_record(&setpoint, i * 10)) {
+            break;
+        }
+        accepted++;
+    }
+    macro_record_stop(MACRO_STEP_MAX * 10 + 10, &record);
+    printf("  %u changes accepted, %u steps\n", accepted, record.count);
+    CHECK(record.count == MACRO_STEP_MAX);
+    CHECK(record.steps[MACRO_STEP_MAX - 1].left == 0 && record.steps[MACRO_STEP_MAX - 1].right == 0);
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,614 @@
+/**
+ * @file
+ * @brief Host tool: DC motor and bridge model for the drive modes.
+ *
+ * One wheel is simulated at 1 us steps through the real compare values from
+ * drive_output(), including the PWM waveform and the bridge states: one
+ * input high drives, both high short the motor, both low leave only the
+ * body diodes, so current decays into the supply until it reaches zero.
+ *
+ * The compare values go through drive_interleave() and the center aligned
+ * timer counter, as on the car, unless an experiment asks for the former
+ * edge aligned timer.
+ *
+ * Six experiments are reported:
+ *   - steady speed against effort in fast and slow decay,
+ *   - wheel travel after a stop from DRIVE_PWM_DUTY, coasting or braking,
+ *   - peak current when reversing from DRIVE_PWM_DUTY, with and without the
+ *     brake dwell, against the running current averaged over whole PWM
+ *     periods, which must hold the load torque,
+ *   - both wheels of a car with mismatched motors, before and after the
+ *     compensation calibration, which runs its measurements on the
+ *     model; the compensated drift must stay within CALIBRATED_DRIFT_MAX,
+ *   - supply current ripple of both wheels at equal efforts, with the edge
+ *     aligned and the interleaved PWM,
+ *   - stall detection and thermal derating (stall.c) fed with the encoder
+ *     counts at the odometry rate: no stall from rest or on reversals,
+ *     jams cut within the bound at every effort, wheels freed by
+ *     reversing, no derating at full effort without load, and loads above
+ *     the rating held to the rated current: a drag that keeps the wheel
+ *     turning without a stall, and a heavy load that the rated current
+ *     cannot turn, held still and cut. A wheel that turns is never cut.
+ * The running current, the compensated drift and the stall results are
+ * checked, and the tool fails if one does not hold.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/motor_sim.c core/src/drive.c core/src/compensation.c core/src/param.c \
+ *         core/src/stall.c -lm -o motor_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "compensation.h"
+#include "drive.h"
+#include "stall.h"
+
+/** Definitions --------------------------------------------------- */
+#define STEP_S              1e-6
+#define PWM_PERIOD_US       1000
+#define CONTROL_PERIOD_US   10000
+#define PWM_TICKS_PER_US    (2 * DRIVE_PWM_TOP / PWM_PERIOD_US)
+
+/* Small geared hobby motor, referred to the wheel */
+#define SUPPLY_V            6.0
+#define RESISTANCE_OHM      2.0
+#define INDUCTANCE_H        1.5e-3
+#define MOTOR_K             0.25    /* V.s/rad and N.m/A */
+#define INERTIA_KG_M2       3e-4
+#define VISCOUS_NM_S        1e-4
+#define FRICTION_NM         0.015
+#define WHEEL_RADIUS_MM     32.5
+#define TRACK_WIDTH_MM      130.0
+#define COUNTS_PER_REV      80
+
+/* Weaker motor with a stiffer gearbox for the other wheel */
+#define WEAK_MOTOR_K        0.23
+#define WEAK_FRICTION_NM    0.022
+
+#define MOTOR_NOMINAL       { .k = MOTOR_K, .friction = FRICTION_NM, .drag = VISCOUS_NM_S }
+
+#define CALIBRATION_SETTLE_US   300000
+#define CALIBRATION_WINDOW_US   500000
+
+/* Worst compensated drift from effort 100 before the interleaved timer */
+#define CALIBRATED_DRIFT_MAX    4.1     /* deg/m */
+
+/* A jammed wheel, a load the motor cannot turn at the rated current and
+ * a drag that slows the wheel to about a third at full effort */
+#define JAM_FRICTION_NM     10.0
+#define HEAVY_FRICTION_NM   0.45
+#define DRAG_NM_S           0.06
+
+#define ODOMETRY_PERIOD_US  (1000000 / ODOMETRY_RATE_HZ)
+#define STALL_BOUND_US      ((STALL_WINDOW_MS + STALL_DETECT_MS) * 1000 + CONTROL_PERIOD_US)
+#define THERMAL_TAU_S       ((double)(1 << STALL_THERMAL_SHIFT) / ODOMETRY_RATE_HZ)
+
+/* One encoder count per speed window */
+#define TURNING_RAD_S       (2 * M_PI / COUNTS_PER_REV / (STALL_WINDOW_MS / 1000.0))
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    double k;           /**< V.s/rad and N.m/A */
+    double friction;    /**< N.m */
+    double drag;        /**< N.m.s */
+    double current;
+    double speed;       /**< rad/s */
+    double travel;      /**< rad */
+    double peak_current;
+    double supply;      /**< Current drawn from the supply in the last step */
+    int32_t counts_read;    /**< Encoder counts taken by the stall detector */
+    int16_t applied;        /**< Effort allowed by the stall detector */
+    uint32_t turning_cuts;  /**< Stalls detected while the wheel turned */
+    double square_sum;      /**< Current squared over the odometry period */
+    double heat;            /**< Model mean square current, in effort counts */
+    uint32_t time_us;
+    drive_output_t output;
+} motor_t;
+
+/** Two wheels driven by one drive sequencer. */
+typedef struct {
+    motor_t left;
+    motor_t right;
+    uint32_t time_us;
+    drive_output_t output;
+    bool edge_aligned;  /**< Former timer setup, both wheels switched together */
+} car_t;
+
+/** Variables ----------------------------------------------------- */
+static car_t *calibration_car = NULL;
+static int failures = 0;
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Level of a bridge input at a time, from its duty.
+ *
+ * A step spans PWM_TICKS_PER_US counter ticks, so the center aligned
+ * counter is sampled at a tick offset that advances every period: over
+ * that many periods every tick is seen once and the modeled duty is exact,
+ * rather than rounded to the ticks that fall on a step.
+ */
+static bool pwm_input(const drive_output_t *output, drive_channel_t channel, uint32_t time_us, bool edge_aligned) {
+    if (edge_aligned) {
+        return time_us % PWM_PERIOD_US < output->ccr[channel];
+    }
+
+    uint16_t compare[DRIVE_CHANNEL_COUNT];
+    uint32_t tick = time_us % PWM_PERIOD_US * PWM_TICKS_PER_US + time_us / PWM_PERIOD_US % PWM_TICKS_PER_US;
+    uint32_t counter = tick <= DRIVE_PWM_TOP ? tick : 2 * DRIVE_PWM_TOP - tick;
+
+    drive_interleave(output, compare);
+    if (channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_2) {
+        return counter < compare[channel];
+    }
+    return counter >= compare[channel];
+}
+
+/**
+ * @brief Advances the motor by one step for the given bridge inputs.
+ */
+static void motor_step(motor_t *motor, bool forward, bool reverse) {
+    double back_emf = motor->k * motor->speed;
+    double voltage;
+    bool open = false;
+
+    if (forward != reverse) {
+        voltage = forward ? SUPPLY_V : -SUPPLY_V;
+    } else if (forward) {
+        voltage = 0;
+    } else if (motor->current > 0) {
+        voltage = -SUPPLY_V;
+    } else if (motor->current < 0) {
+        voltage = SUPPLY_V;
+    } else {
+        voltage = 0;
+        open = true;
+    }
+
+    /* Driving draws the current, the diodes return it, a short holds it */
+    motor->supply = forward != reverse ? (forward ? motor->current : -motor->current)
+                    : forward || open ? 0 : -fabs(motor->current);
+
+    if (!open) {
+        double previous = motor->current;
+        motor->current += (voltage - RESISTANCE_OHM * motor->current - back_emf) / INDUCTANCE_H * STEP_S;
+        if (!forward && !reverse && previous * motor->current < 0) {
+            motor->current = 0;     /* diodes block the reversal */
+        }
+    }
+
+    double torque = motor->k * motor->current - motor->drag * motor->speed;
+    if (motor->speed > 0 || (motor->speed == 0 && torque > motor->friction)) {
+        torque -= motor->friction;
+    } else if (motor->speed < 0 || (motor->speed == 0 && torque < -motor->friction)) {
+        torque += motor->friction;
+    } else {
+        torque = 0;
+    }
+
+    double speed = motor->speed + torque / INERTIA_KG_M2 * STEP_S;
+    if (motor->speed * speed < 0) {
+        speed = 0;
+    }
+    motor->speed = speed;
+    motor->travel += speed * STEP_S;
+
+    if (fabs(motor->current) > motor->peak_current) {
+        motor->peak_current = fabs(motor->current);
+    }
+    motor->time_us++;
+}
+
+/**
+ * @brief Runs the motor with a constant effort, ticking the drive logic
+ * every control period.
+ */
+static void motor_run(motor_t *motor, int16_t effort, uint32_t duration_us) {
+    for (uint32_t n = 0; n < duration_us; n++) {
+        if (motor->time_us % CONTROL_PERIOD_US == 0) {
+            drive_setpoint_t setpoint;
+            drive_wheels(effort, effort, &setpoint);
+            drive_output(&setpoint, motor->time_us / 1000, &motor->output);
+        }
+
+        motor_step(motor, pwm_input(&motor->output, DRIVE_CHANNEL_2, motor->time_us, false),
+                   pwm_input(&motor->output, DRIVE_CHANNEL_1, motor->time_us, false));
+    }
+}
+
+/**
+ * @brief Runs both wheels of the car with constant efforts.
+ */
+static void car_run(car_t *car, int16_t left, int16_t right, uint32_t duration_us) {
+    for (uint32_t n = 0; n < duration_us; n++) {
+        if (car->time_us % CONTROL_PERIOD_US == 0) {
+            drive_setpoint_t setpoint;
+            drive_wheels(left, right, &setpoint);
+            drive_output(&setpoint, car->time_us / 1000, &car->output);
+        }
+
+        motor_step(&car->left, pwm_input(&car->output, DRIVE_CHANNEL_2, car->time_us, car->edge_aligned),
+                   pwm_input(&car->output, DRIVE_CHANNEL_1, car->time_us, car->edge_aligned));
+        motor_step(&car->right, pwm_input(&car->output, DRIVE_CHANNEL_3, car->time_us, car->edge_aligned),
+                   pwm_input(&car->output, DRIVE_CHANNEL_4, car->time_us, car->edge_aligned));
+        car->time_us++;
+    }
+}
+
+/**
+ * @brief Encoder counts of a wheel, quantized like the slotted disk.
+ */
+static int32_t wheel_counts(const motor_t *motor) {
+    return (int32_t)floor(motor->travel * COUNTS_PER_REV / (2 * M_PI));
+}
+
+/**
+ * @brief State of the left wheel in the stall detector.
+ */
+static stall_state_t stall_left(void) {
+    stall_state_t state;
+    stall_get_state(STALL_WHEEL_LEFT, &state);
+    return state;
+}
+
+/**
+ * @brief Runs the left wheel with a constant requested effort through the
+ * stall detector: it takes the encoder counts every odometry period and
+ * limits the setpoint every control period, as the firmware does.
+ */
+static void stall_run(motor_t *motor, int16_t effort, uint32_t duration_us) {
+    for (uint32_t n = 0; n < duration_us; n++) {
+        if (motor->time_us % ODOMETRY_PERIOD_US == 0) {
+            int32_t counts = wheel_counts(motor);
+            uint32_t stalls = stall_left().stalls;
+            stall_update((int16_t)(counts - motor->counts_read), 0);
+            motor->counts_read = counts;
+            if (stall_left().stalls != stalls && fabs(motor->speed) >= TURNING_RAD_S) {
+                motor->turning_cuts++;
+            }
+
+            /* Model heat, over the same time constant */
+            double square = motor->square_sum / ODOMETRY_PERIOD_US;
+            motor->heat += (square - motor->heat) / (1 << STALL_THERMAL_SHIFT);
+            motor->square_sum = 0;
+        }
+        if (motor->time_us % CONTROL_PERIOD_US == 0) {
+            drive_setpoint_t setpoint;
+            drive_wheels(effort, 0, &setpoint);
+            stall_limit(&setpoint);
+            motor->applied = setpoint.left;
+            drive_output(&setpoint, motor->time_us / 1000, &motor->output);
+        }
+
+        motor_step(motor, pwm_input(&motor->output, DRIVE_CHANNEL_2, motor->time_us, false),
+                   pwm_input(&motor->output, DRIVE_CHANNEL_1, motor->time_us, false));
+
+        double current = motor->current / (SUPPLY_V / RESISTANCE_OHM) * DRIVE_EFFORT_MAX;
+        motor->square_sum += current * current;
+    }
+}
+
+static void configure(drive_stop_t stop, drive_decay_t decay, uint16_t dwell_ms) {
+    const drive_config_t config = { .stop = stop, .decay = decay, .reverse_dwell_ms = dwell_ms };
+    drive_init(&config);
+}
+
+static void speed_curve(void) {
+    double no_load = SUPPLY_V / MOTOR_K;
+    double worst[2] = { 0, 0 };
+
+    printf("effort  speed, fast decay  slow decay  (%% of no-load)\n");
+    for (int16_t effort = 100; effort <= DRIVE_EFFORT_MAX; effort += 100) {
+        double speed[2];
+
+        for (uint8_t decay = 0; decay < 2; decay++) {
+            motor_t motor = MOTOR_NOMINAL;
+            configure(DRIVE_STOP_BRAKE, (drive_decay_t)decay, DRIVE_REVERSE_DWELL_MS);
+            motor_run(&motor, effort, 400000);
+
+            double start = motor.travel;
+            motor_run(&motor, effort, 100000);
+            speed[decay] = (motor.travel - start) / 0.1 / no_load * 100;
+
+            double error = fabs(speed[decay] - effort / 10.0);
+            if (error > worst[decay]) {
+                worst[decay] = error;
+            }
+        }
+        printf("%6d  %17.1f  %10.1f\n", effort, speed[0], speed[1]);
+    }
+    printf("worst deviation from effort: fast %.1f%%, slow %.1f%%\n\n", worst[0], worst[1]);
+}
+
+static void stop_distance(void) {
+    printf("stop from effort %d:\n", DRIVE_PWM_DUTY);
+    for (uint8_t stop = 0; stop < 2; stop++) {
+        motor_t motor = MOTOR_NOMINAL;
+        configure((drive_stop_t)stop, DRIVE_DECAY_SLOW, DRIVE_REVERSE_DWELL_MS);
+        motor_run(&motor, DRIVE_PWM_DUTY, 400000);
+
+        double start = motor.travel;
+        uint32_t start_us = motor.time_us;
+        while (motor.speed > 0 && motor.time_us - start_us < 5000000) {
+            motor_run(&motor, 0, 100);
+        }
+        printf("  %s  %6.1f mm in %4u ms\n", stop == DRIVE_STOP_COAST ? "coast" : "brake",
+               (motor.travel - start) * WHEEL_RADIUS_MM, (motor.time_us - start_us) / 1000);
+    }
+    printf("\n");
+}
+
+static void reversal(void) {
+    const uint16_t dwells[] = { 0, DRIVE_REVERSE_DWELL_MS };
+
+    printf("reversal from effort %d:\n", DRIVE_PWM_DUTY);
+    for (uint8_t i = 0; i < 2; i++) {
+        motor_t motor = MOTOR_NOMINAL;
+        configure(DRIVE_STOP_BRAKE, DRIVE_DECAY_SLOW, dwells[i]);
+        motor_run(&motor, DRIVE_PWM_DUTY, 400000 - PWM_TICKS_PER_US * PWM_PERIOD_US);
+
+        /* Mean over whole periods, the ripple depends on the sample phase */
+        double running = 0;
+        for (uint32_t n = 0; n < PWM_TICKS_PER_US * PWM_PERIOD_US; n++) {
+            motor_run(&motor, DRIVE_PWM_DUTY, 1);
+            running += motor.current / (PWM_TICKS_PER_US * PWM_PERIOD_US);
+        }
+        /* At a steady speed the mean current holds the load torque */
+        double load = (FRICTION_NM + VISCOUS_NM_S * motor.speed) / MOTOR_K;
+        CHECK(fabs(running - load) <= 0.1 * load);
+
+        motor.peak_current = 0;
+        motor_run(&motor, -DRIVE_PWM_DUTY, 400000);
+        printf("  dwell %3u ms  peak %.2f A (running %.2f A, stall %.2f A)\n", dwells[i], motor.peak_current,
+               running, SUPPLY_V / RESISTANCE_OHM);
+    }
+}
+
+/**
+ * @brief Calibration measurement, run on the simulated car.
+ */
+static uint32_t calibration_measure(drive_channel_t channel, uint16_t duty) {
+    bool left = channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_2;
+    int16_t effort = channel == DRIVE_CHANNEL_1 || channel == DRIVE_CHANNEL_4 ? -(int16_t)duty : (int16_t)duty;
+    motor_t *motor = left ? &calibration_car->left : &calibration_car->right;
+
+    car_run(calibration_car, left ? effort : 0, left ? 0 : effort, CALIBRATION_SETTLE_US);
+    int32_t start = wheel_counts(motor);
+    car_run(calibration_car, left ? effort : 0, left ? 0 : effort, CALIBRATION_WINDOW_US);
+
+    int32_t counts = wheel_counts(motor) - start;
+    return (uint32_t)(counts < 0 ? -counts : counts);
+}
+
+/**
+ * @brief Steady speeds of both wheels at a common effort, in % of the
+ * nominal no-load speed, and the heading drift they cause.
+ */
+static double car_speeds(const char *title) {
+    const int16_t efforts[] = { 20, 50, 100, 200, 400, 700, 1000 };
+    double no_load = SUPPLY_V / MOTOR_K;
+    double worst = 0;
+
+    printf("%s\neffort  left   right  (%% of no-load)  drift (deg/m)\n", title);
+    for (uint8_t i = 0; i < sizeof(efforts) / sizeof(efforts[0]); i++) {
+        car_t car = { .left = MOTOR_NOMINAL,
+                      .right = { .k = WEAK_MOTOR_K, .friction = WEAK_FRICTION_NM, .drag = VISCOUS_NM_S } };
+
+        configure(DRIVE_STOP_BRAKE, DRIVE_DECAY_SLOW, DRIVE_REVERSE_DWELL_MS);
+        car_run(&car, efforts[i], efforts[i], 400000);
+        double left = car.left.travel;
+        double right = car.right.travel;
+        car_run(&car, efforts[i], efforts[i], 500000);
+        left = (car.left.travel - left) / 0.5;
+        right = (car.right.travel - right) / 0.5;
+
+        double forward_mm = (left + right) / 2 * WHEEL_RADIUS_MM;
+        double drift = 0;
+        if (forward_mm > 0) {
+            drift = (right - left) * WHEEL_RADIUS_MM / TRACK_WIDTH_MM * 180 / M_PI / forward_mm * 1000;
+        }
+        if (efforts[i] >= 100 && fabs(drift) > worst) {
+            worst = fabs(drift);
+        }
+        printf("%6d  %5.1f  %5.1f  %16s  %+6.1f\n", efforts[i], left / no_load * 100, right / no_load * 100, "",
+               drift);
+    }
+    printf("worst drift from effort 100: %.1f deg/m\n\n", worst);
+    return worst;
+}
+
+static void calibration(void) {
+    car_t car = { .left = MOTOR_NOMINAL,
+                  .right = { .k = WEAK_MOTOR_K, .friction = WEAK_FRICTION_NM, .drag = VISCOUS_NM_S } };
+    compensation_channel_t channels[DRIVE_CHANNEL_COUNT];
+
+    compensation_init(NULL);
+    car_speeds("mismatched wheels, no compensation:");
+
+    configure(DRIVE_STOP_BRAKE, DRIVE_DECAY_SLOW, DRIVE_REVERSE_DWELL_MS);
+    calibration_car = &car;
+    bool calibrated = compensation_calibrate(calibration_measure, channels);
+    calibration_car = NULL;
+
+    printf("calibration %s in %.1f s:\n", calibrated ? "done" : "FAILED", car.time_us / 1e6);
+    for (uint8_t c = 0; c < DRIVE_CHANNEL_COUNT; c++) {
+        printf("  CH%u deadband %3u gain %.3f lut", c + 1, channels[c].deadband,
+               channels[c].gain / (double)COMPENSATION_GAIN_ONE);
+        for (uint8_t k = 0; k < COMPENSATION_LUT_POINTS; k++) {
+            printf(" %4u", channels[c].lut[k]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    compensation_init(channels);
+    double drift = car_speeds("mismatched wheels, compensated:");
+    compensation_init(NULL);
+    CHECK(calibrated);
+    CHECK(drift <= CALIBRATED_DRIFT_MAX);
+}
+
+/**
+ * @brief Supply current of both wheels at equal efforts: mean, RMS ripple
+ * and peak, with both wheels switched together and interleaved.
+ */
+static void supply_ripple(void) {
+    const int16_t efforts[] = { 200, 400, DRIVE_PWM_DUTY, 900 };
+    double worst[2] = { 0, 0 };
+
+    printf("supply current, both wheels, slow decay:\n");
+    printf("effort  edge aligned: mean   ripple  peak    interleaved: mean   ripple  peak  (A)\n");
+    for (uint8_t i = 0; i < sizeof(efforts) / sizeof(efforts[0]); i++) {
+        double mean[2];
+        double ripple[2];
+        double peak[2];
+
+        for (uint8_t edge = 0; edge < 2; edge++) {
+            car_t car = { .left = MOTOR_NOMINAL, .right = MOTOR_NOMINAL, .edge_aligned = edge == 0 };
+            double sum = 0;
+            double square = 0;
+
+            configure(DRIVE_STOP_BRAKE, DRIVE_DECAY_SLOW, DRIVE_REVERSE_DWELL_MS);
+            car_run(&car, efforts[i], efforts[i], 400000);
+
+            peak[edge] = 0;
+            for (uint32_t n = 0; n < 100000; n++) {
+                car_run(&car, efforts[i], efforts[i], 1);
+                double supply = car.left.supply + car.right.supply;
+                sum += supply;
+                square += supply * supply;
+                peak[edge] = supply > peak[edge] ? supply : peak[edge];
+            }
+            mean[edge] = sum / 100000;
+            ripple[edge] = sqrt(square / 100000 - mean[edge] * mean[edge]);
+            if (ripple[edge] > worst[edge]) {
+                worst[edge] = ripple[edge];
+            }
+        }
+        printf("%6d  %18.2f  %6.2f  %5.2f  %17.2f  %6.2f  %5.2f\n", efforts[i], mean[0], ripple[0], peak[0], mean[1],
+               ripple[1], peak[1]);
+    }
+    printf("worst RMS ripple: edge aligned %.2f A, interleaved %.2f A\n", worst[0], worst[1]);
+}
+
+/**
+ * @brief Stall detection and thermal derating against the motor model.
+ */
+static void stall(void) {
+    const int16_t efforts[] = { STALL_EFFORT_MIN, 500, 700, DRIVE_EFFORT_MAX };
+    uint32_t worst_us = 0;
+
+    printf("\nstall detection, bound %u ms:\n", STALL_BOUND_US / 1000);
+    printf("effort  start and reverse  jam cut after  freed by reversing\n");
+    configure(DRIVE_STOP_BRAKE, DRIVE_DECAY_SLOW, DRIVE_REVERSE_DWELL_MS);
+    for (uint8_t i = 0; i < sizeof(efforts) / sizeof(efforts[0]); i++) {
+        for (int8_t sign = 1; sign >= -1; sign -= 2) {
+            int16_t effort = (int16_t)(sign * efforts[i]);
+            motor_t motor = MOTOR_NOMINAL;
+
+            /* Free wheel: from rest, then reversed */
+            stall_init();
+            stall_run(&motor, effort, 1000000);
+            stall_run(&motor, (int16_t)-effort, 1000000);
+            bool free = stall_left().stalls == 0;
+            CHECK(free);
+
+            /* Jammed while driven */
+            stall_init();
+            stall_run(&motor, effort, 500000);
+            motor.friction = JAM_FRICTION_NM;
+            uint32_t start_us = motor.time_us;
+            while (!stall_left().stalled && motor.time_us - start_us < 4 * STALL_BOUND_US) {
+                stall_run(&motor, effort, 1000);
+            }
+            uint32_t cut_us = motor.time_us - start_us;
+            CHECK(cut_us <= STALL_BOUND_US);
+            stall_run(&motor, effort, CONTROL_PERIOD_US);
+            CHECK(motor.applied == 0);
+            worst_us = cut_us > worst_us ? cut_us : worst_us;
+
+            /* Cleared, then driven the other way */
+            motor.friction = FRICTION_NM;
+            double travel = motor.travel;
+            stall_run(&motor, (int16_t)-effort, 500000);
+            bool freed = !stall_left().stalled && (motor.travel - travel) * sign < 0;
+            CHECK(freed);
+
+            printf("%6d  %17s  %10u ms  %18s\n", effort, free ? "no stall" : "STALLED", cut_us / 1000,
+                   freed ? "yes" : "NO");
+        }
+    }
+    printf("worst jam cut: %u ms\n", worst_us / 1000);
+
+    /* Full effort without load, for longer than the thermal time constant */
+    motor_t motor = MOTOR_NOMINAL;
+    int16_t lowest = DRIVE_EFFORT_MAX;
+    stall_init();
+    for (uint32_t s = 0; s < 60; s++) {
+        stall_run(&motor, DRIVE_EFFORT_MAX, 1000000);
+        lowest = stall_left().limit < lowest ? stall_left().limit : lowest;
+    }
+    printf("\nthermal, time constant %.0f s:\n", THERMAL_TAU_S);
+    printf("  no load, full effort, 60 s: RMS current %.0f, estimate %.0f, lowest limit %d\n", sqrt(motor.heat),
+           sqrt(stall_left().heat), lowest);
+    CHECK(lowest == DRIVE_EFFORT_MAX);
+
+    /* Loads above the rating: held to the rated current, a turning wheel
+     * is never cut */
+    const struct {
+        const char *name;
+        double friction;
+        double drag;
+    } loads[] = {
+        { "heavy load", HEAVY_FRICTION_NM, VISCOUS_NM_S },
+        { "drag", FRICTION_NM, DRAG_NM_S },
+    };
+    for (uint8_t i = 0; i < sizeof(loads) / sizeof(loads[0]); i++) {
+        double hottest = 0;
+        motor = (motor_t)MOTOR_NOMINAL;
+        motor.friction = loads[i].friction;
+        motor.drag = loads[i].drag;
+        stall_init();
+        for (uint32_t s = 0; s < 240; s++) {
+            stall_run(&motor, DRIVE_EFFORT_MAX, 1000000);
+            hottest = motor.heat > hottest ? motor.heat : hottest;
+            CHECK(stall_left().heat >= motor.heat);
+            if (s % 40 == 39) {
+                printf("  %s, %3u s: RMS current %.0f, estimate %.0f, limit %4d, speed %4.1f%%, %u stalls\n",
+                       loads[i].name, s + 1, sqrt(motor.heat), sqrt(stall_left().heat), stall_left().limit,
+                       motor.speed / (SUPPLY_V / MOTOR_K) * 100, stall_left().stalls);
+            }
+        }
+        printf("  %s: hottest RMS current %.0f (rated %d), %u stalls while turning\n", loads[i].name,
+               sqrt(hottest), STALL_RATED_CURRENT, motor.turning_cuts);
+        CHECK(stall_left().limit < DRIVE_EFFORT_MAX);
+        CHECK(sqrt(hottest) <= STALL_RATED_CURRENT);
+        CHECK(motor.turning_cuts == 0);
+    }
+    CHECK(stall_left().stalls == 0);
+    CHECK(motor.speed >= TURNING_RAD_S);
+}
+
+/** Public functions ---------------------------------------------- */
+int main(void) {
+    speed_curve();
+    stop_distance();
+    reversal();
+    calibration();
+    supply_ripple();
+    stall();
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
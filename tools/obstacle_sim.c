@@ -0,0 +1,176 @@
+/**
+ * @file
+ * @brief Host tool: plant model checking the emergency brake stopping
+ * distance.
+ *
+ * The car drives towards a wall at a constant commanded effort. Speed
+ * follows the effort with a first-order lag. Once the motors are cut it
+ * decelerates at a constant rate from friction, plus a speed proportional
+ * term when the bridge shorts the motors (DRIVE_STOP_BRAKE). The sensor is sampled every ranging period
+ * and its result is available after the echo returns; the firmware rule
+ * (obstacle_check/obstacle_clamp) runs every control tick on the latest
+ * range. For each effort the distance left to the wall after stopping is
+ * reported for both stop modes; it must stay positive.
+ *
+ * Usage: obstacle_sim [-d decel_mm_s2] [-n noise_mm] [-s start_mm]
+ *   -d  Actual friction deceleration, to check the margin against a worse
+ *       floor than the firmware assumes (default OBSTACLE_DECEL_MM_S2).
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/obstacle_sim.c core/src/obstacle.c core/src/drive.c \
+ *         core/src/compensation.c core/src/param.c -o obstacle_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "drive.h"
+#include "obstacle.h"
+#include "ultrasonic.h"
+
+/** Definitions --------------------------------------------------- */
+#define STEP_US             100
+#define CONTROL_PERIOD_US   10000
+#define RANGING_PERIOD_US   40000
+#define MOTOR_TAU_US        100000
+#define SOUND_MM_PER_US     0.343
+#define BRAKE_TAU_US        150000  /* Speed time constant of a shorted motor */
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    double stop_distance_mm;
+    double brake_speed_mm_s;
+    bool collided;
+} sim_result_t;
+
+/** Internal functions -------------------------------------------- */
+static double noise(double amplitude) {
+    return amplitude * (2.0 * rand() / RAND_MAX - 1.0);
+}
+
+/**
+ * @brief Runs one approach until the car stops or hits the wall.
+ */
+static sim_result_t simulate(int16_t effort, drive_stop_t stop, double start_mm, double decel_mm_s2,
+                             double noise_mm) {
+    const drive_config_t config = { .stop = stop, .decay = DRIVE_DECAY_SLOW,
+                                    .reverse_dwell_ms = DRIVE_REVERSE_DWELL_MS };
+    double position = 0;
+    double speed = 0;
+    uint16_t range = ULTRASONIC_RANGE_INVALID;
+    double pending_range = 0;
+    int64_t pending_ready_us = -1;
+    bool motors_on = true;
+    bool shorted = false;
+    sim_result_t result = { 0 };
+
+    drive_init(&config);
+
+    for (int64_t t = 0; t < 120000000; t += STEP_US) {
+        double distance = start_mm - position;
+
+        if (distance <= 0) {
+            result.collided = true;
+            result.stop_distance_mm = distance;
+            return result;
+        }
+
+        if (t % RANGING_PERIOD_US == 0) {
+            double measured = distance + noise(noise_mm);
+            pending_range = measured > ULTRASONIC_RANGE_MAX_MM ? ULTRASONIC_RANGE_MAX_MM : measured;
+            pending_ready_us = t + (int64_t)(2 * distance / SOUND_MM_PER_US);
+        }
+        if (pending_ready_us >= 0 && t >= pending_ready_us) {
+            range = (uint16_t)pending_range;
+            pending_ready_us = -1;
+        }
+
+        if (t % CONTROL_PERIOD_US == 0) {
+            drive_setpoint_t setpoint;
+            drive_wheels(effort, effort, &setpoint);
+
+            if (obstacle_check(&setpoint, range)) {
+                obstacle_clamp(&setpoint);
+            }
+
+            drive_output_t output;
+            drive_output(&setpoint, (uint32_t)(t / 1000), &output);
+
+            bool on = output.ccr[DRIVE_CHANNEL_2] != output.ccr[DRIVE_CHANNEL_1];
+            if (motors_on && !on) {
+                result.brake_speed_mm_s = speed;
+            }
+            motors_on = on;
+            shorted = output.ccr[DRIVE_CHANNEL_1] == DRIVE_EFFORT_MAX;
+        }
+
+        double dt = STEP_US * 1e-6;
+        if (motors_on) {
+            double target = (double)effort * OBSTACLE_FULL_SPEED_MM_S / DRIVE_EFFORT_MAX;
+            speed += (target - speed) * STEP_US / MOTOR_TAU_US;
+        } else {
+            speed -= (decel_mm_s2 + (shorted ? speed * 1e6 / BRAKE_TAU_US : 0)) * dt;
+            if (speed <= 0) {
+                result.stop_distance_mm = distance;
+                return result;
+            }
+        }
+        position += speed * dt;
+    }
+
+    result.stop_distance_mm = start_mm - position;
+    return result;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    double decel = OBSTACLE_DECEL_MM_S2;
+    double noise_mm = 10;
+    double start_mm = 3000;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:n:s:")) != -1) {
+        switch (option) {
+            case 'd': {
+                decel = strtod(optarg, NULL);
+                break;
+            }
+            case 'n': {
+                noise_mm = strtod(optarg, NULL);
+                break;
+            }
+            case 's': {
+                start_mm = strtod(optarg, NULL);
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s [-d decel_mm_s2] [-n noise_mm] [-s start_mm]\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    int result = 0;
+
+    printf("effort  threshold(mm)  brake speed(mm/s)  stopped at, coast(mm)  brake(mm)\n");
+    for (int16_t effort = 100; effort <= DRIVE_EFFORT_MAX; effort += 100) {
+        drive_setpoint_t setpoint;
+        drive_wheels(effort, effort, &setpoint);
+
+        sim_result_t coast = simulate(effort, DRIVE_STOP_COAST, start_mm, decel, noise_mm);
+        sim_result_t brake = simulate(effort, DRIVE_STOP_BRAKE, start_mm, decel, noise_mm);
+        printf("%6d  %13u  %17.0f  %21.0f  %9.0f%s\n", effort, obstacle_threshold(&setpoint),
+               brake.brake_speed_mm_s, coast.stop_distance_mm, brake.stop_distance_mm,
+               coast.collided || brake.collided ? "  COLLISION" : "");
+
+        if (coast.collided || brake.collided) {
+            result = 1;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file
+ * @brief Host tool: accuracy and cost of the fixed-point odometry.
+ *
+ * Wheel speed profiles are turned into integer encoder counts per update
+ * period, as the timers would report them. The same counts are integrated
+ * by odometry_update() and by a double precision reference, so the reported
+ * error is the fixed-point error alone (encoder quantisation affects both).
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/odometry_bench.c core/src/odometry.c \
+ *         core/src/fixmath.c -lm -o odometry_bench
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "odometry.h"
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    const char *name;
+    double seconds;
+    double left_mm_s;
+    double right_mm_s;
+} segment_t;
+
+typedef struct {
+    const char *name;
+    const segment_t *segments;
+    uint8_t count;
+} path_t;
+
+typedef struct {
+    double x;
+    double y;
+    double heading;
+} reference_t;
+
+/** Variables ----------------------------------------------------- */
+static const segment_t straight[] = {
+    { "forward", 20.0, 500.0, 500.0 },
+};
+
+static const segment_t circle[] = {
+    { "arc", 30.0, 300.0, 450.0 },
+};
+
+static const segment_t square[] = {
+    { "side", 2.0, 500.0, 500.0 }, { "turn", 0.5105, -200.0, 200.0 },
+    { "side", 2.0, 500.0, 500.0 }, { "turn", 0.5105, -200.0, 200.0 },
+    { "side", 2.0, 500.0, 500.0 }, { "turn", 0.5105, -200.0, 200.0 },
+    { "side", 2.0, 500.0, 500.0 }, { "turn", 0.5105, -200.0, 200.0 },
+};
+
+static const path_t paths[] = {
+    { "straight 10 m", straight, 1 },
+    { "circle", circle, 1 },
+    { "square 1 m", square, 8 },
+};
+
+/** Internal functions -------------------------------------------- */
+static void reference_update(reference_t *reference, int16_t left_counts, int16_t right_counts) {
+    double um_per_count = M_PI * ODOMETRY_WHEEL_DIAMETER_UM / ODOMETRY_COUNTS_PER_REV;
+    double left = left_counts * um_per_count;
+    double right = right_counts * um_per_count;
+    double distance = (left + right) / 2;
+    double turn = (right - left) / ODOMETRY_TRACK_WIDTH_UM;
+
+    reference->x += distance * cos(reference->heading + turn / 2);
+    reference->y += distance * sin(reference->heading + turn / 2);
+    reference->heading += turn;
+}
+
+static double wrap(double angle) {
+    return atan2(sin(angle), cos(angle));
+}
+
+/**
+ * @brief Runs one path and prints the pose error.
+ */
+static void run_path(const path_t *path) {
+    double counts_per_mm = ODOMETRY_COUNTS_PER_REV / (M_PI * ODOMETRY_WHEEL_DIAMETER_UM / 1000.0);
+    double left_position = 0;
+    double right_position = 0;
+    int32_t left_reported = 0;
+    int32_t right_reported = 0;
+    reference_t reference = { 0 };
+    double worst_mm = 0;
+
+    odometry_init();
+
+    for (uint8_t s = 0; s < path->count; s++) {
+        const segment_t *segment = &path->segments[s];
+        uint32_t updates = (uint32_t)(segment->seconds * ODOMETRY_RATE_HZ + 0.5);
+
+        for (uint32_t n = 0; n < updates; n++) {
+            left_position += segment->left_mm_s / ODOMETRY_RATE_HZ * counts_per_mm;
+            right_position += segment->right_mm_s / ODOMETRY_RATE_HZ * counts_per_mm;
+
+            int16_t left_counts = (int16_t)(lround(left_position) - left_reported);
+            int16_t right_counts = (int16_t)(lround(right_position) - right_reported);
+            left_reported += left_counts;
+            right_reported += right_counts;
+
+            odometry_update(left_counts, right_counts);
+            reference_update(&reference, left_counts, right_counts);
+
+            odometry_pose_t pose;
+            odometry_get_pose(&pose);
+            double error = hypot(pose.x_um - reference.x, pose.y_um - reference.y) / 1000.0;
+            if (error > worst_mm) {
+                worst_mm = error;
+            }
+        }
+    }
+
+    odometry_pose_t pose;
+    odometry_get_pose(&pose);
+
+    double heading = pose.heading / 2147483648.0 * M_PI;
+    printf("%-14s end (%9.2f, %9.2f) mm %8.3f deg, reference (%9.2f, %9.2f) mm %8.3f deg\n", path->name,
+           pose.x_um / 1000.0, pose.y_um / 1000.0, heading * 180 / M_PI, reference.x / 1000.0,
+           reference.y / 1000.0, wrap(reference.heading) * 180 / M_PI);
+    printf("%-14s worst position error %.3f mm, heading error %.5f deg\n", "", worst_mm,
+           fabs(wrap(heading - reference.heading)) * 180 / M_PI);
+}
+
+/**
+ * @brief Measures the cost of one update.
+ */
+static void benchmark(void) {
+    const uint32_t updates = 10000000;
+    struct timespec start, end;
+
+    odometry_init();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < updates; n++) {
+        odometry_update((int16_t)(3 + (n & 1)), (int16_t)(4 - (n & 3)));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%.2f ns per update on this host\n", ns / updates);
+}
+
+/** Public functions ---------------------------------------------- */
+int main(void) {
+    for (uint8_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        run_path(&paths[i]);
+    }
+
+    benchmark();
+    return 0;
+}
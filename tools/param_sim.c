@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @brief Host tool: checks the parameter table, its range checks and the
+ * snapshots.
+ *
+ * Checks:
+ *   - defaults:  every value starts at its default, before and after
+ *                param_init(NULL), and every default is within its range.
+ *   - set:       values out of range and unknown IDs are refused and leave
+ *                the values alone.
+ *   - snapshot:  a snapshot round trips; one from an older build with fewer
+ *                values loads those and defaults the rest; another version,
+ *                a bad magic or a stored value out of range is not used.
+ *   - layout:    the snapshot fits in half a settings page.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/param_sim.c core/src/param.c -o param_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "boot_control.h"
+#include "drive.h"
+#include "line.h"
+#include "param.h"
+
+/** Definitions --------------------------------------------------- */
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Variables ----------------------------------------------------- */
+static int failures = 0;
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Checks every value is at its default.
+ */
+static bool at_defaults(void) {
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        param_entry_t entry;
+        param_describe(id, &entry);
+        if (entry.value != entry.default_value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(void) {
+    param_record_t record;
+    param_entry_t entry;
+
+    printf("defaults\n");
+    CHECK(at_defaults());
+    CHECK(param_get(PARAM_DRIVE_DUTY) == DRIVE_PWM_DUTY);
+    CHECK(param_get(PARAM_LINE_KP) == LINE_KP);
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        CHECK(param_describe(id, &entry) == PARAM_STATUS_OK);
+        CHECK(entry.min <= entry.default_value && entry.default_value <= entry.max);
+    }
+    CHECK(!param_init(NULL));
+    CHECK(at_defaults());
+
+    printf("set\n");
+    CHECK(param_set(PARAM_DRIVE_DUTY, 450) == PARAM_STATUS_OK);
+    CHECK(param_get(PARAM_DRIVE_DUTY) == 450);
+    CHECK(param_set(PARAM_DRIVE_DUTY, DRIVE_EFFORT_MAX + 1) == PARAM_STATUS_RANGE);
+    CHECK(param_set(PARAM_DRIVE_DUTY, -1) == PARAM_STATUS_RANGE);
+    CHECK(param_get(PARAM_DRIVE_DUTY) == 450);
+    CHECK(param_set(PARAM_COUNT, 0) == PARAM_STATUS_UNKNOWN);
+    CHECK(param_describe(PARAM_COUNT, &entry) == PARAM_STATUS_UNKNOWN);
+    CHECK(entry.id == PARAM_COUNT && entry.status == PARAM_STATUS_UNKNOWN);
+
+    printf("snapshot\n");
+    CHECK(param_set(PARAM_LINE_KD, 20) == PARAM_STATUS_OK);
+    CHECK(param_set(PARAM_HEADING_KD, 7) == PARAM_STATUS_OK);
+    param_snapshot(&record);
+    CHECK(record.magic == PARAM_MAGIC && record.version == PARAM_VERSION && record.count == PARAM_COUNT);
+    param_init(NULL);
+    CHECK(param_init(&record));
+    CHECK(param_get(PARAM_DRIVE_DUTY) == 450);
+    CHECK(param_get(PARAM_LINE_KD) == 20);
+    CHECK(param_get(PARAM_HEADING_KD) == 7);
+
+    record.count = PARAM_LINE_KD;
+    CHECK(param_init(&record));
+    CHECK(param_get(PARAM_DRIVE_DUTY) == 450);
+    CHECK(param_get(PARAM_LINE_KD) == LINE_KD);
+
+    record.count = PARAM_COUNT;
+    record.values[PARAM_LINE_KD] = 10000;
+    CHECK(param_init(&record));
+    CHECK(param_get(PARAM_DRIVE_DUTY) == 450);
+    CHECK(param_get(PARAM_LINE_KD) == LINE_KD);
+
+    record.version = PARAM_VERSION + 1;
+    CHECK(!param_init(&record));
+    CHECK(at_defaults());
+
+    record.version = PARAM_VERSION;
+    record.magic = ~PARAM_MAGIC;
+    CHECK(!param_init(&record));
+    CHECK(at_defaults());
+
+    printf("layout: %zu byte snapshot\n", sizeof(param_record_t));
+    CHECK(sizeof(param_record_t) <= BOOT_PAGE_SIZE / 2);
+    CHECK(offsetof(param_record_t, crc) == sizeof(param_record_t) - sizeof(uint32_t));
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
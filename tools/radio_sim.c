@@ -0,0 +1,449 @@
+/**
+ * @file
+ * @brief Host tool: runs the radio link against a simulated nRF24L01+ and
+ * a controller sending drive commands, and measures the latency.
+ *
+ * The simulated radio keeps the register map, a 3 deep RX FIFO, a 3 deep
+ * acknowledgment payload FIFO and the active low IRQ line. It only receives
+ * once it was configured the way the controller expects (address, channel,
+ * dynamic payloads, acknowledgment payloads, CONFIG, CE high) and
+ * register writes are ignored during the power on reset. SPI transfers
+ * take 1 us per byte plus the setup time, and complete through
+ * radio_bus_done() as the DMA interrupt does. radio_tick() runs every
+ * ms with the bus windows of the PWM timer slots (1, 3 and 4 of 5).
+ *
+ * The controller sends a 6 byte command and takes the acknowledgment
+ * payload back, if there is one. The latency is measured from the packet
+ * reaching the radio to the command reaching the motors, at the first PWM
+ * update after its delivery.
+ *
+ * Scenarios:
+ *   - steady: commands at 100 Hz; every one must be delivered in order
+ *             within LATENCY_LIMIT_US, and each acknowledgment must carry
+ *             the sequence of the command before it.
+ *   - burst:  three commands back to back, filling the RX FIFO.
+ *   - bad:    payloads of the wrong size are counted and dropped.
+ *   - reset:  the radio loses power; the idle check must configure it
+ *             again and commands must flow within RECOVERY_LIMIT_MS.
+ *
+ * Usage: radio_sim [-v]
+ *   -v  Print every command delivered.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/radio_sim.c core/src/radio.c -o radio_sim
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "radio.h"
+
+/** Definitions --------------------------------------------------- */
+#define SLOTS               5
+#define BYTE_US             1
+#define SETUP_US            3
+#define POWER_ON_US         100000
+#define STANDBY_US          1500
+#define FIFO_DEPTH          3
+
+#define STEADY_MS           5000
+#define COMMAND_PERIOD_US   10000
+#define LATENCY_LIMIT_US    10000
+#define RECOVERY_LIMIT_MS   500
+#define BRING_UP_MS         300
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition);       \
+            failures++;                                                         \
+        }                                                                       \
+    } while (0)
+
+/** Types --------------------------------------------------------- */
+typedef struct {
+    uint8_t width;
+    uint8_t bytes[RADIO_PAYLOAD_MAX];
+} payload_t;
+
+typedef struct {
+    payload_t items[FIFO_DEPTH];
+    uint8_t count;
+} fifo_t;
+
+typedef struct {
+    uint8_t registers[0x20];
+    uint8_t address[RADIO_ADDRESS_SIZE];
+    fifo_t rx_fifo;
+    fifo_t tx_fifo;
+    bool ce;
+    uint64_t power_on_us;
+    uint64_t power_up_us;       /**< PWR_UP set */
+} chip_t;
+
+/** Transfer in flight. */
+typedef struct {
+    bool busy;
+    uint64_t done_us;
+    uint8_t *rx;
+    uint8_t result[1 + RADIO_PAYLOAD_MAX];
+    uint8_t size;
+} bus_t;
+
+typedef struct {
+    uint32_t delivered;
+    uint32_t out_of_order;
+    uint32_t max_latency_us;
+    uint8_t expected;           /**< Next sequence */
+    bool started;
+    uint64_t sent_us[256];      /**< Arrival time of each sequence */
+} receiver_t;
+
+/** Variables ----------------------------------------------------- */
+static int failures = 0;
+static bool verbose = false;
+
+static chip_t chip;
+static bus_t bus;
+static receiver_t receiver;
+static uint64_t now_us = 0;
+
+static const uint8_t controller_address[RADIO_ADDRESS_SIZE] = { RADIO_ADDRESS_BYTES };
+
+/** Internal functions -------------------------------------------- */
+static uint8_t chip_status(void) {
+    uint8_t status = chip.registers[RADIO_REG_STATUS] & RADIO_STATUS_CLEAR;
+
+    status |= chip.rx_fifo.count == 0 ? RADIO_STATUS_RX_EMPTY : 0;
+    status |= chip.tx_fifo.count == FIFO_DEPTH ? RADIO_STATUS_TX_FULL : 0;
+    return status;
+}
+
+static bool chip_irq_active(void) {
+    return (chip.registers[RADIO_REG_STATUS] & RADIO_STATUS_RX_DR) != 0;
+}
+
+static void chip_power_on(void) {
+    memset(&chip, 0, sizeof(chip));
+    chip.registers[RADIO_REG_CONFIG] = 0x08;
+    chip.registers[RADIO_REG_EN_AA] = 0x3F;
+    chip.registers[RADIO_REG_EN_RXADDR] = 0x03;
+    chip.registers[RADIO_REG_SETUP_AW] = 0x03;
+    chip.registers[RADIO_REG_RF_CH] = 0x02;
+    chip.registers[RADIO_REG_RF_SETUP] = 0x0F;
+    memset(chip.address, 0xE7, sizeof(chip.address));
+    chip.power_on_us = now_us;
+}
+
+static void fifo_pop(fifo_t *fifo) {
+    memmove(&fifo->items[0], &fifo->items[1], (FIFO_DEPTH - 1) * sizeof(fifo->items[0]));
+    fifo->count--;
+}
+
+/**
+ * @brief Runs an SPI command; the result is what the chip clocks out.
+ */
+static void chip_spi(const uint8_t *tx, uint8_t *result, uint8_t size) {
+    bool ready = now_us - chip.power_on_us >= POWER_ON_US;
+    uint8_t command = tx[0];
+
+    memset(result, 0, size);
+    result[0] = chip_status();
+
+    if ((command & 0xE0) == RADIO_CMD_R_REGISTER) {
+        uint8_t reg = command & 0x1F;
+        for (uint8_t i = 1; i < size; i++) {
+            result[i] = reg == RADIO_REG_RX_ADDR_P0 ? chip.address[(i - 1) % RADIO_ADDRESS_SIZE]
+                                                    : reg == RADIO_REG_STATUS ? chip_status() : chip.registers[reg];
+        }
+    } else if ((command & 0xE0) == RADIO_CMD_W_REGISTER && ready) {
+        uint8_t reg = command & 0x1F;
+        if (reg == RADIO_REG_RX_ADDR_P0) {
+            memcpy(chip.address, &tx[1], size - 1 < RADIO_ADDRESS_SIZE ? size - 1 : RADIO_ADDRESS_SIZE);
+        } else if (reg == RADIO_REG_STATUS) {
+            chip.registers[reg] &= (uint8_t)~(tx[1] & RADIO_STATUS_CLEAR);
+        } else {
+            if (reg == RADIO_REG_CONFIG && (tx[1] & 0x02) != 0 && (chip.registers[reg] & 0x02) == 0) {
+                chip.power_up_us = now_us;
+            }
+            chip.registers[reg] = tx[1];
+        }
+    } else if (command == RADIO_CMD_R_RX_PL_WID) {
+        result[1] = chip.rx_fifo.count > 0 ? chip.rx_fifo.items[0].width : 0;
+    } else if (command == RADIO_CMD_R_RX_PAYLOAD) {
+        if (chip.rx_fifo.count > 0) {
+            memcpy(&result[1], chip.rx_fifo.items[0].bytes, size - 1);
+            fifo_pop(&chip.rx_fifo);
+        }
+    } else if (command == RADIO_CMD_W_ACK_PAYLOAD && ready) {
+        if (chip.tx_fifo.count < FIFO_DEPTH) {
+            payload_t *item = &chip.tx_fifo.items[chip.tx_fifo.count++];
+            item->width = (uint8_t)(size - 1);
+            memcpy(item->bytes, &tx[1], size - 1);
+        }
+    } else if (command == RADIO_CMD_FLUSH_RX) {
+        chip.rx_fifo.count = 0;
+    } else if (command == RADIO_CMD_FLUSH_TX) {
+        chip.tx_fifo.count = 0;
+    }
+}
+
+/**
+ * @brief Checks that the chip listens where the controller sends.
+ */
+static bool chip_listening(void) {
+    return chip.ce && chip.registers[RADIO_REG_CONFIG] == RADIO_CONFIG_VALUE
+           && now_us - chip.power_up_us >= STANDBY_US && chip.registers[RADIO_REG_RF_CH] == RADIO_CHANNEL
+           && chip.registers[RADIO_REG_SETUP_AW] == RADIO_SETUP_AW_5_BYTES
+           && (chip.registers[RADIO_REG_EN_RXADDR] & RADIO_PIPE_0) != 0
+           && (chip.registers[RADIO_REG_EN_AA] & RADIO_PIPE_0) != 0
+           && chip.registers[RADIO_REG_FEATURE] == RADIO_FEATURE_DPL_ACK_PAY
+           && (chip.registers[RADIO_REG_DYNPD] & RADIO_PIPE_0) != 0
+           && memcmp(chip.address, controller_address, RADIO_ADDRESS_SIZE) == 0;
+}
+
+/**
+ * @brief A packet over the air: stored if there is room, acknowledged with
+ * the payload on top of the TX FIFO.
+ *
+ * @return false if the packet was not acknowledged.
+ */
+static bool chip_receive(const uint8_t *bytes, uint8_t size, radio_telemetry_t *ack, bool *has_ack) {
+    *has_ack = false;
+    if (!chip_listening() || chip.rx_fifo.count == FIFO_DEPTH) {
+        return false;
+    }
+
+    payload_t *item = &chip.rx_fifo.items[chip.rx_fifo.count++];
+    item->width = size;
+    memcpy(item->bytes, bytes, size);
+
+    if (chip.tx_fifo.count > 0) {
+        memcpy(ack, chip.tx_fifo.items[0].bytes, sizeof(*ack));
+        fifo_pop(&chip.tx_fifo);
+        *has_ack = true;
+    }
+
+    bool edge = !chip_irq_active();
+    chip.registers[RADIO_REG_STATUS] |= RADIO_STATUS_RX_DR;
+    if (edge) {
+        radio_irq();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Runs the simulation up to a time: transfer completions, then the
+ * ticks.
+ */
+static void run_until(uint64_t end_us) {
+    while (now_us < end_us) {
+        now_us++;
+
+        if (bus.busy && now_us >= bus.done_us) {
+            bus.busy = false;
+            memcpy(bus.rx, bus.result, bus.size);
+            radio_bus_done();
+        }
+
+        if (now_us % 1000 == 0) {
+            uint32_t slot = (uint32_t)(now_us / 1000) % SLOTS;
+            radio_tick(slot != 0 && slot != SLOTS / 2);
+        }
+    }
+}
+
+/**
+ * @brief Sends a command at the current time.
+ *
+ * @return true if it was acknowledged; the acknowledgment payload is in ack
+ *         if has_ack is set.
+ */
+static bool send(uint8_t sequence, int16_t left, radio_telemetry_t *ack, bool *has_ack) {
+    serial_command_t command = { .type = SERIAL_FRAME_WHEELS, .sequence = sequence, .a = left, .b = -left };
+    uint8_t bytes[sizeof(command)];
+
+    memcpy(bytes, &command, sizeof(command));
+    receiver.sent_us[sequence] = now_us;
+    return chip_receive(bytes, sizeof(bytes), ack, has_ack);
+}
+
+/**
+ * @brief Sends commands at the period for a while, checking the
+ * acknowledgment sequences.
+ *
+ * @return Number of commands acknowledged.
+ */
+static uint32_t stream(uint8_t *sequence, uint32_t duration_ms, uint32_t *sent, uint32_t *lagging, uint32_t *acks) {
+    uint64_t end_us = now_us + duration_ms * 1000ull;
+    uint32_t acknowledged = 0;
+
+    while (now_us < end_us) {
+        radio_telemetry_t ack;
+        bool has_ack;
+
+        if (send(*sequence, (int16_t)(*sequence * 3), &ack, &has_ack)) {
+            acknowledged++;
+            if (has_ack) {
+                (*acks)++;
+                *lagging += ack.sequence == (uint8_t)(*sequence - 1) ? 1 : 0;
+            }
+        }
+        (*sequence)++;
+        (*sent)++;
+        /* Some phase drift against the tick */
+        run_until(now_us + COMMAND_PERIOD_US + (*sequence % 7) * 37);
+    }
+
+    return acknowledged;
+}
+
+static void handler(const serial_command_t *command) {
+    /* Applied at the next PWM update */
+    uint64_t applied_us = (now_us / 1000 + 1) * 1000;
+    uint32_t latency_us = (uint32_t)(applied_us - receiver.sent_us[command->sequence]);
+
+    if (receiver.started && command->sequence != receiver.expected) {
+        receiver.out_of_order++;
+    }
+    receiver.started = true;
+    receiver.expected = (uint8_t)(command->sequence + 1);
+    receiver.delivered++;
+    receiver.max_latency_us = latency_us > receiver.max_latency_us ? latency_us : receiver.max_latency_us;
+
+    radio_telemetry_t telemetry = { .source = 1, .range_mm = 500, .left = command->a, .right = command->b };
+    radio_set_telemetry(&telemetry);
+
+    if (verbose) {
+        printf("    %8.3f ms  seq %3u  a %5d  latency %5u us\n", now_us / 1000.0, command->sequence, command->a,
+               latency_us);
+    }
+}
+
+/** Radio bus hooks ------------------------------------------------ */
+void radio_bus_setup(void) {
+}
+
+void radio_bus_retime(void) {
+}
+
+bool radio_bus_transfer(const uint8_t *tx, uint8_t *rx, uint8_t size) {
+    if (bus.busy) {
+        return false;
+    }
+
+    chip_spi(tx, bus.result, size);
+    bus.busy = true;
+    bus.rx = rx;
+    bus.size = size;
+    bus.done_us = now_us + SETUP_US + size * BYTE_US;
+    return true;
+}
+
+void radio_bus_enable(bool enabled) {
+    chip.ce = enabled;
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    int option;
+    radio_stats_t stats;
+    uint8_t sequence = 0;
+    uint32_t sent = 0;
+    uint32_t lagging = 0;
+    uint32_t acks = 0;
+
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    chip_power_on();
+    radio_init(handler);
+    run_until(BRING_UP_MS * 1000);
+    radio_get_stats(&stats);
+    printf("bring-up: state %u after %u ms\n", stats.state, BRING_UP_MS);
+    CHECK(stats.state == RADIO_STATE_RUN);
+    CHECK(chip_listening());
+
+    printf("steady: %u ms at %u Hz\n", STEADY_MS, 1000000 / COMMAND_PERIOD_US);
+    uint32_t acknowledged = stream(&sequence, STEADY_MS, &sent, &lagging, &acks);
+    printf("  %u sent, %u acknowledged, %u delivered, %u out of order, max latency %u us\n", sent,
+           acknowledged, receiver.delivered, receiver.out_of_order, receiver.max_latency_us);
+    printf("  %u acknowledgment payloads, %u with the previous sequence\n", acks, lagging);
+    CHECK(acknowledged + 1 >= sent);
+    CHECK(receiver.delivered == acknowledged);
+    CHECK(receiver.out_of_order == 0);
+    CHECK(receiver.max_latency_us < LATENCY_LIMIT_US);
+    CHECK(acks + 1 >= acknowledged);
+    CHECK(lagging + 1 >= acks);
+
+    printf("burst: 3 commands 200 us apart, 20 times\n");
+    receiver.delivered = 0;
+    for (int i = 0; i < 20; i++) {
+        radio_telemetry_t ack;
+        bool has_ack;
+        for (int j = 0; j < 3; j++) {
+            CHECK(send(sequence++, 100, &ack, &has_ack));
+            run_until(now_us + 200);
+        }
+        run_until(now_us + 50000 + i * 123);
+    }
+    printf("  %u delivered, %u out of order, max latency %u us\n", receiver.delivered, receiver.out_of_order,
+           receiver.max_latency_us);
+    CHECK(receiver.delivered == 60);
+    CHECK(receiver.out_of_order == 0);
+    CHECK(receiver.max_latency_us < LATENCY_LIMIT_US);
+
+    printf("bad: 20 payloads of 4 bytes among the commands\n");
+    receiver.delivered = 0;
+    for (int i = 0; i < 20; i++) {
+        radio_telemetry_t ack;
+        bool has_ack;
+        uint8_t bytes[4] = { 1, 2, 3, 4 };
+        send(sequence++, 100, &ack, &has_ack);
+        run_until(now_us + 5000);
+        chip_receive(bytes, sizeof(bytes), &ack, &has_ack);
+        run_until(now_us + 5000);
+    }
+    radio_get_stats(&stats);
+    printf("  %u delivered, %u invalid\n", receiver.delivered, stats.invalid);
+    CHECK(receiver.delivered == 20);
+    CHECK(stats.invalid == 20);
+    CHECK(receiver.out_of_order == 0);
+
+    printf("reset: the radio loses power\n");
+    uint32_t resets = stats.resets;
+    chip_power_on();
+    receiver.delivered = 0;
+    uint64_t lost_us = now_us;
+    uint64_t back_us = 0;
+    for (int i = 0; i < 200 && back_us == 0; i++) {
+        radio_telemetry_t ack;
+        bool has_ack;
+        uint32_t before = receiver.delivered;
+        receiver.expected = sequence;
+        send(sequence++, 100, &ack, &has_ack);
+        run_until(now_us + COMMAND_PERIOD_US);
+        if (receiver.delivered > before) {
+            back_us = now_us;
+        }
+    }
+    radio_get_stats(&stats);
+    printf("  back after %.0f ms, %u resets, %u checks\n", (back_us - lost_us) / 1000.0, stats.resets - resets,
+           stats.checks);
+    CHECK(back_us != 0);
+    CHECK(back_us - lost_us < RECOVERY_LIMIT_MS * 1000ull);
+    CHECK(stats.resets - resets == 1);
+    CHECK(stats.latency_max_ticks < LATENCY_LIMIT_US / 1000);
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? 0 : 1;
+}
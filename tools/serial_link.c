@@ -0,0 +1,191 @@
+/**
+ * @file
+ * @brief Host tool: sender and pty stand-in for the serial control channel.
+ *
+ * Listen mode creates a pseudo terminal standing in for the car, prints its
+ * path and decodes every frame written to it with the firmware parser:
+ *     serial_link -l
+ * Send mode streams drive frames to a serial device (an HC-05 bound to
+ * /dev/rfcomm0, a USB adapter, or the pty printed by listen mode):
+ *     serial_link -d /dev/pts/3 [-t] [-r rate_hz] [-c count] -- a b
+ * a/b are left/right efforts, or linear/angular efforts with -t.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc tools/serial_link.c core/src/serial_frame.c -o serial_link
+ */
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "serial_frame.h"
+
+/** Definitions --------------------------------------------------- */
+#define CRC_POLYNOMIAL  0x04C11DB7
+
+/** Internal functions -------------------------------------------- */
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void set_raw(int fd) {
+    struct termios options;
+
+    if (tcgetattr(fd, &options) == 0) {
+        cfmakeraw(&options);
+        cfsetispeed(&options, B115200);
+        cfsetospeed(&options, B115200);
+        tcsetattr(fd, TCSANOW, &options);
+    }
+}
+
+/**
+ * @brief Creates a pty and decodes the frames written to it.
+ */
+static int run_listen(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 2;
+    }
+    set_raw(master);
+
+    printf("listening on %s\n", ptsname(master));
+    fflush(stdout);
+
+    serial_frame_parser_t parser;
+    serial_frame_init(&parser);
+
+    double window_start = now_seconds();
+    uint32_t window_frames = 0;
+    uint8_t buffer[256];
+    ssize_t size;
+
+    while ((size = read(master, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < size; i++) {
+            serial_command_t command;
+
+            if (serial_frame_parse(&parser, buffer[i], &command)) {
+                window_frames++;
+                printf("seq %3u type %u a %6d b %6d\n", command.sequence, command.type, command.a, command.b);
+            }
+        }
+
+        double now = now_seconds();
+        if (now - window_start >= 1.0) {
+            printf("%.1f frames/s, %u accepted, %u crc errors\n", window_frames / (now - window_start),
+                   parser.accepted, parser.crc_errors);
+            window_start = now;
+            window_frames = 0;
+        }
+        fflush(stdout);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Streams frames with a constant setpoint.
+ */
+static int run_send(const char *path, uint8_t type, int16_t a, int16_t b, uint32_t rate_hz, uint32_t count) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return 2;
+    }
+    set_raw(fd);
+
+    serial_command_t command = { .type = type, .sequence = 0, .a = a, .b = b };
+    useconds_t period_us = 1000000 / rate_hz;
+
+    for (uint32_t n = 0; count == 0 || n < count; n++) {
+        uint8_t frame[SERIAL_FRAME_SIZE];
+
+        serial_frame_encode(&command, frame);
+        if (write(fd, frame, sizeof(frame)) != sizeof(frame)) {
+            perror("write");
+            break;
+        }
+
+        command.sequence++;
+        usleep(period_us);
+    }
+
+    close(fd);
+    return 0;
+}
+
+/** Public functions ---------------------------------------------- */
+/**
+ * @brief Software equivalent of the STM32 CRC unit.
+ */
+uint32_t serial_frame_crc(const uint32_t *words, uint32_t count) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < count; i++) {
+        crc ^= words[i];
+        for (uint8_t bit = 0; bit < 32; bit++) {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ CRC_POLYNOMIAL : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *device = NULL;
+    bool listen = false;
+    uint8_t type = SERIAL_FRAME_WHEELS;
+    uint32_t rate_hz = 50;
+    uint32_t count = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "ld:tr:c:")) != -1) {
+        switch (option) {
+            case 'l': {
+                listen = true;
+                break;
+            }
+            case 'd': {
+                device = optarg;
+                break;
+            }
+            case 't': {
+                type = SERIAL_FRAME_TWIST;
+                break;
+            }
+            case 'r': {
+                rate_hz = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            case 'c': {
+                count = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s -l | -d device [-t] [-r rate_hz] [-c count] a b\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    if (listen) {
+        return run_listen();
+    }
+
+    if (device == NULL || optind + 2 > argc || rate_hz == 0) {
+        fprintf(stderr, "usage: %s -l | -d device [-t] [-r rate_hz] [-c count] a b\n", argv[0]);
+        return 2;
+    }
+
+    return run_send(device, type, (int16_t)atoi(argv[optind]), (int16_t)atoi(argv[optind + 1]), rate_hz, count);
+}
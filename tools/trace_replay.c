@@ -0,0 +1,277 @@
+/**
+ * @file
+ * @brief Host tool: replays a dumped trace through the drive logic.
+ *
+ * Recorded keys and serial commands are posted to the arbiter at their
+ * timestamps. At every recorded PWM or note change the arbiter output is
+ * recomputed for that instant and checked against what the car wrote.
+ * Recorded emergency brake changes are applied as they happened. The drive
+ * sequencer runs with its default configuration, which must match the one
+ * the car was built with; -k replays the short-brake stops of a car whose
+ * stop parameter is set.
+ * Optionally the replay is repeated to benchmark the control logic.
+ *
+ * Build (from the repository root):
+ *     gcc -O2 -Icore/inc -Iexternal_libs/stm32f1_libs/infrared \
+ *         -Iexternal_libs/stm32f1_libs/buzzer \
+ *         tools/trace_replay.c core/src/drive.c core/src/arbiter.c \
+ *         core/src/obstacle.c core/src/compensation.c core/src/param.c -o trace_replay
+ *
+ * Capture a dump by sending 'T' to the console UART (115200 8N1) and saving
+ * the reply to a file. Leading bytes before the trace header are skipped.
+ *
+ * Usage: trace_replay [-v] [-k] [-b iterations] dump.bin
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arbiter.h"
+#include "drive.h"
+#include "obstacle.h"
+#include "serial_frame.h"
+#include "trace.h"
+
+/** Variables ----------------------------------------------------- */
+static drive_stop_t replay_stop = DRIVE_STOP_COAST;
+
+/** Prototypes ---------------------------------------------------- */
+static trace_record_t *load_trace(const char *path, uint16_t *count);
+static bool replay_input(const trace_record_t *record);
+static uint32_t replay(const trace_record_t *records, uint16_t count, bool verbose);
+static void benchmark(const trace_record_t *records, uint16_t count, uint32_t iterations);
+
+/** Internal functions -------------------------------------------- */
+/**
+ * @brief Reads a dump file and returns its records.
+ */
+static trace_record_t *load_trace(const char *path, uint16_t *count) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    static uint8_t raw[sizeof(trace_header_t) + TRACE_RECORD_COUNT * sizeof(trace_record_t) + 4096];
+    size_t size = fread(raw, 1, sizeof(raw), file);
+    fclose(file);
+
+    for (size_t offset = 0; offset + sizeof(trace_header_t) <= size; offset++) {
+        trace_header_t header;
+        memcpy(&header, &raw[offset], sizeof(header));
+
+        if (header.magic != TRACE_MAGIC) {
+            continue;
+        }
+        if (header.record_size != sizeof(trace_record_t)) {
+            fprintf(stderr, "unsupported record size %u\n", header.record_size);
+            return NULL;
+        }
+
+        size_t available = (size - offset - sizeof(header)) / sizeof(trace_record_t);
+        if (available < header.record_count) {
+            fprintf(stderr, "truncated dump: %zu of %u records\n", available, header.record_count);
+            header.record_count = (uint16_t)available;
+        }
+
+        trace_record_t *records = calloc(header.record_count + 1, sizeof(trace_record_t));
+        memcpy(records, &raw[offset + sizeof(header)], header.record_count * sizeof(trace_record_t));
+        *count = header.record_count;
+        return records;
+    }
+
+    fprintf(stderr, "no trace header found in %s\n", path);
+    return NULL;
+}
+
+/**
+ * @brief Posts a key or serial command record to the arbiter.
+ *
+ * @return false for records that are not inputs.
+ */
+static bool replay_input(const trace_record_t *record) {
+    drive_setpoint_t setpoint;
+
+    if (record->type == TRACE_TYPE_KEY) {
+        drive_key((ir_key_id_t)record->arg, &setpoint);
+        arbiter_post(ARBITER_SOURCE_REMOTE, &setpoint, record->timestamp);
+        return true;
+    }
+
+    if (record->type == TRACE_TYPE_SERIAL) {
+        if (record->arg == SERIAL_FRAME_TWIST) {
+            drive_twist((int16_t)record->value[0], (int16_t)record->value[1], &setpoint);
+        } else {
+            drive_wheels((int16_t)record->value[0], (int16_t)record->value[1], &setpoint);
+        }
+        arbiter_post(ARBITER_SOURCE_SERIAL, &setpoint, record->timestamp);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Replays the trace and reports every output change that differs
+ * from the replayed arbitration.
+ *
+ * @return Number of mismatching records.
+ */
+static uint32_t replay(const trace_record_t *records, uint16_t count, bool verbose) {
+    uint32_t mismatches = 0;
+    uint32_t inputs = 0;
+    uint32_t checks = 0;
+    bool braking = false;
+
+    drive_init(NULL);
+    drive_set_stop(replay_stop);
+    arbiter_init();
+
+    for (uint16_t i = 0; i < count; i++) {
+        const trace_record_t *record = &records[i];
+
+        if (verbose) {
+            printf("%10u ms type %u arg %3u value %4u %4u %4u %4u\n", record->timestamp, record->type,
+                   record->arg, record->value[0], record->value[1], record->value[2], record->value[3]);
+        }
+
+        if (replay_input(record)) {
+            inputs++;
+            continue;
+        }
+        if (record->type == TRACE_TYPE_BRAKE) {
+            braking = record->arg != 0;
+            if (!braking) {
+                arbiter_release(ARBITER_SOURCE_SAFETY);
+            }
+            continue;
+        }
+
+        drive_setpoint_t setpoint;
+        drive_output_t expected;
+        if (braking) {
+            /* As the car does, over what the other sources request */
+            arbiter_select_from(ARBITER_SOURCE_SERIAL, record->timestamp, &setpoint);
+            obstacle_clamp(&setpoint);
+            arbiter_post(ARBITER_SOURCE_SAFETY, &setpoint, record->timestamp);
+        }
+        arbiter_source_t source = arbiter_select(record->timestamp, &setpoint);
+        drive_output(&setpoint, record->timestamp, &expected);
+
+        switch (record->type) {
+            case TRACE_TYPE_PWM: {
+                checks++;
+                if (memcmp(expected.ccr, record->value, sizeof(expected.ccr)) != 0) {
+                    printf("%10u ms source %u: expected ccr %4u %4u %4u %4u, recorded %4u %4u %4u %4u\n",
+                           record->timestamp, source, expected.ccr[0], expected.ccr[1], expected.ccr[2],
+                           expected.ccr[3], record->value[0], record->value[1], record->value[2],
+                           record->value[3]);
+                    mismatches++;
+                }
+                break;
+            }
+            case TRACE_TYPE_NOTE: {
+                checks++;
+                if ((uint16_t)expected.note != record->arg) {
+                    printf("%10u ms source %u: expected note %u, recorded %u\n", record->timestamp, source,
+                           (uint16_t)expected.note, record->arg);
+                    mismatches++;
+                }
+                break;
+            }
+            default: {
+                fprintf(stderr, "record %u: unknown type %u\n", i, record->type);
+                break;
+            }
+        }
+    }
+
+    printf("%u records, %u inputs, %u output changes checked, %u mismatches\n", count, inputs, checks,
+           mismatches);
+    return mismatches;
+}
+
+/**
+ * @brief Measures the arbitration and drive logic cost over the trace.
+ */
+static void benchmark(const trace_record_t *records, uint16_t count, uint32_t iterations) {
+    struct timespec start, end;
+    uint32_t steps = 0;
+    volatile uint16_t sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < iterations; n++) {
+        drive_init(NULL);
+        drive_set_stop(replay_stop);
+        arbiter_init();
+
+        for (uint16_t i = 0; i < count; i++) {
+            drive_setpoint_t setpoint;
+            drive_output_t output;
+
+            replay_input(&records[i]);
+            arbiter_select(records[i].timestamp, &setpoint);
+            drive_output(&setpoint, records[i].timestamp, &output);
+            sink += output.ccr[DRIVE_CHANNEL_2];
+            steps++;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    if (steps > 0) {
+        printf("%u records replayed, %.1f ns per record\n", steps, elapsed_ns / steps);
+    }
+}
+
+/** Public functions ---------------------------------------------- */
+int main(int argc, char *argv[]) {
+    bool verbose = false;
+    uint32_t iterations = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "vkb:")) != -1) {
+        switch (option) {
+            case 'v': {
+                verbose = true;
+                break;
+            }
+            case 'k': {
+                replay_stop = DRIVE_STOP_BRAKE;
+                break;
+            }
+            case 'b': {
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            }
+            default: {
+                fprintf(stderr, "usage: %s [-v] [-k] [-b iterations] dump.bin\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "usage: %s [-v] [-k] [-b iterations] dump.bin\n", argv[0]);
+        return 2;
+    }
+
+    uint16_t count = 0;
+    trace_record_t *records = load_trace(argv[optind], &count);
+    if (records == NULL) {
+        return 2;
+    }
+
+    uint32_t mismatches = replay(records, count, verbose);
+
+    if (iterations > 0) {
+        benchmark(records, count, iterations);
+    }
+
+    free(records);
+    return mismatches == 0 ? 0 : 1;
+}